@@ -24,19 +24,16 @@
 static LCFGChange lcfgbdb_get_resource_item( DB * dbh,
                                              LCFGResource * res,
                                              const char * comp_name,
-                                             const char * namespace,
                                              char type_symbol,
-                                             char ** keybuf,
-                                             size_t * keybufsize,
+                                             LCFGResourceKeyBuffer * keybuf,
                                              char ** msg ) {
   assert( res != NULL );
 
-  ssize_t keylen = lcfgresource_build_key( res->name,
-                                           comp_name, namespace,
-                                           type_symbol,
-                                           keybuf, keybufsize );
+  size_t keylen = 0;
+  const char * keystr = lcfgresource_keybuf_get_key( keybuf, type_symbol,
+                                                     &keylen );
 
-  if ( keylen < 0 ) {
+  if ( keystr == NULL ) {
     *msg = lcfgresource_build_message( res, comp_name,
                                        "Failed to retrieve data from DB" );
     return LCFG_CHANGE_ERROR;
@@ -49,7 +46,7 @@ static LCFGChange lcfgbdb_get_resource_item( DB * dbh,
   memset( &key,  0, sizeof(DBT) );
   memset( &data, 0, sizeof(DBT) );
 
-  key.data = *keybuf;
+  key.data = (char *) keystr;
   key.size = (u_int32_t) keylen;
 
   int ret = dbh->get( dbh, NULL, &key, &data, 0 );
@@ -87,7 +84,12 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
   LCFGStatus status = LCFG_STATUS_OK;
   LCFGComponent * component = NULL;
   char * reslist = NULL;
-  char * keybuf  = NULL;
+
+  /* The namespace and component name prefix for the keys is only
+     stored once, the name of each resource is then copied in and all
+     the keys for the resource are taken from the same buffer. */
+
+  LCFGResourceKeyBuffer keybuf = { NULL, 0, 0, 0 };
 
   int ret;
   DBT key, data;
@@ -134,12 +136,10 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
     goto cleanup;
   }
 
-  size_t keybufsize = 512;
-  keybuf = calloc( keybufsize, sizeof(char) );
-  if ( keybuf == NULL ) {
-    perror("Failed to allocate memory for DB key buffer");
-    exit(EXIT_FAILURE);
-  }
+  if ( options&LCFG_OPT_USE_ARENA )
+    lcfgcomponent_use_arena(component);
+
+  lcfgresource_keybuf_init( &keybuf, comp_name, namespace );
 
   char * saveptr = NULL;
   char * resname = strtok_r( reslist, " ", &saveptr );
@@ -151,12 +151,9 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
       break;
     }
 
-    LCFGResource * res = lcfgresource_new();
-
-    char * resname_copy = strdup(resname);
-    if ( !lcfgresource_set_name( res, resname_copy ) ) {
-      free(resname_copy);
+    LCFGResource * res = lcfgcomponent_new_resource(component);
 
+    if ( !lcfgresource_set_name_copy( res, resname ) ) {
       status = LCFG_STATUS_ERROR;
       lcfgutils_build_message( msg, "Failed to set resource name '%s.%s'",
                                comp_name, resname );
@@ -165,15 +162,22 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
 
     LCFGChange res_change = LCFG_CHANGE_NONE;
 
+    if ( lcfgresource_keybuf_set_name( &keybuf, resname ) < 0 ) {
+      status = LCFG_STATUS_ERROR;
+      lcfgutils_build_message( msg, "Failed to build key for resource '%s.%s'",
+                               comp_name, resname );
+      goto local_cleanup;
+    }
+
     if ( use_meta ) {
 
       /* Derivation */
 
       LCFGChange deriv_change =
         lcfgbdb_get_resource_item( dbh, res, 
-                                   comp_name, namespace,
+                                   comp_name,
                                    LCFG_RESOURCE_SYMBOL_DERIVATION,
-                                   &keybuf, &keybufsize, msg );
+                                   &keybuf, msg );
 
       if ( deriv_change == LCFG_CHANGE_ERROR ) {
         res_change = LCFG_CHANGE_ERROR;
@@ -186,9 +190,9 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
 
       LCFGChange context_change =
         lcfgbdb_get_resource_item( dbh, res, 
-                                   comp_name, namespace,
+                                   comp_name,
                                    LCFG_RESOURCE_SYMBOL_CONTEXT,
-                                   &keybuf, &keybufsize, msg );
+                                   &keybuf, msg );
 
       if ( context_change == LCFG_CHANGE_ERROR ) {
         res_change = LCFG_CHANGE_ERROR;
@@ -201,9 +205,9 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
 
       LCFGChange prio_change =
         lcfgbdb_get_resource_item( dbh, res, 
-                                   comp_name, namespace,
+                                   comp_name,
                                    LCFG_RESOURCE_SYMBOL_PRIORITY,
-                                   &keybuf, &keybufsize, msg );
+                                   &keybuf, msg );
 
       if ( prio_change == LCFG_CHANGE_ERROR ) {
         res_change = LCFG_CHANGE_ERROR;
@@ -218,9 +222,9 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
 
     LCFGChange type_change =
       lcfgbdb_get_resource_item( dbh, res, 
-                                 comp_name, namespace,
+                                 comp_name,
                                  LCFG_RESOURCE_SYMBOL_TYPE,
-                                 &keybuf, &keybufsize, msg );
+                                 &keybuf, msg );
 
     if ( type_change == LCFG_CHANGE_ERROR ) {
       res_change = LCFG_CHANGE_ERROR;
@@ -233,9 +237,9 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
 
     LCFGChange value_change =
       lcfgbdb_get_resource_item( dbh, res, 
-				 comp_name, namespace,
+				 comp_name,
 				 LCFG_RESOURCE_SYMBOL_VALUE,
-				 &keybuf, &keybufsize, msg );
+				 &keybuf, msg );
 
     if ( value_change == LCFG_CHANGE_ERROR ) {
       res_change = LCFG_CHANGE_ERROR;
@@ -279,7 +283,7 @@ static LCFGStatus lcfgbdb_process_component( DB * dbh,
  cleanup:
 
   free(reslist);
-  free(keybuf);
+  lcfgresource_keybuf_clear(&keybuf);
 
   if ( status == LCFG_STATUS_ERROR ) {
     lcfgcomponent_relinquish(component);
@@ -458,6 +462,10 @@ static LCFGStatus lcfgbdb_process_components( DB * dbh,
  * profile for comparison with a 'new' one when the old file might
  * legitimately not exist.
  *
+ * If the @c LCFG_OPT_USE_ARENA option is specified then the resources
+ * for each component are allocated from an arena owned by the
+ * component, see @c lcfgcomponent_use_arena() for details.
+ *
  * @param[in] filename Path to the Berkeley DB file.
  * @param[out] result Reference to the pointer for the @c LCFGProfile struct.
  * @param[in] comps_wanted List of allowed component names.
@@ -555,6 +563,10 @@ LCFGStatus lcfgprofile_from_bdb( const char * filename,
  * when loading an 'old' profile for comparison with a 'new' one when
  * the old file might legitimately not exist.
  *
+ * If the @c LCFG_OPT_USE_ARENA option is specified then the resources
+ * are allocated from an arena owned by the component, see
+ * @c lcfgcomponent_use_arena() for details.
+ *
  * @param[in] filename Path to the Berkeley DB file.
  * @param[out] result Reference to the pointer for the @c LCFGComponent struct.
  * @param[in] comp_name Name of required component
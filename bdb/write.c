@@ -100,15 +100,14 @@ LCFGStatus lcfgcomponent_to_bdb( const LCFGComponent * component,
   LCFGTagList * stored_res = lcfgtaglist_new();
 
   /* This is used (and reused) as a buffer for all the resource keys
-     to avoid allocating and freeing lots of memory. */
+     to avoid allocating and freeing lots of memory. The namespace and
+     component name prefix is only stored once, for each resource the
+     name is copied in and then all the keys are taken from the same
+     buffer. */
 
-  ssize_t key_len = 0;
-  size_t key_size = 64;
-  char * key_buf = calloc( key_size, sizeof(char) );
-  if ( key_buf == NULL ) {
-    perror("Failed to allocate memory for data buffer");
-    exit(EXIT_FAILURE);
-  }
+  size_t key_len = 0;
+  LCFGResourceKeyBuffer key_buf;
+  lcfgresource_keybuf_init( &key_buf, compname, namespace );
 
   ssize_t val_len = 0;
   size_t val_size = 16384;
@@ -127,6 +126,13 @@ LCFGStatus lcfgcomponent_to_bdb( const LCFGComponent * component,
   const LCFGResource * resource = NULL;
   while ( ( resource = lcfgcompiter_next(compiter) ) != NULL ) {
 
+    if ( lcfgresource_keybuf_set_name( &key_buf, resource->name ) < 0 ) {
+      status = LCFG_STATUS_ERROR;
+      *msg = lcfgresource_build_message( resource, compname,
+                                         "Failed to build resource key" );
+      break;
+    }
+
     /* Derivation */
 
     if ( lcfgresource_has_derivation(resource) ) {
@@ -134,20 +140,9 @@ LCFGStatus lcfgcomponent_to_bdb( const LCFGComponent * component,
       memset( &key,  0, sizeof(DBT) );
       memset( &data, 0, sizeof(DBT) );
 
-      key_len = lcfgresource_build_key( resource->name,
-                                        compname,
-                                        namespace,
-                                        LCFG_RESOURCE_SYMBOL_DERIVATION,
-                                        &key_buf, &key_size );
-
-      if ( key_len < 0 ) {
-        status = LCFG_STATUS_ERROR;
-        *msg = lcfgresource_build_message( resource, compname,
-                                           "Failed to build derivation key" );
-        break;
-      }
-
-      key.data = key_buf;
+      key.data = (char *)
+        lcfgresource_keybuf_get_key( &key_buf, LCFG_RESOURCE_SYMBOL_DERIVATION,
+                                     &key_len );
       key.size = (u_int32_t) key_len;
 
       val_len = lcfgresource_get_derivation_as_string( resource, LCFG_OPT_NONE,
@@ -182,20 +177,9 @@ LCFGStatus lcfgcomponent_to_bdb( const LCFGComponent * component,
       memset( &key,  0, sizeof(DBT) );
       memset( &data, 0, sizeof(DBT) );
 
-      key_len = lcfgresource_build_key( resource->name,
-                                       compname,
-                                       namespace,
-                                       LCFG_RESOURCE_SYMBOL_TYPE,
-                                       &key_buf, &key_size );
-
-      if ( key_len < 0 ) {
-        status = LCFG_STATUS_ERROR;
-        *msg = lcfgresource_build_message( resource, compname,
-                                           "Failed to build type key" );
-        break;
-      }
-
-      key.data = key_buf;
+      key.data = (char *)
+        lcfgresource_keybuf_get_key( &key_buf, LCFG_RESOURCE_SYMBOL_TYPE,
+                                     &key_len );
       key.size = (u_int32_t) key_len;
 
       val_len = lcfgresource_get_type_as_string( resource, LCFG_OPT_NONE,
@@ -230,20 +214,9 @@ LCFGStatus lcfgcomponent_to_bdb( const LCFGComponent * component,
       memset( &key,  0, sizeof(DBT) );
       memset( &data, 0, sizeof(DBT) );
 
-      key_len = lcfgresource_build_key( resource->name,
-                                       compname,
-                                       namespace,
-                                       LCFG_RESOURCE_SYMBOL_CONTEXT,
-                                       &key_buf, &key_size );
-
-      if ( key_len < 0 ) {
-        status = LCFG_STATUS_ERROR;
-        *msg = lcfgresource_build_message( resource, compname,
-                                           "Failed to build context key" );
-        break;
-      }
-
-      key.data = key_buf;
+      key.data = (char *)
+        lcfgresource_keybuf_get_key( &key_buf, LCFG_RESOURCE_SYMBOL_CONTEXT,
+                                     &key_len );
       key.size = (u_int32_t) key_len;
 
       const char * context = lcfgresource_get_context(resource);
@@ -271,20 +244,9 @@ LCFGStatus lcfgcomponent_to_bdb( const LCFGComponent * component,
       memset( &key,  0, sizeof(DBT) );
       memset( &data, 0, sizeof(DBT) );
 
-      key_len = lcfgresource_build_key( resource->name,
-                                       compname,
-                                       namespace,
-                                       LCFG_RESOURCE_SYMBOL_PRIORITY,
-                                       &key_buf, &key_size );
-
-      if ( key_len < 0 ) {
-        status = LCFG_STATUS_ERROR;
-        *msg = lcfgresource_build_message( resource, compname,
-                                           "Failed to build priority key" );
-        break;
-      }
-
-      key.data = key_buf;
+      key.data = (char *)
+        lcfgresource_keybuf_get_key( &key_buf, LCFG_RESOURCE_SYMBOL_PRIORITY,
+                                     &key_len );
       key.size = (u_int32_t) key_len;
 
       val_len = lcfgresource_get_priority_as_string( resource, LCFG_OPT_NONE,
@@ -316,20 +278,9 @@ LCFGStatus lcfgcomponent_to_bdb( const LCFGComponent * component,
     memset( &key,  0, sizeof(DBT) );
     memset( &data, 0, sizeof(DBT) );
 
-    key_len = lcfgresource_build_key( resource->name,
-                                     compname,
-                                     namespace,
-                                     LCFG_RESOURCE_SYMBOL_VALUE,
-                                     &key_buf, &key_size );
-
-    if ( key_len < 0 ) {
-      status = LCFG_STATUS_ERROR;
-      *msg = lcfgresource_build_message( resource, compname,
-					 "Failed to build value key" );
-      break;
-    }
-
-    key.data = key_buf;
+    key.data = (char *)
+      lcfgresource_keybuf_get_key( &key_buf, LCFG_RESOURCE_SYMBOL_VALUE,
+                                   &key_len );
     key.size = (u_int32_t) key_len;
 
     const char * value;
@@ -406,7 +357,7 @@ LCFGStatus lcfgcomponent_to_bdb( const LCFGComponent * component,
 
   lcfgcompiter_destroy(compiter);
   lcfgtaglist_relinquish(stored_res);
-  free(key_buf);
+  lcfgresource_keybuf_clear(&key_buf);
   free(val_buf);
 
   return status;
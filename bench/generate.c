@@ -0,0 +1,374 @@
+/**
+ * @file bench/generate.c
+ * @brief Synthetic LCFG XML profiles and timing for benchmarks
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "generate.h"
+
+/* Source files are picked from a fixed pool so that derivations
+   share strings in the way they do for real profiles */
+
+#define LCFGBENCH_HEADERS 200
+
+/* Roughly one in this many resources and packages is given (in
+   later versions) a changed value */
+
+#define LCFGBENCH_CHANGE_RATE  20
+
+/* A simple xorshift generator is used rather than rand() so that the
+   same profile is generated on every platform */
+
+static uint64_t lcfgbench_random( uint64_t * state ) {
+
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+
+  return x * UINT64_C(2685821657736338717);
+}
+
+/**
+ * @brief Set the default parameters
+ *
+ * This sets the parameters to values which give a profile similar
+ * in size to that of a typical managed machine.
+ *
+ * @param[in] params Pointer to @c LCFGBenchParams
+ *
+ */
+
+void lcfgbench_default_params( LCFGBenchParams * params ) {
+  assert( params != NULL );
+
+  params->components   = 50;
+  params->first        = 0;
+  params->changed      = 0;
+  params->resources    = 200;
+  params->list_depth   = 2;
+  params->list_size    = 5;
+  params->fanout       = 3;
+  params->packages     = 2000;
+  params->contexts     = 10;
+  params->context_rate = 10;
+  params->seed         = 1;
+}
+
+static void lcfgbench_write_derivation( FILE * fh,
+                                        const LCFGBenchParams * params,
+                                        uint64_t * state ) {
+
+  fputs( " cfg:derivation=\"", fh );
+
+  unsigned int i;
+  for ( i=0; i<params->fanout; i++ ) {
+    unsigned int header = lcfgbench_random(state) % LCFGBENCH_HEADERS;
+    unsigned int line   = lcfgbench_random(state) % 500 + 1;
+
+    fprintf( fh, "%s/var/lcfg/conf/server/headers/header%u.h:%u",
+             ( i > 0 ? " " : "" ), header, line );
+  }
+
+  fputs( "\"", fh );
+}
+
+static void lcfgbench_write_context( FILE * fh,
+                                     const LCFGBenchParams * params,
+                                     uint64_t * state ) {
+
+  unsigned int ctx1 = lcfgbench_random(state) % params->contexts;
+  unsigned int ctx2 = lcfgbench_random(state) % params->contexts;
+
+  fputs( " cfg:context=\"", fh );
+
+  switch ( lcfgbench_random(state) % 3 ) {
+  case 0:
+    fprintf( fh, LCFGBENCH_CONTEXT_FORMAT, ctx1 );
+    break;
+  case 1:
+    fprintf( fh, LCFGBENCH_CONTEXT_FORMAT " &amp; !" LCFGBENCH_CONTEXT_FORMAT,
+             ctx1, ctx2 );
+    break;
+  default:
+    fprintf( fh, LCFGBENCH_CONTEXT_FORMAT " | " LCFGBENCH_CONTEXT_FORMAT,
+             ctx1, ctx2 );
+    break;
+  }
+
+  fputs( "\"", fh );
+}
+
+static void lcfgbench_write_resource( FILE * fh,
+                                      const LCFGBenchParams * params,
+                                      unsigned int comp, unsigned int res,
+                                      bool changed, uint64_t * state ) {
+
+  fprintf( fh, "<res%u", res );
+  lcfgbench_write_derivation( fh, params, state );
+
+  const char * suffix = changed ? " changed" : "";
+
+  switch ( res % 5 ) {
+  case 0:
+    fprintf( fh, " cfg:type=\"boolean\">%s</res%u>\n",
+             ( changed ? "no" : "yes" ), res );
+    break;
+  case 1:
+    fprintf( fh, " cfg:type=\"integer\">%u</res%u>\n",
+             res + ( changed ? 1 : 0 ), res );
+    break;
+  case 2:
+    fprintf( fh, ">/etc/comp%u/file%u.conf%s</res%u>\n",
+             comp, res, suffix, res );
+    break;
+  case 3:
+    fprintf( fh, ">a longer value with spaces &amp; entities %u%s</res%u>\n",
+             res, suffix, res );
+    break;
+  default:
+    fprintf( fh, ">%s</res%u>\n", suffix, res );
+    break;
+  }
+
+}
+
+/* Each level of a nested list has one value and (except at the
+   bottom) one sub-list per record, the placeholder count increases
+   with the depth. For a depth of 2 the top list has a template of
+   "val1_$ list2_$" and the sub-list has "val2_$_$" (as the name of
+   the sub-list is given in the template for the level above it only
+   has as many placeholders as that level). */
+
+static void lcfgbench_write_template( FILE * fh, const char * name,
+                                      unsigned int index,
+                                      unsigned int level ) {
+
+  fprintf( fh, "%s%u", name, index );
+
+  unsigned int i;
+  for ( i=0; i<level; i++ )
+    fputs( "_$", fh );
+
+}
+
+static void lcfgbench_write_list( FILE * fh,
+                                  const LCFGBenchParams * params,
+                                  unsigned int level,
+                                  bool changed, uint64_t * state ) {
+
+  fprintf( fh, "<list%u cfg:template=\"", level );
+  lcfgbench_write_template( fh, "val", level, level );
+  if ( level < params->list_depth ) {
+    fputs( " ", fh );
+    lcfgbench_write_template( fh, "list", level + 1, level );
+  }
+  fputs( "\"", fh );
+
+  if ( level == 1 )
+    lcfgbench_write_derivation( fh, params, state );
+
+  fputs( ">", fh );
+
+  unsigned int i;
+  for ( i=0; i<params->list_size; i++ ) {
+    fprintf( fh, "<list%u_RECORD cfg:name=\"t%u\"><val%u>%u%s</val%u>",
+             level, i, level, i, ( changed && i == 0 ? " changed" : "" ),
+             level );
+
+    if ( level < params->list_depth )
+      lcfgbench_write_list( fh, params, level + 1, changed, state );
+
+    fprintf( fh, "</list%u_RECORD>", level );
+  }
+
+  fprintf( fh, "</list%u>\n", level );
+}
+
+static void lcfgbench_write_component( FILE * fh,
+                                       const LCFGBenchParams * params,
+                                       unsigned int version,
+                                       unsigned int comp,
+                                       uint64_t * state ) {
+
+  /* Only the first few components differ if the number is limited */
+
+  if ( params->changed > 0 && comp - params->first >= params->changed )
+    version = 1;
+
+  fprintf( fh, "<comp%u>\n", comp );
+
+  unsigned int res;
+  for ( res=0; res<params->resources; res++ ) {
+
+    /* The random numbers are always used in the same sequence
+       whatever the version so that the only differences between
+       versions are the changed values */
+
+    bool changed =
+      ( lcfgbench_random(state) % LCFGBENCH_CHANGE_RATE == 0 && version > 1 );
+
+    lcfgbench_write_resource( fh, params, comp, res, changed, state );
+
+    if ( params->contexts > 0 && params->context_rate > 0 &&
+         lcfgbench_random(state) % params->context_rate == 0 ) {
+
+      fprintf( fh, "<res%u", res );
+      lcfgbench_write_context( fh, params, state );
+      lcfgbench_write_derivation( fh, params, state );
+
+      if ( res % 5 == 0 )
+        fprintf( fh, " cfg:type=\"boolean\">no</res%u>\n", res );
+      else if ( res % 5 == 1 )
+        fprintf( fh, " cfg:type=\"integer\">0</res%u>\n", res );
+      else
+        fprintf( fh, ">context value %u</res%u>\n", res, res );
+    }
+
+  }
+
+  if ( params->list_depth > 0 ) {
+    bool changed =
+      ( lcfgbench_random(state) % LCFGBENCH_CHANGE_RATE == 0 && version > 1 );
+
+    lcfgbench_write_list( fh, params, 1, changed, state );
+  }
+
+  fprintf( fh, "</comp%u>\n", comp );
+}
+
+static void lcfgbench_write_package( FILE * fh,
+                                     const LCFGBenchParams * params,
+                                     unsigned int pkg, unsigned int release,
+                                     bool with_context, uint64_t * state ) {
+
+  fputs( "<package", fh );
+  lcfgbench_write_derivation( fh, params, state );
+  if ( with_context )
+    lcfgbench_write_context( fh, params, state );
+
+  fprintf( fh, "><name>bench-package%u</name><v>%u.%u.%u</v>",
+           pkg, pkg % 7 + 1, pkg % 13, pkg % 31 );
+
+  switch ( pkg % 4 ) {
+  case 0:
+    fprintf( fh, "<r>%u.el7/noarch</r>", release );
+    break;
+  case 1:
+    fprintf( fh, "<r>%u.el7/x86_64</r>", release );
+    break;
+  default:
+    fprintf( fh, "<r>%u.el7</r>", release );
+    break;
+  }
+
+  fputs( "</package>\n", fh );
+}
+
+/**
+ * @brief Write a synthetic XML profile
+ *
+ * This writes an LCFG XML profile with the size and shape given in
+ * the @c LCFGBenchParams to the specified file. The profile is
+ * deterministic, the same parameters and version will always produce
+ * exactly the same file.
+ *
+ * Later versions of the profile (any version greater than 1) differ
+ * from the first only in that about one in twenty of the resource
+ * values and package releases are changed. This makes it possible to
+ * benchmark comparisons of profiles. The changes can be limited to
+ * the first few components with the @e changed parameter.
+ *
+ * The components are numbered from the @e first parameter so that a
+ * file holding only some of the components of a larger profile can
+ * be written (e.g. for overrides). Note that the derivations and
+ * contexts will not match those in the larger profile.
+ *
+ * @param[in] params Pointer to @c LCFGBenchParams
+ * @param[in] version Version of the profile
+ * @param[in] filename Path of file to be created
+ *
+ * @return Boolean which indicates success
+ *
+ */
+
+bool lcfgbench_write_profile( const LCFGBenchParams * params,
+                              unsigned int version,
+                              const char * filename ) {
+  assert( params != NULL );
+  assert( filename != NULL );
+
+  FILE * fh = fopen( filename, "w" );
+  if ( fh == NULL ) return false;
+
+  /* xorshift has a fixed point at zero so that is not a usable seed */
+
+  uint64_t state = params->seed != 0 ? params->seed : 1;
+
+  fputs( "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+         "<lcfg xmlns:cfg=\"http://www.lcfg.org/namespace/profile-1.2\">\n"
+         "<components>\n", fh );
+
+  unsigned int comp;
+  for ( comp=params->first; comp<params->first + params->components; comp++ )
+    lcfgbench_write_component( fh, params, version, comp, &state );
+
+  fputs( "</components>\n<packages>\n", fh );
+
+  unsigned int pkg;
+  for ( pkg=0; pkg<params->packages; pkg++ ) {
+    bool changed =
+      ( lcfgbench_random(&state) % LCFGBENCH_CHANGE_RATE == 0 && version > 1 );
+
+    lcfgbench_write_package( fh, params, pkg, ( changed ? 2 : 1 ),
+                             false, &state );
+
+    /* A second release which is only wanted in some contexts */
+
+    if ( params->contexts > 0 && params->context_rate > 0 &&
+         lcfgbench_random(&state) % params->context_rate == 0 )
+      lcfgbench_write_package( fh, params, pkg, 3, true, &state );
+  }
+
+  fputs( "</packages>\n</lcfg>\n", fh );
+
+  bool ok = !ferror(fh);
+  if ( fclose(fh) != 0 ) ok = false;
+
+  return ok;
+}
+
+/**
+ * @brief Time elapsed since the start of a step
+ *
+ * The start time must have been taken with @c clock_gettime() using
+ * the @c CLOCK_MONOTONIC clock.
+ *
+ * @param[in] start Pointer to the start time
+ *
+ * @return Elapsed time in milliseconds
+ *
+ */
+
+double lcfgbench_elapsed( const struct timespec * start ) {
+  assert( start != NULL );
+
+  struct timespec end;
+  clock_gettime( CLOCK_MONOTONIC, &end );
+
+  return ( end.tv_sec - start->tv_sec ) * 1e3 +
+         ( end.tv_nsec - start->tv_nsec ) / 1e6;
+}
+
+/* eof */
@@ -0,0 +1,58 @@
+/**
+ * @file bench/generate.h
+ * @brief Synthetic LCFG XML profiles and timing for benchmarks
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#ifndef LCFG_CORE_BENCH_GENERATE_H
+#define LCFG_CORE_BENCH_GENERATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/* The names of the contexts used in the profile, only those with an
+   even index are expected to be set when the profile is loaded */
+
+#define LCFGBENCH_CONTEXT_FORMAT "bench%u"
+
+/**
+ * @brief Parameters for a synthetic profile
+ *
+ * The same parameters (including the seed) always produce exactly
+ * the same profile so that benchmark results can be compared between
+ * releases.
+ */
+
+struct LCFGBenchParams {
+  /*@{*/
+  unsigned int components;    /**< Number of components */
+  unsigned int first;         /**< Number used in the name of the first component */
+  unsigned int changed;       /**< Number of components which differ in later versions (zero for all) */
+  unsigned int resources;     /**< Number of simple resources per component */
+  unsigned int list_depth;    /**< Depth of the nested list resource (zero for none) */
+  unsigned int list_size;     /**< Number of records at each level of a list */
+  unsigned int fanout;        /**< Number of source files in each derivation */
+  unsigned int packages;      /**< Number of packages */
+  unsigned int contexts;      /**< Number of contexts */
+  unsigned int context_rate;  /**< One in this many resources and packages has a value for a context */
+  uint64_t seed;              /**< Seed for the pseudo-random generator */
+  /*@}*/
+};
+
+typedef struct LCFGBenchParams LCFGBenchParams;
+
+void lcfgbench_default_params( LCFGBenchParams * params );
+
+bool lcfgbench_write_profile( const LCFGBenchParams * params,
+                              unsigned int version,
+                              const char * filename );
+
+double lcfgbench_elapsed( const struct timespec * start );
+
+#endif /* LCFG_CORE_BENCH_GENERATE_H */
+
+/* eof */
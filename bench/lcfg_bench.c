@@ -0,0 +1,604 @@
+/**
+ * @file bench/lcfg_bench.c
+ * @brief End-to-end benchmark for loading and storing LCFG profiles
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ *
+ * Two versions of a synthetic profile are generated (see generate.c)
+ * in a temporary directory and the time taken for each of the common
+ * operations on a profile is measured over a number of rounds. The
+ * results are written as JSON so they can be compared between
+ * releases.
+ */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <dirent.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "context.h"
+#include "tags.h"
+#include "profile.h"
+#include "differences.h"
+#include "xml.h"
+#include "bdb.h"
+#include "generate.h"
+
+#ifndef LCFG_CORE_VERSION
+#define LCFG_CORE_VERSION "unknown"
+#endif
+
+#define LCFGBENCH_NAMESPACE "bench"
+#define LCFGBENCH_DEFARCH   "x86_64"
+
+struct LCFGBenchState {
+  const LCFGBenchParams * params;
+  char * xml_file;                 /**< First version of the profile */
+  char * xml_file2;                /**< Second version of the profile */
+  char * bdb_file;
+  char * status_dir;
+  char * rpmcfg_file;
+  LCFGContextList * ctxlist;
+  LCFGProfile * profile;           /**< Most recent load of first version */
+  LCFGProfile * profile2;          /**< Second version, loaded once */
+};
+
+typedef struct LCFGBenchState LCFGBenchState;
+
+typedef bool (*LCFGBenchFunc)( LCFGBenchState * state, double * time,
+                               char ** msg );
+
+struct LCFGBenchStep {
+  const char * name;
+  LCFGBenchFunc func;
+  double min;
+  double max;
+  double total;
+};
+
+typedef struct LCFGBenchStep LCFGBenchStep;
+
+static size_t count_components( const LCFGProfile * profile ) {
+  return ( profile != NULL && profile->components != NULL ?
+           profile->components->entries : 0 );
+}
+
+static unsigned int count_packages( const LCFGPackageSet * pkgset ) {
+  return ( pkgset != NULL ? lcfgpkgset_size(pkgset) : 0 );
+}
+
+static void remove_status_dir( const char * dir ) {
+
+  DIR * dh = opendir(dir);
+  if ( dh == NULL ) return;
+
+  struct dirent * entry;
+  while ( ( entry = readdir(dh) ) != NULL ) {
+    if ( entry->d_name[0] == '.' ) continue;
+
+    char * path = lcfgutils_catfile( dir, entry->d_name );
+    unlink(path);
+    free(path);
+  }
+
+  closedir(dh);
+  rmdir(dir);
+}
+
+/* Each step does any preparation which should not be included in
+   the time before starting the clock */
+
+static bool bench_xml_load( LCFGBenchState * state, double * time,
+                            char ** msg ) {
+
+  lcfgprofile_destroy(state->profile);
+  state->profile = NULL;
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGStatus rc = lcfgprofile_from_xml( state->xml_file, &(state->profile),
+                                        NULL, NULL, state->ctxlist, NULL,
+                                        false, msg );
+
+  *time = lcfgbench_elapsed(&start);
+
+  return ( rc == LCFG_STATUS_OK );
+}
+
+static bool bench_xml_load_parallel( LCFGBenchState * state, double * time,
+                                     char ** msg ) {
+
+  LCFGProfile * profile = NULL;
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGStatus rc = lcfgprofile_from_xml_parallel( state->xml_file, &profile,
+                                                 NULL, NULL, state->ctxlist,
+                                                 NULL, false, msg );
+
+  *time = lcfgbench_elapsed(&start);
+
+  bool ok = ( rc == LCFG_STATUS_OK );
+  if ( ok &&
+       count_components(profile) != count_components(state->profile) ) {
+    lcfgutils_build_message( msg, "Different components loaded in parallel" );
+    ok = false;
+  }
+
+  lcfgprofile_destroy(profile);
+
+  return ok;
+}
+
+static bool bench_bdb_write( LCFGBenchState * state, double * time,
+                             char ** msg ) {
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGStatus rc = lcfgprofile_to_bdb( state->profile, LCFGBENCH_NAMESPACE,
+                                      state->bdb_file, msg );
+
+  *time = lcfgbench_elapsed(&start);
+
+  return ( rc == LCFG_STATUS_OK );
+}
+
+static bool bench_bdb_read( LCFGBenchState * state, double * time,
+                            char ** msg ) {
+
+  LCFGProfile * profile = NULL;
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGStatus rc = lcfgprofile_from_bdb( state->bdb_file, &profile, NULL,
+                                        LCFGBENCH_NAMESPACE, LCFG_OPT_NONE,
+                                        msg );
+
+  *time = lcfgbench_elapsed(&start);
+
+  lcfgprofile_destroy(profile);
+
+  return ( rc == LCFG_STATUS_OK );
+}
+
+static bool bench_status_write( LCFGBenchState * state, double * time,
+                                char ** msg ) {
+
+  /* Status files are only replaced when they differ so always start
+     with an empty directory. The contexts have already been
+     evaluated and the status file reader does not accept them. */
+
+  remove_status_dir(state->status_dir);
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGStatus rc = lcfgprofile_to_status_dir( state->profile,
+                                             state->status_dir,
+                                             LCFG_OPT_NOCONTEXT, msg );
+
+  *time = lcfgbench_elapsed(&start);
+
+  return ( rc == LCFG_STATUS_OK );
+}
+
+static bool bench_status_read( LCFGBenchState * state, double * time,
+                               char ** msg ) {
+
+  LCFGProfile * profile = NULL;
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGStatus rc = lcfgprofile_from_status_dir( state->status_dir, &profile,
+                                               NULL, LCFG_OPT_NONE, msg );
+
+  *time = lcfgbench_elapsed(&start);
+
+  lcfgprofile_destroy(profile);
+
+  return ( rc == LCFG_STATUS_OK );
+}
+
+static bool bench_diff( LCFGBenchState * state, double * time,
+                        char ** msg ) {
+
+  LCFGDiffProfile * diff = NULL;
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGChange change = lcfgprofile_diff( state->profile, state->profile2,
+                                        &diff );
+
+  *time = lcfgbench_elapsed(&start);
+
+  lcfgdiffprofile_destroy(diff);
+
+  if ( change == LCFG_CHANGE_ERROR ) {
+    lcfgutils_build_message( msg, "Failed to compare profiles" );
+    return false;
+  }
+
+  return true;
+}
+
+static bool bench_signature( LCFGBenchState * state, double * time,
+                             char ** msg ) {
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  char * signature = lcfgprofile_signature(state->profile);
+
+  *time = lcfgbench_elapsed(&start);
+
+  if ( signature == NULL ) {
+    lcfgutils_build_message( msg, "Failed to generate profile signature" );
+    return false;
+  }
+
+  free(signature);
+
+  return true;
+}
+
+static bool bench_rpmcfg( LCFGBenchState * state, double * time,
+                          char ** msg ) {
+
+  /* The file is only replaced when it differs so always remove it */
+
+  unlink(state->rpmcfg_file);
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGChange change = lcfgprofile_write_rpmcfg( state->profile,
+                                                LCFGBENCH_DEFARCH,
+                                                state->rpmcfg_file,
+                                                NULL, msg );
+
+  *time = lcfgbench_elapsed(&start);
+
+  return ( change != LCFG_CHANGE_ERROR );
+}
+
+/* The steps are run in this order in each round, later steps use the
+   profile loaded by the first */
+
+static LCFGBenchStep steps[] = {
+  { "xml_load",          bench_xml_load,          0, 0, 0 },
+  { "xml_load_parallel", bench_xml_load_parallel, 0, 0, 0 },
+  { "bdb_write",         bench_bdb_write,         0, 0, 0 },
+  { "bdb_read",          bench_bdb_read,          0, 0, 0 },
+  { "status_dir_write",  bench_status_write,      0, 0, 0 },
+  { "status_dir_read",   bench_status_read,       0, 0, 0 },
+  { "diff",              bench_diff,              0, 0, 0 },
+  { "signature",         bench_signature,         0, 0, 0 },
+  { "rpmcfg",            bench_rpmcfg,            0, 0, 0 },
+  { NULL,                NULL,                    0, 0, 0 }
+};
+
+/* Contexts with an even index are set, the others are not so that
+   some context expressions in the profile are false */
+
+static LCFGContextList * make_contexts( unsigned int count ) {
+
+  LCFGContextList * ctxlist = lcfgctxlist_new();
+
+  unsigned int i;
+  for ( i=0; i<count; i+=2 ) {
+    char * str = NULL;
+    if ( asprintf( &str, LCFGBENCH_CONTEXT_FORMAT " = 1", i ) < 0 ) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+    }
+
+    LCFGContext * ctx = NULL;
+    char * msg = NULL;
+    if ( lcfgcontext_from_string( str, 1, &ctx, &msg ) != LCFG_STATUS_OK ||
+         lcfgctxlist_update( ctxlist, ctx ) == LCFG_CHANGE_ERROR ) {
+      fprintf( stderr, "Failed to create context '%s': %s\n", str,
+               ( msg != NULL ? msg : "unknown error" ) );
+      exit(EXIT_FAILURE);
+    }
+
+    lcfgcontext_relinquish(ctx);
+    free(msg);
+    free(str);
+  }
+
+  return ctxlist;
+}
+
+static void write_results( FILE * fh, const LCFGBenchParams * params,
+                           const LCFGBenchState * state,
+                           unsigned int rounds ) {
+
+  struct stat sb;
+  long long xml_size = stat( state->xml_file, &sb ) == 0 ? sb.st_size : -1;
+
+  fprintf( fh, "{\n" );
+  fprintf( fh, "  \"version\": \"%s\",\n", LCFG_CORE_VERSION );
+  fprintf( fh, "  \"cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN) );
+  fprintf( fh, "  \"rounds\": %u,\n", rounds );
+
+  fprintf( fh, "  \"params\": {\n" );
+  fprintf( fh, "    \"components\": %u,\n", params->components );
+  fprintf( fh, "    \"resources\": %u,\n",  params->resources );
+  fprintf( fh, "    \"list_depth\": %u,\n", params->list_depth );
+  fprintf( fh, "    \"list_size\": %u,\n",  params->list_size );
+  fprintf( fh, "    \"fanout\": %u,\n",     params->fanout );
+  fprintf( fh, "    \"packages\": %u,\n",   params->packages );
+  fprintf( fh, "    \"contexts\": %u,\n",   params->contexts );
+  fprintf( fh, "    \"seed\": %llu\n", (unsigned long long) params->seed );
+  fprintf( fh, "  },\n" );
+
+  fprintf( fh, "  \"profile\": {\n" );
+  fprintf( fh, "    \"xml_bytes\": %lld,\n", xml_size );
+  fprintf( fh, "    \"components\": %zu,\n",
+           count_components(state->profile) );
+  fprintf( fh, "    \"active_packages\": %u,\n",
+           count_packages(state->profile->active_packages) );
+  fprintf( fh, "    \"inactive_packages\": %u\n",
+           count_packages(state->profile->inactive_packages) );
+  fprintf( fh, "  },\n" );
+
+  fprintf( fh, "  \"results\": {\n" );
+
+  LCFGBenchStep * step;
+  for ( step=steps; step->name != NULL; step++ ) {
+    fprintf( fh, "    \"%s\": { \"min_ms\": %.3f, \"mean_ms\": %.3f, \"max_ms\": %.3f }%s\n",
+             step->name, step->min, step->total / rounds, step->max,
+             ( (step+1)->name != NULL ? "," : "" ) );
+  }
+
+  fprintf( fh, "  }\n" );
+  fprintf( fh, "}\n" );
+}
+
+static bool parse_count( const char * value, const char * name,
+                         unsigned int * result ) {
+
+  char * end = NULL;
+  unsigned long count = strtoul( value, &end, 10 );
+  if ( *value == '\0' || *end != '\0' || count > UINT32_MAX ) {
+    fprintf( stderr, "Invalid value '%s' for %s\n", value, name );
+    return false;
+  }
+
+  *result = (unsigned int) count;
+
+  return true;
+}
+
+static void usage( const char * progname ) {
+
+  fprintf( stderr, "Usage: %s [options]\n"
+           "  --components N   number of components\n"
+           "  --resources N    resources per component\n"
+           "  --list-depth N   depth of nested list resource (max %d)\n"
+           "  --list-size N    records at each level of the list\n"
+           "  --fanout N       source files in each derivation\n"
+           "  --packages N     number of packages\n"
+           "  --contexts N     number of contexts\n"
+           "  --seed N         seed for the profile generator\n"
+           "  --rounds N       number of times each step is run\n"
+           "  --output FILE    file for JSON results (default stdout)\n",
+           progname, LCFG_TAGS_MAX_DEPTH );
+}
+
+int main(int argc, char* argv[]) {
+
+  LCFGBenchParams params;
+  lcfgbench_default_params(&params);
+
+  unsigned int rounds = 5;
+  unsigned int seed   = params.seed;
+  const char * output = NULL;
+
+  bool ok = true;
+
+  while (ok) {
+    static struct option long_options[] =
+      {
+        {"components", required_argument, 0, 'c'},
+        {"resources",  required_argument, 0, 'r'},
+        {"list-depth", required_argument, 0, 'd'},
+        {"list-size",  required_argument, 0, 'l'},
+        {"fanout",     required_argument, 0, 'f'},
+        {"packages",   required_argument, 0, 'p'},
+        {"contexts",   required_argument, 0, 'x'},
+        {"seed",       required_argument, 0, 's'},
+        {"rounds",     required_argument, 0, 'n'},
+        {"output",     required_argument, 0, 'o'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+      };
+
+    /* getopt_long stores the option index here. */
+    int option_index = 0;
+
+    int c = getopt_long( argc, argv, "c:r:d:l:f:p:x:s:n:o:h",
+                         long_options, &option_index );
+
+    /* Detect the end of the options. */
+    if (c == -1)
+      break;
+
+    switch (c) {
+    case 'c':
+      ok = parse_count( optarg, "components", &(params.components) );
+      break;
+    case 'r':
+      ok = parse_count( optarg, "resources", &(params.resources) );
+      break;
+    case 'd':
+      ok = parse_count( optarg, "list-depth", &(params.list_depth) );
+      break;
+    case 'l':
+      ok = parse_count( optarg, "list-size", &(params.list_size) );
+      break;
+    case 'f':
+      ok = parse_count( optarg, "fanout", &(params.fanout) );
+      break;
+    case 'p':
+      ok = parse_count( optarg, "packages", &(params.packages) );
+      break;
+    case 'x':
+      ok = parse_count( optarg, "contexts", &(params.contexts) );
+      break;
+    case 's':
+      ok = parse_count( optarg, "seed", &seed );
+      break;
+    case 'n':
+      ok = parse_count( optarg, "rounds", &rounds );
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      ok = false;
+      break;
+    }
+  }
+
+  params.seed = seed;
+
+  /* Each level of a nested list needs another placeholder */
+
+  if ( params.list_depth > LCFG_TAGS_MAX_DEPTH ) {
+    fprintf( stderr, "List depth cannot be more than %d\n",
+             LCFG_TAGS_MAX_DEPTH );
+    ok = false;
+  }
+
+  if ( !ok || optind < argc || rounds == 0 ) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char * tmpdir = getenv("TMPDIR");
+  if ( tmpdir == NULL || *tmpdir == '\0' )
+    tmpdir = "/tmp";
+
+  char * dir = lcfgutils_catfile( tmpdir, "lcfg_bench_XXXXXX" );
+  if ( mkdtemp(dir) == NULL ) {
+    perror("Failed to create temporary directory");
+    exit(EXIT_FAILURE);
+  }
+
+  LCFGBenchState state;
+  state.params      = &params;
+  state.xml_file    = lcfgutils_catfile( dir, "profile.xml" );
+  state.xml_file2   = lcfgutils_catfile( dir, "profile2.xml" );
+  state.bdb_file    = lcfgutils_catfile( dir, "profile.db" );
+  state.status_dir  = lcfgutils_catfile( dir, "status" );
+  state.rpmcfg_file = lcfgutils_catfile( dir, "rpmcfg" );
+  state.ctxlist     = make_contexts(params.contexts);
+  state.profile     = NULL;
+  state.profile2    = NULL;
+
+  char * msg = NULL;
+
+  if ( !lcfgbench_write_profile( &params, 1, state.xml_file ) ||
+       !lcfgbench_write_profile( &params, 2, state.xml_file2 ) ) {
+    perror("Failed to write profile");
+    ok = false;
+  }
+
+  /* The second version is only needed for comparisons */
+
+  if ( ok &&
+       lcfgprofile_from_xml( state.xml_file2, &(state.profile2),
+                             NULL, NULL, state.ctxlist, NULL,
+                             false, &msg ) != LCFG_STATUS_OK ) {
+    fprintf( stderr, "Failed to load profile: %s\n", msg );
+    ok = false;
+  }
+
+  unsigned int round;
+  for ( round=0; ok && round<rounds; round++ ) {
+
+    LCFGBenchStep * step;
+    for ( step=steps; ok && step->name != NULL; step++ ) {
+      double time = 0;
+
+      free(msg);
+      msg = NULL;
+
+      if ( step->func( &state, &time, &msg ) ) {
+        if ( round == 0 || time < step->min ) step->min = time;
+        if ( round == 0 || time > step->max ) step->max = time;
+        step->total += time;
+      } else {
+        fprintf( stderr, "Failed to run %s: %s\n", step->name,
+                 ( msg != NULL ? msg : "unknown error" ) );
+        ok = false;
+      }
+
+    }
+
+  }
+
+  if (ok) {
+    FILE * fh = stdout;
+    if ( output != NULL && strcmp( output, "-" ) != 0 ) {
+      fh = fopen( output, "w" );
+      if ( fh == NULL ) {
+        perror("Failed to open output file");
+        ok = false;
+      }
+    }
+
+    if ( fh != NULL ) {
+      write_results( fh, &params, &state, rounds );
+      if ( fh != stdout && fclose(fh) != 0 ) {
+        perror("Failed to write output file");
+        ok = false;
+      }
+    }
+  }
+
+  free(msg);
+
+  lcfgprofile_destroy(state.profile);
+  lcfgprofile_destroy(state.profile2);
+  lcfgctxlist_destroy(state.ctxlist);
+
+  remove_status_dir(state.status_dir);
+  unlink(state.rpmcfg_file);
+  unlink(state.bdb_file);
+  unlink(state.xml_file2);
+  unlink(state.xml_file);
+  rmdir(dir);
+
+  free(state.rpmcfg_file);
+  free(state.status_dir);
+  free(state.bdb_file);
+  free(state.xml_file2);
+  free(state.xml_file);
+  free(dir);
+
+  return ( ok ? 0 : 1 );
+}
+
+/* eof */
@@ -0,0 +1,446 @@
+/**
+ * @file context/batch.c
+ * @brief Functions for evaluating batches of context expressions
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "context.h"
+#include "utils.h"
+
+/* The distinct expressions are stored in an array in the order they
+   were added, the position in the array is used as the identifier
+   which is returned to the caller. To find an existing expression
+   there is an open-addressed hash table of positions. The table size
+   is a power of two and it is never more than half full. */
+
+#define LCFG_CTXBATCH_SIZE_MIN    16
+#define LCFG_CTXBATCH_CHUNK_MIN   64 /* Fewer expressions are not split */
+#define LCFG_CTXBATCH_MAX_THREADS 16
+
+/**
+ * @brief Create and initialise a new batch of context expressions
+ *
+ * Creates a new @c LCFGContextBatch which holds no expressions.
+ *
+ * If the memory allocation for the new structure is not successful
+ * the @c exit() function will be called with a non-zero value.
+ *
+ * To avoid memory leaks, when the new structure is no longer required
+ * the @c lcfgctxbatch_destroy() function should be called.
+ *
+ * @return Pointer to new @c LCFGContextBatch
+ *
+ */
+
+LCFGContextBatch * lcfgctxbatch_new(void) {
+
+  LCFGContextBatch * batch = malloc( sizeof(LCFGContextBatch) );
+  if ( batch == NULL ) {
+    perror( "Failed to allocate memory for LCFG context batch" );
+    exit(EXIT_FAILURE);
+  }
+
+  batch->entries  = NULL;
+  batch->count    = 0;
+  batch->capacity = 0;
+  batch->slots    = NULL;
+  batch->size     = 0;
+
+  return batch;
+}
+
+/**
+ * @brief Destroy the batch of context expressions
+ *
+ * When the specified @c LCFGContextBatch is no longer required this
+ * can be used to free all associated memory.
+ *
+ * @param[in] batch Pointer to @c LCFGContextBatch to be destroyed.
+ *
+ */
+
+void lcfgctxbatch_destroy( LCFGContextBatch * batch ) {
+
+  if ( batch == NULL ) return;
+
+  unsigned int i;
+  for ( i=0; i<batch->count; i++ )
+    free(batch->entries[i].expr);
+
+  free(batch->entries);
+  batch->entries = NULL;
+
+  free(batch->slots);
+  batch->slots = NULL;
+
+  free(batch);
+  batch = NULL;
+
+}
+
+/* Returns the slot which holds the expression or the empty slot where
+   it should be stored */
+
+static unsigned int * lcfgctxbatch_slot( const LCFGContextBatch * batch,
+                                         unsigned int * slots,
+                                         unsigned int size,
+                                         const char * expr,
+                                         unsigned long hash ) {
+
+  unsigned long mask = size - 1;
+  unsigned long slot = hash & mask;
+
+  while ( slots[slot] != 0 ) {
+    const LCFGContextBatchEntry * entry = &( batch->entries[slots[slot] - 1] );
+    if ( entry->hash == hash && strcmp( entry->expr, expr ) == 0 ) break;
+
+    slot = ( slot + 1 ) & mask;
+  }
+
+  return &( slots[slot] );
+}
+
+static void lcfgctxbatch_grow( LCFGContextBatch * batch ) {
+
+  if ( batch->count < batch->capacity ) return;
+
+  unsigned int new_capacity = batch->capacity > 0 ?
+                              2 * batch->capacity : LCFG_CTXBATCH_SIZE_MIN / 2;
+
+  LCFGContextBatchEntry * new_entries =
+    realloc( batch->entries, new_capacity * sizeof(LCFGContextBatchEntry) );
+  if ( new_entries == NULL ) {
+    perror( "Failed to allocate memory for LCFG context batch" );
+    exit(EXIT_FAILURE);
+  }
+
+  batch->entries  = new_entries;
+  batch->capacity = new_capacity;
+
+  /* The table always has twice as many slots as there can be entries */
+
+  unsigned int new_size = 2 * new_capacity;
+
+  unsigned int * new_slots = calloc( new_size, sizeof(unsigned int) );
+  if ( new_slots == NULL ) {
+    perror( "Failed to allocate memory for LCFG context batch" );
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int i;
+  for ( i=0; i<batch->count; i++ ) {
+    const LCFGContextBatchEntry * entry = &( batch->entries[i] );
+    *( lcfgctxbatch_slot( batch, new_slots, new_size,
+                          entry->expr, entry->hash ) ) = i + 1;
+  }
+
+  free(batch->slots);
+  batch->slots = new_slots;
+  batch->size  = new_size;
+
+}
+
+/**
+ * @brief Add a context expression to a batch
+ *
+ * This adds the context expression to the @c LCFGContextBatch if it
+ * is not already present. Expressions are compared as strings so
+ * logically equivalent expressions with different representations
+ * are stored separately. The expression must not be empty.
+ *
+ * The returned identifier is the same for each call with the same
+ * expression and remains valid for the lifetime of the batch. After
+ * the batch has been evaluated it can be passed to @c
+ * lcfgctxbatch_get_priority() to retrieve the priority.
+ *
+ * @param[in] batch Pointer to @c LCFGContextBatch
+ * @param[in] expr Context expression
+ *
+ * @return Identifier for the expression within the batch
+ *
+ */
+
+unsigned int lcfgctxbatch_add( LCFGContextBatch * batch, const char * expr ) {
+  assert( batch != NULL );
+  assert( !isempty(expr) );
+
+  unsigned long hash = lcfgutils_string_djbhash( expr, NULL );
+
+  if ( batch->count > 0 ) {
+    unsigned int id = *( lcfgctxbatch_slot( batch, batch->slots, batch->size,
+                                            expr, hash ) );
+    if ( id != 0 ) return id - 1;
+  }
+
+  lcfgctxbatch_grow(batch);
+
+  LCFGContextBatchEntry * entry = &( batch->entries[batch->count] );
+
+  entry->expr = strdup(expr);
+  if ( entry->expr == NULL ) {
+    perror( "Failed to allocate memory for LCFG context batch" );
+    exit(EXIT_FAILURE);
+  }
+
+  entry->hash      = hash;
+  entry->priority  = 0;
+  entry->evaluated = false;
+
+  *( lcfgctxbatch_slot( batch, batch->slots, batch->size,
+                        expr, hash ) ) = batch->count + 1;
+
+  return batch->count++;
+}
+
+/* The expressions waiting to be evaluated are split into chunks of
+   roughly equal size, each chunk is evaluated in a separate thread */
+
+struct LCFGContextBatchChunk {
+  LCFGContextBatchEntry ** entries;
+  unsigned int count;
+  const LCFGContextList * ctxlist;
+  char * error_msg;
+};
+
+typedef struct LCFGContextBatchChunk LCFGContextBatchChunk;
+
+static void * lcfgctxbatch_eval_chunk( void * data ) {
+
+  LCFGContextBatchChunk * chunk = data;
+
+  unsigned int i;
+  for ( i=0; i<chunk->count && chunk->error_msg == NULL; i++ ) {
+    LCFGContextBatchEntry * entry = chunk->entries[i];
+
+    char * eval_msg = NULL;
+    if ( lcfgctxlist_eval_expression( chunk->ctxlist, entry->expr,
+                                      &( entry->priority ), &eval_msg ) ) {
+      entry->evaluated = true;
+    } else {
+      lcfgutils_build_message( &( chunk->error_msg ),
+                               "Failed to evaluate context expression '%s': %s",
+                               entry->expr,
+                               eval_msg != NULL ? eval_msg : "unknown error" );
+    }
+
+    free(eval_msg);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Evaluate all the context expressions in a batch
+ *
+ * This evaluates each of the expressions in the @c LCFGContextBatch
+ * which has not already been evaluated using the @c
+ * lcfgctxlist_eval_expression() function with the specified @c
+ * LCFGContextList. The resulting priorities can be retrieved with @c
+ * lcfgctxbatch_get_priority().
+ *
+ * When there are many expressions they may be split into chunks
+ * which are evaluated in parallel, the number of threads is limited
+ * by the @c max_threads parameter. A value of zero means the number
+ * of online processors is used, a value of one means the expressions
+ * are all evaluated in the calling thread. The @c LCFGContextList
+ * must not be modified whilst the expressions are being evaluated.
+ *
+ * If any expression cannot be evaluated then an error is returned,
+ * the other expressions may still have been evaluated.
+ *
+ * @param[in] batch Pointer to @c LCFGContextBatch
+ * @param[in] ctxlist Pointer to @c LCFGContextList
+ * @param[in] max_threads Maximum number of threads to be used
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgctxbatch_evaluate( LCFGContextBatch * batch,
+                                  const LCFGContextList * ctxlist,
+                                  unsigned int max_threads,
+                                  char ** msg ) {
+  assert( batch != NULL );
+
+  unsigned int npending = 0;
+  unsigned int i;
+  for ( i=0; i<batch->count; i++ ) {
+    if ( !batch->entries[i].evaluated )
+      npending++;
+  }
+
+  if ( npending == 0 ) return LCFG_STATUS_OK;
+
+  LCFGContextBatchEntry ** pending =
+    calloc( npending, sizeof(LCFGContextBatchEntry *) );
+  if ( pending == NULL ) {
+    perror( "Failed to allocate memory for LCFG context batch" );
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int count = 0;
+  for ( i=0; i<batch->count; i++ ) {
+    if ( !batch->entries[i].evaluated )
+      pending[count++] = &( batch->entries[i] );
+  }
+
+  /* Decide how many chunks are required */
+
+  if ( max_threads == 0 ) {
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    max_threads = ncpus > 1 ? (unsigned int) ncpus : 1;
+  }
+
+  unsigned int nchunks = npending / LCFG_CTXBATCH_CHUNK_MIN + 1;
+  if ( nchunks > max_threads )
+    nchunks = max_threads;
+  if ( nchunks > LCFG_CTXBATCH_MAX_THREADS )
+    nchunks = LCFG_CTXBATCH_MAX_THREADS;
+
+  LCFGContextBatchChunk * chunks =
+    calloc( nchunks, sizeof(LCFGContextBatchChunk) );
+  if ( chunks == NULL ) {
+    perror( "Failed to allocate memory for LCFG context batch" );
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int first = 0;
+  for ( i=0; i<nchunks; i++ ) {
+    unsigned int last = ( i == nchunks - 1 ) ?
+                        npending : ( i + 1 ) * ( npending / nchunks );
+
+    chunks[i].entries = pending + first;
+    chunks[i].count   = last - first;
+    chunks[i].ctxlist = ctxlist;
+
+    first = last;
+  }
+
+  /* The first chunk is always done in this thread, if a thread cannot
+     be created the chunk is also evaluated here. */
+
+  pthread_t * threads = NULL;
+  bool * started = NULL;
+
+  if ( nchunks > 1 ) {
+    threads = calloc( nchunks, sizeof(pthread_t) );
+    started = calloc( nchunks, sizeof(bool) );
+    if ( threads == NULL || started == NULL ) {
+      perror( "Failed to allocate memory for LCFG context batch" );
+      exit(EXIT_FAILURE);
+    }
+
+    for ( i=1; i<nchunks; i++ )
+      started[i] = ( pthread_create( &threads[i], NULL,
+                                     lcfgctxbatch_eval_chunk,
+                                     &chunks[i] ) == 0 );
+  }
+
+  (void) lcfgctxbatch_eval_chunk( &chunks[0] );
+
+  for ( i=1; i<nchunks; i++ ) {
+    if ( started[i] )
+      pthread_join( threads[i], NULL );
+    else
+      (void) lcfgctxbatch_eval_chunk( &chunks[i] );
+  }
+
+  free(threads);
+  free(started);
+
+  /* Report the first error */
+
+  LCFGStatus status = LCFG_STATUS_OK;
+  for ( i=0; i<nchunks; i++ ) {
+
+    if ( chunks[i].error_msg != NULL && status == LCFG_STATUS_OK ) {
+      status = LCFG_STATUS_ERROR;
+
+      free(*msg);
+      *msg = chunks[i].error_msg;
+    } else {
+      free(chunks[i].error_msg);
+    }
+
+  }
+
+  free(chunks);
+  free(pending);
+
+  return status;
+}
+
+/**
+ * @brief Get the priority for a context expression in a batch
+ *
+ * This retrieves the priority for a context expression which was
+ * evaluated using @c lcfgctxbatch_evaluate(). The identifier is the
+ * value which was returned by @c lcfgctxbatch_add(). If the
+ * expression has not been evaluated the priority will be zero.
+ *
+ * @param[in] batch Pointer to @c LCFGContextBatch
+ * @param[in] id Identifier for the expression within the batch
+ *
+ * @return Integer priority for the expression
+ *
+ */
+
+int lcfgctxbatch_get_priority( const LCFGContextBatch * batch,
+                               unsigned int id ) {
+  assert( batch != NULL );
+  assert( id < batch->count );
+
+  return batch->entries[id].priority;
+}
+
+/**
+ * @brief Find the priority for a context expression in a batch
+ *
+ * This looks up the priority for a context expression which was
+ * evaluated using @c lcfgctxbatch_evaluate(). It is useful when the
+ * identifier returned by @c lcfgctxbatch_add() has not been kept. As
+ * with @c lcfgctxlist_eval_expression() an empty expression has a
+ * priority of zero.
+ *
+ * @param[in] batch Pointer to @c LCFGContextBatch
+ * @param[in] expr Context expression
+ * @param[out] priority Integer priority for the expression
+ *
+ * @return Boolean which indicates if the expression has been evaluated
+ *
+ */
+
+bool lcfgctxbatch_priority( const LCFGContextBatch * batch,
+                            const char * expr,
+                            int * priority ) {
+  assert( batch != NULL );
+
+  *priority = 0;
+
+  if ( isempty(expr) ) return true;
+  if ( batch->count == 0 ) return false;
+
+  unsigned long hash = lcfgutils_string_djbhash( expr, NULL );
+
+  unsigned int id = *( lcfgctxbatch_slot( batch, batch->slots, batch->size,
+                                          expr, hash ) );
+  if ( id == 0 || !batch->entries[id - 1].evaluated ) return false;
+
+  *priority = batch->entries[id - 1].priority;
+
+  return true;
+}
+
+/* eof */
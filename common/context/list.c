@@ -48,6 +48,61 @@ static LCFGChange lcfgctxlist_remove_next( LCFGContextList * list,
 
 #define lcfgctxlist_append(ctxlist, ctx) ( lcfgctxlist_insert_next( ctxlist, lcfgslist_tail(ctxlist), ctx ) )
 
+/* As well as being linked together the nodes are indexed by context
+   name in an open-addressed hash table. Every context name referenced
+   in an expression is looked up whilst it is being evaluated so this
+   avoids walking the list each time. The table size is a power of two
+   and it is never more than half full. When several nodes have the
+   same name only the first is indexed, that is the one which would be
+   found by searching the list. */
+
+#define LCFG_CTXLIST_INDEX_MIN 16
+
+static void lcfgctxlist_index_add( LCFGContextList * ctxlist,
+                                   LCFGSListNode * node ) {
+
+  const char * name = lcfgcontext_get_name(lcfgslist_data(node));
+
+  unsigned long mask = ctxlist->index_size - 1;
+  unsigned long slot = lcfgutils_string_djbhash( name, NULL ) & mask;
+
+  while ( ctxlist->index[slot] != NULL ) {
+    if ( lcfgcontext_match( lcfgslist_data(ctxlist->index[slot]), name ) )
+      return;
+
+    slot = ( slot + 1 ) & mask;
+  }
+
+  ctxlist->index[slot] = node;
+}
+
+static void lcfgctxlist_reindex( LCFGContextList * ctxlist ) {
+
+  unsigned int want_size = LCFG_CTXLIST_INDEX_MIN;
+  while ( want_size < 2 * ctxlist->size )
+    want_size *= 2;
+
+  free(ctxlist->index);
+
+  ctxlist->index = calloc( want_size, sizeof(LCFGSListNode *) );
+  if ( ctxlist->index == NULL ) {
+    perror( "Failed to allocate memory for LCFG context list index" );
+    exit(EXIT_FAILURE);
+  }
+  ctxlist->index_size = want_size;
+
+  LCFGSListNode * cur_node = NULL;
+  for ( cur_node = lcfgslist_head(ctxlist);
+        cur_node != NULL;
+        cur_node = lcfgslist_next(cur_node) ) {
+
+    if ( lcfgcontext_is_valid(lcfgslist_data(cur_node)) )
+      lcfgctxlist_index_add( ctxlist, cur_node );
+
+  }
+
+}
+
 /**
  * @brief Create and initialise a new context list
  *
@@ -78,6 +133,11 @@ LCFGContextList * lcfgctxlist_new(void) {
   ctxlist->head = NULL;
   ctxlist->tail = NULL;
 
+  /* The index is created when the first context is added */
+
+  ctxlist->index      = NULL;
+  ctxlist->index_size = 0;
+
   return ctxlist;
 }
 
@@ -105,6 +165,12 @@ void lcfgctxlist_destroy(LCFGContextList * ctxlist) {
 
   if ( ctxlist == NULL ) return;
 
+  /* No point maintaining the index whilst emptying the list */
+
+  free(ctxlist->index);
+  ctxlist->index      = NULL;
+  ctxlist->index_size = 0;
+
   while ( lcfgslist_size(ctxlist) > 0 ) {
     LCFGContext * ctx = NULL;
     if ( lcfgctxlist_remove_next( ctxlist, NULL,
@@ -228,6 +294,15 @@ static LCFGChange lcfgctxlist_insert_next( LCFGContextList * list,
 
   list->size++;
 
+  /* A node which is not at the end of the list might come before
+     another with the same name so the index is rebuilt */
+
+  if ( list->index == NULL || new_node->next != NULL ||
+       2 * list->size > list->index_size )
+    lcfgctxlist_reindex(list);
+  else
+    lcfgctxlist_index_add( list, new_node );
+
   return LCFG_CHANGE_ADDED;
 }
 
@@ -293,6 +368,9 @@ static LCFGChange lcfgctxlist_remove_next( LCFGContextList * list,
 
   lcfgslistnode_destroy(old_node);
 
+  if ( list->index != NULL )
+    lcfgctxlist_reindex(list);
+
   return LCFG_CHANGE_REMOVED;
 }
 
@@ -302,6 +380,11 @@ static LCFGChange lcfgctxlist_remove_next( LCFGContextList * list,
  * This can be used to search through an @c LCFGContextList to find
  * the first context node which has a matching name. Note that the
  * matching is done using strcmp(3) which is case-sensitive.
+ *
+ * The node is found using the hash index of context names for the
+ * list so the time taken does not depend on the length of the
+ * list. For that reason the name of a context must not be changed
+ * whilst it is in a list.
  * 
  * A @c NULL value is returned if no matching node is found. Also, a
  * @c NULL value is returned if a @c NULL value or an empty list is
@@ -318,22 +401,20 @@ LCFGSListNode * lcfgctxlist_find_node( const LCFGContextList * ctxlist,
                                        const char * want_name ) {
   assert( want_name != NULL );
 
-  if ( lcfgslist_is_empty(ctxlist) ) return NULL;
+  if ( lcfgctxlist_is_empty(ctxlist) || ctxlist->index == NULL ) return NULL;
 
   LCFGSListNode * result = NULL;
 
-  LCFGSListNode * cur_node = NULL;
-  for ( cur_node = lcfgslist_head(ctxlist);
-        cur_node != NULL && result == NULL;
-        cur_node = lcfgslist_next(cur_node) ) {
-
-    const LCFGContext * ctx = lcfgslist_data(cur_node);
+  unsigned long mask = ctxlist->index_size - 1;
+  unsigned long slot = lcfgutils_string_djbhash( want_name, NULL ) & mask;
 
-    if ( !lcfgcontext_is_valid(ctx) ) continue;
+  LCFGSListNode * cur_node = NULL;
+  while ( result == NULL && ( cur_node = ctxlist->index[slot] ) != NULL ) {
 
-    if ( lcfgcontext_match( ctx, want_name ) )
+    if ( lcfgcontext_match( lcfgslist_data(cur_node), want_name ) )
       result = cur_node;
 
+    slot = ( slot + 1 ) & mask;
   }
 
   return result;
@@ -792,6 +873,10 @@ void lcfgctxlist_sort_by_priority( LCFGContextList * ctxlist ) {
     }
   }
 
+  /* The contexts have moved between nodes */
+
+  lcfgctxlist_reindex(ctxlist);
+
 }
 
 /**
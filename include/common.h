@@ -79,7 +79,8 @@ typedef enum {
   LCFG_OPT_ALL_VALUES     = 1024, /**< Include all values */
   LCFG_OPT_COMPAT         = 2048, /**< Compatibility mode */
   LCFG_OPT_LEGACY         = 4096, /**< Legacy support */
-  LCFG_OPT_NEW            = 8192  /**< New (not yet standard) support */
+  LCFG_OPT_NEW            = 8192, /**< New (not yet standard) support */
+  LCFG_OPT_USE_ARENA      = 16384 /**< Allocate loaded resources from an arena */
 } LCFGOption;
 
 /**
@@ -11,6 +11,7 @@
 #define LCFG_CORE_COMPONENT_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include "resources.h"
@@ -26,15 +27,21 @@ typedef enum {
 #define LCFG_COMP_LOAD_INIT 0.5
 #define LCFG_COMP_LOAD_MAX  0.7
 
+/* Number of resources which can be stored in a resource list without
+   a separate allocation */
+
+#define LCFG_RESLIST_INLINE 2
+
 /**
  * @brief A structure to represent an LCFG Component
  */
 
 struct LCFGResourceList {
   /*@{*/
-  LCFGSListNode * head;      /**< The first node in the list */
-  LCFGSListNode * tail;      /**< The last node in the list */
+  LCFGResource ** items;     /**< Array of resources in order of priority */
+  LCFGResource * inline_items[LCFG_RESLIST_INLINE]; /**< Storage for short lists */
   unsigned int size;         /**< The length of the list */
+  unsigned int capacity;     /**< The allocated length of the array */
   LCFGComponentPK primary_key; /**< Controls which package fields are used as primary key */
   LCFGMergeRule merge_rules; /**< Rules which control how resources are merged */
   /*@}*/
@@ -43,15 +50,34 @@ struct LCFGResourceList {
 
 typedef struct LCFGResourceList LCFGResourceList;
 
+/**
+ * @brief Hash information for a bucket in an LCFG Component
+ */
+
+struct LCFGComponentSlot {
+  /*@{*/
+  uint64_t hash;     /**< Full 64-bit hash of the resource name */
+  uint32_t name_len; /**< Length of the resource name */
+  uint32_t distance; /**< Probe distance from home bucket plus one (zero when empty) */
+  /*@}*/
+};
+
+typedef struct LCFGComponentSlot LCFGComponentSlot;
+
 struct LCFGComponent {
   /*@{*/
   char * name;                   /**< Name (required) */
   LCFGResourceList ** resources; /**< Array of resource lists */
+  LCFGComponentSlot * slots;     /**< Hash information for each bucket */
+  LCFGResourceList ** sorted;    /**< Resource lists in order of name */
   unsigned long buckets;         /**< Array of derivation lists */
   unsigned long entries;         /**< Number of full buckets in map */
   LCFGComponentPK primary_key;     /**< Controls which resource fields are used as primary key */
   LCFGMergeRule merge_rules;     /**< Rules which control how resources are merged */
   /*@}*/
+  LCFGResArena * arena;          /**< Optional arena for loaded resources */
+  uint64_t source_hash;          /**< Hash of the XML the resources were loaded from (zero if not known) */
+  unsigned int * _shared_buckets; /**< Number of clones sharing the buckets (changed atomically) */
   unsigned int _refcount;
 };
 
@@ -72,6 +98,9 @@ bool lcfgcomponent_set_merge_rules( LCFGComponent * comp,
 
 LCFGComponent * lcfgcomponent_clone( const LCFGComponent * comp );
 
+void lcfgcomponent_use_arena( LCFGComponent * comp );
+LCFGResource * lcfgcomponent_new_resource( LCFGComponent * comp );
+
 bool lcfgcomponent_is_valid( const LCFGComponent * comp );
 
 bool lcfgcomponent_has_name(const LCFGComponent * comp);
@@ -143,6 +172,9 @@ LCFGChange lcfgcomponent_merge_component( LCFGComponent * comp,
 
 unsigned long lcfgcomponent_hash( const LCFGComponent * comp );
 
+void lcfgcomponent_memory_stats( const LCFGComponent * comp,
+                                 LCFGResourceStats * stats );
+
 bool lcfgcomponent_same_name( const LCFGComponent * comp1,
                               const LCFGComponent * comp2 );
 
@@ -188,6 +220,9 @@ void lcfgcompset_relinquish( LCFGComponentSet * compset );
 LCFGComponent * lcfgcompset_find_component( const LCFGComponentSet * compset,
                                             const char * want_name );
 
+void lcfgcompset_memory_stats( const LCFGComponentSet * compset,
+                               LCFGResourceStats * stats );
+
 bool lcfgcompset_has_component( const LCFGComponentSet * compset,
                                 const char * want_name );
 
@@ -206,6 +241,16 @@ LCFGChange lcfgcompset_transplant_components( LCFGComponentSet * compset1,
                                               char ** msg )
   __attribute__((warn_unused_result));
 
+LCFGChange lcfgcompset_eval_priority( LCFGComponentSet * compset,
+                                      const LCFGContextList * ctxlist,
+                                      char ** msg )
+  __attribute__((warn_unused_result));
+
+LCFGChange lcfgcompset_eval_priority_parallel( LCFGComponentSet * compset,
+                                               const LCFGContextList * ctxlist,
+                                               char ** msg )
+  __attribute__((warn_unused_result));
+
 LCFGComponent * lcfgcompset_find_or_create_component(
                                                      LCFGComponentSet * compset,
                                                      const char * name )
@@ -260,7 +305,7 @@ char * lcfgcompset_signature( const LCFGComponentSet * compset );
 
 struct LCFGResourceListIterator {
   LCFGResourceList * list; /**< The resource list */
-  LCFGSListNode * current; /**< Current location in the list */
+  unsigned int next;       /**< Index of next item in the list */
 };
 typedef struct LCFGResourceListIterator LCFGResourceListIterator;
 
@@ -144,6 +144,8 @@ struct LCFGContextList {
   LCFGSListNode * tail; /**< The last context in the list */
   unsigned int size;      /**< The length of the list */
   /*@}*/
+  LCFGSListNode ** index;  /**< Hash index of the nodes by context name */
+  unsigned int index_size; /**< Number of slots in the index */
 };
 
 typedef struct LCFGContextList LCFGContextList;
@@ -234,6 +236,63 @@ int lcfgcontext_compare_expressions( const char * ctx1,
                                      const char * ctx2 )
   __attribute__((const));
 
+/* Batch evaluation */
+
+/**
+ * @brief A context expression in a batch
+ */
+
+struct LCFGContextBatchEntry {
+  /*@{*/
+  char * expr;          /**< The context expression */
+  unsigned long hash;   /**< Hash of the expression */
+  int priority;         /**< Priority from evaluating the expression */
+  bool evaluated;       /**< Whether the expression has been evaluated */
+  /*@}*/
+};
+
+typedef struct LCFGContextBatchEntry LCFGContextBatchEntry;
+
+/**
+ * @brief A set of distinct context expressions for evaluation
+ *
+ * Many packages and resources share the same few context expressions,
+ * a batch is used to evaluate each distinct expression only once,
+ * see @c lcfgctxbatch_evaluate() for details.
+ */
+
+struct LCFGContextBatch {
+  /*@{*/
+  LCFGContextBatchEntry * entries; /**< Distinct expressions in order of addition */
+  unsigned int count;              /**< Number of distinct expressions */
+  unsigned int capacity;           /**< Allocated length of the array of entries */
+  unsigned int * slots;            /**< Hash table of entry numbers plus one (zero when empty) */
+  unsigned int size;               /**< Number of slots in the table */
+  /*@}*/
+};
+
+typedef struct LCFGContextBatch LCFGContextBatch;
+
+LCFGContextBatch * lcfgctxbatch_new(void);
+
+void lcfgctxbatch_destroy( LCFGContextBatch * batch );
+
+unsigned int lcfgctxbatch_add( LCFGContextBatch * batch, const char * expr );
+
+LCFGStatus lcfgctxbatch_evaluate( LCFGContextBatch * batch,
+                                  const LCFGContextList * ctxlist,
+                                  unsigned int max_threads,
+                                  char ** msg )
+  __attribute__((warn_unused_result));
+
+int lcfgctxbatch_get_priority( const LCFGContextBatch * batch,
+                               unsigned int id );
+
+bool lcfgctxbatch_priority( const LCFGContextBatch * batch,
+                            const char * expr,
+                            int * priority )
+  __attribute__((warn_unused_result));
+
 /* Tools */
 
 bool lcfgcontext_check_cfgdir( const char * contextdir, char ** msg )
@@ -42,6 +42,8 @@ struct LCFGPackage {
   char prefix;       /**< Prefix - primary merge conflict resolution for multiple specifications (single alpha-numeric character) */
   int priority;      /**< Priority - result of evaluating context expression, secondary merge conflict resolution */
   /*@}*/
+  struct LCFGPkgArena * _arena; /**< Arena from which the package was allocated (if any) */
+  unsigned int _arena_fields;   /**< Fields with strings allocated from the arena */
   unsigned int _refcount;
 };
 
@@ -222,6 +224,11 @@ LCFGChange lcfgpackage_eval_priority( LCFGPackage * pkg,
                                       char ** msg )
   __attribute__((warn_unused_result));
 
+LCFGChange lcfgpackage_apply_priority( LCFGPackage * pkg,
+                                       const LCFGContextBatch * batch,
+                                       char ** msg )
+  __attribute__((warn_unused_result));
+
 char * lcfgpackage_full_version( const LCFGPackage * pkg );
 
 char * lcfgpackage_id( const LCFGPackage * pkg );
@@ -498,6 +505,14 @@ LCFGChange lcfgpkglist_eval_priority( const LCFGPackageList * pkglist,
                                       char ** msg )
   __attribute__((warn_unused_result));
 
+void lcfgpkglist_collect_contexts( const LCFGPackageList * pkglist,
+                                   LCFGContextBatch * batch );
+
+LCFGChange lcfgpkglist_apply_priority( const LCFGPackageList * pkglist,
+                                       const LCFGContextBatch * batch,
+                                       char ** msg )
+  __attribute__((warn_unused_result));
+
 /**
  * @brief Simple iterator for package lists
  */
@@ -532,6 +547,8 @@ struct LCFGPackageSet {
   LCFGPkgListPK primary_key; /**< Controls which package fields are used as primary key */
   LCFGMergeRule merge_rules; /**< Rules which control how packages are merged */
   /*@}*/
+  struct LCFGPkgSetIndex * index; /**< Optional search index */
+  struct LCFGPkgArena * arena;    /**< Optional arena for parsed packages */
   unsigned int _refcount;
 };
 
@@ -587,6 +604,14 @@ bool lcfgpkgset_print( const LCFGPackageSet * pkgset,
                        FILE * out )
   __attribute__((warn_unused_result));
 
+ssize_t lcfgpkgset_to_buffer( const LCFGPackageSet * pkgset,
+                              const char * defarch,
+                              const char * base,
+                              LCFGPkgStyle style,
+                              LCFGOption options,
+                              char ** buffer, size_t * size, size_t len )
+  __attribute__((warn_unused_result));
+
 LCFGStatus lcfgpkgset_from_rpmlist( const char * filename,
                                      LCFGPackageSet ** result,
                                      LCFGOption options,
@@ -649,11 +674,81 @@ LCFGPackageSet * lcfgpkgset_match( const LCFGPackageSet * pkgset,
                                    const char * want_ver,
                                    const char * want_rel );
 
+void lcfgpkgset_build_index( LCFGPackageSet * pkgset );
+void lcfgpkgset_drop_index( LCFGPackageSet * pkgset );
+bool lcfgpkgset_has_index( const LCFGPackageSet * pkgset );
+
 LCFGChange lcfgpkgset_eval_priority( const LCFGPackageSet * pkgset,
                                      const LCFGContextList * ctxlist,
                                      char ** msg )
   __attribute__((warn_unused_result));
 
+LCFGChange lcfgpkgset_eval_priority_parallel( const LCFGPackageSet * pkgset,
+                                              const LCFGContextList * ctxlist,
+                                              char ** msg )
+  __attribute__((warn_unused_result));
+
+/* Differences */
+
+/**
+ * @brief Types of difference between two package sets
+ */
+
+typedef enum {
+  LCFG_PKGDIFF_UNCHANGED,  /**< Same version in both sets */
+  LCFG_PKGDIFF_ADDED,      /**< Only in the new set */
+  LCFG_PKGDIFF_REMOVED,    /**< Only in the old set */
+  LCFG_PKGDIFF_UPGRADED,   /**< Greater version in the new set */
+  LCFG_PKGDIFF_DOWNGRADED  /**< Lesser version in the new set */
+} LCFGPkgDiffType;
+
+#define LCFG_PKGDIFF_TYPES 5
+
+/**
+ * @brief A single difference between two package sets
+ */
+
+struct LCFGPkgDiffEntry {
+  /*@{*/
+  LCFGPackage * old;    /**< The 'old' package (@c NULL if added) */
+  LCFGPackage * new;    /**< The 'new' package (@c NULL if removed) */
+  LCFGPkgDiffType type; /**< The type of difference */
+  /*@}*/
+};
+typedef struct LCFGPkgDiffEntry LCFGPkgDiffEntry;
+
+/**
+ * @brief The differences between two package sets
+ */
+
+struct LCFGPkgSetDiff {
+  /*@{*/
+  LCFGPkgDiffEntry * entries;  /**< Array of entries grouped by type */
+  unsigned int size;           /**< Total number of entries */
+  unsigned int start[LCFG_PKGDIFF_TYPES]; /**< Offset of first entry for each type */
+  unsigned int count[LCFG_PKGDIFF_TYPES]; /**< Number of entries for each type */
+  /*@}*/
+  unsigned int _refcount;
+};
+typedef struct LCFGPkgSetDiff LCFGPkgSetDiff;
+
+LCFGChange lcfgpkgset_diff( const LCFGPackageSet * pkgset1,
+                            const LCFGPackageSet * pkgset2,
+                            LCFGPkgSetDiff ** result )
+  __attribute__((warn_unused_result));
+
+void lcfgpkgsetdiff_destroy( LCFGPkgSetDiff * diff );
+void lcfgpkgsetdiff_acquire( LCFGPkgSetDiff * diff );
+void lcfgpkgsetdiff_relinquish( LCFGPkgSetDiff * diff );
+
+unsigned int lcfgpkgsetdiff_count( const LCFGPkgSetDiff * diff,
+                                   LCFGPkgDiffType type );
+
+const LCFGPkgDiffEntry * lcfgpkgsetdiff_entries( const LCFGPkgSetDiff * diff,
+                                                 LCFGPkgDiffType type );
+
+bool lcfgpkgsetdiff_has_changes( const LCFGPkgSetDiff * diff );
+
 /**
  * @brief Iterator for package sets
  */
@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "common.h"
 #include "derivation.h"
@@ -55,6 +56,12 @@ typedef enum {
 #define LCFG_RESOURCE_DEFAULT_TYPE     LCFG_RESOURCE_TYPE_STRING
 #define LCFG_RESOURCE_DEFAULT_PRIORITY 0
 
+/* Space in each resource for storing short name and value strings
+   without separate allocations. This is sized so that the structure
+   is 112 bytes on 64-bit platforms. */
+
+#define LCFG_RESOURCE_INLINE_SIZE 32
+
 /**
  * @brief Resource format styles
  *
@@ -71,6 +78,33 @@ typedef enum {
   LCFG_RESOURCE_STYLE_VALUE       /**< Resource value only (possibly encoded) */
 } LCFGResourceStyle;
 
+/**
+ * @brief Arena for loaded resources
+ *
+ * Resources (and the strings for their attributes) which are created
+ * when loading a component can be allocated from an arena in large
+ * slabs. Each resource allocated from the arena holds a reference so
+ * the slabs are all freed together when the component and every
+ * resource are gone. Derivation lists and templates are always
+ * allocated separately. See @c lcfgresarena_new() for details.
+ *
+ */
+
+struct LCFGResArena {
+  struct LCFGResArenaSlab * slabs; /**< List of slabs, current first */
+  char * next;                     /**< Next free byte in current slab */
+  size_t remaining;                /**< Free bytes in current slab */
+  unsigned int _refcount;
+};
+typedef struct LCFGResArena LCFGResArena;
+
+LCFGResArena * lcfgresarena_new(void);
+void lcfgresarena_acquire( LCFGResArena * arena );
+void lcfgresarena_relinquish( LCFGResArena * arena );
+void * lcfgresarena_alloc( LCFGResArena * arena, size_t size );
+char * lcfgresarena_strndup( LCFGResArena * arena,
+                             const char * str, size_t len );
+
 /**
  * @brief A structure to represent an LCFG resource
  *
@@ -88,15 +122,45 @@ struct LCFGResource {
   char * context;                 /**< Context expression - when the resource is applicable */
   LCFGDerivationList * derivation; /**< Derivation - where the resource was specified */
   char * comment;                 /**< Any comments associated with the type information */
-  LCFGResourceType type;          /**< Type - see LCFGResourceType for list of supported types */
   int priority;                   /**< Priority - result of evaluating context expression, used for merge conflict resolution */
+  LCFGResourceType type : 8;      /**< Type - see LCFGResourceType for list of supported types */
   /*@}*/
+  unsigned int _flags : 16;       /**< Internal storage and cache flags */
   unsigned int _refcount;
+  struct LCFGResArena * _arena;   /**< Arena from which the resource was allocated (if any) */
+  union {
+    int64_t integer;                   /**< Cached integer value */
+    struct LCFGResourceTagIndex * tags; /**< Cached offsets of tags in value */
+  } _typed;
+  char _inline[LCFG_RESOURCE_INLINE_SIZE]; /**< Storage for short name and value */
 };
 
 typedef struct LCFGResource LCFGResource;
 
+/**
+ * @brief Memory usage statistics for LCFG resources
+ *
+ * This is used to gather information on the amount of memory used
+ * for storing resources, see @c lcfgresource_memory_stats() for
+ * details.
+ */
+
+struct LCFGResourceStats {
+  /*@{*/
+  unsigned long resources;    /**< Number of resources */
+  unsigned long inline_strings; /**< Number of strings stored inside resources */
+  unsigned long heap_strings; /**< Number of separately allocated strings */
+  unsigned long arena_strings; /**< Number of strings allocated from an arena */
+  size_t resource_bytes;      /**< Memory used for resource structures */
+  size_t string_bytes;        /**< Memory used for heap and arena strings */
+  size_t container_bytes;     /**< Memory used for lists and hashes of resources */
+  /*@}*/
+};
+
+typedef struct LCFGResourceStats LCFGResourceStats;
+
 LCFGResource * lcfgresource_new(void);
+LCFGResource * lcfgresource_arena_new( LCFGResArena * arena );
 
 LCFGResource * lcfgresource_clone(const LCFGResource * res);
 void lcfgresource_acquire( LCFGResource * res );
@@ -115,6 +179,9 @@ const char * lcfgresource_get_name( const LCFGResource * res );
 bool lcfgresource_set_name( LCFGResource * res,
                             char * new_value )
   __attribute__((warn_unused_result));
+bool lcfgresource_set_name_copy( LCFGResource * res,
+                                 const char * new_value )
+  __attribute__((warn_unused_result));
 
 /* Resources: Types */
 
@@ -191,12 +258,27 @@ const char * lcfgresource_get_value( const LCFGResource * res );
 bool lcfgresource_set_value( LCFGResource * res,
                              char * new_value )
   __attribute__((warn_unused_result));
+bool lcfgresource_set_value_copy( LCFGResource * res,
+                                  const char * new_value )
+  __attribute__((warn_unused_result));
 
 bool lcfgresource_unset_value( LCFGResource * res )
   __attribute__((warn_unused_result));
 
 bool lcfgresource_value_needs_encode( const LCFGResource * res );
 
+bool lcfgresource_get_integer( const LCFGResource * res, int64_t * result )
+  __attribute__((warn_unused_result));
+
+unsigned int lcfgresource_value_tag_count( const LCFGResource * res );
+
+const char * lcfgresource_value_get_tag( const LCFGResource * res,
+                                         unsigned int index,
+                                         size_t * len );
+
+ssize_t lcfgresource_value_tag_position( const LCFGResource * res,
+                                         const char * tag );
+
 char * lcfgresource_enc_value( const LCFGResource * res );
 
 /* Resources: Value Mutations */
@@ -250,6 +332,37 @@ bool lcfgresource_value_add_tags( LCFGResource * res,
                                   const char * extra_tags )
   __attribute__((warn_unused_result));
 
+/**
+ * @brief Types of tag mutation which can be applied in a batch
+ */
+
+typedef enum {
+  LCFG_TAG_MUTATE_APPEND,   /**< Append the tags */
+  LCFG_TAG_MUTATE_PREPEND,  /**< Prepend the tags */
+  LCFG_TAG_MUTATE_ADD,      /**< Append the tags which are not present */
+  LCFG_TAG_MUTATE_REMOVE,   /**< Remove the first instance of each tag */
+  LCFG_TAG_MUTATE_REPLACE   /**< Replace the first instance of a tag */
+} LCFGTagMutationType;
+
+/**
+ * @brief A tag mutation, see @c lcfgresource_value_mutate_tags()
+ */
+
+struct LCFGTagMutation {
+  /*@{*/
+  LCFGTagMutationType type;  /**< Type of mutation */
+  const char * tags;         /**< Space-separated tags (the old tag for replace) */
+  const char * new_tag;      /**< New tag (replace only) */
+  /*@}*/
+};
+
+typedef struct LCFGTagMutation LCFGTagMutation;
+
+bool lcfgresource_value_mutate_tags( LCFGResource * res,
+                                     const LCFGTagMutation * mutations,
+                                     size_t count )
+  __attribute__((warn_unused_result));
+
 /* Resources: Derivations */
 
 bool lcfgresource_has_derivation( const LCFGResource * res );
@@ -450,6 +563,66 @@ ssize_t lcfgresource_build_key( const char * resource,
                                 size_t * size )
   __attribute__((warn_unused_result));
 
+/**
+ * @brief The parts of a resource key, see @c lcfgresource_parse_key_view()
+ *
+ * Each part points into the original key, the parts are not
+ * nul-terminated so the lengths must always be used. A part which is
+ * not present in the key has a @c NULL pointer and zero length.
+ */
+
+struct LCFGResourceKeyView {
+  /*@{*/
+  const char * namespace;  /**< Namespace, typically a hostname */
+  size_t namespace_len;    /**< Length of the namespace */
+  const char * component;  /**< Component name */
+  size_t component_len;    /**< Length of the component name */
+  const char * resource;   /**< Resource name */
+  size_t resource_len;     /**< Length of the resource name */
+  char type;               /**< The key type symbol */
+  /*@}*/
+};
+
+typedef struct LCFGResourceKeyView LCFGResourceKeyView;
+
+bool lcfgresource_parse_key_view( const char * key, size_t len,
+                                  LCFGResourceKeyView * view )
+  __attribute__((warn_unused_result));
+
+/**
+ * @brief Reusable buffer for building resource keys
+ *
+ * The @c namespace.component. prefix is stored once when the buffer
+ * is initialised so building the keys for each resource only requires
+ * the name to be copied, see @c lcfgresource_keybuf_init() for
+ * details.
+ */
+
+struct LCFGResourceKeyBuffer {
+  /*@{*/
+  char * buffer;      /**< Type symbol, prefix and current resource name */
+  size_t size;        /**< Size of the buffer */
+  size_t prefix_len;  /**< Length of the prefix including the type symbol */
+  size_t name_len;    /**< Length of the current resource name */
+  /*@}*/
+};
+
+typedef struct LCFGResourceKeyBuffer LCFGResourceKeyBuffer;
+
+void lcfgresource_keybuf_init( LCFGResourceKeyBuffer * keybuf,
+                               const char * component,
+                               const char * namespace );
+
+ssize_t lcfgresource_keybuf_set_name( LCFGResourceKeyBuffer * keybuf,
+                                      const char * resource )
+  __attribute__((warn_unused_result));
+
+const char * lcfgresource_keybuf_get_key( LCFGResourceKeyBuffer * keybuf,
+                                          char type_symbol,
+                                          size_t * len );
+
+void lcfgresource_keybuf_clear( LCFGResourceKeyBuffer * keybuf );
+
 bool lcfgresource_set_attribute( LCFGResource * res,
                                  char type_symbol,
                                  const char * value,
@@ -459,6 +632,9 @@ bool lcfgresource_set_attribute( LCFGResource * res,
 
 unsigned long lcfgresource_hash( const LCFGResource * res );
 
+void lcfgresource_memory_stats( const LCFGResource * res,
+                                LCFGResourceStats * stats );
+
 #endif /* LCFG_CORE_RESOURCES_H */
 
 /* eof */
@@ -356,6 +356,38 @@ bool lcfgtagiter_has_prev( LCFGTagIterator * iterator );
 
 LCFGTag * lcfgtagiter_prev(LCFGTagIterator * iterator);
 
+/**
+ * @brief Fixed-depth stack of tag names
+ *
+ * This holds the tags for the ancestors of a resource whilst the
+ * resource name is built from a template. Only the top
+ * @c LCFG_TAGS_MAX_DEPTH tags can be used by a template so these are
+ * held in place, any tags below are only saved so that they can be
+ * restored when the stack is popped. The names are not copied, see
+ * @c lcfgtagstack_push() for details.
+ */
+
+struct LCFGTagStack {
+  const char * names[LCFG_TAGS_MAX_DEPTH]; /**< Top tag names, bottom first */
+  size_t lengths[LCFG_TAGS_MAX_DEPTH];     /**< Lengths of the tag names */
+  unsigned int depth;                      /**< Number of tags in the window */
+  unsigned int overflow;                   /**< Number of tags below the window */
+  unsigned int overflow_size;              /**< Allocated size for tags below the window */
+  const char ** overflow_names;            /**< Tag names below the window, bottom first */
+  size_t * overflow_lengths;               /**< Lengths of tag names below the window */
+};
+typedef struct LCFGTagStack LCFGTagStack;
+
+void lcfgtagstack_init( LCFGTagStack * stack );
+
+void lcfgtagstack_push( LCFGTagStack * stack,
+                        const char * name, size_t len );
+
+void lcfgtagstack_pop( LCFGTagStack * stack );
+
+void lcfgtagstack_from_taglist( LCFGTagStack * stack,
+                                const LCFGTagList * taglist );
+
 #endif /* LCFG_CORE_TAGS_H */
 
 /* eof */
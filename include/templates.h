@@ -63,13 +63,13 @@ LCFGTemplate * lcfgtemplate_find( const LCFGTemplate * head_template,
                                   const char * field_name );
 
 ssize_t lcfgtemplate_substitute( const LCFGTemplate * res_tmpl,
-				 LCFGTagList * taglist,
+				 const LCFGTagStack * tags,
 				 char ** result, size_t * size,
 				 char ** msg )
   __attribute__((warn_unused_result));
 
 char * lcfgresource_build_name( const LCFGTemplate * templates,
-                                LCFGTagList  * taglist,
+                                const LCFGTagStack * tags,
                                 const char * field_name,
                                 char ** msg );
 
@@ -23,6 +23,28 @@
 #define LCFGXML_ATTR_DEPTH 2
 #define LCFGXML_ATTRVALUE_DEPTH 3
 
+/**
+ * @brief Compression types for XML profiles
+ *
+ * Profiles compressed with these types can be read directly, see
+ * @c lcfgxml_reader_for_file() for details.
+ *
+ */
+
+typedef enum {
+  LCFG_XML_COMPRESS_NONE, /**< Plain XML */
+  LCFG_XML_COMPRESS_GZIP, /**< gzip */
+  LCFG_XML_COMPRESS_ZSTD  /**< zstd (only if supported at build time) */
+} LCFGXMLCompression;
+
+LCFGXMLCompression lcfgxml_compression_type( const unsigned char * data,
+                                             size_t len );
+
+LCFGStatus lcfgxml_reader_for_file( const char * filename,
+                                    xmlTextReaderPtr * result,
+                                    char ** msg )
+  __attribute__((warn_unused_result));
+
 LCFGStatus lcfgxml_init_reader( const char * filename,
                                 xmlTextReaderPtr * result,
                                 char ** msg )
@@ -46,12 +68,129 @@ LCFGStatus lcfgprofile_from_xml( const char   * filename,
 				 char        ** msg )
   __attribute__((warn_unused_result));
 
+LCFGStatus lcfgprofile_from_xml_with_options( const char   * filename,
+                                              LCFGProfile ** profile,
+                                              const char   * base_context,
+                                              const char   * base_derivation,
+                                              const LCFGContextList * ctxlist,
+                                              const LCFGTagList     * comps_wanted,
+                                              bool           require_packages,
+                                              LCFGOption     options,
+                                              char        ** msg )
+  __attribute__((warn_unused_result));
+
+LCFGStatus lcfgprofile_from_xml_parallel( const char   * filename,
+                                          LCFGProfile ** profile,
+                                          const char   * base_context,
+                                          const char   * base_derivation,
+                                          const LCFGContextList * ctxlist,
+                                          const LCFGTagList     * comps_wanted,
+                                          bool           require_packages,
+                                          char        ** msg )
+  __attribute__((warn_unused_result));
+
+LCFGStatus lcfgprofile_from_xml_parallel_with_options( const char   * filename,
+                                                       LCFGProfile ** profile,
+                                                       const char   * base_context,
+                                                       const char   * base_derivation,
+                                                       const LCFGContextList * ctxlist,
+                                                       const LCFGTagList     * comps_wanted,
+                                                       bool           require_packages,
+                                                       LCFGOption     options,
+                                                       char        ** msg )
+  __attribute__((warn_unused_result));
+
+/* Components in the previous profile are shared with the new profile,
+   only their reference counts are changed (atomically). The previous
+   profile must not be modified or destroyed by another thread during
+   the call. */
+
+LCFGStatus lcfgprofile_from_xml_incremental( const char   * filename,
+                                             LCFGProfile ** profile,
+                                             const LCFGProfile * previous,
+                                             const char   * base_context,
+                                             const char   * base_derivation,
+                                             const LCFGContextList * ctxlist,
+                                             const LCFGTagList     * comps_wanted,
+                                             bool           require_packages,
+                                             char        ** msg )
+  __attribute__((warn_unused_result));
+
+LCFGStatus lcfgprofile_from_xml_incremental_with_options( const char   * filename,
+                                                          LCFGProfile ** profile,
+                                                          const LCFGProfile * previous,
+                                                          const char   * base_context,
+                                                          const char   * base_derivation,
+                                                          const LCFGContextList * ctxlist,
+                                                          const LCFGTagList     * comps_wanted,
+                                                          bool           require_packages,
+                                                          LCFGOption     options,
+                                                          char        ** msg )
+  __attribute__((warn_unused_result));
+
+/**
+ * @brief A reference to a context from an XML profile
+ */
+
+struct LCFGXMLContextRef {
+  /*@{*/
+  char * context; /**< Name of the context */
+  char * owner;   /**< Name of the component (@c NULL for the packages) */
+  /*@}*/
+};
+
+typedef struct LCFGXMLContextRef LCFGXMLContextRef;
+
+/**
+ * @brief Index of the contexts referenced in an XML profile
+ *
+ * This maps the names of contexts to the components and packages
+ * which depend on them, see @c lcfgxml_context_index() for details.
+ */
+
+struct LCFGXMLContextIndex {
+  /*@{*/
+  char * filename;          /**< The XML profile which was indexed */
+  char * base_context;      /**< Base context used when loading the profile */
+  char * base_derivation;   /**< Base derivation used when loading the profile */
+  time_t mtime;             /**< Modification time of the XML profile */
+  LCFGXMLContextRef * refs; /**< References sorted by context name */
+  unsigned int nrefs;       /**< Number of references */
+  unsigned int size;        /**< Allocated size of the array of references */
+  /*@}*/
+};
+
+typedef struct LCFGXMLContextIndex LCFGXMLContextIndex;
+
+LCFGStatus lcfgxml_context_index( const char * filename,
+                                  const char * base_context,
+                                  const char * base_derivation,
+                                  LCFGXMLContextIndex ** result,
+                                  char ** msg )
+  __attribute__((warn_unused_result));
+
+void lcfgxml_context_index_destroy( LCFGXMLContextIndex * index );
+
+LCFGChange lcfgprofile_reeval_contexts( LCFGProfile * profile,
+                                        const LCFGXMLContextIndex * index,
+                                        const LCFGContextList * old_ctxlist,
+                                        const LCFGContextList * new_ctxlist,
+                                        LCFGTagList ** changed,
+                                        char ** msg )
+  __attribute__((warn_unused_result));
+
 LCFGChange lcfgprofile_overrides_xmldir( LCFGProfile  * profile,
                                          const char   * override_dir,
                                          const LCFGContextList * ctxlist,
                                          char        ** msg )
   __attribute__((warn_unused_result));
 
+LCFGChange lcfgprofile_overrides_xmldir_parallel( LCFGProfile  * profile,
+                                                  const char   * override_dir,
+                                                  const LCFGContextList * ctxlist,
+                                                  char        ** msg )
+  __attribute__((warn_unused_result));
+
 LCFGChange lcfgprofile_overrides_context( LCFGProfile * profile,
 					  const char * override_dir,
                                           LCFGContextList * ctxlist,
@@ -64,6 +203,28 @@ LCFGChange lcfgprofile_overrides_context( LCFGProfile * profile,
 #define LCFGXML_PACKAGES_PARENT_NODE "packages"
 #define LCFGXML_PACKAGES_CHILD_NODE  "package"
 
+/**
+ * @brief The values of the LCFG attributes for an XML element
+ *
+ * These point into the XML reader and are only valid until the reader
+ * is next moved on, see @c lcfgxml_gather_attributes() for details.
+ */
+
+struct LCFGXMLAttributes {
+  /*@{*/
+  const xmlChar * name;       /**< Value of @c cfg:name */
+  const xmlChar * derivation; /**< Value of @c cfg:derivation */
+  const xmlChar * context;    /**< Value of @c cfg:context */
+  const xmlChar * type;       /**< Value of @c cfg:type */
+  const xmlChar * template;   /**< Value of @c cfg:template */
+  /*@}*/
+};
+
+typedef struct LCFGXMLAttributes LCFGXMLAttributes;
+
+void lcfgxml_gather_attributes( xmlTextReaderPtr reader,
+                                LCFGXMLAttributes * attrs );
+
 bool lcfgxml_moveto_next_tag( xmlTextReaderPtr reader );
 
 bool lcfgxml_moveto_node( xmlTextReaderPtr reader,
@@ -77,8 +238,8 @@ LCFGStatus lcfgxml_error( char ** msg, const char * fmt, ...);
 LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
 				     LCFGComponent * lcfgcomp,
 				     const LCFGTemplate * templates,
-				     char ** thistag,
-				     const LCFGTagList * ancestor_tags,
+				     const char ** thistag,
+				     LCFGTagStack * tags,
 				     const char * base_context,
 				     const char * base_derivation,
 				     const LCFGContextList * ctxlist,
@@ -91,6 +252,7 @@ LCFGStatus lcfgxml_process_component( xmlTextReaderPtr reader,
 				      const char * base_context,
 				      const char * base_derivation,
 				      const LCFGContextList * ctxlist,
+				      LCFGOption options,
 				      char ** msg )
   __attribute__((warn_unused_result));
 
@@ -100,6 +262,7 @@ LCFGStatus lcfgxml_process_components( xmlTextReaderPtr reader,
 				       const char * base_derivation,
 				       const LCFGContextList * ctxlist,
 				       const LCFGTagList * comps_wanted,
+				       LCFGOption options,
 				       char ** msg )
   __attribute__((warn_unused_result));
 
@@ -0,0 +1,236 @@
+/**
+ * @file packages/arena.c
+ * @brief Arena allocator used when parsing LCFG packages
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packages.h"
+#include "container.h"
+
+/* Each slab is a single allocation with the header at the start and
+   the space for the objects following immediately after. */
+
+struct LCFGPkgArenaSlab {
+  struct LCFGPkgArenaSlab * next;
+  size_t size;
+};
+
+#define LCFG_PKGARENA_SLAB_SIZE 65536
+#define LCFG_PKGARENA_ALIGN     sizeof(void *)
+
+static struct LCFGPkgArenaSlab * lcfgpkgarena_add_slab( LCFGPkgArena * arena,
+                                                        size_t size ) {
+
+  struct LCFGPkgArenaSlab * slab =
+    malloc( sizeof(struct LCFGPkgArenaSlab) + size );
+  if ( slab == NULL ) {
+    perror( "Failed to allocate memory for LCFG package arena" );
+    exit(EXIT_FAILURE);
+  }
+
+  slab->size   = size;
+  slab->next   = arena->slabs;
+  arena->slabs = slab;
+
+  return slab;
+}
+
+/**
+ * @brief Create and initialise a new package arena
+ *
+ * Creates a new @c LCFGPkgArena which can be used to allocate the
+ * memory for packages (and the strings for their fields) in large
+ * slabs rather than with many small individual allocations. Memory
+ * is never freed individually, all the slabs are freed together when
+ * the arena is destroyed.
+ *
+ * Every package which is allocated from the arena holds a reference
+ * to it so that the memory remains valid for as long as the package
+ * is in use, even when it has been copied into other containers.
+ *
+ * If the memory allocation for the new structure is not successful the
+ * @c exit() function will be called with a non-zero value.
+ *
+ * The reference count for the structure is initialised to 1. To avoid
+ * memory leaks, when it is no longer required the
+ * @c lcfgpkgarena_relinquish() function should be called.
+ *
+ * @return Pointer to new @c LCFGPkgArena
+ *
+ */
+
+LCFGPkgArena * lcfgpkgarena_new(void) {
+
+  LCFGPkgArena * arena = calloc( 1, sizeof(LCFGPkgArena) );
+  if ( arena == NULL ) {
+    perror( "Failed to allocate memory for LCFG package arena" );
+    exit(EXIT_FAILURE);
+  }
+
+  arena->slabs     = NULL;
+  arena->next      = NULL;
+  arena->remaining = 0;
+  arena->_refcount = 1;
+
+  return arena;
+}
+
+/**
+ * @brief Destroy the package arena
+ *
+ * When the specified @c LCFGPkgArena is no longer required this will
+ * free all the slabs. This should only be called via @c
+ * lcfgpkgarena_relinquish() as the memory may still be in use by
+ * packages.
+ *
+ * @param[in] arena Pointer to @c LCFGPkgArena to be destroyed.
+ *
+ */
+
+static void lcfgpkgarena_destroy( LCFGPkgArena * arena ) {
+
+  if ( arena == NULL ) return;
+
+  struct LCFGPkgArenaSlab * slab = arena->slabs;
+  while ( slab != NULL ) {
+    struct LCFGPkgArenaSlab * next = slab->next;
+    free(slab);
+    slab = next;
+  }
+
+  free(arena);
+  arena = NULL;
+}
+
+/**
+ * @brief Acquire reference to package arena
+ *
+ * This is used to record a reference to the @c LCFGPkgArena, it
+ * does this by simply incrementing the reference count.
+ *
+ * @param[in] arena Pointer to @c LCFGPkgArena
+ *
+ */
+
+void lcfgpkgarena_acquire( LCFGPkgArena * arena ) {
+  assert( arena != NULL );
+
+  arena->_refcount += 1;
+}
+
+/**
+ * @brief Release reference to package arena
+ *
+ * This is used to release a reference to the @c LCFGPkgArena, it
+ * does this by simply decrementing the reference count. If the
+ * reference count reaches zero all the memory for the arena will be
+ * freed.
+ *
+ * If the value of the pointer passed in is @c NULL then the function
+ * has no affect.
+ *
+ * @param[in] arena Pointer to @c LCFGPkgArena
+ *
+ */
+
+void lcfgpkgarena_relinquish( LCFGPkgArena * arena ) {
+
+  if ( arena == NULL ) return;
+
+  if ( arena->_refcount > 0 )
+    arena->_refcount -= 1;
+
+  if ( arena->_refcount == 0 )
+    lcfgpkgarena_destroy(arena);
+
+}
+
+static void * lcfgpkgarena_take( LCFGPkgArena * arena, size_t size,
+                                 size_t align ) {
+  assert( arena != NULL );
+
+  /* Anything big gets a slab of its own, the current slab is kept for
+     subsequent small allocations */
+
+  if ( size > LCFG_PKGARENA_SLAB_SIZE / 4 ) {
+    struct LCFGPkgArenaSlab * slab = lcfgpkgarena_add_slab( arena, size );
+    return slab + 1;
+  }
+
+  size_t pad = ( align - ( (uintptr_t) arena->next % align ) ) % align;
+
+  if ( arena->next == NULL || size + pad > arena->remaining ) {
+    struct LCFGPkgArenaSlab * slab =
+      lcfgpkgarena_add_slab( arena, LCFG_PKGARENA_SLAB_SIZE );
+
+    arena->next      = (char *) ( slab + 1 );
+    arena->remaining = LCFG_PKGARENA_SLAB_SIZE;
+    pad = 0;
+  }
+
+  void * ptr = arena->next + pad;
+  arena->next      += pad + size;
+  arena->remaining -= pad + size;
+
+  return ptr;
+}
+
+/**
+ * @brief Allocate zeroed memory from the package arena
+ *
+ * The memory is suitably aligned for any structure.
+ *
+ * @param[in] arena Pointer to @c LCFGPkgArena
+ * @param[in] size Number of bytes required
+ *
+ * @return Pointer to the new memory
+ *
+ */
+
+void * lcfgpkgarena_alloc( LCFGPkgArena * arena, size_t size ) {
+
+  void * ptr = lcfgpkgarena_take( arena, size, LCFG_PKGARENA_ALIGN );
+  memset( ptr, 0, size );
+
+  return ptr;
+}
+
+/**
+ * @brief Copy a string into the package arena
+ *
+ * This is the arena equivalent of @c strndup(3), at most @c len
+ * characters are copied and the new string is always nul-terminated.
+ *
+ * @param[in] arena Pointer to @c LCFGPkgArena
+ * @param[in] str String to be copied
+ * @param[in] len Maximum number of characters to copy
+ *
+ * @return Pointer to the new string
+ *
+ */
+
+char * lcfgpkgarena_strndup( LCFGPkgArena * arena,
+                             const char * str, size_t len ) {
+  assert( str != NULL );
+
+  const char * end = memchr( str, '\0', len );
+  if ( end != NULL ) len = end - str;
+
+  char * copy = lcfgpkgarena_take( arena, len + 1, 1 );
+  memcpy( copy, str, len );
+  copy[len] = '\0';
+
+  return copy;
+}
+
+/* eof */
@@ -9,11 +9,15 @@
 
 #define _GNU_SOURCE /* for asprintf */
 
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -236,10 +240,16 @@ LCFGChange lcfgpackages_from_cpp( const char * filename,
 
   LCFGChange (*merge_fn)(void *, LCFGPackage *, char **);
 
+  /* Packages parsed into a set are allocated from an arena tied to
+     the set */
+
+  LCFGPkgArena * arena = NULL;
+
   void * pkgs;
   if ( ctr_type == LCFG_PKG_CONTAINER_SET ) {
     pkgs = ctr->set;
     merge_fn = &lcfgpkgset_merge_package;
+    arena = lcfgpkgset_arena(ctr->set);
   } else {
     pkgs = ctr->list;
     merge_fn = &lcfgpkglist_merge_package;
@@ -347,7 +357,8 @@ LCFGChange lcfgpackages_from_cpp( const char * filename,
     char * error_msg = NULL;
 
     LCFGPackage * pkg = NULL;
-    LCFGStatus parse_status = lcfgpackage_from_spec( line, &pkg, &error_msg );
+    LCFGStatus parse_status = lcfgpackage_parse_spec( line, arena,
+                                                      &pkg, &error_msg );
 
     if ( parse_status == LCFG_STATUS_ERROR )
       change = LCFG_CHANGE_ERROR;
@@ -360,9 +371,14 @@ LCFGChange lcfgpackages_from_cpp( const char * filename,
 
       if ( !lcfgpackage_has_arch(pkg) && !isempty(defarch) ) {
 
-        char * pkg_arch = strdup(defarch);
-        if ( !lcfgpackage_set_arch( pkg, pkg_arch ) ) {
-          free(pkg_arch);
+        char * pkg_arch = arena != NULL ?
+          lcfgpkgarena_strndup( arena, defarch, strlen(defarch) ) :
+          strdup(defarch);
+
+        if ( lcfgpackage_set_arch( pkg, pkg_arch ) ) {
+          if ( arena != NULL ) pkg->_arena_fields |= LCFG_PKG_ARENA_ARCH;
+        } else {
+          if ( arena == NULL ) free(pkg_arch);
           change = LCFG_CHANGE_ERROR;
           lcfgutils_build_message( &error_msg,
                                    "Failed to set package architecture to '%s'",
@@ -495,6 +511,265 @@ LCFGChange lcfgpackages_from_cpp( const char * filename,
   return change;
 }
 
+/* Debian Packages index support
+
+   The index files for upstream repositories are very large (50MB+)
+   so, rather than reading them line-by-line through stdio, the file
+   is mapped into memory and split into chunks on stanza boundaries
+   (i.e. blank lines). Each chunk is parsed on a separate thread into
+   an array of packages, those are then merged into the container in
+   file order so the results are identical to a serial parse.
+*/
+
+#define LCFG_DEBIDX_CHUNK_MIN   1048576 /* Never split into chunks smaller than 1MB */
+#define LCFG_DEBIDX_MAX_THREADS 16
+
+struct LCFGDebIndexChunk {
+  const char * start;    /**< Start of the chunk */
+  const char * end;      /**< End of the chunk (not inclusive) */
+  LCFGPackage ** pkgs;   /**< Packages parsed from the chunk */
+  unsigned int * ends;   /**< Line (within chunk) at which each package ends */
+  unsigned int count;    /**< Number of packages parsed */
+  unsigned int size;     /**< Size of the packages array */
+  unsigned int lines;    /**< Number of lines processed */
+  bool failed;           /**< Whether an error occurred */
+  char * error_msg;      /**< Any diagnostic message */
+};
+
+typedef struct LCFGDebIndexChunk LCFGDebIndexChunk;
+
+static void lcfgdebidx_chunk_store( LCFGDebIndexChunk * chunk,
+                                    LCFGPackage * pkg ) {
+
+  if ( chunk->count == chunk->size ) {
+    unsigned int new_size = chunk->size > 0 ? chunk->size * 2 : 256;
+
+    LCFGPackage ** new_pkgs = realloc( chunk->pkgs,
+                                       new_size * sizeof(LCFGPackage *) );
+    unsigned int * new_ends = realloc( chunk->ends,
+                                       new_size * sizeof(unsigned int) );
+    if ( new_pkgs == NULL || new_ends == NULL ) {
+      perror( "Failed to allocate memory whilst processing debian index file" );
+      exit(EXIT_FAILURE);
+    }
+
+    chunk->pkgs = new_pkgs;
+    chunk->ends = new_ends;
+    chunk->size = new_size;
+  }
+
+  chunk->ends[chunk->count]   = chunk->lines;
+  chunk->pkgs[chunk->count++] = pkg;
+}
+
+static bool lcfgdebidx_field( const char * line, size_t len,
+                              const char * field, size_t field_len,
+                              const char ** value, size_t * value_len ) {
+
+  if ( len < field_len || memcmp( line, field, field_len ) != 0 )
+    return false;
+
+  *value     = line + field_len;
+  *value_len = len - field_len;
+
+  return true;
+}
+
+static void * lcfgdebidx_parse_chunk( void * data ) {
+
+  LCFGDebIndexChunk * chunk = data;
+
+  LCFGPackage * pkg = NULL;
+  char * error_msg = NULL;
+  bool ok = true;
+
+  const char * cur = chunk->start;
+  while ( ok && cur < chunk->end ) {
+    chunk->lines++;
+
+    const char * eol = memchr( cur, '\n', chunk->end - cur );
+    if ( eol == NULL ) eol = chunk->end;
+
+    /* Trim leading and trailing whitespace */
+
+    const char * line = cur;
+    const char * line_end = eol;
+    while ( line < line_end && isspace(*line) ) line++;
+    while ( line_end > line && isspace(*( line_end - 1 )) ) line_end--;
+
+    size_t len = line_end - line;
+
+    cur = eol + 1;
+
+    if ( len == 0 ) {
+
+      if ( pkg != NULL ) {
+        lcfgdebidx_chunk_store( chunk, pkg );
+        pkg = NULL;
+      }
+
+      continue;
+    }
+
+    if ( pkg == NULL )
+      pkg = lcfgpackage_new();
+
+    /* Only interested in Package/Version/Architecture */
+
+    const char * value;
+    size_t value_len;
+    char * copy = NULL;
+
+    if ( lcfgdebidx_field( line, len, "Package: ", 9, &value, &value_len ) ) {
+      copy = strndup( value, value_len );
+      ok = lcfgpackage_set_name( pkg, copy );
+
+      if (ok) {
+        copy = NULL;
+      } else {
+        error_msg =
+          lcfgpackage_build_message(pkg, "Invalid name '%s'", copy );
+      }
+
+    } else if ( lcfgdebidx_field( line, len, "Version: ", 9,
+                                  &value, &value_len ) ) {
+
+      const char * sep = memrchr( value, '-', value_len );
+      size_t ver_len = sep == NULL ? value_len : (size_t) ( sep - value );
+
+      copy = strndup( value, ver_len );
+      ok = lcfgpackage_set_version( pkg, copy );
+
+      if (ok) {
+        copy = NULL;
+      } else {
+        error_msg =
+          lcfgpackage_build_message(pkg, "Invalid version '%s'", copy );
+      }
+
+      /* Release is optional for Debian (native) packages */
+
+      if ( ok && sep != NULL ) {
+        copy = strndup( sep + 1, value_len - ver_len - 1 );
+        ok = lcfgpackage_set_release( pkg, copy );
+
+        if (ok) {
+          copy = NULL;
+        } else {
+          error_msg =
+            lcfgpackage_build_message(pkg, "Invalid release '%s'", copy );
+        }
+      }
+
+    } else if ( lcfgdebidx_field( line, len, "Architecture: ", 14,
+                                  &value, &value_len ) ) {
+      copy = strndup( value, value_len );
+      ok = lcfgpackage_set_arch( pkg, copy );
+
+      if (ok) {
+        copy = NULL;
+      } else {
+        error_msg =
+          lcfgpackage_build_message(pkg, "Invalid architecture '%s'", copy );
+      }
+
+    } else if ( lcfgdebidx_field( line, len, "Filename: ", 10,
+                                  &value, &value_len ) ) {
+
+      /* ok, ok, this is a hack. I really needed to store the
+         location of the package file and I did not want to add yet
+         another field to the package struct just for this case. */
+
+      char * filename = strndup( value, value_len );
+      ok = lcfgpackage_set_derivation_as_string( pkg, filename );
+
+      if (!ok) {
+        error_msg =
+          lcfgpackage_build_message(pkg, "Invalid filename '%s'", filename );
+      }
+
+      free(filename);
+    }
+
+    free(copy);
+
+    if (!ok) {
+      lcfgpackage_relinquish(pkg);
+      pkg = NULL;
+    }
+
+  }
+
+  /* Any package at the very end of the chunk (e.g. no trailing blank
+     line at the end of the file) */
+
+  if ( pkg != NULL )
+    lcfgdebidx_chunk_store( chunk, pkg );
+
+  chunk->failed    = !ok;
+  chunk->error_msg = error_msg;
+
+  return NULL;
+}
+
+/* Find the start of the first blank line at or after the specified
+   position. Chunks are only ever split on stanza boundaries. */
+
+static const char * lcfgdebidx_next_boundary( const char * pos,
+                                              const char * end ) {
+
+  /* Move to the start of the next line */
+
+  const char * eol = memchr( pos, '\n', end - pos );
+  if ( eol == NULL ) return end;
+  pos = eol + 1;
+
+  while ( pos < end ) {
+
+    eol = memchr( pos, '\n', end - pos );
+    if ( eol == NULL ) eol = end;
+
+    const char * ptr = pos;
+    while ( ptr < eol && isspace(*ptr) ) ptr++;
+
+    if ( ptr == eol ) return pos;
+
+    pos = eol + 1;
+  }
+
+  return end;
+}
+
+/**
+ * @brief Process a Debian Packages index file
+ *
+ * This processes a Debian Packages index file (as used by apt
+ * repositories) and merges each package into the container using the
+ * relevant merge function (e.g. @c lcfgpkgset_merge_package or @c
+ * lcfgpkglist_merge_package). Only the @c Package, @c Version, @c
+ * Architecture and @c Filename fields are used, all other fields are
+ * ignored.
+ *
+ * The file is mapped into memory and large files are split on stanza
+ * boundaries into chunks which are parsed concurrently. The packages
+ * are merged into the container in the order in which they appear in
+ * the file. When the container is an @c LCFGPackageSet it is sized
+ * ahead of the merge so that it does not need to be resized whilst
+ * the packages are inserted.
+ *
+ * An error is returned if the file does not exist unless the
+ * @c LCFG_OPT_ALLOW_NOEXIST option is specified.
+ *
+ * @param[in] filename The path to the Packages file
+ * @param[in] ctr Reference to a @c LCFGPackageSet or @c LCFGPackageList
+ * @param[in] ctr_type Type of package container being passed
+ * @param[in] options Controls the behaviour of the process.
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
 LCFGChange lcfgpackages_from_debian_index( const char * filename,
                                            LCFGPkgContainer * ctr,
                                            LCFGPkgContainerType ctr_type,
@@ -508,8 +783,8 @@ LCFGChange lcfgpackages_from_debian_index( const char * filename,
     return LCFG_CHANGE_ERROR;
   }
 
-  FILE * fp;
-  if ( (fp = fopen(filename, "r")) == NULL ) {
+  int fd;
+  if ( (fd = open(filename, O_RDONLY)) == -1 ) {
 
     if (errno == ENOENT) {
       if ( options&LCFG_OPT_ALLOW_NOEXIST ) {
@@ -525,169 +800,170 @@ LCFGChange lcfgpackages_from_debian_index( const char * filename,
 
   }
 
-  /* Setup the getline buffer */
-
-  size_t line_len = 128;
-  char * line = malloc( line_len * sizeof(char) );
-  if ( line == NULL ) {
-    perror( "Failed to allocate memory whilst processing debian index file" );
-    exit(EXIT_FAILURE);
+  struct stat sb;
+  if ( fstat( fd, &sb ) == -1 ) {
+    close(fd);
+    lcfgutils_build_message( msg, "File is not readable" );
+    return LCFG_CHANGE_ERROR;
   }
 
-  /* Process index file
+  /* Nothing to do for an empty file */
 
-     Select package list merge function - hack to support sets and
-     lists - this generates warnings about pointer types but its
-     perfectly valid code.
-  */
+  if ( sb.st_size == 0 ) {
+    close(fd);
+    return LCFG_CHANGE_NONE;
+  }
 
-  LCFGChange (*merge_fn)(void *, LCFGPackage *, char **);
+  size_t map_size = (size_t) sb.st_size;
+  const char * map = mmap( NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close(fd);
 
-  void * pkgs;
-  if ( ctr_type == LCFG_PKG_CONTAINER_SET ) {
-    pkgs = ctr->set;
-    merge_fn = &lcfgpkgset_merge_package;
-  } else {
-    pkgs = ctr->list;
-    merge_fn = &lcfgpkglist_merge_package;
+  if ( map == MAP_FAILED ) {
+    lcfgutils_build_message( msg, "Failed to map file into memory" );
+    return LCFG_CHANGE_ERROR;
   }
 
-  LCFGChange change = LCFG_CHANGE_NONE;
-  LCFGPackage * pkg = NULL;
-  char * error_msg = NULL;
+  (void) madvise( (void *) map, map_size, MADV_SEQUENTIAL );
 
-  unsigned int cur_line = 0;
-  while( LCFGChangeOK(change) && getline( &line, &line_len, fp ) != -1 ) {
-    cur_line++;
+  /* Decide how many chunks are required */
 
-    lcfgutils_string_trim(line);
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if ( ncpus < 1 ) ncpus = 1;
 
-    if ( isempty(line) ) {
+  unsigned int nchunks = map_size / LCFG_DEBIDX_CHUNK_MIN + 1;
+  if ( nchunks > (unsigned int) ncpus )
+    nchunks = ncpus;
+  if ( nchunks > LCFG_DEBIDX_MAX_THREADS )
+    nchunks = LCFG_DEBIDX_MAX_THREADS;
 
-      if ( pkg == NULL )
-        continue;
+  LCFGDebIndexChunk * chunks = calloc( nchunks, sizeof(LCFGDebIndexChunk) );
+  if ( chunks == NULL ) {
+    perror( "Failed to allocate memory whilst processing debian index file" );
+    exit(EXIT_FAILURE);
+  }
 
-      /* Merge package into container (set or list) */
+  const char * map_end = map + map_size;
+  size_t chunk_size = map_size / nchunks;
 
-      LCFGChange merge_status = (*merge_fn)( pkgs, pkg, &error_msg );
-      if ( LCFGChangeError(merge_status) )
-        change = LCFG_CHANGE_ERROR;
-      else if ( merge_status != LCFG_CHANGE_NONE )
-        change = LCFG_CHANGE_MODIFIED;
-
-      lcfgpackage_relinquish(pkg);
-      pkg = NULL;
+  unsigned int i;
+  const char * pos = map;
+  for ( i=0; i<nchunks; i++ ) {
+    chunks[i].start = pos;
 
+    if ( i == nchunks - 1 ) {
+      pos = map_end;
     } else {
+      const char * target = map + ( i + 1 ) * chunk_size;
+      pos = lcfgdebidx_next_boundary( target > pos ? target : pos, map_end );
+    }
 
-      if ( pkg == NULL )
-        pkg = lcfgpackage_new();
+    chunks[i].end = pos;
+  }
 
-      /* Only interested in Package/Version/Architecture */
+  /* Parse the chunks. The first is always done in this thread, if a
+     thread cannot be created the chunk is also parsed here. */
 
-      bool ok = true;
-      char * value = NULL;
-      if ( strncmp( line, "Package: ", 9 ) == 0 ) {
-        value = strdup( line + 9 );
-        ok = lcfgpackage_set_name( pkg, value );
+  pthread_t * threads = calloc( nchunks, sizeof(pthread_t) );
+  bool * started = calloc( nchunks, sizeof(bool) );
+  if ( threads == NULL || started == NULL ) {
+    perror( "Failed to allocate memory whilst processing debian index file" );
+    exit(EXIT_FAILURE);
+  }
 
-        if (ok) {
-          value = NULL;
-        } else {
-          error_msg =
-            lcfgpackage_build_message(pkg, "Invalid name '%s'", value );
-        }
+  for ( i=1; i<nchunks; i++ ) {
+    if ( chunks[i].start < chunks[i].end )
+      started[i] = ( pthread_create( &threads[i], NULL,
+                                     lcfgdebidx_parse_chunk,
+                                     &chunks[i] ) == 0 );
+  }
 
-      } else if ( strncmp( line, "Version: ", 9 ) == 0 ) {
-        char * ver_start = line + 9;
-        char * sep = strrchr( ver_start, '-' );
-        if ( sep == NULL )
-          value = strdup( ver_start );
-        else
-          value = strndup( ver_start, sep - ver_start );
+  (void) lcfgdebidx_parse_chunk( &chunks[0] );
 
-        ok = lcfgpackage_set_version( pkg, value );
+  for ( i=1; i<nchunks; i++ ) {
+    if ( started[i] )
+      pthread_join( threads[i], NULL );
+    else
+      (void) lcfgdebidx_parse_chunk( &chunks[i] );
+  }
 
-        if (ok) {
-          value = NULL;
-        } else {
-          error_msg =
-            lcfgpackage_build_message(pkg, "Invalid version '%s'", value );
-        }
+  free(threads);
+  free(started);
 
-        /* Release is optional for Debian (native) packages */
+  munmap( (void *) map, map_size );
 
-        if ( sep != NULL ) {
-          value = strdup( sep + 1 );
+  /* Process index file
 
-          ok = lcfgpackage_set_release( pkg, value );
+     Select package list merge function - hack to support sets and
+     lists - this generates warnings about pointer types but its
+     perfectly valid code.
+  */
 
-          if (ok) {
-            value = NULL;
-          } else {
-            error_msg =
-              lcfgpackage_build_message(pkg, "Invalid release '%s'", value );
-          }
+  LCFGChange (*merge_fn)(void *, LCFGPackage *, char **);
 
-        }
-        
-      } else if ( strncmp( line, "Architecture: ", 14 ) == 0 ) {
-        value = strdup( line + 14 );
-        ok = lcfgpackage_set_arch( pkg, value );
+  void * pkgs;
+  if ( ctr_type == LCFG_PKG_CONTAINER_SET ) {
+    pkgs = ctr->set;
+    merge_fn = &lcfgpkgset_merge_package;
 
-        if (ok) {
-          value = NULL;
-        } else {
-          error_msg =
-            lcfgpackage_build_message(pkg, "Invalid architecture '%s'", value );
-        }
+    unsigned long total = 0;
+    for ( i=0; i<nchunks; i++ )
+      total += chunks[i].count;
 
-      } else if ( strncmp( line, "Filename: ", 10 ) == 0 ) {
+    lcfgpkgset_reserve( ctr->set, total );
+  } else {
+    pkgs = ctr->list;
+    merge_fn = &lcfgpkglist_merge_package;
+  }
 
-        /* ok, ok, this is a hack. I really needed to store the
-           location of the package file and I did not want to add yet
-           another field to the package struct just for this case. */
+  LCFGChange change = LCFG_CHANGE_NONE;
+  char * error_msg = NULL;
 
-        const char * filename = line + 10; /* copy not required */
-        ok = lcfgpackage_set_derivation_as_string( pkg, filename );
+  /* Line numbers are only needed for error messages */
 
-        if (!ok) {
-          error_msg =
-            lcfgpackage_build_message(pkg, "Invalid filename '%s'", filename );
-        }
+  unsigned int base_line = 0;
+  unsigned int cur_line  = 0;
 
-      }
+  for ( i=0; i<nchunks; i++ ) {
+    LCFGDebIndexChunk * chunk = &chunks[i];
 
-      if (!ok) {
-        change = LCFG_CHANGE_ERROR;
+    unsigned int j;
+    for ( j=0; j<chunk->count; j++ ) {
+      LCFGPackage * pkg = chunk->pkgs[j];
 
-        free(value);
+      if ( LCFGChangeOK(change) ) {
 
-        lcfgpackage_relinquish(pkg);
-        pkg = NULL;
+        /* Merge package into container (set or list) */
+
+        LCFGChange merge_status = (*merge_fn)( pkgs, pkg, &error_msg );
+        if ( LCFGChangeError(merge_status) ) {
+          change = LCFG_CHANGE_ERROR;
+          cur_line = base_line + chunk->ends[j];
+        } else if ( merge_status != LCFG_CHANGE_NONE ) {
+          change = LCFG_CHANGE_MODIFIED;
+        }
 
       }
+
+      lcfgpackage_relinquish(pkg);
     }
-    
-  }
 
-  free(line);
+    free(chunk->pkgs);
+    free(chunk->ends);
 
-  if ( pkg != NULL ) {
+    if ( LCFGChangeOK(change) && chunk->failed ) {
+      change = LCFG_CHANGE_ERROR;
+      cur_line = base_line + chunk->lines;
 
-    /* Merge package into container (set or list) */
+      error_msg = chunk->error_msg;
+      chunk->error_msg = NULL;
+    }
 
-    LCFGChange merge_status = (*merge_fn)( pkgs, pkg, &error_msg );
-    if ( LCFGChangeError(merge_status) )
-      change = LCFG_CHANGE_ERROR;
-    else if ( merge_status != LCFG_CHANGE_NONE )
-      change = LCFG_CHANGE_MODIFIED;
+    base_line += chunk->lines;
 
-    lcfgpackage_relinquish(pkg);
-    pkg = NULL;
+    free(chunk->error_msg);
   }
 
-  fclose(fp);
+  free(chunks);
 
   /* Issue a useful error message */
   if ( LCFGChangeError(change) ) {
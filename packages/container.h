@@ -3,6 +3,8 @@
 #ifndef LCFG_CORE_PACKAGES_CONTAINER_H
 #define LCFG_CORE_PACKAGES_CONTAINER_H
 
+#include <stdint.h>
+
 /**
  * @brief Package container identifier
  *
@@ -56,6 +58,95 @@ LCFGChange lcfgpackages_from_debian_index( const char * filename,
                                            char ** msg )
   __attribute__((warn_unused_result));
 
+/**
+ * @brief Arena for parsed packages
+ *
+ * Packages (and the strings for their fields) which are created when
+ * parsing files into a package set can be allocated from an arena in
+ * large slabs. Each package allocated from the arena holds a
+ * reference so the slabs are all freed together when the set and
+ * every package are gone. See @c lcfgpkgarena_new() for details.
+ *
+ */
+
+struct LCFGPkgArena {
+  struct LCFGPkgArenaSlab * slabs; /**< List of slabs, current first */
+  char * next;                     /**< Next free byte in current slab */
+  size_t remaining;                /**< Free bytes in current slab */
+  unsigned int _refcount;
+};
+typedef struct LCFGPkgArena LCFGPkgArena;
+
+LCFGPkgArena * lcfgpkgarena_new(void);
+void lcfgpkgarena_acquire( LCFGPkgArena * arena );
+void lcfgpkgarena_relinquish( LCFGPkgArena * arena );
+void * lcfgpkgarena_alloc( LCFGPkgArena * arena, size_t size );
+char * lcfgpkgarena_strndup( LCFGPkgArena * arena,
+                             const char * str, size_t len );
+
+/* Flags for package fields with strings allocated from an arena,
+   these are never freed individually */
+
+#define LCFG_PKG_ARENA_NAME     (1<<0)
+#define LCFG_PKG_ARENA_ARCH     (1<<1)
+#define LCFG_PKG_ARENA_VERSION  (1<<2)
+#define LCFG_PKG_ARENA_RELEASE  (1<<3)
+#define LCFG_PKG_ARENA_FLAGS    (1<<4)
+#define LCFG_PKG_ARENA_CONTEXT  (1<<5)
+#define LCFG_PKG_ARENA_CATEGORY (1<<6)
+
+LCFGPackage * lcfgpackage_arena_new( LCFGPkgArena * arena );
+
+LCFGStatus lcfgpackage_parse_spec( const char * input,
+                                   LCFGPkgArena * arena,
+                                   LCFGPackage ** result,
+                                   char ** msg )
+  __attribute__((warn_unused_result));
+
+LCFGStatus lcfgpackage_parse_rpm_filename( const char * input,
+                                           LCFGPkgArena * arena,
+                                           LCFGPackage ** result,
+                                           char ** msg )
+  __attribute__((warn_unused_result));
+
+LCFGPkgArena * lcfgpkgset_arena( struct LCFGPackageSet * pkgset );
+
+size_t lcfgpackages_buffer_append( char ** buffer, size_t * size, size_t len,
+                                   const char * str, size_t str_len );
+
+void lcfgpkgset_reserve( struct LCFGPackageSet * pkgset,
+                         unsigned long entries );
+
+/**
+ * @brief Search index for package sets
+ *
+ * This holds the package names in sorted order, the reversed names in
+ * sorted order and the posting lists of slots for every trigram which
+ * appears in the names. The slots refer to the package lists array
+ * of the @c LCFGPackageSet. See @c lcfgpkgset_build_index() for
+ * details.
+ *
+ */
+
+struct LCFGPkgSetIndex {
+  unsigned long size;          /**< Number of names */
+  char * strings;              /**< Storage for names and reversed names */
+  const char ** names;         /**< Sorted names */
+  unsigned long * name_slots;  /**< Slot for each sorted name */
+  const char ** rnames;        /**< Sorted reversed names */
+  unsigned long * rname_slots; /**< Slot for each sorted reversed name */
+  unsigned long ngrams;        /**< Number of distinct trigrams */
+  uint32_t * grams;            /**< Sorted trigrams */
+  unsigned long * gram_start;  /**< Start of posting list for each trigram */
+  unsigned long * postings;    /**< Posting lists of slots */
+};
+typedef struct LCFGPkgSetIndex LCFGPkgSetIndex;
+
+bool lcfgpkgset_index_candidates( const struct LCFGPackageSet * pkgset,
+                                  const char * pattern,
+                                  const unsigned long ** result,
+                                  unsigned long * count );
+
 #endif /* LCFG_CORE_PACKAGES_CONTAINER_H */
 
 /* eof */
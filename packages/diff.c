@@ -0,0 +1,429 @@
+/**
+ * @file packages/diff.c
+ * @brief Functions for finding the differences between LCFG package sets
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2017 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packages.h"
+#include "utils.h"
+
+/* Gather all the valid packages from a set into an array which is
+   sorted by name, architecture and version. */
+
+static int lcfgpkgdiff_compare_keys( const LCFGPackage * pkg1,
+                                     const LCFGPackage * pkg2 ) {
+
+  int result = strcmp( pkg1->name, pkg2->name );
+
+  if ( result == 0 )
+    result = lcfgpackage_compare_archs( pkg1, pkg2 );
+
+  return result;
+}
+
+static int lcfgpkgdiff_sort_cmp( const void * a, const void * b ) {
+  const LCFGPackage * pkg1 = *( (LCFGPackage * const *) a );
+  const LCFGPackage * pkg2 = *( (LCFGPackage * const *) b );
+
+  int result = lcfgpkgdiff_compare_keys( pkg1, pkg2 );
+
+  if ( result == 0 )
+    result = lcfgpackage_compare_versions( pkg1, pkg2 );
+
+  return result;
+}
+
+static unsigned int lcfgpkgdiff_sorted_packages( const LCFGPackageSet * pkgset,
+                                                 LCFGPackage *** result ) {
+
+  *result = NULL;
+
+  if ( lcfgpkgset_is_empty(pkgset) ) return 0;
+
+  unsigned int size = lcfgpkgset_size(pkgset);
+
+  LCFGPackage ** pkgs = calloc( size, sizeof(LCFGPackage *) );
+  if ( pkgs == NULL ) {
+    perror( "Failed to allocate memory for LCFG package diff" );
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int count = 0;
+
+  unsigned long i;
+  for ( i=0; i<pkgset->buckets; i++ ) {
+    const LCFGPackageList * pkglist = pkgset->packages[i];
+    if ( pkglist == NULL ) continue;
+
+    const LCFGSListNode * cur_node = NULL;
+    for ( cur_node = lcfgslist_head(pkglist);
+          cur_node != NULL;
+          cur_node = lcfgslist_next(cur_node) ) {
+
+      LCFGPackage * pkg = lcfgslist_data(cur_node);
+      if ( lcfgpackage_is_valid(pkg) )
+        pkgs[count++] = pkg;
+    }
+  }
+
+  qsort( pkgs, count, sizeof(LCFGPackage *), lcfgpkgdiff_sort_cmp );
+
+  *result = pkgs;
+
+  return count;
+}
+
+static void lcfgpkgdiff_store( LCFGPkgDiffEntry * entries,
+                               unsigned int * count,
+                               LCFGPkgDiffType type,
+                               LCFGPackage * old_pkg,
+                               LCFGPackage * new_pkg ) {
+
+  LCFGPkgDiffEntry * entry = &entries[(*count)++];
+
+  entry->type = type;
+
+  entry->old = old_pkg;
+  if ( old_pkg != NULL )
+    lcfgpackage_acquire(old_pkg);
+
+  entry->new = new_pkg;
+  if ( new_pkg != NULL )
+    lcfgpackage_acquire(new_pkg);
+
+}
+
+/**
+ * @brief Find the differences between two package sets
+ *
+ * This compares two @c LCFGPackageSet and classifies every package as
+ * being @e added, @e removed, @e upgraded, @e downgraded or
+ * @e unchanged. A typical use would be comparing the packages in a
+ * profile with those currently installed (e.g. as returned by
+ * @c lcfgpkgset_from_rpm_db() ) to plan an installation.
+ *
+ * The packages in both sets are sorted by name and architecture and
+ * then compared with a single merge-join pass. Packages are matched
+ * by name and architecture, when there is exactly one package in each
+ * set for a name/architecture the versions are compared using
+ * @c lcfgpackage_compare_versions() to decide whether it has been
+ * upgraded, downgraded or is unchanged. When there are multiple
+ * versions for a name/architecture (e.g. kernels) any versions which
+ * only appear in the first set are considered to be removed and
+ * those which only appear in the second set are considered to be
+ * added.
+ *
+ * The results are stored in a single array grouped by type of
+ * change, use @c lcfgpkgsetdiff_count() and
+ * @c lcfgpkgsetdiff_entries() to access them. Within each group the
+ * entries are sorted by name and architecture.
+ *
+ * Either set may be @c NULL which is treated as being empty.
+ *
+ * To avoid memory leaks, when the diff is no longer required the
+ * @c lcfgpkgsetdiff_relinquish() function should be called.
+ *
+ * @param[in] pkgset1 Pointer to 'old' @c LCFGPackageSet (may be @c NULL)
+ * @param[in] pkgset2 Pointer to 'new' @c LCFGPackageSet (may be @c NULL)
+ * @param[out] result Reference to pointer to new @c LCFGPkgSetDiff
+ *
+ * @return Integer value indicating whether there are any differences
+ *
+ */
+
+LCFGChange lcfgpkgset_diff( const LCFGPackageSet * pkgset1,
+                            const LCFGPackageSet * pkgset2,
+                            LCFGPkgSetDiff ** result ) {
+
+  *result = NULL;
+
+  LCFGPackage ** pkgs1 = NULL;
+  unsigned int count1 = lcfgpkgdiff_sorted_packages( pkgset1, &pkgs1 );
+
+  LCFGPackage ** pkgs2 = NULL;
+  unsigned int count2 = lcfgpkgdiff_sorted_packages( pkgset2, &pkgs2 );
+
+  /* Every package produces at most one entry so this is the upper
+     bound on the number of entries */
+
+  size_t max_entries = (size_t) count1 + (size_t) count2;
+
+  LCFGPkgDiffEntry * work = NULL;
+  if ( max_entries > 0 ) {
+    work = calloc( max_entries, sizeof(LCFGPkgDiffEntry) );
+    if ( work == NULL ) {
+      perror( "Failed to allocate memory for LCFG package diff" );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  unsigned int n = 0;
+
+  unsigned int i = 0, j = 0;
+  while ( i < count1 || j < count2 ) {
+
+    int key_cmp;
+    if ( i == count1 )
+      key_cmp = 1;
+    else if ( j == count2 )
+      key_cmp = -1;
+    else
+      key_cmp = lcfgpkgdiff_compare_keys( pkgs1[i], pkgs2[j] );
+
+    if ( key_cmp < 0 ) {
+      lcfgpkgdiff_store( work, &n, LCFG_PKGDIFF_REMOVED, pkgs1[i++], NULL );
+      continue;
+    } else if ( key_cmp > 0 ) {
+      lcfgpkgdiff_store( work, &n, LCFG_PKGDIFF_ADDED, NULL, pkgs2[j++] );
+      continue;
+    }
+
+    /* Find the extent of the group for this name/arch in each set */
+
+    unsigned int end1 = i + 1;
+    while ( end1 < count1 &&
+            lcfgpkgdiff_compare_keys( pkgs1[i], pkgs1[end1] ) == 0 ) end1++;
+
+    unsigned int end2 = j + 1;
+    while ( end2 < count2 &&
+            lcfgpkgdiff_compare_keys( pkgs2[j], pkgs2[end2] ) == 0 ) end2++;
+
+    if ( end1 - i == 1 && end2 - j == 1 ) {
+      int ver_cmp = lcfgpackage_compare_versions( pkgs1[i], pkgs2[j] );
+
+      LCFGPkgDiffType type = LCFG_PKGDIFF_UNCHANGED;
+      if ( ver_cmp < 0 )
+        type = LCFG_PKGDIFF_UPGRADED;
+      else if ( ver_cmp > 0 )
+        type = LCFG_PKGDIFF_DOWNGRADED;
+
+      lcfgpkgdiff_store( work, &n, type, pkgs1[i], pkgs2[j] );
+    } else {
+
+      /* Multiple versions - merge-join on the version */
+
+      while ( i < end1 || j < end2 ) {
+
+        int ver_cmp;
+        if ( i == end1 )
+          ver_cmp = 1;
+        else if ( j == end2 )
+          ver_cmp = -1;
+        else
+          ver_cmp = lcfgpackage_compare_versions( pkgs1[i], pkgs2[j] );
+
+        if ( ver_cmp < 0 ) {
+          lcfgpkgdiff_store( work, &n, LCFG_PKGDIFF_REMOVED, pkgs1[i++], NULL );
+        } else if ( ver_cmp > 0 ) {
+          lcfgpkgdiff_store( work, &n, LCFG_PKGDIFF_ADDED, NULL, pkgs2[j++] );
+        } else {
+          lcfgpkgdiff_store( work, &n, LCFG_PKGDIFF_UNCHANGED,
+                             pkgs1[i++], pkgs2[j++] );
+        }
+
+      }
+
+    }
+
+    i = end1;
+    j = end2;
+  }
+
+  free(pkgs1);
+  free(pkgs2);
+
+  /* Group the entries by type using a counting sort, this preserves
+     the name/arch ordering within each group. */
+
+  LCFGPkgSetDiff * diff = calloc( 1, sizeof(LCFGPkgSetDiff) );
+  if ( diff == NULL ) {
+    perror( "Failed to allocate memory for LCFG package diff" );
+    exit(EXIT_FAILURE);
+  }
+
+  diff->size      = n;
+  diff->_refcount = 1;
+
+  if ( n > 0 ) {
+    diff->entries = calloc( n, sizeof(LCFGPkgDiffEntry) );
+    if ( diff->entries == NULL ) {
+      perror( "Failed to allocate memory for LCFG package diff" );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  unsigned int k;
+  for ( k=0; k<n; k++ )
+    diff->count[work[k].type]++;
+
+  unsigned int offset = 0;
+  for ( k=0; k<LCFG_PKGDIFF_TYPES; k++ ) {
+    diff->start[k] = offset;
+    offset += diff->count[k];
+  }
+
+  unsigned int next[LCFG_PKGDIFF_TYPES];
+  memcpy( next, diff->start, sizeof(next) );
+
+  for ( k=0; k<n; k++ )
+    diff->entries[next[work[k].type]++] = work[k];
+
+  free(work);
+
+  *result = diff;
+
+  return ( lcfgpkgsetdiff_has_changes(diff) ?
+           LCFG_CHANGE_MODIFIED : LCFG_CHANGE_NONE );
+}
+
+/**
+ * @brief Destroy the package set diff
+ *
+ * When the specified @c LCFGPkgSetDiff is no longer required this
+ * will free all associated memory. The references to the packages
+ * will be released using @c lcfgpackage_relinquish().
+ *
+ * If the value of the pointer passed in is @c NULL then the function
+ * has no affect.
+ *
+ * @param[in] diff Pointer to @c LCFGPkgSetDiff to be destroyed.
+ *
+ */
+
+void lcfgpkgsetdiff_destroy( LCFGPkgSetDiff * diff ) {
+
+  if ( diff == NULL ) return;
+
+  unsigned int i;
+  for ( i=0; i<diff->size; i++ ) {
+    lcfgpackage_relinquish(diff->entries[i].old);
+    lcfgpackage_relinquish(diff->entries[i].new);
+  }
+
+  free(diff->entries);
+  diff->entries = NULL;
+
+  free(diff);
+  diff = NULL;
+}
+
+/**
+ * @brief Acquire reference to package set diff
+ *
+ * This is used to record a reference to the @c LCFGPkgSetDiff, it
+ * does this by simply incrementing the reference count.
+ *
+ * To avoid memory leaks, once the reference to the structure is no
+ * longer required the @c lcfgpkgsetdiff_relinquish() function should
+ * be called.
+ *
+ * @param[in] diff Pointer to @c LCFGPkgSetDiff
+ *
+ */
+
+void lcfgpkgsetdiff_acquire( LCFGPkgSetDiff * diff ) {
+  assert( diff != NULL );
+
+  diff->_refcount += 1;
+}
+
+/**
+ * @brief Release reference to package set diff
+ *
+ * This is used to release a reference to the @c LCFGPkgSetDiff, it
+ * does this by simply decrementing the reference count. If the
+ * reference count reaches zero the @c lcfgpkgsetdiff_destroy()
+ * function will be called to clean up the memory associated with the
+ * structure.
+ *
+ * If the value of the pointer passed in is @c NULL then the function
+ * has no affect.
+ *
+ * @param[in] diff Pointer to @c LCFGPkgSetDiff
+ *
+ */
+
+void lcfgpkgsetdiff_relinquish( LCFGPkgSetDiff * diff ) {
+
+  if ( diff == NULL ) return;
+
+  if ( diff->_refcount > 0 )
+    diff->_refcount -= 1;
+
+  if ( diff->_refcount == 0 )
+    lcfgpkgsetdiff_destroy(diff);
+
+}
+
+/**
+ * @brief Get the number of entries of a particular type
+ *
+ * @param[in] diff Pointer to @c LCFGPkgSetDiff
+ * @param[in] type The type of difference
+ *
+ * @return Number of entries of the specified type
+ *
+ */
+
+unsigned int lcfgpkgsetdiff_count( const LCFGPkgSetDiff * diff,
+                                   LCFGPkgDiffType type ) {
+  assert( diff != NULL );
+  assert( type < LCFG_PKGDIFF_TYPES );
+
+  return diff->count[type];
+}
+
+/**
+ * @brief Get the entries of a particular type
+ *
+ * This returns a pointer to the first entry of the specified type,
+ * the number of entries can be found using
+ * @c lcfgpkgsetdiff_count(). The entries are stored contiguously so
+ * they can be accessed directly as an array. If there are no entries
+ * of the type then @c NULL is returned.
+ *
+ * The entries belong to the @c LCFGPkgSetDiff and must not be freed.
+ *
+ * @param[in] diff Pointer to @c LCFGPkgSetDiff
+ * @param[in] type The type of difference
+ *
+ * @return Pointer to the first @c LCFGPkgDiffEntry (or @c NULL)
+ *
+ */
+
+const LCFGPkgDiffEntry * lcfgpkgsetdiff_entries( const LCFGPkgSetDiff * diff,
+                                                 LCFGPkgDiffType type ) {
+  assert( diff != NULL );
+  assert( type < LCFG_PKGDIFF_TYPES );
+
+  if ( diff->count[type] == 0 ) return NULL;
+
+  return diff->entries + diff->start[type];
+}
+
+/**
+ * @brief Check if there are any differences
+ *
+ * @param[in] diff Pointer to @c LCFGPkgSetDiff
+ *
+ * @return Boolean which indicates if any package has changed
+ *
+ */
+
+bool lcfgpkgsetdiff_has_changes( const LCFGPkgSetDiff * diff ) {
+
+  if ( diff == NULL ) return false;
+
+  return ( diff->size > diff->count[LCFG_PKGDIFF_UNCHANGED] );
+}
+
+/* eof */
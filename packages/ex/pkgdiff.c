@@ -0,0 +1,114 @@
+/* Benchmark for lcfgpkgset_diff()
+
+   Builds two synthetic package sets (default 10000 packages each)
+   which differ by a known number of added, removed, upgraded and
+   downgraded packages and then times the diff. */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lcfg/packages.h>
+
+static LCFGPackage * make_package( unsigned int id, unsigned int ver ) {
+
+  LCFGPackage * pkg = lcfgpackage_new();
+
+  char * name = NULL;
+  char * version = NULL;
+  if ( asprintf( &name, "package%05u", id ) < 0 ||
+       asprintf( &version, "1.%u", ver ) < 0 ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  if ( !lcfgpackage_set_name( pkg, name ) ||
+       !lcfgpackage_set_version( pkg, version ) ||
+       !lcfgpackage_set_release( pkg, strdup("1") ) ||
+       !lcfgpackage_set_arch( pkg, strdup( id % 4 ? "x86_64" : "noarch" ) ) ) {
+    fprintf( stderr, "Failed to create package\n" );
+    exit(EXIT_FAILURE);
+  }
+
+  return pkg;
+}
+
+static void add_package( LCFGPackageSet * pkgset, LCFGPackage * pkg ) {
+  char * msg = NULL;
+  if ( lcfgpkgset_merge_package( pkgset, pkg, &msg ) == LCFG_CHANGE_ERROR ) {
+    fprintf( stderr, "Failed to merge package: %s\n", msg );
+    exit(EXIT_FAILURE);
+  }
+  free(msg);
+  lcfgpackage_relinquish(pkg);
+}
+
+static double elapsed( const struct timespec * start ) {
+  struct timespec end;
+  clock_gettime( CLOCK_MONOTONIC, &end );
+  return ( end.tv_sec - start->tv_sec ) * 1e3 +
+         ( end.tv_nsec - start->tv_nsec ) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+
+  unsigned int size   = argc > 1 ? atoi(argv[1]) : 10000;
+  unsigned int rounds = argc > 2 ? atoi(argv[2]) : 20;
+
+  LCFGPackageSet * old_set = lcfgpkgset_new();
+  LCFGPackageSet * new_set = lcfgpkgset_new();
+
+  unsigned int i;
+  for ( i=0; i<size; i++ ) {
+
+    /* 1% removed, 1% added, 5% upgraded, 1% downgraded */
+
+    if ( i % 100 != 0 )
+      add_package( old_set, make_package( i, 10 ) );
+
+    if ( i % 100 == 1 )
+      continue;
+
+    unsigned int ver = 10;
+    if ( i % 20 == 2 )
+      ver = 11;
+    else if ( i % 100 == 3 )
+      ver = 9;
+
+    add_package( new_set, make_package( i, ver ) );
+  }
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGPkgSetDiff * diff = NULL;
+  for ( i=0; i<rounds; i++ ) {
+    lcfgpkgsetdiff_relinquish(diff);
+    diff = NULL;
+
+    if ( lcfgpkgset_diff( old_set, new_set, &diff ) == LCFG_CHANGE_ERROR ) {
+      fprintf( stderr, "Failed to diff package sets\n" );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  double total = elapsed(&start);
+
+  printf( "packages:   %u/%u\n", lcfgpkgset_size(old_set),
+          lcfgpkgset_size(new_set) );
+  printf( "added:      %u\n", lcfgpkgsetdiff_count( diff, LCFG_PKGDIFF_ADDED ) );
+  printf( "removed:    %u\n", lcfgpkgsetdiff_count( diff, LCFG_PKGDIFF_REMOVED ) );
+  printf( "upgraded:   %u\n", lcfgpkgsetdiff_count( diff, LCFG_PKGDIFF_UPGRADED ) );
+  printf( "downgraded: %u\n", lcfgpkgsetdiff_count( diff, LCFG_PKGDIFF_DOWNGRADED ) );
+  printf( "unchanged:  %u\n", lcfgpkgsetdiff_count( diff, LCFG_PKGDIFF_UNCHANGED ) );
+  printf( "diff:       %.3f ms/round (%u rounds)\n", total / rounds, rounds );
+
+  lcfgpkgsetdiff_relinquish(diff);
+  lcfgpkgset_relinquish(old_set);
+  lcfgpkgset_relinquish(new_set);
+
+  return 0;
+}
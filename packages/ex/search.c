@@ -1,185 +1,138 @@
+/* Benchmark for lcfgpkgset_match() with and without a search index
+
+   Builds a synthetic package set (default 20000 packages) and times
+   a selection of name patterns (prefix, suffix, substring, exact and
+   glob) both by scanning all packages and by using the index. The
+   number of matches must be the same for both. */
+
+#define _GNU_SOURCE /* for asprintf */
+
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <assert.h>
-
-#include "packages.h"
+#include <time.h>
 
-/* Search stuff hidden here as it's a private API */
-
-typedef char * (*LCFGPackageMatchField)(const LCFGPackage * pkg);
-typedef bool (*LCFGPackageMatchFunc)( const char * field,
-                                      const char * match_string );
-
-struct LCFGPackageMatch {
-  LCFGPackageMatchFunc  matcher;
-  LCFGPackageMatchField fetcher;
-  const char * string;
-};
-typedef struct LCFGPackageMatch LCFGPackageMatch;
-
-static bool lcfgpkglist_match_exact( const char * field,
-                              const char * match_string ) {
-  return ( field != NULL && strcmp( field, match_string ) == 0 );
-}
+#include <lcfg/packages.h>
 
-static bool lcfgpkglist_match_startswith( const char * field,
-                                   const char * match_string ) {
-  const char * match = field == NULL ? NULL : strstr( field, match_string );
-  return ( match != NULL && match == field );
-}
+static const char * prefixes[] = { "perl", "python3", "lib", "texlive", "kernel", "golang", "rubygem", "xorg-x11" };
+static const char * suffixes[] = { "", "-devel", "-doc", "-libs", "-common", "-tools" };
 
-static bool lcfgpkglist_match_endswith( const char * field,
-                                 const char * match_string ) {
-  const char * match = field == NULL ? NULL : strstr( field, match_string );
-  return ( match != NULL && strlen(match) == strlen(match_string) );
-}
+#define NPREFIXES ( sizeof(prefixes) / sizeof(prefixes[0]) )
+#define NSUFFIXES ( sizeof(suffixes) / sizeof(suffixes[0]) )
 
-static bool lcfgpkglist_match_contains( const char * field,
-                                 const char * match_string ) {
-  const char * match = field == NULL ? NULL : strstr( field, match_string );
-  return ( match != NULL );
-}
+static LCFGPackage * make_package( unsigned int id ) {
 
-static LCFGPackageMatch * lcfgpkglist_build_match( const char * field_name,
-                                                   const char * match_expr ) {
+  LCFGPackage * pkg = lcfgpackage_new();
 
-  LCFGPackageMatch * match = malloc( sizeof(LCFGPackageMatch) );
-  if ( match == NULL ) {
-    perror( "Failed to allocate memory for LCFG package search" );
+  char * name = NULL;
+  if ( asprintf( &name, "%s-mod%05u%s", prefixes[id % NPREFIXES], id,
+                 suffixes[( id / NPREFIXES ) % NSUFFIXES] ) < 0 ) {
+    perror("Failed to allocate memory");
     exit(EXIT_FAILURE);
   }
 
-  if ( strcmp( field_name, "name" ) == 0 ) {
-    match->fetcher = &lcfgpackage_get_name;
-  } else if ( strcmp( field_name, "arch" ) == 0 ) {
-    match->fetcher = &lcfgpackage_get_arch;
-  } else if ( strcmp( field_name, "version" ) == 0 ) {
-    match->fetcher = &lcfgpackage_get_version;
-  } else if ( strcmp( field_name, "release" ) == 0 ) {
-    match->fetcher = &lcfgpackage_get_release;
-  } else {
-    fprintf( stderr, "Cannot search for packages with unsupported field '%s'\n", field_name );
+  if ( !lcfgpackage_set_name( pkg, name ) ||
+       !lcfgpackage_set_version( pkg, strdup("1.0") ) ||
+       !lcfgpackage_set_release( pkg, strdup("1") ) ||
+       !lcfgpackage_set_arch( pkg, strdup("x86_64") ) ) {
+    fprintf( stderr, "Failed to create package\n" );
     exit(EXIT_FAILURE);
   }
 
-  size_t expr_len = strlen(match_expr);
+  return pkg;
+}
+
+static double elapsed( const struct timespec * start ) {
+  struct timespec end;
+  clock_gettime( CLOCK_MONOTONIC, &end );
+  return ( end.tv_sec - start->tv_sec ) * 1e3 +
+         ( end.tv_nsec - start->tv_nsec ) / 1e6;
+}
+
+static unsigned int run_search( const LCFGPackageSet * pkgset,
+                                const char * pattern,
+                                unsigned int rounds,
+                                double * time ) {
+
+  unsigned int matches = 0;
 
-  if ( match_expr[0] == '^' ) {
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
 
-    if ( match_expr[expr_len-1] == '$' ) {      /* exact */
-      match->matcher = &lcfgpkglist_match_exact;
-      match->string  = strndup( match_expr + 1, expr_len - 2 );
-    } else {                                    /* starts with */
-      match->matcher = lcfgpkglist_match_startswith;
-      match->string  = strdup(match_expr + 1);
+  unsigned int i;
+  for ( i=0; i<rounds; i++ ) {
+    LCFGPackageSet * result = lcfgpkgset_match( pkgset, pattern,
+                                                NULL, NULL, NULL );
+    if ( result == NULL ) {
+      fprintf( stderr, "Failed to search packages\n" );
+      exit(EXIT_FAILURE);
     }
 
-  } else if ( match_expr[expr_len-1] == '$' ) { /* ends with */
-    match->matcher = lcfgpkglist_match_endswith;
-    match->string  = strndup( match_expr, expr_len - 1 );
-  } else {                                      /* contains */
-    match->matcher = lcfgpkglist_match_contains;
-    match->string  = strdup(match_expr);
+    matches = lcfgpkgset_size(result);
+    lcfgpkgset_relinquish(result);
   }
 
-  return match;
-}
+  *time = elapsed(&start) / rounds;
 
-static void lcfgpkglist_destroy_match( LCFGPackageMatch * match ) {
-  if ( match != NULL ) {
-    free( (char *) match->string );
-    free(match);
-    match = NULL;
-  }
+  return matches;
 }
 
-inline static bool lcfgpkglist_match_required( const char * expr ) {
-  return ( expr  != NULL &&
-           *expr != '\0' &&
-           strcmp( expr, LCFG_PKG_WILDCARD ) != 0 );
-}
+int main(int argc, char *argv[]) {
 
-LCFGPackageList * lcfgpkglist_search( const LCFGPackageList * pkglist,
-                                      const char * pkgname,
-                                      const char * pkgarch,
-                                      const char * pkgver,
-                                      const char * pkgrel ) {
-  assert( pkglist != NULL );
+  unsigned int size   = argc > 1 ? atoi(argv[1]) : 20000;
+  unsigned int rounds = argc > 2 ? atoi(argv[2]) : 20;
 
-  LCFGPackageList * result = lcfgpkglist_new();
+  LCFGPackageSet * pkgset = lcfgpkgset_new();
 
-  if ( lcfgpkglist_size(pkglist) == 0 )
-    return result;
+  unsigned int i;
+  for ( i=0; i<size; i++ ) {
+    LCFGPackage * pkg = make_package(i);
 
-  /* Assemble list of required matches */
+    char * msg = NULL;
+    if ( lcfgpkgset_merge_package( pkgset, pkg, &msg ) == LCFG_CHANGE_ERROR ) {
+      fprintf( stderr, "Failed to merge package: %s\n", msg );
+      exit(EXIT_FAILURE);
+    }
+    free(msg);
 
-  LCFGPackageMatch * matches[4] = { NULL, NULL, NULL, NULL };
-  int match_id = 0;
-  if ( lcfgpkglist_match_required(pkgname) ) {
-    matches[match_id]   = lcfgpkglist_build_match( "name",    pkgname );
-  }
-  if ( lcfgpkglist_match_required(pkgarch) ) {
-    matches[++match_id] = lcfgpkglist_build_match( "arch",    pkgarch );
-    match_id++;
-  }
-  if ( lcfgpkglist_match_required(pkgver) ) {
-    matches[++match_id] = lcfgpkglist_build_match( "version", pkgver );
-  }
-  if ( lcfgpkglist_match_required(pkgrel) ) {
-    matches[++match_id] = lcfgpkglist_build_match( "release", pkgrel );
+    lcfgpackage_relinquish(pkg);
   }
 
-  /* Run the search */
+  const char * patterns[] = { "python3-*", "*-devel", "*mod0012*",
+                              "kernel-mod00004", "lib*mod1?3*-doc",
+                              "*" };
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  lcfgpkgset_build_index(pkgset);
+  printf( "index:   %.3f ms for %u packages\n", elapsed(&start),
+          lcfgpkgset_size(pkgset) );
 
   bool ok = true;
 
-  LCFGPackageNode * cur_node = NULL;
-  for ( cur_node = lcfgpkglist_head(pkglist);
-        cur_node != NULL;
-        cur_node = lcfgpkglist_next(cur_node) ) {
+  for ( i=0; i<sizeof(patterns)/sizeof(patterns[0]); i++ ) {
+    double scan_time, index_time;
 
-    LCFGPackage * pkg = lcfgpkglist_package(cur_node);
+    lcfgpkgset_drop_index(pkgset);
+    unsigned int scan_matches = run_search( pkgset, patterns[i], rounds,
+                                            &scan_time );
 
-    bool matched = true;
+    lcfgpkgset_build_index(pkgset);
+    unsigned int index_matches = run_search( pkgset, patterns[i], rounds,
+                                             &index_time );
 
-    int i = 0;
-    for ( i=0; i<=match_id; i++ ) {
-      const LCFGPackageMatch * match = matches[i];
-      if ( match != NULL &&
-           !match->matcher( match->fetcher(pkg), match->string ) ) {
-        matched = false;
-        break;
-      }
-    }
+    printf( "%-22s %6u matches  scan %8.3f ms  index %8.3f ms\n",
+            patterns[i], index_matches, scan_time, index_time );
 
-    if ( matched ) {
-      if ( lcfgpkglist_append( result, pkg ) != LCFG_CHANGE_ADDED ) {
-	ok = false;
-	break;
-      }
+    if ( scan_matches != index_matches ) {
+      fprintf( stderr, "Mismatch for '%s': %u != %u\n",
+               patterns[i], scan_matches, index_matches );
+      ok = false;
     }
-
   }
 
-  if (ok) {
-    /* Sort so that the result list is always the same */
-
-    lcfgpkglist_sort(result);
-
-    int i = 0;
-    for ( i=0; i<=match_id; i++ ) {
-      if ( matches[i] != NULL )
-      lcfgpkglist_destroy_match(matches[i]);
-    }
-
-  } else {
-    lcfgpkglist_destroy(result);
-    result = NULL;
-  }
+  lcfgpkgset_relinquish(pkgset);
 
-  return result;
+  return ( ok ? 0 : 1 );
 }
-
-/* eof */
@@ -1290,8 +1290,9 @@ LCFGPackage * lcfgpkglist_first_package( const LCFGPackageList * pkglist ) {
  * This will evaluate and update the value of the @e priority
  * attribute for all the LCFG packages using the value set for the @e
  * context attribute (if any) and the list of LCFG contexts passed in
- * as an argument. The priority is evaluated using @c
- * lcfgpackage_eval_priority().
+ * as an argument. The priorities are the same as those from @c
+ * lcfgpackage_eval_priority() but each distinct context expression
+ * is only evaluated once, see @c lcfgctxbatch_evaluate() for details.
  *
  * The default value for the priority is zero, if the package is
  * applicable for the specified list of contexts the priority will be
@@ -1316,6 +1317,71 @@ LCFGChange lcfgpkglist_eval_priority( const LCFGPackageList * pkglist,
 
   if ( lcfgslist_is_empty(pkglist) ) return LCFG_CHANGE_NONE;
 
+  LCFGContextBatch * batch = lcfgctxbatch_new();
+  lcfgpkglist_collect_contexts( pkglist, batch );
+
+  LCFGChange result = LCFG_CHANGE_ERROR;
+  if ( lcfgctxbatch_evaluate( batch, ctxlist, 1, msg ) == LCFG_STATUS_OK )
+    result = lcfgpkglist_apply_priority( pkglist, batch, msg );
+
+  lcfgctxbatch_destroy(batch);
+
+  return result;
+}
+
+/**
+ * @brief Collect the context expressions for all packages
+ *
+ * This adds the value of the @e context attribute (if any) for every
+ * package in the @c LCFGPackageList to the @c LCFGContextBatch. Once
+ * the batch has been evaluated the priorities can be updated with @c
+ * lcfgpkglist_apply_priority().
+ *
+ * @param[in] pkglist Pointer to an @c LCFGPackageList
+ * @param[in] batch Pointer to an @c LCFGContextBatch
+ *
+ */
+
+void lcfgpkglist_collect_contexts( const LCFGPackageList * pkglist,
+                                   LCFGContextBatch * batch ) {
+
+  if ( lcfgslist_is_empty(pkglist) ) return;
+
+  const LCFGSListNode * cur_node = NULL;
+  for ( cur_node = lcfgslist_head(pkglist);
+        cur_node != NULL;
+        cur_node = lcfgslist_next(cur_node) ) {
+
+    const LCFGPackage * pkg = lcfgslist_data(cur_node);
+
+    if ( lcfgpackage_has_context(pkg) )
+      lcfgctxbatch_add( batch, lcfgpackage_get_context(pkg) );
+
+  }
+
+}
+
+/**
+ * @brief Set the priority for all packages from a batch of contexts
+ *
+ * This updates the value of the @e priority attribute for every
+ * package in the @c LCFGPackageList using the results in an @c
+ * LCFGContextBatch, see @c lcfgpackage_apply_priority() for details.
+ *
+ * @param[in] pkglist Pointer to an @c LCFGPackageList
+ * @param[in] batch Pointer to an evaluated @c LCFGContextBatch
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
+LCFGChange lcfgpkglist_apply_priority( const LCFGPackageList * pkglist,
+                                       const LCFGContextBatch * batch,
+                                       char ** msg ) {
+
+  if ( lcfgslist_is_empty(pkglist) ) return LCFG_CHANGE_NONE;
+
   LCFGChange result = LCFG_CHANGE_NONE;
 
   const LCFGSListNode * cur_node = NULL;
@@ -1325,7 +1391,7 @@ LCFGChange lcfgpkglist_eval_priority( const LCFGPackageList * pkglist,
 
     LCFGPackage * pkg = lcfgslist_data(cur_node);
 
-    LCFGChange pkg_change = lcfgpackage_eval_priority( pkg, ctxlist, msg );
+    LCFGChange pkg_change = lcfgpackage_apply_priority( pkg, batch, msg );
 
     if ( pkg_change != LCFG_CHANGE_NONE )
       result = pkg_change;
@@ -27,6 +27,7 @@
 #include "derivation.h"
 #include "context.h"
 #include "packages.h"
+#include "container.h"
 #include "utils.h"
 
 /**
@@ -123,11 +124,54 @@ LCFGPackage * lcfgpackage_new(void) {
   pkg->category   = NULL;
   pkg->prefix     = LCFG_PKG_PREFIX_NONE;
   pkg->priority   = 0;
+  pkg->_arena     = NULL;
+  pkg->_arena_fields = 0;
   pkg->_refcount  = 1;
 
   return pkg;
 }
 
+/**
+ * @brief Create and initialise a new package in an arena
+ *
+ * This is similar to @c lcfgpackage_new() except that the memory for
+ * the @c LCFGPackage structure is taken from the specified @c
+ * LCFGPkgArena. The package holds a reference to the arena which is
+ * released when the package is destroyed.
+ *
+ * @param[in] arena Pointer to @c LCFGPkgArena
+ *
+ * @return Pointer to new @c LCFGPackage
+ *
+ */
+
+LCFGPackage * lcfgpackage_arena_new( LCFGPkgArena * arena ) {
+  assert( arena != NULL );
+
+  LCFGPackage * pkg = lcfgpkgarena_alloc( arena, sizeof(LCFGPackage) );
+
+  pkg->prefix    = LCFG_PKG_PREFIX_NONE;
+  pkg->_arena    = arena;
+  pkg->_refcount = 1;
+
+  lcfgpkgarena_acquire(arena);
+
+  return pkg;
+}
+
+/* Strings which were allocated from an arena are not freed, the
+   memory is returned when the whole arena is destroyed. */
+
+static void lcfgpackage_free_string( LCFGPackage * pkg, char ** value,
+                                     unsigned int field ) {
+
+  if ( !( pkg->_arena_fields & field ) )
+    free(*value);
+
+  pkg->_arena_fields &= ~field;
+  *value = NULL;
+}
+
 /**
  * @brief Destroy the package
  *
@@ -157,31 +201,28 @@ void lcfgpackage_destroy(LCFGPackage * pkg) {
 
   if ( pkg == NULL ) return;
 
-  free(pkg->name);
-  pkg->name = NULL;
-
-  free(pkg->arch);
-  pkg->arch = NULL;
-
-  free(pkg->version);
-  pkg->version = NULL;
-
-  free(pkg->release);
-  pkg->release = NULL;
-
-  free(pkg->flags);
-  pkg->flags = NULL;
-
-  free(pkg->context);
-  pkg->context = NULL;
+  lcfgpackage_free_string( pkg, &(pkg->name),     LCFG_PKG_ARENA_NAME );
+  lcfgpackage_free_string( pkg, &(pkg->arch),     LCFG_PKG_ARENA_ARCH );
+  lcfgpackage_free_string( pkg, &(pkg->version),  LCFG_PKG_ARENA_VERSION );
+  lcfgpackage_free_string( pkg, &(pkg->release),  LCFG_PKG_ARENA_RELEASE );
+  lcfgpackage_free_string( pkg, &(pkg->flags),    LCFG_PKG_ARENA_FLAGS );
+  lcfgpackage_free_string( pkg, &(pkg->context),  LCFG_PKG_ARENA_CONTEXT );
 
   lcfgderivlist_relinquish(pkg->derivation);
   pkg->derivation = NULL;
 
-  free(pkg->category);
-  pkg->category = NULL;
+  lcfgpackage_free_string( pkg, &(pkg->category), LCFG_PKG_ARENA_CATEGORY );
+
+  /* A package allocated from an arena is freed with the arena */
+
+  if ( pkg->_arena != NULL ) {
+    LCFGPkgArena * arena = pkg->_arena;
+    pkg->_arena = NULL;
+    lcfgpkgarena_relinquish(arena);
+  } else {
+    free(pkg);
+  }
 
-  free(pkg);
   pkg = NULL;
 
 }
@@ -443,7 +484,7 @@ bool lcfgpackage_set_name( LCFGPackage * pkg, char * new_name ) {
 
   bool ok = false;
   if ( lcfgpackage_valid_name(new_name) ) {
-    free(pkg->name);
+    lcfgpackage_free_string( pkg, &(pkg->name), LCFG_PKG_ARENA_NAME );
 
     pkg->name = new_name;
     ok = true;
@@ -553,7 +594,7 @@ bool lcfgpackage_set_arch( LCFGPackage * pkg, char * new_arch ) {
 
   bool ok = false;
   if ( lcfgpackage_valid_arch(new_arch) ) {
-    free(pkg->arch);
+    lcfgpackage_free_string( pkg, &(pkg->arch), LCFG_PKG_ARENA_ARCH );
 
     pkg->arch = new_arch;
     ok = true;
@@ -737,7 +778,7 @@ bool lcfgpackage_set_version( LCFGPackage * pkg, char * new_version ) {
 
   bool ok = false;
   if ( lcfgpackage_valid_version(new_version) ) {
-    free(pkg->version);
+    lcfgpackage_free_string( pkg, &(pkg->version), LCFG_PKG_ARENA_VERSION );
 
     pkg->version = new_version;
     ok = true;
@@ -850,7 +891,7 @@ bool lcfgpackage_set_release( LCFGPackage * pkg, char * new_release ) {
 
   bool ok = false;
   if ( lcfgpackage_valid_release(new_release) ) {
-    free(pkg->release);
+    lcfgpackage_free_string( pkg, &(pkg->release), LCFG_PKG_ARENA_RELEASE );
 
     pkg->release = new_release;
     ok = true;
@@ -1111,7 +1152,7 @@ bool lcfgpackage_set_flags( LCFGPackage * pkg, char * new_flags ) {
 
   bool ok = false;
   if ( lcfgpackage_valid_flags(new_flags) ) {
-    free(pkg->flags);
+    lcfgpackage_free_string( pkg, &(pkg->flags), LCFG_PKG_ARENA_FLAGS );
 
     pkg->flags = new_flags;
     ok = true;
@@ -1137,8 +1178,7 @@ bool lcfgpackage_set_flags( LCFGPackage * pkg, char * new_flags ) {
 bool lcfgpackage_clear_flags( LCFGPackage * pkg ) {
   assert( pkg != NULL );
 
-  free(pkg->flags);
-  pkg->flags = NULL;
+  lcfgpackage_free_string( pkg, &(pkg->flags), LCFG_PKG_ARENA_FLAGS );
 
   return true;
 }
@@ -1346,7 +1386,7 @@ bool lcfgpackage_set_context( LCFGPackage * pkg, char * new_ctx ) {
 
   bool ok = false;
   if ( lcfgpackage_valid_context(new_ctx) ) {
-    free(pkg->context);
+    lcfgpackage_free_string( pkg, &(pkg->context), LCFG_PKG_ARENA_CONTEXT );
 
     pkg->context = new_ctx;
     ok = true;
@@ -1815,7 +1855,7 @@ bool lcfgpackage_set_category( LCFGPackage * pkg, char * new_value ) {
 
   bool ok = false;
   if ( lcfgpackage_valid_category(new_value) ) {
-    free(pkg->category);
+    lcfgpackage_free_string( pkg, &(pkg->category), LCFG_PKG_ARENA_CATEGORY );
 
     pkg->category = new_value;
     ok = true;
@@ -1926,6 +1966,50 @@ LCFGChange lcfgpackage_eval_priority( LCFGPackage * pkg,
   return change;
 }
 
+/**
+ * @brief Set the priority for the package from a batch of contexts
+ *
+ * This does the same as @c lcfgpackage_eval_priority() except that
+ * the priority for the value of the @e context attribute is taken
+ * from an @c LCFGContextBatch which has already been evaluated with
+ * @c lcfgctxbatch_evaluate(). This is used when evaluating the
+ * priorities for many packages so that each distinct context
+ * expression is only evaluated once.
+ *
+ * If the context expression for the package is not in the batch an
+ * error is returned.
+ *
+ * @param[in] pkg Pointer to an @c LCFGPackage
+ * @param[in] batch Pointer to an evaluated @c LCFGContextBatch
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
+LCFGChange lcfgpackage_apply_priority( LCFGPackage * pkg,
+                                       const LCFGContextBatch * batch,
+                                       char ** msg ) {
+  assert( pkg != NULL );
+
+  int new_priority = 0;
+  if ( !lcfgctxbatch_priority( batch, pkg->context, &new_priority ) ) {
+    lcfgutils_build_message( msg,
+                             "Context expression '%s' has not been evaluated",
+                             pkg->context );
+    return LCFG_CHANGE_ERROR;
+  }
+
+  LCFGChange change = LCFG_CHANGE_NONE;
+  if ( new_priority != pkg->priority ) {
+    change = LCFG_CHANGE_MODIFIED;
+    if ( !lcfgpackage_set_priority( pkg, new_priority ) )
+      change = LCFG_CHANGE_ERROR;
+  }
+
+  return change;
+}
+
 /**
  * @brief Check if the package is considered to be active
  *
@@ -2031,7 +2115,26 @@ char * lcfgpackage_id( const LCFGPackage * pkg ) {
   return id;
 }
 
-static bool walk_forwards_until( const char ** start,
+/* When parsing into an arena the strings for the fields are copied
+   into the arena and must not be freed. */
+
+static char * lcfgpackage_strndup( LCFGPkgArena * arena,
+                                   const char * str, size_t len ) {
+  return ( arena != NULL ? lcfgpkgarena_strndup( arena, str, len ) :
+                           strndup( str, len ) );
+}
+
+static void lcfgpackage_strfree( LCFGPkgArena * arena, char * str ) {
+  if ( arena == NULL ) free(str);
+}
+
+static void lcfgpackage_mark_arena( LCFGPackage * pkg, LCFGPkgArena * arena,
+                                    unsigned int field ) {
+  if ( arena != NULL ) pkg->_arena_fields |= field;
+}
+
+static bool walk_forwards_until( LCFGPkgArena * arena,
+                                 const char ** start,
                                  char separator, const char * stop,
                                  char ** field_value ) {
 
@@ -2071,7 +2174,7 @@ static bool walk_forwards_until( const char ** start,
       while ( field_len > 0 && isspace( *( begin + field_len - 1 ) ) ) field_len--;
 
       if ( field_len > 0 )
-        *field_value = strndup( begin, field_len );
+        *field_value = lcfgpackage_strndup( arena, begin, field_len );
 
     }
 
@@ -2081,7 +2184,8 @@ static bool walk_forwards_until( const char ** start,
 }
 
 
-static bool walk_backwards_until( const char * input, size_t * len,
+static bool walk_backwards_until( LCFGPkgArena * arena,
+                                  const char * input, size_t * len,
                                   char separator, const char * stop,
                                   char ** field_value ) {
 
@@ -2124,7 +2228,7 @@ static bool walk_backwards_until( const char * input, size_t * len,
 
       size_t field_len = end - begin + 1;
       if ( field_len > 0 )
-        *field_value = strndup( begin, field_len );
+        *field_value = lcfgpackage_strndup( arena, begin, field_len );
 
     }
 
@@ -2173,6 +2277,31 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
                                     LCFGPackage ** result,
                                     char ** msg ) {
 
+  return lcfgpackage_parse_spec( input, NULL, result, msg );
+}
+
+/**
+ * @brief Create a new package from a string using an arena
+ *
+ * This is the implementation of @c lcfgpackage_from_spec(). If an
+ * @c LCFGPkgArena is specified then the new package and the strings
+ * for all the fields parsed from the specification are allocated
+ * from the arena.
+ *
+ * @param[in] input The package specification string.
+ * @param[in] arena Pointer to @c LCFGPkgArena (may be @c NULL)
+ * @param[out] result Reference to the pointer for the new @c LCFGPackage.
+ * @param[out] msg Pointer to any diagnostic messages.
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgpackage_parse_spec( const char * input,
+                                   LCFGPkgArena * arena,
+                                   LCFGPackage ** result,
+                                   char ** msg ) {
+
   *result = NULL;
   *msg = NULL;
 
@@ -2186,7 +2315,8 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
   if ( *start == '\0' ) return invalid_package( msg, "empty spec string" );
 
   bool ok = true;
-  LCFGPackage * pkg = lcfgpackage_new();
+  LCFGPackage * pkg = arena != NULL ?
+    lcfgpackage_arena_new(arena) : lcfgpackage_new();
 
   /* Prefix - optional */
 
@@ -2217,7 +2347,7 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
   */
 
   char * pkg_arch = NULL;
-  walk_forwards_until( &start, '/', "-=", &pkg_arch );
+  walk_forwards_until( arena, &start, '/', "-=", &pkg_arch );
 
   /* Find the end of the string, ignoring any trailing whitespace */
 
@@ -2237,7 +2367,7 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
 
     char * pkg_context = NULL;
 
-    if ( walk_backwards_until( start, &ctx_len, '[', NULL, &pkg_context ) ) {
+    if ( walk_backwards_until( arena, start, &ctx_len, '[', NULL, &pkg_context ) ) {
       len = ctx_len;
 
       if ( pkg_context != NULL ) {
@@ -2245,10 +2375,12 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
         ok = lcfgpackage_set_context( pkg, pkg_context );
         if (!ok) {
           invalid_package( msg, "bad context '%s'", pkg_context );
-          free(pkg_context);
-          free(pkg_arch); /* not yet stored so must be freed */
+          lcfgpackage_strfree( arena, pkg_context );
+          lcfgpackage_strfree( arena, pkg_arch ); /* not yet stored so must be freed */
           goto failure;
         }
+
+        lcfgpackage_mark_arena( pkg, arena, LCFG_PKG_ARENA_CONTEXT );
       }
 
     }
@@ -2269,18 +2401,20 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
   */
 
   char * pkg_flags = NULL;
-  walk_backwards_until( start, &len, ':', "/-=.~_+-*?", &pkg_flags );
+  walk_backwards_until( arena, start, &len, ':', "/-=.~_+-*?", &pkg_flags );
 
   if ( pkg_flags != NULL ) {
 
     ok = lcfgpackage_set_flags( pkg, pkg_flags );
     if (!ok) {
       invalid_package( msg, "bad flags '%s'", pkg_flags );
-      free(pkg_flags);
-      free(pkg_arch); /* not yet stored so must be freed */
+      lcfgpackage_strfree( arena, pkg_flags );
+      lcfgpackage_strfree( arena, pkg_arch ); /* not yet stored so must be freed */
       goto failure;
     }
 
+    lcfgpackage_mark_arena( pkg, arena, LCFG_PKG_ARENA_FLAGS );
+
   }
   
   /* Primary Architecture - optional
@@ -2294,12 +2428,12 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
  */
 
   char * arch2 = NULL;
-  walk_backwards_until( start, &len, '/', "-=", &arch2 );
+  walk_backwards_until( arena, start, &len, '/', "-=", &arch2 );
 
   if ( pkg_arch == NULL ) {
     pkg_arch = arch2;
   } else {
-    free(arch2);
+    lcfgpackage_strfree( arena, arch2 );
     arch2 = NULL;
   }
 
@@ -2308,11 +2442,13 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
     ok = lcfgpackage_set_arch( pkg, pkg_arch );
     if (!ok) {
       invalid_package( msg, "bad architecture '%s'", pkg_arch );
-      free(pkg_arch);
+      lcfgpackage_strfree( arena, pkg_arch );
       pkg_arch = NULL;
       goto failure;
     }
 
+    lcfgpackage_mark_arena( pkg, arena, LCFG_PKG_ARENA_ARCH );
+
   }
 
   /* Release and Version */
@@ -2321,7 +2457,7 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
   char * pkg_release = NULL;
 
   char * vr = NULL;
-  walk_backwards_until( start, &len, '=', NULL, &vr );
+  walk_backwards_until( arena, start, &len, '=', NULL, &vr );
 
   if ( vr != NULL ) { /* Modern specification style is name=version */
     pkg_version = vr;
@@ -2332,7 +2468,8 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
       const char * rel_start = vr_sep + 1;
 
       if ( !isempty(rel_start) )
-        pkg_release = strdup(rel_start);
+        pkg_release = lcfgpackage_strndup( arena, rel_start,
+                                           strlen(rel_start) );
 
       *vr_sep = '\0';
     }
@@ -2344,7 +2481,7 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
        This is separated from the version field using a '-' (hyphen) character.
     */
 
-    walk_backwards_until( start, &len, '-', NULL, &pkg_release );
+    walk_backwards_until( arena, start, &len, '-', NULL, &pkg_release );
 
     if ( pkg_release == NULL ) {
       ok = false;
@@ -2358,7 +2495,7 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
        (hyphen) character.
     */
 
-    walk_backwards_until( start, &len, '-', NULL, &pkg_version );
+    walk_backwards_until( arena, start, &len, '-', NULL, &pkg_version );
 
     if ( pkg_version == NULL ) {
       ok = false;
@@ -2373,11 +2510,13 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
 
     if (!ok) {
       invalid_package( msg, "bad version '%s'", pkg_version );
-      free(pkg_version);
+      lcfgpackage_strfree( arena, pkg_version );
       pkg_version = NULL;
       goto failure;
     }
 
+    lcfgpackage_mark_arena( pkg, arena, LCFG_PKG_ARENA_VERSION );
+
   }
 
   if ( !isempty(pkg_release) ) {
@@ -2385,11 +2524,13 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
 
     if (!ok) {
       invalid_package( msg, "bad release '%s'", pkg_release );
-      free(pkg_release);
+      lcfgpackage_strfree( arena, pkg_release );
       pkg_release = NULL;
       goto failure;
     }
 
+    lcfgpackage_mark_arena( pkg, arena, LCFG_PKG_ARENA_RELEASE );
+
   }
 
   /* Name - required
@@ -2403,16 +2544,18 @@ LCFGStatus lcfgpackage_from_spec( const char * input,
     invalid_package( msg, "failed to extract name" );
     goto failure;
   } else {
-    char * pkg_name = strndup( start, len );
+    char * pkg_name = lcfgpackage_strndup( arena, start, len );
 
     ok = lcfgpackage_set_name( pkg, pkg_name );
 
     if ( !ok ) {
       invalid_package( msg, "bad name '%s'", pkg_name );
-      free(pkg_name);
+      lcfgpackage_strfree( arena, pkg_name );
       goto failure;
     }
 
+    lcfgpackage_mark_arena( pkg, arena, LCFG_PKG_ARENA_NAME );
+
   }
 
  failure:
@@ -23,6 +23,7 @@
 #include <unistd.h>
 
 #include "packages.h"
+#include "container.h"
 #include "utils.h"
 
 static const char * rpm_file_suffix = ".rpm";
@@ -73,6 +74,43 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
                                           LCFGPackage ** result,
                                           char ** msg ) {
 
+  return lcfgpackage_parse_rpm_filename( input, NULL, result, msg );
+}
+
+/* When parsing into an arena the strings for the fields are copied
+   into the arena and must not be freed. */
+
+static char * rpm_strndup( LCFGPkgArena * arena, const char * str, size_t len ) {
+  return ( arena != NULL ? lcfgpkgarena_strndup( arena, str, len ) :
+                           strndup( str, len ) );
+}
+
+static void rpm_strfree( LCFGPkgArena * arena, char * str ) {
+  if ( arena == NULL ) free(str);
+}
+
+/**
+ * @brief Create a new package from an RPM filename using an arena
+ *
+ * This is the implementation of @c lcfgpackage_from_rpm_filename(). If
+ * an @c LCFGPkgArena is specified then the new package and the
+ * strings for all the fields parsed from the filename are allocated
+ * from the arena.
+ *
+ * @param[in] input The RPM filename string.
+ * @param[in] arena Pointer to @c LCFGPkgArena (may be @c NULL)
+ * @param[out] result Reference to the pointer for the @c LCFGPackage.
+ * @param[out] msg Pointer to any diagnostic messages.
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgpackage_parse_rpm_filename( const char * input,
+                                           LCFGPkgArena * arena,
+                                           LCFGPackage ** result,
+                                           char ** msg ) {
+
   *result = NULL;
 
   if ( isempty(input) )
@@ -95,7 +133,9 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
   /* Results - note that the file name has to be split apart backwards */
 
   bool ok = true;
-  *result = lcfgpackage_new();
+  *result = arena != NULL ?
+    lcfgpackage_arena_new(arena) : lcfgpackage_new();
+
 
   size_t offset = filename_len - rpm_file_suffix_len - 1;
 
@@ -106,7 +146,7 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
   unsigned int i;
   for ( i=offset; i--; ) {
     if ( filename[i] == '.' ) {
-      pkg_arch = strndup( filename + i + 1, offset - i );
+      pkg_arch = rpm_strndup( arena, filename + i + 1, offset - i );
       break;
     }
   }
@@ -119,10 +159,13 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
     ok = lcfgpackage_set_arch( *result, pkg_arch );
     if ( !ok ) {
       invalid_rpm( msg, "bad package architecture '%s'", pkg_arch );
-      free(pkg_arch);
+      rpm_strfree( arena, pkg_arch );
       pkg_arch = NULL;
       goto failure;
     }
+
+    if ( arena != NULL )
+      (*result)->_arena_fields |= LCFG_PKG_ARENA_ARCH;
   }
 
   /* Release field - search backwards for '-' */
@@ -134,7 +177,7 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
 
     for ( i=offset; i--; ) {
       if ( filename[i] == '-' ) {
-        pkg_release = strndup( filename + i + 1, offset - i );
+        pkg_release = rpm_strndup( arena, filename + i + 1, offset - i );
         break;
       }
     }
@@ -149,10 +192,13 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
     ok = lcfgpackage_set_release( *result, pkg_release );
     if ( !ok ) {
       invalid_rpm( msg, "bad release '%s'", pkg_release );
-      free(pkg_release);
+      rpm_strfree( arena, pkg_release );
       pkg_release = NULL;
       goto failure;
     }
+
+    if ( arena != NULL )
+      (*result)->_arena_fields |= LCFG_PKG_ARENA_RELEASE;
   }
 
   /* Version field - search backwards for '-' */
@@ -164,7 +210,7 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
 
     for ( i=offset; i--; ) {
       if ( filename[i] == '-' ) {
-        pkg_version = strndup( filename + i + 1, offset - i );
+        pkg_version = rpm_strndup( arena, filename + i + 1, offset - i );
         break;
       }
     }
@@ -179,10 +225,13 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
     ok = lcfgpackage_set_version( *result, pkg_version );
     if ( !ok ) {
       invalid_rpm( msg, "bad version '%s'", pkg_version );
-      free(pkg_version);
+      rpm_strfree( arena, pkg_version );
       pkg_version = NULL;
       goto failure;
     }
+
+    if ( arena != NULL )
+      (*result)->_arena_fields |= LCFG_PKG_ARENA_VERSION;
   }
 
   /* Name field - everything else */
@@ -191,7 +240,7 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
   if ( i > 0 ) {
     offset = i - 1;
 
-    pkg_name = strndup( filename, offset + 1 );
+    pkg_name = rpm_strndup( arena, filename, offset + 1 );
   }
 
   if ( pkg_name == NULL ) {
@@ -202,14 +251,18 @@ LCFGStatus lcfgpackage_from_rpm_filename( const char * input,
     ok = lcfgpackage_set_name( *result, pkg_name );
     if ( !ok ) {
       invalid_rpm( msg, "bad name '%s'", pkg_name );
-      free(pkg_name);
+      rpm_strfree( arena, pkg_name );
       pkg_name = NULL;
       goto failure;
     }
+
+    if ( arena != NULL )
+      (*result)->_arena_fields |= LCFG_PKG_ARENA_NAME;
   }
 
   /* Finishing off */
 
+
   if ( !ok ) {
 
   failure:
@@ -481,8 +534,9 @@ LCFGChange lcfgpkglist_to_rpmlist( LCFGPackageList * pkglist,
  * The package set will be sorted so that the file is generated
  * consistently.
  *
- * The file is securely created using a temporary file and it is only
- * renamed to the target name if the contents differ. If the
+ * The contents are generated in memory and compared with the current
+ * file, only if they differ is the file securely created using a
+ * temporary file which is then renamed to the target name. If the
  * modification time is specified (i.e. non-zero) the mtime for the
  * file will always be updated. If the package list is empty then an
  * empty file will be created.
@@ -509,50 +563,33 @@ LCFGChange lcfgpkgset_to_rpmlist( LCFGPackageSet * pkgset,
 
   LCFGChange change = LCFG_CHANGE_NONE;
 
-  char * tmpfile = NULL;
-  FILE * tmpfh = lcfgutils_safe_tmpfile( filename, &tmpfile );
-
-  if ( tmpfh == NULL ) {
-    change = LCFG_CHANGE_ERROR;
-    lcfgutils_build_message( msg, "Failed to open rpmlist file" );
-    goto cleanup;
-  }
-
   /* For efficiency, ensure we have a default architecture */
   if ( defarch == NULL )
     defarch = default_architecture();
 
-  bool print_ok = lcfgpkgset_print( pkgset,
-                                    defarch,
-                                    base,
-                                    LCFG_PKG_STYLE_RPM,
-                                    LCFG_OPT_NEWLINE,
-                                    tmpfh );
+  /* The whole file is rendered into a single buffer which is then
+     compared with the current file and only written if different */
 
-  if (!print_ok) {
-    change = LCFG_CHANGE_ERROR;
-    lcfgutils_build_message( msg, "Failed to write rpmlist file" );
-  }
+  char * buffer = NULL;
+  size_t size = 0;
 
-  /* Always attempt to close temporary file */
+  ssize_t len = lcfgpkgset_to_buffer( pkgset,
+                                      defarch,
+                                      base,
+                                      LCFG_PKG_STYLE_RPM,
+                                      LCFG_OPT_NEWLINE,
+                                      &buffer, &size, 0 );
 
-  if ( fclose(tmpfh) != 0 ) {
+  if ( len < 0 ) {
     change = LCFG_CHANGE_ERROR;
-    lcfgutils_build_message( msg, "Failed to close rpmlist file" );
+    lcfgutils_build_message( msg, "Failed to write rpmlist file" );
+  } else {
+    change = lcfgutils_file_update_buffer( filename, buffer, len, mtime );
+    if ( change == LCFG_CHANGE_ERROR )
+      lcfgutils_build_message( msg, "Failed to write rpmlist file" );
   }
 
-  if ( change != LCFG_CHANGE_ERROR )
-    change = lcfgutils_file_update( filename, tmpfile, mtime );
-
- cleanup:
-
-  /* This might have already gone but call unlink to ensure
-     tidiness. Do not care about the result */
-
-  if ( tmpfile != NULL ) {
-    (void) unlink(tmpfile);
-    free(tmpfile);
-  }
+  free(buffer);
 
   return change;
 }
@@ -730,6 +767,10 @@ LCFGStatus lcfgpkgset_from_rpm_dir( const char * rpmdir,
   *result = lcfgpkgset_new();
   ok = lcfgpkgset_set_merge_rules( *result, LCFG_MERGE_RULE_KEEP_ALL );
 
+  /* Parsed packages are allocated from an arena tied to the set */
+
+  LCFGPkgArena * arena = lcfgpkgset_arena(*result);
+
   /* Scan the directory for any non-hidden files with .rpm suffix */
 
   struct dirent * dp;
@@ -749,8 +790,9 @@ LCFGStatus lcfgpkgset_from_rpm_dir( const char * rpmdir,
 
       LCFGPackage * pkg = NULL;
       char * parse_msg = NULL;
-      LCFGStatus parse_rc = lcfgpackage_from_rpm_filename( filename, &pkg,
-                                                           &parse_msg );
+      LCFGStatus parse_rc = lcfgpackage_parse_rpm_filename( filename, arena,
+                                                            &pkg,
+                                                            &parse_msg );
 
       if ( parse_rc == LCFG_STATUS_ERROR ) {
 
@@ -1032,23 +1074,27 @@ LCFGStatus lcfgpkgset_from_rpmlist( const char * filename,
   ok = lcfgpkgset_set_merge_rules( *result,
                     LCFG_MERGE_RULE_SQUASH_IDENTICAL | LCFG_MERGE_RULE_KEEP_ALL );
 
+  /* Parsed packages are allocated from an arena tied to the set */
+
+  LCFGPkgArena * arena = lcfgpkgset_arena(*result);
+
   unsigned int linenum = 0;
   while( ok && getline( &line, &line_len, fp ) != -1 ) {
     linenum++;
 
-    char * trimmed = strdup(line);
+    /* The line buffer is reused so it can be trimmed in place */
+
+    char * trimmed = line;
     lcfgutils_string_trim(trimmed);
 
     /* Ignore empty lines */
-    if ( *trimmed == '\0' || *trimmed == '#' ) {
-      free(trimmed);
-      continue;
-    }
+    if ( *trimmed == '\0' || *trimmed == '#' ) continue;
 
     LCFGPackage * pkg = NULL;
     char * parse_errmsg = NULL;
-    LCFGStatus parse_rc = lcfgpackage_from_rpm_filename( trimmed, &pkg,
-                                                         &parse_errmsg );
+    LCFGStatus parse_rc = lcfgpackage_parse_rpm_filename( trimmed, arena,
+                                                          &pkg,
+                                                          &parse_errmsg );
 
     if ( parse_rc == LCFG_STATUS_ERROR ) {
 
@@ -1086,8 +1132,6 @@ LCFGStatus lcfgpkgset_from_rpmlist( const char * filename,
 
     }
     lcfgpackage_relinquish(pkg);
-
-    free(trimmed);
   }
   fclose(fp);
   free(line);
@@ -1296,8 +1340,9 @@ LCFGChange lcfgpkglist_to_rpmcfg( LCFGPackageList * active,
  * The package set will be sorted so that the file is generated
  * consistently.
  *
- * The file is securely created using a temporary file and it is only
- * renamed to the target name if the contents differ. If the
+ * The contents are generated in memory and compared with the current
+ * file, only if they differ is the file securely created using a
+ * temporary file which is then renamed to the target name. If the
  * modification time is specified (i.e. non-zero) the mtime for the
  * file will always be updated. If the package list is empty then an
  * empty file will be created.
@@ -1326,75 +1371,65 @@ LCFGChange lcfgpkgset_to_rpmcfg( LCFGPackageSet * active,
   *msg = NULL;
   LCFGChange change = LCFG_CHANGE_NONE;
 
-  char * tmpfile = NULL;
-  FILE * tmpfh = lcfgutils_safe_tmpfile( filename, &tmpfile );
-
-  if ( tmpfh == NULL ) {
-    change = LCFG_CHANGE_ERROR;
-    lcfgutils_build_message( msg, "Failed to open temporary rpmcfg file" );
-    goto cleanup;
-  }
+  /* The whole file is rendered into a single buffer which is then
+     compared with the current file and only written if different */
 
-  bool print_ok = true;
+  char * buffer = NULL;
+  size_t size = 0;
+  ssize_t len = 0;
 
   /* The sort is not just cosmetic - there needs to be a deterministic
-     order so that we can compare the RPM list for changes using cmp */
+     order so that we can compare the RPM list for changes */
 
   if ( !lcfgpkgset_is_empty(active) ) {
-    print_ok = lcfgpkgset_print( active, defarch, NULL,
-                                 LCFG_PKG_STYLE_CPP, LCFG_OPT_USE_META,
-                                 tmpfh );
+    len = lcfgpkgset_to_buffer( active, defarch, NULL,
+                                LCFG_PKG_STYLE_CPP, LCFG_OPT_USE_META,
+                                &buffer, &size, len );
   }
 
   /* List the RPMs that would be present in other contexts. This is
     used by the rpm cache stuff because we need to cache all the RPMs,
     regardless of context. */
 
-  if (print_ok) {
-    if ( fprintf( tmpfh, "#ifdef ALL_CONTEXTS\n" ) < 0 )
-      print_ok = false;
-  }
+  static const char all_start[] = "#ifdef ALL_CONTEXTS\n";
+  static const char all_end[]   = "#endif\n\n";
 
-  if ( print_ok && !lcfgpkgset_is_empty(inactive) ) {
-    print_ok = lcfgpkgset_print( inactive, defarch, NULL,
-                                 LCFG_PKG_STYLE_CPP, LCFG_OPT_USE_META,
-                                 tmpfh );
-  }
+  if ( len >= 0 )
+    len = lcfgpackages_buffer_append( &buffer, &size, len,
+                                      all_start, sizeof(all_start) - 1 );
 
-  if (print_ok) {
-    if ( fprintf( tmpfh, "#endif\n\n" ) < 0 )
-      print_ok = false;
+  if ( len >= 0 && !lcfgpkgset_is_empty(inactive) ) {
+    len = lcfgpkgset_to_buffer( inactive, defarch, NULL,
+                                LCFG_PKG_STYLE_CPP, LCFG_OPT_USE_META,
+                                &buffer, &size, len );
   }
 
-  if ( print_ok && rpminc != NULL ) {
-    if ( fprintf( tmpfh, "#include \"%s\"\n", rpminc ) < 0 )
-      print_ok = false;
-  }
+  if ( len >= 0 )
+    len = lcfgpackages_buffer_append( &buffer, &size, len,
+                                      all_end, sizeof(all_end) - 1 );
 
-  if (!print_ok) {
-    change = LCFG_CHANGE_ERROR;
-    lcfgutils_build_message( msg, "Failed to write rpmcfg file" );
-  }
+  if ( len >= 0 && rpminc != NULL ) {
+    char * include = NULL;
+    int rc = asprintf( &include, "#include \"%s\"\n", rpminc );
+    if ( rc < 0 ) {
+      perror( "Failed to allocate memory for LCFG rpmcfg file" );
+      exit(EXIT_FAILURE);
+    }
 
-  /* Always attempt to close temporary file */
+    len = lcfgpackages_buffer_append( &buffer, &size, len, include, rc );
+    free(include);
+  }
 
-  if ( fclose(tmpfh) != 0 ) {
+  if ( len < 0 ) {
     change = LCFG_CHANGE_ERROR;
-    lcfgutils_build_message( msg, "Failed to close rpmcfg file" );
+    lcfgutils_build_message( msg, "Failed to write rpmcfg file" );
+  } else {
+    change = lcfgutils_file_update_buffer( filename, buffer, len, mtime );
+    if ( change == LCFG_CHANGE_ERROR )
+      lcfgutils_build_message( msg, "Failed to write rpmcfg file" );
   }
 
-  if ( change != LCFG_CHANGE_ERROR )
-    change = lcfgutils_file_update( filename, tmpfile, mtime );
-
- cleanup:
-
-  /* This might have already gone but call unlink to ensure
-     tidiness. Do not care about the result */
-
-  if ( tmpfile != NULL ) {
-    (void) unlink(tmpfile);
-    free(tmpfile);
-  }
+  free(buffer);
 
   return change;
 }
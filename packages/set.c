@@ -32,15 +32,8 @@ static double lcfgpkgset_load_factor( const LCFGPackageSet * pkgset ) {
   return ( (double) pkgset->entries / (double) pkgset->buckets );
 }
 
-static void lcfgpkgset_resize( LCFGPackageSet * pkgset ) {
-
-  double load_factor = lcfgpkgset_load_factor(pkgset);
-
-  size_t want_buckets = pkgset->buckets;
-  if ( load_factor >= LCFG_PKGSET_LOAD_MAX ) {
-    want_buckets = (size_t) 
-      ( (double) pkgset->entries / LCFG_PKGSET_LOAD_INIT ) + 1;
-  }
+static void lcfgpkgset_rehash( LCFGPackageSet * pkgset,
+                               size_t want_buckets ) {
 
   LCFGPackageList ** cur_set = pkgset->packages;
   size_t cur_buckets = pkgset->buckets;
@@ -94,6 +87,43 @@ static void lcfgpkgset_resize( LCFGPackageSet * pkgset ) {
 
 }
 
+static void lcfgpkgset_resize( LCFGPackageSet * pkgset ) {
+
+  double load_factor = lcfgpkgset_load_factor(pkgset);
+
+  size_t want_buckets = pkgset->buckets;
+  if ( load_factor >= LCFG_PKGSET_LOAD_MAX ) {
+    want_buckets = (size_t) 
+      ( (double) pkgset->entries / LCFG_PKGSET_LOAD_INIT ) + 1;
+  }
+
+  lcfgpkgset_rehash( pkgset, want_buckets );
+}
+
+/**
+ * @brief Ensure the package set has space for many entries
+ *
+ * This can be used to size the hash table for a package set ahead of
+ * a bulk insertion so that it does not need to be repeatedly resized
+ * as the packages are merged. The number of entries is the number of
+ * distinct package names, specifying the total number of packages is
+ * a safe upper limit. If the set is already large enough this has no
+ * effect.
+ *
+ * @param[in] pkgset Pointer to @c LCFGPackageSet
+ * @param[in] entries Number of entries expected
+ *
+ */
+
+void lcfgpkgset_reserve( LCFGPackageSet * pkgset, unsigned long entries ) {
+  assert( pkgset != NULL );
+
+  size_t want_buckets = (size_t)
+    ( (double) ( pkgset->entries + entries ) / LCFG_PKGSET_LOAD_INIT ) + 1;
+
+  lcfgpkgset_rehash( pkgset, want_buckets );
+}
+
 /**
  * @brief Create and initialise a new empty package set
  *
@@ -124,6 +154,8 @@ LCFGPackageSet * lcfgpkgset_new() {
   pkgset->packages    = NULL;
   pkgset->entries     = 0;
   pkgset->buckets     = LCFG_PKGSET_DEFAULT_SIZE;
+  pkgset->index       = NULL;
+  pkgset->arena       = NULL;
   pkgset->_refcount   = 1;
 
   lcfgpkgset_resize(pkgset);
@@ -174,10 +206,44 @@ void lcfgpkgset_destroy(LCFGPackageSet * pkgset) {
   free(pkgset->packages);
   pkgset->packages = NULL;
 
+  lcfgpkgset_drop_index(pkgset);
+
+  /* Any packages from the arena still in use elsewhere hold their own
+     references so this only frees the slabs when all are gone */
+
+  lcfgpkgarena_relinquish(pkgset->arena);
+  pkgset->arena = NULL;
+
   free(pkgset);
   pkgset = NULL;
 }
 
+/**
+ * @brief Get the arena for parsing packages into the set
+ *
+ * This returns the @c LCFGPkgArena which is used to allocate packages
+ * which are parsed from files into the @c LCFGPackageSet, the arena
+ * is created when first required. The arena is tied to the lifetime
+ * of the set, the set holds one reference and every package
+ * allocated from the arena holds another. This means that when the
+ * set is destroyed all the memory for the parsed packages is freed
+ * together as a small number of large slabs.
+ *
+ * @param[in] pkgset Pointer to @c LCFGPackageSet
+ *
+ * @return Pointer to the @c LCFGPkgArena for the set
+ *
+ */
+
+LCFGPkgArena * lcfgpkgset_arena( LCFGPackageSet * pkgset ) {
+  assert( pkgset != NULL );
+
+  if ( pkgset->arena == NULL )
+    pkgset->arena = lcfgpkgarena_new();
+
+  return pkgset->arena;
+}
+
 /**
  * @brief Acquire reference to package set
  *
@@ -470,6 +536,11 @@ LCFGChange lcfgpkgset_merge_package( LCFGPackageSet * pkgset,
 
     change = lcfgpkglist_merge_package( pkglist, new_pkg, msg );
 
+    /* Any search index is now out of date */
+
+    if ( change != LCFG_CHANGE_NONE )
+      lcfgpkgset_drop_index(pkgset);
+
     if (new_entry) {
       if ( LCFGChangeOK(change) && change != LCFG_CHANGE_NONE ) {
         packages[slot] = pkglist;
@@ -785,12 +856,63 @@ static unsigned int lcfgpkgset_sorted_entries( const LCFGPackageSet * pkgset,
 }
 
 /**
- * @brief Write list of formatted packages to file stream
+ * @brief Append a string to a growable buffer
+ *
+ * This appends the string to the buffer at the specified offset,
+ * the buffer is grown (at least doubling in size) when there is not
+ * enough space. The buffer is always nul-terminated.
+ *
+ * If the memory allocation is not successful the @c exit() function
+ * will be called with a non-zero value.
+ *
+ * @param[in,out] buffer Reference to the pointer to the string buffer
+ * @param[in,out] size Reference to the size of the string buffer
+ * @param[in] len Current length of string in buffer
+ * @param[in] str String to be appended
+ * @param[in] str_len Length of string to be appended
+ *
+ * @return The new length of the string in the buffer
+ *
+ */
+
+size_t lcfgpackages_buffer_append( char ** buffer, size_t * size, size_t len,
+                                   const char * str, size_t str_len ) {
+
+  if ( *buffer == NULL || *size < ( len + str_len + 1 ) ) {
+    size_t new_size = *buffer == NULL ? 16384 : *size * 2;
+    while ( new_size < ( len + str_len + 1 ) ) new_size *= 2;
+
+    char * new_buf = realloc( *buffer, new_size * sizeof(char) );
+    if ( new_buf == NULL ) {
+      perror( "Failed to allocate memory for LCFG package buffer" );
+      exit(EXIT_FAILURE);
+    }
+
+    *buffer = new_buf;
+    *size   = new_size;
+  }
+
+  memcpy( *buffer + len, str, str_len );
+  len += str_len;
+  (*buffer)[len] = '\0';
+
+  return len;
+}
+
+/**
+ * @brief Format list of packages into a buffer
  *
  * This uses @c lcfgpackage_to_string() to format each package as a
  * string. See the documentation for that function for full
- * details. The generated string is written to the specified file
- * stream which must have already been opened for writing.
+ * details. The generated strings are appended, in sorted order, to
+ * the buffer starting at the specified offset (e.g. the current
+ * length of the string in the buffer). The buffer is grown as
+ * necessary so that all the packages are rendered into a single
+ * block of memory which can then be written out with one call.
+ *
+ * If the buffer is initially unallocated then it MUST be set to
+ * @c NULL and the size should be zero. To avoid memory leaks, call
+ * @c free(3) on the buffer when no longer required.
  *
  * Packages which are invalid will be ignored.
  *
@@ -799,18 +921,20 @@ static unsigned int lcfgpkgset_sorted_entries( const LCFGPackageSet * pkgset,
  * @param[in] base String to be prepended to all package strings
  * @param[in] style Integer indicating required style of formatting
  * @param[in] options Integer that controls formatting
- * @param[in] out Stream to which the packages should be written
+ * @param[in,out] buffer Reference to the pointer to the string buffer
+ * @param[in,out] size Reference to the size of the string buffer
+ * @param[in] len Current length of string in buffer
  *
- * @return Boolean indicating success
+ * @return The new length of the string in the buffer (or -1 for an error)
  *
  */
 
-bool lcfgpkgset_print( const LCFGPackageSet * pkgset,
-                       const char * defarch,
-                       const char * base,
-                       LCFGPkgStyle style,
-                       LCFGOption options,
-                       FILE * out ) {
+ssize_t lcfgpkgset_to_buffer( const LCFGPackageSet * pkgset,
+                              const char * defarch,
+                              const char * base,
+                              LCFGPkgStyle style,
+                              LCFGOption options,
+                              char ** buffer, size_t * size, size_t len ) {
   assert( pkgset != NULL );
 
   LCFGPkgSetEntry * entries = NULL;
@@ -839,22 +963,29 @@ bool lcfgpkgset_print( const LCFGPackageSet * pkgset,
       break;
     }
 
-  bool ok = true;
+  static const char xml_start[] = "  <packages>\n";
+  static const char xml_end[]   = "  </packages>\n";
 
   if ( style == LCFG_PKG_STYLE_XML )
-    ok = ( fputs( "  <packages>\n", out ) >= 0 );
+    len = lcfgpackages_buffer_append( buffer, size, len,
+                                      xml_start, sizeof(xml_start) - 1 );
+
+  size_t base_len = isempty(base) ? 0 : strlen(base);
 
-  /* Derivation information is often enormous so initialise a much
-     larger buffer when that option is enabled */
+  /* Each package is formatted into a reusable scratch buffer and then
+     appended. Derivation information is often enormous so initialise
+     a much larger buffer when that option is enabled */
 
-  size_t buf_size = options&LCFG_OPT_USE_META ?  16384 : 512;
+  size_t pkg_size = options&LCFG_OPT_USE_META ?  16384 : 512;
 
-  char * buffer = calloc( buf_size, sizeof(char) );
-  if ( buffer == NULL ) {
+  char * pkg_buf = calloc( pkg_size, sizeof(char) );
+  if ( pkg_buf == NULL ) {
     perror( "Failed to allocate memory for LCFG package buffer" );
     exit(EXIT_FAILURE);
   }
 
+  bool ok = true;
+
   unsigned long i;
   for ( i=0; i<count && ok; i++ ) {
 
@@ -871,7 +1002,7 @@ bool lcfgpkgset_print( const LCFGPackageSet * pkgset,
       if ( lcfgpackage_is_valid(pkg) ) {
 
         ssize_t rc = lcfgpackage_to_string( pkg, defarch, style, options,
-                                            &buffer, &buf_size );
+                                            &pkg_buf, &pkg_size );
 
         if ( rc < 0 ) {
           ok = false;
@@ -879,18 +1010,14 @@ bool lcfgpkgset_print( const LCFGPackageSet * pkgset,
 
           /* Optional base string */
 
-          if ( !isempty(base) ) {
-            if ( fputs( base, out ) < 0 )
-              ok = false;
-          }
+          if ( base_len > 0 )
+            len = lcfgpackages_buffer_append( buffer, size, len,
+                                              base, base_len );
 
           /* Package string */
 
-          if (ok) {
-            if ( fputs( buffer, out ) < 0 )
-              ok = false;
-          }
-
+          len = lcfgpackages_buffer_append( buffer, size, len,
+                                            pkg_buf, (size_t) rc );
         }
       }
 
@@ -898,10 +1025,56 @@ bool lcfgpkgset_print( const LCFGPackageSet * pkgset,
   }
 
   free(entries);
-  free(buffer);
+  free(pkg_buf);
 
   if ( ok && style == LCFG_PKG_STYLE_XML )
-    ok = ( fputs( "  </packages>\n", out ) >= 0 );
+    len = lcfgpackages_buffer_append( buffer, size, len,
+                                      xml_end, sizeof(xml_end) - 1 );
+
+  return ( ok ? (ssize_t) len : -1 );
+}
+
+/**
+ * @brief Write list of formatted packages to file stream
+ *
+ * This uses @c lcfgpkgset_to_buffer() to format all the packages
+ * into a single buffer. See the documentation for that function for
+ * full details. The generated string is written to the specified
+ * file stream which must have already been opened for writing.
+ *
+ * Packages which are invalid will be ignored.
+ *
+ * @param[in] pkgset Pointer to @c LCFGPackageSet
+ * @param[in] defarch Default architecture string (may be @c NULL)
+ * @param[in] base String to be prepended to all package strings
+ * @param[in] style Integer indicating required style of formatting
+ * @param[in] options Integer that controls formatting
+ * @param[in] out Stream to which the packages should be written
+ *
+ * @return Boolean indicating success
+ *
+ */
+
+bool lcfgpkgset_print( const LCFGPackageSet * pkgset,
+                       const char * defarch,
+                       const char * base,
+                       LCFGPkgStyle style,
+                       LCFGOption options,
+                       FILE * out ) {
+  assert( pkgset != NULL );
+
+  char * buffer = NULL;
+  size_t size = 0;
+
+  ssize_t len = lcfgpkgset_to_buffer( pkgset, defarch, base, style, options,
+                                      &buffer, &size, 0 );
+
+  bool ok = ( len >= 0 );
+
+  if ( ok && len > 0 )
+    ok = ( fwrite( buffer, sizeof(char), len, out ) == (size_t) len );
+
+  free(buffer);
 
   return ok;
 }
@@ -1082,6 +1255,36 @@ LCFGChange lcfgpkgset_from_pkgsfile( const char * filename,
 
 #include <fnmatch.h>
 
+static bool lcfgpkgset_match_slot( LCFGPackageSet * result,
+                                   const LCFGPackageList * pkgs_for_name,
+                                   const char * want_name,
+                                   const char * want_arch,
+                                   const char * want_ver,
+                                   const char * want_rel ) {
+
+  if ( lcfgpkglist_is_empty(pkgs_for_name) ) return true;
+
+  const LCFGPackage * first_pkg = lcfgpkglist_first_package(pkgs_for_name);
+
+  if ( !lcfgpackage_is_valid(first_pkg) ||
+       ( !isempty(want_name) &&
+         fnmatch( want_name, first_pkg->name, 0 ) != 0 ) ) return true;
+
+  LCFGPackageList * matches = lcfgpkglist_match( pkgs_for_name,
+                                                 want_name,
+                                                 want_arch,
+                                                 want_ver,
+                                                 want_rel );
+  char * merge_msg = NULL;
+  LCFGChange merge_rc = lcfgpkgset_merge_list( result, matches,
+                                               &merge_msg );
+  free(merge_msg);
+
+  lcfgpkglist_relinquish(matches);
+
+  return ( merge_rc != LCFG_CHANGE_ERROR );
+}
+
 /**
  * @brief Search package set for all matches
  *
@@ -1093,6 +1296,10 @@ LCFGChange lcfgpkgset_from_pkgsfile( const char * filename,
  * (asterisk) meta-characters are supported. To avoid matching on a
  * particular parameter specify the value as @c NULL.
  *
+ * If a search index has been built for the set using @c
+ * lcfgpkgset_build_index() then it will be used to reduce the number
+ * of packages which have to be compared with the name pattern.
+ *
  * To avoid memory leaks, when the set of matches is no longer
  * required the @c lcfgpkgset_relinquish() function should be called.
  *
@@ -1125,39 +1332,28 @@ LCFGPackageSet * lcfgpkgset_match( const LCFGPackageSet * pkgset,
 
   LCFGPackageList ** packages = pkgset->packages;
 
-  /* Run the search */
+  /* Run the search, if possible only the candidates found using the
+     index are checked. */
 
   bool ok = true;
 
-  bool all_names = isempty(want_name);
+  const unsigned long * slots = NULL;
+  unsigned long count = 0;
 
   unsigned long i;
-  for ( i=0; i<pkgset->buckets && ok; i++ ) {
-    LCFGPackageList * pkgs_for_name = packages[i];
+  if ( !isempty(want_name) &&
+       lcfgpkgset_index_candidates( pkgset, want_name, &slots, &count ) ) {
 
-    if ( !lcfgpkglist_is_empty(pkgs_for_name) ) {
-      const LCFGPackage * first_pkg =
-        lcfgpkglist_first_package(pkgs_for_name);
-
-      if ( lcfgpackage_is_valid(first_pkg) && 
-           ( all_names || fnmatch( want_name, first_pkg->name, 0 ) == 0 ) ) {
-
-        LCFGPackageList * matches = lcfgpkglist_match( pkgs_for_name,
-                                                       want_name,
-                                                       want_arch,
-                                                       want_ver,
-                                                       want_rel );
-        char * merge_msg = NULL;
-        LCFGChange merge_rc = lcfgpkgset_merge_list( result, matches,
-                                                     &merge_msg );
-        free(merge_msg);
-
-        if ( merge_rc == LCFG_CHANGE_ERROR )
-          ok = false;
+    for ( i=0; i<count && ok; i++ ) {
+      ok = lcfgpkgset_match_slot( result, packages[slots[i]],
+                                  want_name, want_arch, want_ver, want_rel );
+    }
 
-        lcfgpkglist_relinquish(matches);
-      }
+  } else {
 
+    for ( i=0; i<pkgset->buckets && ok; i++ ) {
+      ok = lcfgpkgset_match_slot( result, packages[i],
+                                  want_name, want_arch, want_ver, want_rel );
     }
 
   }
@@ -1170,14 +1366,58 @@ LCFGPackageSet * lcfgpkgset_match( const LCFGPackageSet * pkgset,
   return result;
 }
 
+static LCFGChange lcfgpkgset_eval_batch( const LCFGPackageSet * pkgset,
+                                         const LCFGContextList * ctxlist,
+                                         unsigned int max_threads,
+                                         char ** msg ) {
+
+  if ( lcfgpkgset_is_empty(pkgset) ) return LCFG_CHANGE_NONE;
+
+  LCFGPackageList ** packages = pkgset->packages;
+
+  /* Collect the distinct expressions, evaluate each of them once and
+     then apply the priorities to the packages */
+
+  LCFGContextBatch * batch = lcfgctxbatch_new();
+
+  unsigned long i;
+  for ( i=0; i<pkgset->buckets; i++ ) {
+    if ( packages[i] )
+      lcfgpkglist_collect_contexts( packages[i], batch );
+  }
+
+  LCFGChange result = LCFG_CHANGE_NONE;
+  if ( lcfgctxbatch_evaluate( batch, ctxlist, max_threads, msg )
+       != LCFG_STATUS_OK )
+    result = LCFG_CHANGE_ERROR;
+
+  for ( i=0; i<pkgset->buckets && LCFGChangeOK(result); i++ ) {
+
+    if ( packages[i] ) {
+
+      LCFGChange list_change =
+        lcfgpkglist_apply_priority( packages[i], batch, msg );
+
+      if ( list_change != LCFG_CHANGE_NONE )
+        result = list_change;
+    }
+
+  }
+
+  lcfgctxbatch_destroy(batch);
+
+  return result;
+}
+
 /**
  * @brief Evaluate the priority for all packages for a list of contexts
  *
  * This will evaluate and update the value of the @e priority
  * attribute for all the LCFG packages using the value set for the @e
  * context attribute (if any) and the list of LCFG contexts passed in
- * as an argument. The priority is evaluated using @c
- * lcfgpackage_eval_priority().
+ * as an argument. The priorities are the same as those from @c
+ * lcfgpackage_eval_priority() but each distinct context expression
+ * is only evaluated once, see @c lcfgctxbatch_evaluate() for details.
  *
  * The default value for the priority is zero, if the package is
  * applicable for the specified list of contexts the priority will be
@@ -1200,27 +1440,30 @@ LCFGChange lcfgpkgset_eval_priority( const LCFGPackageSet * pkgset,
                                      const LCFGContextList * ctxlist,
                                      char ** msg ) {
 
-  if ( lcfgpkgset_is_empty(pkgset) ) return LCFG_CHANGE_NONE;
-
-  LCFGPackageList ** packages = pkgset->packages;
-
-  LCFGChange result = LCFG_CHANGE_NONE;
-
-  unsigned long i;
-  for ( i=0; i<pkgset->buckets && LCFGChangeOK(result); i++ ) {
-
-    if ( packages[i] ) {
-
-      LCFGChange list_change =
-        lcfgpkglist_eval_priority( packages[i], ctxlist, msg );
+  return lcfgpkgset_eval_batch( pkgset, ctxlist, 1, msg );
+}
 
-      if ( list_change != LCFG_CHANGE_NONE )
-        result = list_change;
-    }
+/**
+ * @brief Evaluate the priority for all packages using multiple threads
+ *
+ * This does the same as @c lcfgpkgset_eval_priority() except that
+ * when there are many distinct context expressions they are split
+ * into chunks which are evaluated in parallel. The number of threads
+ * used is limited to the number of online processors.
+ *
+ * @param[in] pkg Pointer to an @c LCFGPackageSet
+ * @param[in] ctxlist List of LCFG contexts
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
 
-  }
+LCFGChange lcfgpkgset_eval_priority_parallel( const LCFGPackageSet * pkgset,
+                                              const LCFGContextList * ctxlist,
+                                              char ** msg ) {
 
-  return result;
+  return lcfgpkgset_eval_batch( pkgset, ctxlist, 0, msg );
 }
 
 /**
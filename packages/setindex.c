@@ -0,0 +1,513 @@
+/**
+ * @file packages/setindex.c
+ * @brief Search index for LCFG package sets
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packages.h"
+#include "container.h"
+#include "utils.h"
+
+/* Used when sorting the names and the reversed names */
+
+struct LCFGPkgIndexName {
+  const char * name;
+  unsigned long slot;
+};
+
+/* Used when collecting the trigrams for all names */
+
+struct LCFGPkgIndexGram {
+  uint32_t gram;
+  unsigned long slot;
+};
+
+static int lcfgpkgindex_name_compare( const void * a, const void * b ) {
+  const struct LCFGPkgIndexName * n1 = a;
+  const struct LCFGPkgIndexName * n2 = b;
+  return strcmp( n1->name, n2->name );
+}
+
+static int lcfgpkgindex_gram_compare( const void * a, const void * b ) {
+  const struct LCFGPkgIndexGram * g1 = a;
+  const struct LCFGPkgIndexGram * g2 = b;
+
+  int result = 0;
+  if ( g1->gram != g2->gram )
+    result = g1->gram < g2->gram ? -1 : 1;
+  else if ( g1->slot != g2->slot )
+    result = g1->slot < g2->slot ? -1 : 1;
+
+  return result;
+}
+
+static inline uint32_t lcfgpkgindex_gram( const char * str ) {
+  return ( (uint32_t) (unsigned char) str[0] << 16 ) |
+         ( (uint32_t) (unsigned char) str[1] << 8  ) |
+           (uint32_t) (unsigned char) str[2];
+}
+
+static void * lcfgpkgindex_alloc( size_t nmemb, size_t size ) {
+
+  void * ptr = calloc( nmemb > 0 ? nmemb : 1, size );
+  if ( ptr == NULL ) {
+    perror( "Failed to allocate memory for LCFG package set index" );
+    exit(EXIT_FAILURE);
+  }
+
+  return ptr;
+}
+
+static void lcfgpkgindex_sort_names( struct LCFGPkgIndexName * tmp,
+                                     unsigned long size,
+                                     const char ** names,
+                                     unsigned long * slots ) {
+
+  qsort( tmp, size, sizeof(struct LCFGPkgIndexName),
+         lcfgpkgindex_name_compare );
+
+  unsigned long i;
+  for ( i=0; i<size; i++ ) {
+    names[i] = tmp[i].name;
+    slots[i] = tmp[i].slot;
+  }
+
+}
+
+static void lcfgpkgindex_destroy( LCFGPkgSetIndex * index ) {
+
+  if ( index == NULL ) return;
+
+  free(index->strings);
+  free(index->names);
+  free(index->name_slots);
+  free(index->rnames);
+  free(index->rname_slots);
+  free(index->grams);
+  free(index->gram_start);
+  free(index->postings);
+
+  free(index);
+  index = NULL;
+}
+
+static LCFGPkgSetIndex * lcfgpkgindex_new( const LCFGPackageSet * pkgset ) {
+
+  LCFGPkgSetIndex * index = lcfgpkgindex_alloc( 1, sizeof(LCFGPkgSetIndex) );
+
+  LCFGPackageList ** packages = pkgset->packages;
+
+  /* Collect the names, each name is copied (forwards and reversed)
+     into a single block so that the index does not depend on the
+     lifetime of the packages. */
+
+  unsigned long size = 0;
+  size_t total_len = 0;
+  size_t total_grams = 0;
+
+  unsigned long i;
+  for ( i=0; i<pkgset->buckets; i++ ) {
+    if ( !lcfgpkglist_is_empty(packages[i]) ) {
+      const LCFGPackage * pkg = lcfgpkglist_first_package(packages[i]);
+      if ( lcfgpackage_is_valid(pkg) ) {
+        size_t len = strlen(pkg->name);
+        size++;
+        total_len += len + 1;
+        if ( len >= 3 ) total_grams += len - 2;
+      }
+    }
+  }
+
+  index->size        = size;
+  index->strings     = lcfgpkgindex_alloc( 2 * total_len, sizeof(char) );
+  index->names       = lcfgpkgindex_alloc( size, sizeof(char *) );
+  index->name_slots  = lcfgpkgindex_alloc( size, sizeof(unsigned long) );
+  index->rnames      = lcfgpkgindex_alloc( size, sizeof(char *) );
+  index->rname_slots = lcfgpkgindex_alloc( size, sizeof(unsigned long) );
+
+  struct LCFGPkgIndexName * fwd =
+    lcfgpkgindex_alloc( size, sizeof(struct LCFGPkgIndexName) );
+  struct LCFGPkgIndexName * rev =
+    lcfgpkgindex_alloc( size, sizeof(struct LCFGPkgIndexName) );
+  struct LCFGPkgIndexGram * grams =
+    lcfgpkgindex_alloc( total_grams, sizeof(struct LCFGPkgIndexGram) );
+
+  char * fwd_str = index->strings;
+  char * rev_str = index->strings + total_len;
+
+  unsigned long n = 0;
+  size_t g = 0;
+  for ( i=0; i<pkgset->buckets; i++ ) {
+    if ( lcfgpkglist_is_empty(packages[i]) ) continue;
+
+    const LCFGPackage * pkg = lcfgpkglist_first_package(packages[i]);
+    if ( !lcfgpackage_is_valid(pkg) ) continue;
+
+    const char * name = pkg->name;
+    size_t len = strlen(name);
+
+    memcpy( fwd_str, name, len + 1 );
+
+    size_t j;
+    for ( j=0; j<len; j++ )
+      rev_str[j] = name[len - 1 - j];
+    rev_str[len] = '\0';
+
+    fwd[n].name = fwd_str;
+    fwd[n].slot = i;
+    rev[n].name = rev_str;
+    rev[n].slot = i;
+
+    for ( j=0; j+2<len; j++ ) {
+      grams[g].gram = lcfgpkgindex_gram( name + j );
+      grams[g].slot = i;
+      g++;
+    }
+
+    fwd_str += len + 1;
+    rev_str += len + 1;
+    n++;
+  }
+
+  lcfgpkgindex_sort_names( fwd, size, index->names, index->name_slots );
+  lcfgpkgindex_sort_names( rev, size, index->rnames, index->rname_slots );
+
+  free(fwd);
+  free(rev);
+
+  /* Sort the trigrams and squash any duplicates (where a trigram
+     appears more than once in a name) then build the posting lists. */
+
+  qsort( grams, total_grams, sizeof(struct LCFGPkgIndexGram),
+         lcfgpkgindex_gram_compare );
+
+  size_t uniq_pairs = 0, uniq_grams = 0;
+  for ( g=0; g<total_grams; g++ ) {
+    if ( g == 0 || grams[g].gram != grams[g-1].gram ) {
+      uniq_grams++;
+      uniq_pairs++;
+    } else if ( grams[g].slot != grams[g-1].slot ) {
+      uniq_pairs++;
+    }
+  }
+
+  index->ngrams     = uniq_grams;
+  index->grams      = lcfgpkgindex_alloc( uniq_grams, sizeof(uint32_t) );
+  index->gram_start = lcfgpkgindex_alloc( uniq_grams + 1,
+                                          sizeof(unsigned long) );
+  index->postings   = lcfgpkgindex_alloc( uniq_pairs,
+                                          sizeof(unsigned long) );
+
+  size_t p = 0, k = 0;
+  for ( g=0; g<total_grams; g++ ) {
+    if ( g == 0 || grams[g].gram != grams[g-1].gram ) {
+      index->grams[k]      = grams[g].gram;
+      index->gram_start[k] = p;
+      k++;
+      index->postings[p++] = grams[g].slot;
+    } else if ( grams[g].slot != grams[g-1].slot ) {
+      index->postings[p++] = grams[g].slot;
+    }
+  }
+  index->gram_start[k] = p;
+
+  free(grams);
+
+  return index;
+}
+
+/**
+ * @brief Build a search index for the package set
+ *
+ * This builds a search index for the names of the packages in the
+ * @c LCFGPackageSet which is used by @c lcfgpkgset_match() to avoid
+ * having to compare the name pattern against every package in the
+ * set. The index holds the sorted package names (for patterns with a
+ * literal prefix, e.g. @c perl-*), the sorted reversed names (for
+ * patterns with a literal suffix, e.g. @c *-devel) and the set of
+ * packages in which each trigram (3 character sequence) appears (for
+ * patterns containing a literal substring, e.g. @c *python3*). The
+ * candidates found using the index are still checked using the full
+ * pattern so the results are identical to those without an index.
+ *
+ * The index is a snapshot of the package names, it is automatically
+ * dropped when the set is changed by merging packages, it must be
+ * rebuilt to be used again. Building an index is only worthwhile when
+ * a set is going to be searched many times. If there is already an
+ * index for the set it will be rebuilt.
+ *
+ * If the memory allocation for the index is not successful the
+ * @c exit() function will be called with a non-zero value.
+ *
+ * @param[in] pkgset Pointer to @c LCFGPackageSet
+ *
+ */
+
+void lcfgpkgset_build_index( LCFGPackageSet * pkgset ) {
+  assert( pkgset != NULL );
+
+  lcfgpkgset_drop_index(pkgset);
+
+  pkgset->index = lcfgpkgindex_new(pkgset);
+}
+
+/**
+ * @brief Drop any search index for the package set
+ *
+ * This frees any search index which was created for the @c
+ * LCFGPackageSet using @c lcfgpkgset_build_index(). It is safe to
+ * call this function when there is no index.
+ *
+ * @param[in] pkgset Pointer to @c LCFGPackageSet
+ *
+ */
+
+void lcfgpkgset_drop_index( LCFGPackageSet * pkgset ) {
+  assert( pkgset != NULL );
+
+  lcfgpkgindex_destroy(pkgset->index);
+  pkgset->index = NULL;
+}
+
+/**
+ * @brief Check if the package set has a search index
+ *
+ * @param[in] pkgset Pointer to @c LCFGPackageSet
+ *
+ * @return Boolean which indicates if there is a current search index
+ *
+ */
+
+bool lcfgpkgset_has_index( const LCFGPackageSet * pkgset ) {
+  return ( pkgset != NULL && pkgset->index != NULL );
+}
+
+/* Find the range of names which start with the specified string using
+   a binary search. Comparing only the first len bytes keeps the order
+   consistent with the strcmp() sorting. */
+
+static unsigned long lcfgpkgindex_bound( const char ** names,
+                                         unsigned long size,
+                                         const char * str, size_t len,
+                                         bool upper ) {
+  unsigned long lo = 0, hi = size;
+  while ( lo < hi ) {
+    unsigned long mid = lo + ( hi - lo ) / 2;
+    int cmp = strncmp( names[mid], str, len );
+    if ( cmp < 0 || ( upper && cmp == 0 ) )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static void lcfgpkgindex_range( const char ** names,
+                                const unsigned long * slots,
+                                unsigned long size,
+                                const char * str, size_t len,
+                                const unsigned long ** result,
+                                unsigned long * count ) {
+
+  unsigned long first = lcfgpkgindex_bound( names, size, str, len, false );
+  unsigned long last  = lcfgpkgindex_bound( names, size, str, len, true );
+
+  *result = slots + first;
+  *count  = last - first;
+}
+
+static void lcfgpkgindex_postings( const LCFGPkgSetIndex * index,
+                                   uint32_t gram,
+                                   const unsigned long ** result,
+                                   unsigned long * count ) {
+
+  unsigned long lo = 0, hi = index->ngrams;
+  while ( lo < hi ) {
+    unsigned long mid = lo + ( hi - lo ) / 2;
+    if ( index->grams[mid] < gram )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if ( lo < index->ngrams && index->grams[lo] == gram ) {
+    *result = index->postings + index->gram_start[lo];
+    *count  = index->gram_start[lo+1] - index->gram_start[lo];
+  } else {
+    *result = index->postings;
+    *count  = 0;
+  }
+
+}
+
+/**
+ * @brief Find candidate slots for a name pattern
+ *
+ * This uses the search index for the @c LCFGPackageSet to find the
+ * smallest set of slots in the package array which might hold
+ * packages with names that match the @c fnmatch(3) pattern. The
+ * literal parts of the pattern are extracted, the prefix and suffix
+ * are looked up in the sorted names and reversed names, any literal
+ * part which is at least 3 characters long is looked up in the
+ * trigram index. The candidates are not guaranteed to match, they
+ * must still be checked against the full pattern.
+ *
+ * The results point into the index so they are only valid whilst the
+ * index exists, they must not be freed.
+ *
+ * If there is no index, or the pattern does not contain enough
+ * literal text to narrow the search, then false is returned and all
+ * slots must be searched.
+ *
+ * @param[in] pkgset Pointer to @c LCFGPackageSet
+ * @param[in] pattern Package name pattern
+ * @param[out] result Reference to array of candidate slots
+ * @param[out] count Number of candidate slots
+ *
+ * @return Boolean which indicates if the index could be used
+ *
+ */
+
+bool lcfgpkgset_index_candidates( const LCFGPackageSet * pkgset,
+                                  const char * pattern,
+                                  const unsigned long ** result,
+                                  unsigned long * count ) {
+  assert( pkgset != NULL );
+  assert( pattern != NULL );
+
+  const LCFGPkgSetIndex * index = pkgset->index;
+  if ( index == NULL ) return false;
+
+  /* Split the pattern into literal segments (with any escaping
+     removed), each segment is terminated with a nul. Bracket
+     expressions are awkward to parse correctly so everything after
+     the first one is ignored. */
+
+  size_t pat_len = strlen(pattern);
+  char * literals = malloc( pat_len + 2 );
+  if ( literals == NULL ) {
+    perror( "Failed to allocate memory for LCFG package search" );
+    exit(EXIT_FAILURE);
+  }
+
+  size_t lit_len = 0;
+  unsigned int segments = 0;
+  bool anchored_start = true, anchored_end = true;
+  bool in_segment = false;
+
+  const char * ptr;
+  for ( ptr = pattern; *ptr != '\0'; ptr++ ) {
+    char c = *ptr;
+
+    if ( c == '*' || c == '?' || c == '[' ) {
+      if ( ptr == pattern ) anchored_start = false;
+      if ( in_segment ) {
+        literals[lit_len++] = '\0';
+        in_segment = false;
+      }
+      if ( c == '[' ) break;
+      continue;
+    }
+
+    if ( c == '\\' && *( ptr + 1 ) != '\0' )
+      c = *(++ptr);
+
+    if ( !in_segment ) {
+      in_segment = true;
+      segments++;
+    }
+    literals[lit_len++] = c;
+  }
+
+  if ( *ptr != '\0' || !in_segment )
+    anchored_end = false;
+
+  if ( in_segment ) literals[lit_len++] = '\0';
+
+  const unsigned long * best = NULL;
+  unsigned long best_count = 0;
+  bool found = false;
+
+  /* Literal prefix */
+
+  if ( anchored_start && segments > 0 ) {
+    lcfgpkgindex_range( index->names, index->name_slots, index->size,
+                        literals, strlen(literals), &best, &best_count );
+    found = true;
+  }
+
+  /* Literal suffix - reversed and looked up in the reversed names */
+
+  if ( anchored_end && segments > 0 && ( !found || best_count > 0 ) ) {
+    const char * last = literals + lit_len - 1;
+    while ( last > literals && *( last - 1 ) != '\0' ) last--;
+
+    size_t len = strlen(last);
+    char * rev = malloc( len + 1 );
+    if ( rev == NULL ) {
+      perror( "Failed to allocate memory for LCFG package search" );
+      exit(EXIT_FAILURE);
+    }
+
+    size_t j;
+    for ( j=0; j<len; j++ )
+      rev[j] = last[len - 1 - j];
+    rev[len] = '\0';
+
+    const unsigned long * slots = NULL;
+    unsigned long nslots = 0;
+    lcfgpkgindex_range( index->rnames, index->rname_slots, index->size,
+                        rev, len, &slots, &nslots );
+    free(rev);
+
+    if ( !found || nslots < best_count ) {
+      best = slots;
+      best_count = nslots;
+      found = true;
+    }
+  }
+
+  /* Trigrams from all literal segments */
+
+  const char * seg = literals;
+  while ( seg < literals + lit_len && ( !found || best_count > 0 ) ) {
+    size_t len = strlen(seg);
+
+    size_t j;
+    for ( j=0; j+2<len; j++ ) {
+      const unsigned long * slots = NULL;
+      unsigned long nslots = 0;
+      lcfgpkgindex_postings( index, lcfgpkgindex_gram( seg + j ),
+                             &slots, &nslots );
+
+      if ( !found || nslots < best_count ) {
+        best = slots;
+        best_count = nslots;
+        found = true;
+      }
+    }
+
+    seg += len + 1;
+  }
+
+  free(literals);
+
+  if ( found ) {
+    *result = best;
+    *count  = best_count;
+  }
+
+  return found;
+}
+
+/* eof */
@@ -0,0 +1,238 @@
+/**
+ * @file resources/arena.c
+ * @brief Arena allocator used when loading LCFG resources
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "resources.h"
+
+/* Each slab is a single allocation with the header at the start and
+   the space for the objects following immediately after. */
+
+struct LCFGResArenaSlab {
+  struct LCFGResArenaSlab * next;
+  size_t size;
+};
+
+/* Slabs are kept below the size at which freeing a chunk makes glibc
+   consolidate the whole heap, otherwise destroying a large component
+   is noticeably slower than freeing the resources individually. */
+
+#define LCFG_RESARENA_SLAB_SIZE 32768
+#define LCFG_RESARENA_ALIGN     sizeof(void *)
+
+static struct LCFGResArenaSlab * lcfgresarena_add_slab( LCFGResArena * arena,
+                                                        size_t size ) {
+
+  struct LCFGResArenaSlab * slab =
+    malloc( sizeof(struct LCFGResArenaSlab) + size );
+  if ( slab == NULL ) {
+    perror( "Failed to allocate memory for LCFG resource arena" );
+    exit(EXIT_FAILURE);
+  }
+
+  slab->size   = size;
+  slab->next   = arena->slabs;
+  arena->slabs = slab;
+
+  return slab;
+}
+
+/**
+ * @brief Create and initialise a new resource arena
+ *
+ * Creates a new @c LCFGResArena which can be used to allocate the
+ * memory for resources (and the strings for their attributes) in
+ * large slabs rather than with many small individual
+ * allocations. Memory is never freed individually, all the slabs are
+ * freed together when the arena is destroyed.
+ *
+ * Every resource which is allocated from the arena holds a reference
+ * to it so that the memory remains valid for as long as the resource
+ * is in use, even when it has been copied into other containers.
+ *
+ * If the memory allocation for the new structure is not successful the
+ * @c exit() function will be called with a non-zero value.
+ *
+ * The reference count for the structure is initialised to 1. To avoid
+ * memory leaks, when it is no longer required the
+ * @c lcfgresarena_relinquish() function should be called.
+ *
+ * @return Pointer to new @c LCFGResArena
+ *
+ */
+
+LCFGResArena * lcfgresarena_new(void) {
+
+  LCFGResArena * arena = calloc( 1, sizeof(LCFGResArena) );
+  if ( arena == NULL ) {
+    perror( "Failed to allocate memory for LCFG resource arena" );
+    exit(EXIT_FAILURE);
+  }
+
+  arena->slabs     = NULL;
+  arena->next      = NULL;
+  arena->remaining = 0;
+  arena->_refcount = 1;
+
+  return arena;
+}
+
+/**
+ * @brief Destroy the resource arena
+ *
+ * When the specified @c LCFGResArena is no longer required this will
+ * free all the slabs. This should only be called via @c
+ * lcfgresarena_relinquish() as the memory may still be in use by
+ * resources.
+ *
+ * @param[in] arena Pointer to @c LCFGResArena to be destroyed.
+ *
+ */
+
+static void lcfgresarena_destroy( LCFGResArena * arena ) {
+
+  if ( arena == NULL ) return;
+
+  struct LCFGResArenaSlab * slab = arena->slabs;
+  while ( slab != NULL ) {
+    struct LCFGResArenaSlab * next = slab->next;
+    free(slab);
+    slab = next;
+  }
+
+  free(arena);
+  arena = NULL;
+}
+
+/**
+ * @brief Acquire reference to resource arena
+ *
+ * This is used to record a reference to the @c LCFGResArena, it
+ * does this by atomically incrementing the reference count. An arena
+ * is shared by clones of a component so references may be taken by
+ * several threads at once.
+ *
+ * @param[in] arena Pointer to @c LCFGResArena
+ *
+ */
+
+void lcfgresarena_acquire( LCFGResArena * arena ) {
+  assert( arena != NULL );
+
+  __atomic_add_fetch( &(arena->_refcount), 1, __ATOMIC_ACQ_REL );
+}
+
+/**
+ * @brief Release reference to resource arena
+ *
+ * This is used to release a reference to the @c LCFGResArena, it
+ * does this by atomically decrementing the reference count. If the
+ * reference count reaches zero all the memory for the arena will be
+ * freed.
+ *
+ * If the value of the pointer passed in is @c NULL then the function
+ * has no affect.
+ *
+ * @param[in] arena Pointer to @c LCFGResArena
+ *
+ */
+
+void lcfgresarena_relinquish( LCFGResArena * arena ) {
+
+  if ( arena == NULL ) return;
+
+  if ( __atomic_sub_fetch( &(arena->_refcount), 1, __ATOMIC_ACQ_REL ) == 0 )
+    lcfgresarena_destroy(arena);
+
+}
+
+static void * lcfgresarena_take( LCFGResArena * arena, size_t size,
+                                 size_t align ) {
+  assert( arena != NULL );
+
+  /* Anything big gets a slab of its own, the current slab is kept for
+     subsequent small allocations */
+
+  if ( size > LCFG_RESARENA_SLAB_SIZE / 4 ) {
+    struct LCFGResArenaSlab * slab = lcfgresarena_add_slab( arena, size );
+    return slab + 1;
+  }
+
+  size_t pad = ( align - ( (uintptr_t) arena->next % align ) ) % align;
+
+  if ( arena->next == NULL || size + pad > arena->remaining ) {
+    struct LCFGResArenaSlab * slab =
+      lcfgresarena_add_slab( arena, LCFG_RESARENA_SLAB_SIZE );
+
+    arena->next      = (char *) ( slab + 1 );
+    arena->remaining = LCFG_RESARENA_SLAB_SIZE;
+    pad = 0;
+  }
+
+  void * ptr = arena->next + pad;
+  arena->next      += pad + size;
+  arena->remaining -= pad + size;
+
+  return ptr;
+}
+
+/**
+ * @brief Allocate zeroed memory from the resource arena
+ *
+ * The memory is suitably aligned for any structure.
+ *
+ * @param[in] arena Pointer to @c LCFGResArena
+ * @param[in] size Number of bytes required
+ *
+ * @return Pointer to the new memory
+ *
+ */
+
+void * lcfgresarena_alloc( LCFGResArena * arena, size_t size ) {
+
+  void * ptr = lcfgresarena_take( arena, size, LCFG_RESARENA_ALIGN );
+  memset( ptr, 0, size );
+
+  return ptr;
+}
+
+/**
+ * @brief Copy a string into the resource arena
+ *
+ * This is the arena equivalent of @c strndup(3), at most @c len
+ * characters are copied and the new string is always nul-terminated.
+ *
+ * @param[in] arena Pointer to @c LCFGResArena
+ * @param[in] str String to be copied
+ * @param[in] len Maximum number of characters to copy
+ *
+ * @return Pointer to the new string
+ *
+ */
+
+char * lcfgresarena_strndup( LCFGResArena * arena,
+                             const char * str, size_t len ) {
+  assert( str != NULL );
+
+  const char * end = memchr( str, '\0', len );
+  if ( end != NULL ) len = end - str;
+
+  char * copy = lcfgresarena_take( arena, len + 1, 1 );
+  memcpy( copy, str, len );
+  copy[len] = '\0';
+
+  return copy;
+}
+
+/* eof */
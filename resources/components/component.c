@@ -36,13 +36,209 @@ static double lcfgcomponent_load_factor( const LCFGComponent * comp ) {
   return ( (double) comp->entries / (double) comp->buckets );
 }
 
-static unsigned long lcfgcomponent_hash_string( const LCFGComponent * comp,
-                                                const char * string ) {
-  assert( comp != NULL );
-  assert( string != NULL );
+/* Computes the hash information for a resource name. The full 64-bit
+   hash and the length of the name are stored alongside each bucket
+   so that the hash never has to be recomputed when the table is
+   resized and so that, when searching, the name of a resource only
+   needs to be compared when both of those match. */
+
+static void lcfgcomponent_hash_name( const char * name,
+                                     LCFGComponentSlot * key ) {
+  assert( name != NULL );
+  assert( key != NULL );
+
+  size_t len = strlen(name);
+
+  key->hash     = farmhash64( name, len );
+  key->name_len = (uint32_t) len;
+  key->distance = 0;
+}
+
+static inline unsigned long lcfgcomponent_home_bucket( const LCFGComponent * comp,
+                                                       uint64_t hash ) {
+  return (unsigned long) ( hash % comp->buckets );
+}
+
+static inline unsigned long lcfgcomponent_next_bucket( const LCFGComponent * comp,
+                                                       unsigned long bucket ) {
+  bucket++;
+  return ( bucket == comp->buckets ? 0 : bucket );
+}
+
+/* The component keeps the resource lists in order of name, along
+   with the hash buckets, so that serialising a component does not
+   require a sort. The order is updated as each list is added,
+   replaced or removed, it is not affected by lists moving between
+   buckets. Since there are always fewer entries than buckets the
+   array is allocated with the same size as the hash. */
+
+static int lcfgcomponent_list_cmp( const LCFGResourceList * list,
+                                   const char * name ) {
+  return strcasecmp( lcfgreslist_get_name(list), name );
+}
+
+/* Returns the position of the first list which sorts after the
+   name. */
+
+static unsigned long lcfgcomponent_sorted_upper( const LCFGComponent * comp,
+                                                 const char * name ) {
+
+  unsigned long lo = 0, hi = comp->entries;
+  while ( lo < hi ) {
+    unsigned long mid = lo + ( hi - lo ) / 2;
+    if ( lcfgcomponent_list_cmp( (comp->sorted)[mid], name ) <= 0 )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+/* Must be called before comp->entries is incremented */
+
+static void lcfgcomponent_sorted_add( LCFGComponent * comp,
+                                      LCFGResourceList * list ) {
+
+  unsigned long pos =
+    lcfgcomponent_sorted_upper( comp, lcfgreslist_get_name(list) );
+
+  LCFGResourceList ** sorted = comp->sorted;
+  memmove( sorted + pos + 1, sorted + pos,
+           ( comp->entries - pos ) * sizeof(LCFGResourceList *) );
+  sorted[pos] = list;
+}
+
+/* Must be called before comp->entries is decremented. The list may
+   have been emptied so it is found by address rather than name. */
+
+static void lcfgcomponent_sorted_remove( LCFGComponent * comp,
+                                         const LCFGResourceList * list ) {
+
+  LCFGResourceList ** sorted = comp->sorted;
+
+  unsigned long i;
+  for ( i=0; i < comp->entries; i++ ) {
+    if ( sorted[i] == list ) {
+      memmove( sorted + i, sorted + i + 1,
+               ( comp->entries - i - 1 ) * sizeof(LCFGResourceList *) );
+      break;
+    }
+  }
+
+}
+
+/* The replacement has the same name so it takes the same position,
+   any other lists with a name which only differs in case are just
+   before the upper bound. */
+
+static void lcfgcomponent_sorted_replace( LCFGComponent * comp,
+                                          const LCFGResourceList * current,
+                                          LCFGResourceList * new ) {
+
+  LCFGResourceList ** sorted = comp->sorted;
+
+  unsigned long i =
+    lcfgcomponent_sorted_upper( comp, lcfgreslist_get_name(new) );
+  while ( i > 0 ) {
+    i--;
+    if ( sorted[i] == current ) {
+      sorted[i] = new;
+      break;
+    }
+  }
+
+}
+
+/* Once the resources have been modified the component no longer
+   matches the XML profile from which it was loaded (see
+   lcfgprofile_from_xml_incremental()). */
+
+static void lcfgcomponent_clear_source( LCFGComponent * comp ) {
+  comp->source_hash = 0;
+}
+
+/* The bucket arrays may be shared with clones of the component, in
+   which case each resource list is only referenced once for all the
+   components. Before the buckets can be modified the component must
+   take a private copy of the arrays. At that point each resource list
+   becomes referenced by both components so any later modification of
+   a list will result in it being duplicated (see
+   lcfgcomponent_merge_resource()). Lists which are not touched remain
+   shared.
+
+   The counter of components sharing the buckets is allocated along
+   with the component and is only ever changed atomically so that a
+   component can be cloned by several threads at once. */
+
+static unsigned int * lcfgcomponent_new_shared_count(void) {
+
+  unsigned int * shared = malloc( sizeof(unsigned int) );
+  if ( shared == NULL ) {
+    perror( "Failed to allocate memory for LCFG component" );
+    exit(EXIT_FAILURE);
+  }
+
+  *shared = 1;
+
+  return shared;
+}
+
+static void lcfgcomponent_unshare( LCFGComponent * comp ) {
+
+  unsigned int * shared = comp->_shared_buckets;
+  if ( shared == NULL ||
+       __atomic_load_n( shared, __ATOMIC_ACQUIRE ) <= 1 ) return;
+
+  LCFGResourceList ** old_set = comp->resources;
+  LCFGComponentSlot * old_slots = comp->slots;
+
+  LCFGResourceList ** new_set = malloc( comp->buckets *
+                                        sizeof(LCFGResourceList *) );
+  LCFGComponentSlot * new_slots = malloc( comp->buckets *
+                                          sizeof(LCFGComponentSlot) );
+  if ( new_set == NULL || new_slots == NULL ) {
+    perror( "Failed to allocate memory for LCFG resources set" );
+    exit(EXIT_FAILURE);
+  }
+
+  memcpy( new_set, old_set, comp->buckets * sizeof(LCFGResourceList *) );
+  memcpy( new_slots, old_slots, comp->buckets * sizeof(LCFGComponentSlot) );
+
+  unsigned long i;
+  for ( i=0; i < comp->buckets; i++ ) {
+    if ( new_set[i] != NULL )
+      lcfgreslist_acquire(new_set[i]);
+  }
+
+  comp->resources = new_set;
+  comp->slots     = new_slots;
+  comp->_shared_buckets = lcfgcomponent_new_shared_count();
+
+  /* If all the clones went away whilst the copy was being taken then
+     this was the last reference to the old arrays */
+
+  if ( __atomic_sub_fetch( shared, 1, __ATOMIC_ACQ_REL ) == 0 ) {
+    for ( i=0; i < comp->buckets; i++ ) {
+      if ( old_set[i] != NULL )
+        lcfgreslist_relinquish(old_set[i]);
+    }
+
+    free(old_set);
+    free(old_slots);
+    free(shared);
+  }
+
+}
+
+/* A resource list must be duplicated before it is modified if it is
+   referenced elsewhere or if the buckets are shared with a clone. */
 
-  size_t len = strlen(string);
-  return farmhash64( string, len ) % comp->buckets;
+static bool lcfgcomponent_list_is_shared( const LCFGComponent * comp,
+                                          const LCFGResourceList * list ) {
+  return ( lcfgreslist_is_shared(list) ||
+           ( comp->_shared_buckets != NULL &&
+             __atomic_load_n( comp->_shared_buckets, __ATOMIC_ACQUIRE ) > 1 ) );
 }
 
 /* Creates a new empty resource list then sets the 'merge rules' and
@@ -57,50 +253,47 @@ static LCFGResourceList * lcfgcomponent_empty_list(const LCFGComponent * comp) {
   return new_list;
 }
 
-/* Given a particular resource name this will return the associated
-   bucket in the hash. Note that this does NOT guarantee there is a
-   resource with that name already stored in the hash, the bucket
-   might be empty. */
+/* Given a particular resource name (and the associated hash
+   information) this will find the bucket in which the list of
+   resources with that name is stored. Returns false if there is
+   nothing stored with that name.
+
+   The hash uses "Robin Hood" open addressing, entries are kept in
+   order of distance from their home bucket so the search can stop as
+   soon as it reaches a bucket which is empty or which holds an entry
+   that is closer to home than the wanted entry would be. */
 
 static bool lcfgcomponent_find_bucket( const LCFGComponent * comp,
                                        const char * want_name,
+                                       const LCFGComponentSlot * key,
                                        unsigned long * bucket ) {
   assert( comp != NULL );
   assert( want_name != NULL );
+  assert( key != NULL );
 
-  unsigned long hash = lcfgcomponent_hash_string( comp, want_name );
+  if ( comp->entries == 0 ) return false;
 
-  LCFGResourceList ** resources = comp->resources;
+  const LCFGComponentSlot * slots = comp->slots;
 
-  /* Find matching resource list or first empty bucket */
+  unsigned long i = lcfgcomponent_home_bucket( comp, key->hash );
+  uint32_t distance = 1;
 
   bool found = false;
+  while ( !found && slots[i].distance >= distance ) {
 
-  unsigned long i;
-  for ( i = hash; !found && i < comp->buckets; i++ ) {
+    if ( slots[i].hash     == key->hash &&
+         slots[i].name_len == key->name_len ) {
 
-    if ( !resources[i] ) {
-      found = true;
-    } else {
-      const LCFGResource * head = lcfgreslist_first_resource(resources[i]);
-      if ( head != NULL && lcfgresource_match( head, want_name ) )
-        found = true;
-    }
-
-    if (found) *bucket = i;
-  }
-
-  for ( i = 0; !found && i < hash; i++ ) {
+      const char * name = lcfgreslist_get_name( (comp->resources)[i] );
+      if ( name != NULL && memcmp( name, want_name, key->name_len ) == 0 ) {
+        found   = true;
+        *bucket = i;
+      }
 
-    if ( !resources[i] ) {
-      found = true;
-    } else {
-      const LCFGResource * head = lcfgreslist_first_resource(resources[i]);
-      if ( head != NULL && lcfgresource_match( head, want_name ) )
-        found = true;
     }
 
-    if (found) *bucket = i;
+    i = lcfgcomponent_next_bucket( comp, i );
+    distance++;
   }
 
   return found;
@@ -117,8 +310,11 @@ static const LCFGResourceList * lcfgcomponent_find_list( const LCFGComponent * c
 
   if ( lcfgcomponent_is_empty(comp) ) return NULL;
 
+  LCFGComponentSlot key;
+  lcfgcomponent_hash_name( want_name, &key );
+
   unsigned long bucket;
-  bool found = lcfgcomponent_find_bucket( comp, want_name, &bucket );
+  bool found = lcfgcomponent_find_bucket( comp, want_name, &key, &bucket );
 
   const LCFGResourceList * result = NULL;
   if (found)
@@ -127,47 +323,131 @@ static const LCFGResourceList * lcfgcomponent_find_list( const LCFGComponent * c
   return result;
 }
 
-/* Inserts the resource list into the specified bucket. If there is
-   already a list stored in that bucket the reference count will be
-   decremented. If the value specified for the resource list is NULL
-   then it functions as a removal. */
+/* Places a resource list into the hash. Starting at the home bucket
+   for the hash any entry which is closer to its own home bucket is
+   displaced and carried forward until an empty bucket is reached.
+   This does not alter the reference count or the number of entries,
+   the caller must ensure there is at least one empty bucket. */
 
-static LCFGChange lcfgcomponent_set_bucket( LCFGComponent * comp,
-                                            unsigned long bucket,
-                                            LCFGResourceList * new ) {
+static void lcfgcomponent_place_list( LCFGComponent * comp,
+                                      const LCFGComponentSlot * key,
+                                      LCFGResourceList * list ) {
+
+  LCFGComponentSlot * slots     = comp->slots;
+  LCFGResourceList ** resources = comp->resources;
+
+  LCFGComponentSlot cur_slot = *key;
+  cur_slot.distance = 1;
+  LCFGResourceList * cur_list = list;
+
+  unsigned long i = lcfgcomponent_home_bucket( comp, cur_slot.hash );
+  while ( slots[i].distance != 0 ) {
+
+    if ( slots[i].distance < cur_slot.distance ) {
+      LCFGComponentSlot tmp_slot = slots[i];
+      LCFGResourceList * tmp_list = resources[i];
+
+      slots[i]     = cur_slot;
+      resources[i] = cur_list;
+
+      cur_slot = tmp_slot;
+      cur_list = tmp_list;
+    }
+
+    i = lcfgcomponent_next_bucket( comp, i );
+    cur_slot.distance++;
+  }
+
+  slots[i]     = cur_slot;
+  resources[i] = cur_list;
+}
+
+/* Adds a new resource list into the hash. The caller must have
+   already checked that there is nothing stored with the same
+   name. */
+
+static LCFGChange lcfgcomponent_add_bucket( LCFGComponent * comp,
+                                            const LCFGComponentSlot * key,
+                                            LCFGResourceList * list ) {
   assert( comp != NULL );
+  assert( list != NULL );
+
+  if ( comp->entries + 1 >= comp->buckets ) return LCFG_CHANGE_ERROR;
+
+  lcfgcomponent_unshare(comp);
+  lcfgcomponent_clear_source(comp);
+
+  lcfgreslist_acquire(list);
+  lcfgcomponent_place_list( comp, key, list );
+  lcfgcomponent_sorted_add( comp, list );
+  comp->entries++;
 
+  return LCFG_CHANGE_ADDED;
+}
+
+/* Empties the specified bucket. Rather than leaving a 'tombstone'
+   marker any following entries which are not in their home bucket
+   are shifted back by one place. This keeps probe sequences short
+   when resources are frequently removed. */
+
+static void lcfgcomponent_clear_bucket( LCFGComponent * comp,
+                                        unsigned long bucket ) {
+
+  LCFGComponentSlot * slots     = comp->slots;
   LCFGResourceList ** resources = comp->resources;
 
   LCFGResourceList * current = resources[bucket];
 
-  LCFGChange change = LCFG_CHANGE_NONE;
-  if ( current != new ) {
+  unsigned long i = bucket;
+  unsigned long next = lcfgcomponent_next_bucket( comp, i );
+  while ( slots[next].distance > 1 ) {
+    slots[i] = slots[next];
+    slots[i].distance--;
+    resources[i] = resources[next];
 
-    resources[bucket] = new;
+    i = next;
+    next = lcfgcomponent_next_bucket( comp, i );
+  }
 
-    if ( new != NULL ) {
-      lcfgreslist_acquire(new);
+  memset( &(slots[i]), 0, sizeof(LCFGComponentSlot) );
+  resources[i] = NULL;
 
-      if ( current == NULL ) {   /* add */
-        comp->entries++;
+  lcfgcomponent_sorted_remove( comp, current );
+  comp->entries--;
 
-        change = LCFG_CHANGE_ADDED;
-      } else {                   /* replace */
-        change = LCFG_CHANGE_REPLACED;
-      }
+  lcfgreslist_relinquish(current);
+}
 
-    } else {
+/* Replaces the resource list stored in an occupied bucket. If there
+   is already a list stored in that bucket the reference count will
+   be decremented. If the value specified for the resource list is
+   NULL then it functions as a removal. */
+
+static LCFGChange lcfgcomponent_set_bucket( LCFGComponent * comp,
+                                            unsigned long bucket,
+                                            LCFGResourceList * new ) {
+  assert( comp != NULL );
 
-      if ( current != NULL ) {   /* remove */
-        comp->entries--;
+  lcfgcomponent_unshare(comp);
+  lcfgcomponent_clear_source(comp);
 
-        change = LCFG_CHANGE_REMOVED;
-      }
+  LCFGResourceList ** resources = comp->resources;
 
-    }
+  LCFGResourceList * current = resources[bucket];
+  assert( current != NULL );
 
+  LCFGChange change = LCFG_CHANGE_NONE;
+  if ( new == NULL ) {           /* remove */
+    lcfgcomponent_clear_bucket( comp, bucket );
+
+    change = LCFG_CHANGE_REMOVED;
+  } else if ( current != new ) { /* replace */
+    lcfgreslist_acquire(new);
+    resources[bucket] = new;
+    lcfgcomponent_sorted_replace( comp, current, new );
     lcfgreslist_relinquish(current);
+
+    change = LCFG_CHANGE_REPLACED;
   }
 
   return change;
@@ -181,80 +461,99 @@ static LCFGChange lcfgcomponent_insert_list( LCFGComponent * comp,
 
   if ( lcfgreslist_is_empty(list) ) return LCFG_CHANGE_NONE;
 
-  LCFGChange change = LCFG_CHANGE_NONE;
-
   const char * name = lcfgreslist_get_name(list);
 
+  LCFGComponentSlot key;
+  lcfgcomponent_hash_name( name, &key );
+
+  LCFGChange change = LCFG_CHANGE_NONE;
+
   unsigned long bucket;
-  if ( lcfgcomponent_find_bucket( comp, name, &bucket ) )
+  if ( lcfgcomponent_find_bucket( comp, name, &key, &bucket ) )
     change = lcfgcomponent_set_bucket( comp, bucket, list );
   else
-    change = LCFG_CHANGE_ERROR;
+    change = lcfgcomponent_add_bucket( comp, &key, list );
 
   return change;
 }
 
-/* Resizes the hash to the 'best' size for the number of entries. For
-   efficiency the code avoids constant resizes in small steps by only
-   actually doing a resize once the maximum allowed 'load factor' is
-   exceeded. */
-
-static void lcfgcomponent_resize( LCFGComponent * comp ) {
-
-  LCFGResourceList ** cur_set = comp->resources;
-  unsigned long cur_buckets   = comp->buckets;
-  unsigned long cur_entries   = comp->entries;
+/* Moves all entries into a new set of buckets. Since the full hash is
+   stored for each entry there is no need to recompute anything. */
 
-  /* Decide if a resize is actually required */
+static void lcfgcomponent_rehash( LCFGComponent * comp,
+                                  unsigned long new_buckets ) {
 
-  double load_factor = lcfgcomponent_load_factor(comp);
+  lcfgcomponent_unshare(comp);
 
-  unsigned long new_buckets = cur_buckets;
-  if ( load_factor >= LCFG_COMP_LOAD_MAX )
-    new_buckets = want_buckets(cur_entries);
-
-  if ( cur_set != NULL && new_buckets <= cur_buckets ) return;
-
-  /* Resize the hash */
+  LCFGResourceList ** cur_set   = comp->resources;
+  LCFGComponentSlot * cur_slots = comp->slots;
+  unsigned long cur_buckets     = comp->buckets;
 
   LCFGResourceList ** new_set = calloc( (size_t) new_buckets,
                                         sizeof(LCFGResourceList *) );
-  if ( new_set == NULL ) {
+  LCFGComponentSlot * new_slots = calloc( (size_t) new_buckets,
+                                          sizeof(LCFGComponentSlot) );
+  if ( new_set == NULL || new_slots == NULL ) {
+    perror( "Failed to allocate memory for LCFG resources set" );
+    exit(EXIT_FAILURE);
+  }
+
+  /* The order is unchanged, only the space is increased */
+
+  LCFGResourceList ** new_sorted = realloc( comp->sorted, new_buckets *
+                                            sizeof(LCFGResourceList *) );
+  if ( new_sorted == NULL ) {
     perror( "Failed to allocate memory for LCFG resources set" );
     exit(EXIT_FAILURE);
   }
 
   comp->resources = new_set;
-  comp->entries   = 0;
+  comp->slots     = new_slots;
+  comp->sorted    = new_sorted;
   comp->buckets   = new_buckets;
 
   /* If there are any resources in the hash then they need to be transferred */
 
   if ( cur_set != NULL ) {
 
-    LCFGChange change = LCFG_CHANGE_NONE;
-
     unsigned long i;
-    for ( i=0; LCFGChangeOK(change) && i<cur_buckets; i++ ) {
-      change = lcfgcomponent_insert_list( comp, cur_set[i] );
-      lcfgreslist_relinquish(cur_set[i]);
+    for ( i=0; i<cur_buckets; i++ ) {
+      if ( cur_slots[i].distance != 0 )
+        lcfgcomponent_place_list( comp, &(cur_slots[i]), cur_set[i] );
     }
 
-    if ( LCFGChangeOK(change) ) {
+    free(cur_set);
+    free(cur_slots);
+  }
 
-      free(cur_set);
+}
 
-    } else { /* Restore previous state if error occurs */
+/* Resizes the hash to the 'best' size for the number of entries. For
+   efficiency the code avoids constant resizes in small steps by only
+   actually doing a resize once the maximum allowed 'load factor' is
+   exceeded. */
 
-      free(new_set);
+static void lcfgcomponent_resize( LCFGComponent * comp ) {
 
-      comp->resources = cur_set;
-      comp->entries   = cur_entries;
-      comp->buckets   = cur_buckets;
+  if ( comp->resources == NULL ) {
+    lcfgcomponent_rehash( comp, comp->buckets );
+  } else if ( lcfgcomponent_load_factor(comp) >= LCFG_COMP_LOAD_MAX ) {
+    unsigned long new_buckets = want_buckets(comp->entries);
+    if ( new_buckets > comp->buckets )
+      lcfgcomponent_rehash( comp, new_buckets );
+  }
 
-    }
+}
 
-  }
+/* Ensures the hash is large enough to hold the specified number of
+   entries without any further resizing. */
+
+static void lcfgcomponent_reserve( LCFGComponent * comp,
+                                   unsigned long entries ) {
+
+  unsigned long new_buckets = want_buckets(entries);
+  if ( new_buckets > comp->buckets )
+    lcfgcomponent_rehash( comp, new_buckets );
 
 }
 
@@ -286,7 +585,12 @@ LCFGComponent * lcfgcomponent_new(void) {
   comp->primary_key = LCFG_COMP_PK_NAME;
 
   comp->resources   = NULL;
+  comp->slots       = NULL;
+  comp->sorted      = NULL;
   comp->entries     = 0;
+  comp->arena       = NULL;
+  comp->source_hash = 0;
+  comp->_shared_buckets = lcfgcomponent_new_shared_count();
   comp->buckets     = LCFG_COMP_DEFAULT_SIZE;
   comp->_refcount   = 1;
 
@@ -295,6 +599,170 @@ LCFGComponent * lcfgcomponent_new(void) {
   return comp;
 }
 
+/**
+ * @brief Use an arena for new resources in the component
+ *
+ * This can be used to enable an @c LCFGResArena for a component which
+ * is being loaded (e.g. from an XML profile, a DB or a status file)
+ * and which is expected to be read-only afterwards. Resources created
+ * with @c lcfgcomponent_new_resource() are then allocated, along with
+ * the strings for their attributes, from large slabs rather than
+ * with many small individual allocations. The arena is tied to the
+ * lifetime of the component, when the component is destroyed the
+ * slabs are freed together. Derivation lists and templates are not
+ * allocated from the arena, they are freed separately as usual.
+ *
+ * Memory is never returned to the arena, when a string for a resource
+ * is replaced (e.g. with @c lcfgresource_set_value() ) the space used
+ * by the old string is not reclaimed until the arena is freed. An
+ * arena should therefore not be used for a component which will be
+ * modified repeatedly.
+ *
+ * If a resource from the arena is merged into a different component
+ * it is promoted to the heap by taking a copy so that the arena is not
+ * kept alive by a few stray resources. Any resource from the arena
+ * which is used elsewhere in some other way holds a reference to the
+ * arena so the memory remains valid.
+ *
+ * Calling this more than once has no further effect.
+ *
+ * @param[in] comp Pointer to @c LCFGComponent
+ *
+ */
+
+void lcfgcomponent_use_arena( LCFGComponent * comp ) {
+  assert( comp != NULL );
+
+  if ( comp->arena == NULL )
+    comp->arena = lcfgresarena_new();
+}
+
+/**
+ * @brief Create a new resource for the component
+ *
+ * This creates a new @c LCFGResource which is intended to be merged
+ * into the @c LCFGComponent. If an arena is in use for the component
+ * (see @c lcfgcomponent_use_arena()) then the resource will be
+ * allocated from the arena, otherwise this is the same as calling
+ * @c lcfgresource_new(). Note that the resource is NOT added to the
+ * component.
+ *
+ * To avoid memory leaks, when it is no longer required the
+ * @c lcfgresource_relinquish() function should be called.
+ *
+ * @param[in] comp Pointer to @c LCFGComponent
+ *
+ * @return Pointer to new @c LCFGResource
+ *
+ */
+
+LCFGResource * lcfgcomponent_new_resource( LCFGComponent * comp ) {
+  assert( comp != NULL );
+
+  return ( comp->arena != NULL ? lcfgresource_arena_new(comp->arena) :
+                                 lcfgresource_new() );
+}
+
+/* A component which shares resources with another (e.g. a clone) also
+   shares the arena from which they were allocated. */
+
+static void lcfgcomponent_share_arena( LCFGComponent * comp,
+                                       const LCFGComponent * orig ) {
+
+  if ( comp->arena == NULL && orig->arena != NULL ) {
+    lcfgresarena_acquire(orig->arena);
+    comp->arena = orig->arena;
+  }
+
+}
+
+/* Resources which were allocated from the arena of a different
+   component are promoted to the heap when they are merged. */
+
+static bool lcfgcomponent_needs_promotion( const LCFGComponent * comp,
+                                           const LCFGResArena * arena ) {
+  return ( arena != NULL && arena != comp->arena );
+}
+
+static LCFGResourceList * lcfgcomponent_promote_list( const LCFGResourceList * list ) {
+
+  LCFGResourceList * heap_list = lcfgreslist_clone(list);
+
+  unsigned int i;
+  for ( i=0; i<heap_list->size; i++ ) {
+    LCFGResource * res = (heap_list->items)[i];
+    if ( res->_arena == NULL ) continue;
+
+    LCFGResource * copy = lcfgresource_clone(res);
+    if ( copy != NULL ) {
+      (heap_list->items)[i] = copy;
+      lcfgresource_relinquish(res);
+    }
+  }
+
+  return heap_list;
+}
+
+/* Returns the resource list stored in the component with the same
+   name as the specified list once neither the list nor any of its
+   resources are shared with anything else. The resources can then be
+   modified in place (e.g. by lcfgcompset_eval_priority()) without
+   affecting any clone of the component. The source hash is cleared
+   as the caller is expected to modify the resources. Returns NULL if
+   the component does not hold such a list or a resource cannot be
+   copied. */
+
+LCFGResourceList * lcfgcomponent_private_list( LCFGComponent * comp,
+                                               const LCFGResourceList * list ) {
+  assert( comp != NULL );
+
+  if ( lcfgreslist_is_empty(list) ) return NULL;
+
+  const char * name = lcfgreslist_get_name(list);
+
+  LCFGComponentSlot key;
+  lcfgcomponent_hash_name( name, &key );
+
+  unsigned long bucket;
+  if ( !lcfgcomponent_find_bucket( comp, name, &key, &bucket ) ) return NULL;
+
+  lcfgcomponent_clear_source(comp);
+
+  LCFGResourceList * current = (comp->resources)[bucket];
+
+  bool shared = lcfgcomponent_list_is_shared( comp, current );
+
+  unsigned int i;
+  for ( i=0; !shared && i<current->size; i++ )
+    shared = ( (current->items)[i]->_refcount > 1 );
+
+  if ( !shared ) return current;
+
+  /* Every resource in a duplicated list is in use elsewhere */
+
+  LCFGResourceList * new_list = lcfgreslist_clone(current);
+
+  bool ok = true;
+  for ( i=0; ok && i<new_list->size; i++ ) {
+    LCFGResource * res = (new_list->items)[i];
+
+    LCFGResource * copy = lcfgresource_clone(res);
+    if ( copy != NULL ) {
+      (new_list->items)[i] = copy;
+      lcfgresource_relinquish(res);
+    } else {
+      ok = false;
+    }
+  }
+
+  if ( ok )
+    lcfgcomponent_set_bucket( comp, bucket, new_list );
+
+  lcfgreslist_relinquish(new_list);
+
+  return ( ok ? (comp->resources)[bucket] : NULL );
+}
+
 /**
  * @brief Remove all the resources for the component
  *
@@ -309,9 +777,17 @@ LCFGComponent * lcfgcomponent_new(void) {
 
 void lcfgcomponent_remove_all_resources( LCFGComponent * comp ) {
 
+  lcfgcomponent_unshare(comp);
+  lcfgcomponent_clear_source(comp);
+
   unsigned long i;
-  for ( i=0; i < comp->buckets; i++ )
-    lcfgcomponent_set_bucket( comp, i, NULL );
+  for ( i=0; i < comp->buckets; i++ ) {
+    lcfgreslist_relinquish( (comp->resources)[i] );
+    (comp->resources)[i] = NULL;
+  }
+
+  memset( comp->slots, 0, comp->buckets * sizeof(LCFGComponentSlot) );
+  comp->entries = 0;
 
 }
 
@@ -348,10 +824,30 @@ static void lcfgcomponent_destroy(LCFGComponent * comp) {
 
   if ( comp == NULL ) return;
 
-  lcfgcomponent_remove_all_resources(comp);
+  /* The buckets are left alone if they are still in use by a clone */
 
-  free(comp->resources);
+  unsigned int * shared = comp->_shared_buckets;
+  if ( shared == NULL ||
+       __atomic_sub_fetch( shared, 1, __ATOMIC_ACQ_REL ) == 0 ) {
+    lcfgcomponent_remove_all_resources(comp);
+
+    free(comp->resources);
+    free(comp->slots);
+    free(shared);
+  }
+
+  comp->_shared_buckets = NULL;
   comp->resources = NULL;
+  comp->slots     = NULL;
+
+  free(comp->sorted);
+  comp->sorted = NULL;
+
+  /* Any resources from the arena still in use elsewhere hold their
+     own references so this only frees the slabs when all are gone */
+
+  lcfgresarena_relinquish(comp->arena);
+  comp->arena = NULL;
 
   free(comp->name);
   comp->name = NULL;
@@ -665,6 +1161,17 @@ bool lcfgcomponent_set_name( LCFGComponent * comp, char * new_name ) {
  * resources stored in the component will result in them becoming
  * duplicated so they are no longer shared.
  *
+ * The hash of resources is also shared so cloning a component takes
+ * the same time regardless of the number of resources. When either
+ * component is first modified it takes a private copy of the hash
+ * buckets, only the resource lists which are modified are duplicated.
+ *
+ * The original component is not otherwise altered, the count of
+ * components sharing the buckets is updated atomically so the same
+ * component may be cloned by several threads at once. The clones
+ * themselves must not be modified concurrently as they still share
+ * the resource lists.
+ *
  * @param[in] comp Pointer to @c LCFGComponent to be cloned.
  *
  * @return Pointer to new clone @c LCFGComponent (@c NULL if error occurs)
@@ -691,25 +1198,34 @@ LCFGComponent * lcfgcomponent_clone( const LCFGComponent * comp ) {
   clone->primary_key = comp->primary_key;
   clone->merge_rules = comp->merge_rules;
 
-  /* Avoid multiple calls to resize() by increasing the size of the set
-     of buckets in the clone before starting to merge resources */
+  /* Share the hash buckets - the only change to the original
+     component is the atomic increment of the shared counter so
+     several threads may clone the same component at once */
 
-  unsigned long new_buckets = want_buckets(comp->entries);
-  if ( new_buckets > clone->buckets ) {
-    clone->buckets = new_buckets;
-    lcfgcomponent_resize(clone);
-  }
+  free(clone->resources);
+  free(clone->slots);
+  free(clone->sorted);
+  free(clone->_shared_buckets);
 
-  /* Copy over the resource lists - note that the resource lists will
-     be shared between the original and clone components */
+  __atomic_add_fetch( comp->_shared_buckets, 1, __ATOMIC_ACQ_REL );
 
-  LCFGChange insert_rc = LCFG_CHANGE_NONE;
+  lcfgcomponent_share_arena( clone, comp );
 
-  unsigned long i;
-  for ( i=0; LCFGChangeOK(insert_rc) && i<comp->buckets; i++ )
-    insert_rc = lcfgcomponent_insert_list( clone, (comp->resources)[i] );
+  clone->_shared_buckets = comp->_shared_buckets;
+  clone->resources       = comp->resources;
+  clone->slots           = comp->slots;
+  clone->buckets         = comp->buckets;
+  clone->entries         = comp->entries;
 
-  ok = LCFGChangeOK(insert_rc);
+  /* The order is private to each component */
+
+  clone->sorted = malloc( comp->buckets * sizeof(LCFGResourceList *) );
+  if ( clone->sorted == NULL ) {
+    perror( "Failed to allocate memory for LCFG resources set" );
+    exit(EXIT_FAILURE);
+  }
+  memcpy( clone->sorted, comp->sorted,
+          comp->entries * sizeof(LCFGResourceList *) );
 
  cleanup:
 
@@ -721,55 +1237,6 @@ LCFGComponent * lcfgcomponent_clone( const LCFGComponent * comp ) {
   return clone;
 }
 
-/* Use for sorting entries by name */
-struct LCFGComponentEntry {
-  const char * name;
-  unsigned int bucket;
-};
-
-typedef struct LCFGComponentEntry LCFGComponentEntry;
-
-static int lcfgcomponent_entry_cmp( const void * a, const void * b ) {
-  const char * a_name = ( (const LCFGComponentEntry *) a )->name;
-  const char * b_name = ( (const LCFGComponentEntry *) b )->name;
-  return strcasecmp( a_name, b_name );
-}
-
-/* Returns a sorted list of resource names along with the associated buckets */
-
-static unsigned int lcfgcomponent_sorted_entries( const LCFGComponent * comp,
-                                                  LCFGComponentEntry ** result ) {
-
-   LCFGComponentEntry * entries =
-     calloc( comp->entries + 1, sizeof(LCFGComponentEntry) );
-
-   unsigned long count = 0;
-
-   unsigned long i;
-   for (i=0; i < comp->buckets; i++ ) {
-     LCFGResourceList * list = (comp->resources)[i];
-
-     if ( !lcfgreslist_is_empty(list) ) {
-
-       unsigned int k = count++;
-       entries[k].name = lcfgreslist_get_name(list);
-       entries[k].bucket = i;
-
-     }
-   }
-
-   if ( count > 0 ) {
-     qsort( entries, count, sizeof(LCFGComponentEntry), lcfgcomponent_entry_cmp );
-   } else {
-     free(entries);
-     entries = NULL;
-   }
-
-   *result = entries;
-
-   return count;
-}
-
 /**
  * @brief Write list of formatted resources to file stream
  *
@@ -823,24 +1290,19 @@ bool lcfgcomponent_print( const LCFGComponent * comp,
     exit(EXIT_FAILURE);
   }
 
-  LCFGComponentEntry * entries = NULL;
-  unsigned int count = lcfgcomponent_sorted_entries( comp, &entries );
+  LCFGResourceList ** sorted = comp->sorted;
+  unsigned long count = comp->entries;
 
   const char * comp_name = lcfgcomponent_get_name(comp);
-  LCFGResourceList ** resources = comp->resources;
 
   bool ok = true;
 
   unsigned long i;
   for ( i=0; i<count && ok; i++ ) {
-
-    unsigned int bucket = entries[i].bucket;
-
-    ok = lcfgreslist_print( resources[bucket], comp_name, style, options,
+    ok = lcfgreslist_print( sorted[i], comp_name, style, options,
                             &buffer, &buf_size, out );
   }
   free(buffer);
-  free(entries);
 
   return ok;
 }
@@ -1039,18 +1501,16 @@ static LCFGChange lcfgcomponent_find_or_create_resource( LCFGComponent * comp,
   } else {
     /* If not found then create new resource and add it to the comp */
 
-    LCFGResource * new_res = lcfgresource_new();
+    LCFGResource * new_res = lcfgcomponent_new_resource(comp);
 
     /* Setting name can fail if it is invalid */
 
-    char * new_name = strdup(name);
-    bool ok = lcfgresource_set_name( new_res, new_name );
+    bool ok = lcfgresource_set_name_copy( new_res, name );
 
     if ( !ok ) {
       change = LCFG_CHANGE_ERROR;
       lcfgutils_build_message( msg, "Failed to create new resource named '%s'",
-                               new_name );
-      free(new_name);
+                               name );
     } else {
 
       change = lcfgcomponent_merge_resource( comp, new_res, msg );
@@ -1082,6 +1542,10 @@ static LCFGChange lcfgcomponent_find_or_create_resource( LCFGComponent * comp,
  * @c LCFG_OPT_ALLOW_NOEXIST option is specified. If the file exists
  * but is empty then an empty @c LCFGComponent is returned.
  *
+ * If the @c LCFG_OPT_USE_ARENA option is specified then the resources
+ * will be allocated from an arena owned by the component, see
+ * @c lcfgcomponent_use_arena() for details.
+ *
  * @param[in] filename Path to status file
  * @param[out] result Reference to pointer for new @c LCFGComponent
  * @param[in] compname_in Component name (optional)
@@ -1134,6 +1598,9 @@ LCFGStatus lcfgcomponent_from_status_file( const char * filename,
     goto cleanup;
   }
 
+  if ( options & LCFG_OPT_USE_ARENA )
+    lcfgcomponent_use_arena(comp);
+
   const char * statusfile = filename != NULL ? filename : comp_name;
 
   FILE *fp;
@@ -1653,50 +2120,60 @@ LCFGChange lcfgcomponent_merge_resource( LCFGComponent * comp,
 
   if ( !lcfgresource_is_valid(resource) ) return LCFG_CHANGE_ERROR;
 
+  LCFGResource * promoted = NULL;
+  if ( lcfgcomponent_needs_promotion( comp, resource->_arena ) ) {
+    promoted = lcfgresource_clone(resource);
+    if ( promoted != NULL )
+      resource = promoted;
+  }
+
   const char * name = lcfgresource_get_name(resource);
 
-  unsigned long bucket;
-  bool found = lcfgcomponent_find_bucket( comp, name, &bucket );
+  LCFGComponentSlot key;
+  lcfgcomponent_hash_name( name, &key );
 
-  LCFGChange change = LCFG_CHANGE_NONE;
-  if ( !found ) {
-    lcfgutils_build_message( msg,
-                             "No free space for new entries in component" );
-    change = LCFG_CHANGE_ERROR;
-  } else {
+  unsigned long bucket = 0;
+  bool found = lcfgcomponent_find_bucket( comp, name, &key, &bucket );
 
-    /* find the existing list or create a new one */
+  /* find the existing list or create a new one */
 
-    LCFGResourceList * list = (comp->resources)[bucket];
-    LCFGResourceList * new_list = NULL;
-    if ( list == NULL ) {
-      new_list = lcfgcomponent_empty_list(comp);
-      list = new_list;
-    } else if ( lcfgreslist_is_shared(list) ) { /* COW */
-      new_list = lcfgreslist_clone(list);
-      list = new_list;
-    }
+  LCFGResourceList * list = found ? (comp->resources)[bucket] : NULL;
+  LCFGResourceList * new_list = NULL;
+  if ( list == NULL ) {
+    new_list = lcfgcomponent_empty_list(comp);
+    list = new_list;
+  } else if ( lcfgcomponent_list_is_shared( comp, list ) ) { /* COW */
+    new_list = lcfgreslist_clone(list);
+    list = new_list;
+  }
 
-    change = lcfgreslist_merge_resource( list, resource, msg );
+  LCFGChange change = lcfgreslist_merge_resource( list, resource, msg );
 
-    if ( LCFGChangeOK(change) ) {
-      LCFGChange set_rc = LCFG_CHANGE_NONE;
+  if ( LCFGChangeOK(change) ) {
+    LCFGChange set_rc = LCFG_CHANGE_NONE;
 
-      if ( lcfgreslist_is_empty(list) ) { /* remove empty list */
+    if ( lcfgreslist_is_empty(list) ) { /* remove empty list */
+      if (found)
         set_rc = lcfgcomponent_set_bucket( comp, bucket, NULL );
-      } else if ( change != LCFG_CHANGE_NONE ) {
+    } else if ( change != LCFG_CHANGE_NONE ) {
+      if (found) {
         set_rc = lcfgcomponent_set_bucket( comp, bucket, list );
+      } else {
+        set_rc = lcfgcomponent_add_bucket( comp, &key, list );
 
         if ( set_rc == LCFG_CHANGE_ADDED )
           lcfgcomponent_resize(comp);
+        else
+          lcfgutils_build_message( msg,
+                                 "No free space for new entries in component" );
       }
-      if ( LCFGChangeError(set_rc) ) change = set_rc;
     }
-
-    lcfgreslist_relinquish(new_list);
-      
+    if ( LCFGChangeError(set_rc) ) change = set_rc;
   }
 
+  lcfgreslist_relinquish(new_list);
+  lcfgresource_relinquish(promoted);
+
   return change;
 }
 
@@ -1725,53 +2202,67 @@ LCFGChange lcfgcomponent_merge_component( LCFGComponent * comp1,
 
   LCFGChange change = LCFG_CHANGE_NONE;
 
+  bool promote = lcfgcomponent_needs_promotion( comp1, comp2->arena );
+
   unsigned long i;
   for ( i=0; i<comp2->buckets && LCFGChangeOK(change); i++ ) {
 
     const LCFGResourceList * list2 = (comp2->resources)[i];
     if ( lcfgreslist_is_empty(list2) ) continue;
 
+    LCFGResourceList * promoted = NULL;
+    if (promote) {
+      promoted = lcfgcomponent_promote_list(list2);
+      list2 = promoted;
+    }
+
     const char * name = lcfgreslist_get_name(list2);
 
-    unsigned long bucket;
-    bool found = lcfgcomponent_find_bucket( comp1, name, &bucket );
+    /* The stored hash for the override list can be reused */
 
-    if ( !found ) {
-      lcfgutils_build_message( msg,
-                               "No free space for new entries in component" );
-      change = LCFG_CHANGE_ERROR;
-    } else {
-      LCFGResourceList * list1 = (comp1->resources)[bucket];
-
-      LCFGResourceList * new_list = NULL;
-      if ( list1 == NULL ) {
-        new_list = lcfgcomponent_empty_list(comp1);
-        list1 = new_list;
-      } else if ( lcfgreslist_is_shared(list1) ) { /* COW */
-        new_list = lcfgreslist_clone(list1);
-        list1 = new_list;
-      }
+    const LCFGComponentSlot * key = &( (comp2->slots)[i] );
 
-      change = lcfgreslist_merge_list( list1, list2, msg );
+    unsigned long bucket = 0;
+    bool found = lcfgcomponent_find_bucket( comp1, name, key, &bucket );
 
-      if ( LCFGChangeOK(change) ) {
-        LCFGChange set_rc = LCFG_CHANGE_NONE;
+    LCFGResourceList * list1 = found ? (comp1->resources)[bucket] : NULL;
 
-        if ( lcfgreslist_is_empty(list1) ) { /* remove empty list */
+    LCFGResourceList * new_list = NULL;
+    if ( list1 == NULL ) {
+      new_list = lcfgcomponent_empty_list(comp1);
+      list1 = new_list;
+    } else if ( lcfgcomponent_list_is_shared( comp1, list1 ) ) { /* COW */
+      new_list = lcfgreslist_clone(list1);
+      list1 = new_list;
+    }
+
+    change = lcfgreslist_merge_list( list1, list2, msg );
+
+    if ( LCFGChangeOK(change) ) {
+      LCFGChange set_rc = LCFG_CHANGE_NONE;
+
+      if ( lcfgreslist_is_empty(list1) ) { /* remove empty list */
+        if (found)
           set_rc = lcfgcomponent_set_bucket( comp1, bucket, NULL );
-        } else if ( change != LCFG_CHANGE_NONE ) {
+      } else if ( change != LCFG_CHANGE_NONE ) {
+        if (found) {
           set_rc = lcfgcomponent_set_bucket( comp1, bucket, list1 );
+        } else {
+          set_rc = lcfgcomponent_add_bucket( comp1, key, list1 );
 
           if ( set_rc == LCFG_CHANGE_ADDED )
             lcfgcomponent_resize(comp1);
+          else
+            lcfgutils_build_message( msg,
+                                 "No free space for new entries in component" );
         }
-        if ( LCFGChangeError(set_rc) ) change = set_rc;
       }
-
-      lcfgreslist_relinquish(new_list);
-
+      if ( LCFGChangeError(set_rc) ) change = set_rc;
     }
 
+    lcfgreslist_relinquish(new_list);
+    lcfgreslist_relinquish(promoted);
+
   }
 
   return change;
@@ -1847,21 +2338,55 @@ char * lcfgcomponent_get_resources_as_string(const LCFGComponent * comp) {
 
   if ( lcfgcomponent_is_empty(comp) ) return strdup("");
 
-  LCFGTagList * reslist = lcfgcomponent_get_resources_as_taglist(comp);
+  LCFGResourceList ** sorted = comp->sorted;
+  unsigned long count = comp->entries;
+
+  const char ** names = calloc( count, sizeof(char *) );
+  if ( names == NULL ) {
+    perror( "Failed to allocate memory for LCFG resource names" );
+    exit(EXIT_FAILURE);
+  }
+
+  size_t new_len = 0;
 
-  if ( reslist == NULL ) return NULL;
+  unsigned long i;
+  for ( i=0; i<count; i++ ) {
+    names[i] = lcfgreslist_get_name(sorted[i]);
+    new_len += strlen(names[i]) + 1; /* +1 for single space or nul */
+  }
+
+  /* The names are sorted with strcmp() whereas the stored order uses
+     strcasecmp(). The two orders only differ for mixed-case names so
+     an insertion sort is effectively just a linear check. */
 
-  lcfgtaglist_sort(reslist);
+  for ( i=1; i<count; i++ ) {
+    const char * name = names[i];
 
-  size_t buf_len = 0;
-  char * res_as_str = NULL;
+    unsigned long j = i;
+    while ( j > 0 && strcmp( names[j-1], name ) > 0 ) {
+      names[j] = names[j-1];
+      j--;
+    }
+    names[j] = name;
+  }
 
-  if ( lcfgtaglist_to_string( reslist, 0, &res_as_str, &buf_len ) < 0 ) {
-    free(res_as_str);
-    res_as_str = NULL;
+  char * res_as_str = malloc( new_len * sizeof(char) );
+  if ( res_as_str == NULL ) {
+    perror( "Failed to allocate memory for LCFG resource names" );
+    exit(EXIT_FAILURE);
   }
 
-  lcfgtaglist_relinquish(reslist);
+  char * to = res_as_str;
+  for ( i=0; i<count; i++ ) {
+    if ( i > 0 ) *to++ = ' ';
+
+    size_t len = strlen(names[i]);
+    memcpy( to, names[i], len );
+    to += len;
+  }
+  *to = '\0';
+
+  free(names);
 
   return res_as_str;
 }
@@ -2069,6 +2594,46 @@ unsigned long lcfgcomponent_hash( const LCFGComponent * comp ) {
   return farmhash64( comp->name, len );
 }
 
+/**
+ * @brief Gather memory usage statistics for the component
+ *
+ * This adds the memory used by the @c LCFGComponent, the hash table,
+ * the resource lists and all the resources to the totals in the
+ * specified @c LCFGResourceStats structure. See
+ * @c lcfgresource_memory_stats() for details of what is counted for
+ * each resource. Resources which appear in more than one list (or
+ * hash tables shared with clones) will be counted every time.
+ *
+ * @param[in] comp Pointer to @c LCFGComponent
+ * @param[out] stats Pointer to an @c LCFGResourceStats
+ *
+ */
+
+void lcfgcomponent_memory_stats( const LCFGComponent * comp,
+                                 LCFGResourceStats * stats ) {
+  assert( stats != NULL );
+
+  if ( comp == NULL ) return;
+
+  stats->container_bytes += sizeof(LCFGComponent) +
+    comp->buckets * ( sizeof(LCFGResourceList *) + sizeof(LCFGComponentSlot) );
+
+  unsigned long i;
+  for ( i=0; i<comp->buckets; i++ ) {
+    const LCFGResourceList * list = (comp->resources)[i];
+    if ( list == NULL ) continue;
+
+    stats->container_bytes += sizeof(LCFGResourceList);
+    if ( list->items != list->inline_items )
+      stats->container_bytes += list->capacity * sizeof(LCFGResource *);
+
+    unsigned int j;
+    for ( j=0; j<list->size; j++ )
+      lcfgresource_memory_stats( (list->items)[j], stats );
+  }
+
+}
+
 /**
  * @brief Compare the component names
  *
@@ -2196,14 +2761,13 @@ LCFGStatus lcfgcomponent_select( const LCFGComponent * comp,
   new_comp->primary_key = comp->primary_key;
   new_comp->merge_rules = comp->merge_rules;
 
+  /* The selected resources are shared so the arena is also shared */
+
+  lcfgcomponent_share_arena( new_comp, comp );
+
   /* Preallocate a sufficiently large hash */
 
-  unsigned long taglist_size = lcfgtaglist_size(res_wanted);
-  unsigned long new_buckets = want_buckets(taglist_size);
-  if ( new_buckets > new_comp->buckets ) {
-    new_comp->buckets = new_buckets;
-    lcfgcomponent_resize(new_comp);
-  }
+  lcfgcomponent_reserve( new_comp, lcfgtaglist_size(res_wanted) );
 
   /* Collect the required subset of resources */
 
@@ -2293,19 +2857,17 @@ bool lcfgcomponent_update_signature( const LCFGComponent * comp,
                                      char ** buffer, size_t * buf_size ) {
   assert( comp != NULL );
 
-  LCFGComponentEntry * entries = NULL;
-  unsigned int count = lcfgcomponent_sorted_entries( comp, &entries );
+  LCFGResourceList ** sorted = comp->sorted;
+  unsigned long count = comp->entries;
 
   const char * comp_name = lcfgcomponent_get_name(comp);
-  LCFGResourceList ** resources = comp->resources;
 
   bool ok = true;
 
   unsigned long i;
   for ( i=0; i<count && ok; i++ ) {
 
-    unsigned int bucket = entries[i].bucket;
-    const LCFGResourceList * list = resources[bucket];
+    const LCFGResourceList * list = sorted[i];
 
     if ( !lcfgreslist_is_empty(list) ) {
 
@@ -2322,8 +2884,6 @@ bool lcfgcomponent_update_signature( const LCFGComponent * comp,
     }
   }
 
-  free(entries);
-
   return ok;
 }
 
@@ -27,8 +27,8 @@ static LCFGResourceListIterator * lcfgreslistiter_new(LCFGResourceList * list) {
 
   lcfgreslist_acquire(list);
 
-  iterator->list    = list;
-  iterator->current = NULL;
+  iterator->list = list;
+  iterator->next = 0;
 
   return iterator;
 }
@@ -38,9 +38,7 @@ static void lcfgreslistiter_destroy( LCFGResourceListIterator * iterator ) {
   if ( iterator == NULL ) return;
 
   lcfgreslist_relinquish(iterator->list);
-  iterator->list    = NULL;
-
-  iterator->current = NULL;
+  iterator->list = NULL;
 
   free(iterator);
   iterator = NULL;
@@ -48,28 +46,15 @@ static void lcfgreslistiter_destroy( LCFGResourceListIterator * iterator ) {
 }
 
 static bool lcfgreslistiter_has_next( LCFGResourceListIterator * iterator ) {
-
-  bool has_next = false;
-  if ( iterator->current == NULL )
-    has_next = !lcfgslist_is_empty(iterator->list);
-  else
-    has_next = ( lcfgslist_next(iterator->current) != NULL );
-
-  return has_next;
+  return ( iterator->next < lcfgreslist_size(iterator->list) );
 }
 
 static const LCFGResource * lcfgreslistiter_next(LCFGResourceListIterator * iterator) {
 
   if ( !lcfgreslistiter_has_next(iterator) ) return NULL;
 
-  if ( iterator->current == NULL )
-    iterator->current = lcfgslist_head(iterator->list);
-  else
-    iterator->current = lcfgslist_next(iterator->current);
-
-  const LCFGResource * next = NULL;
-  if ( iterator->current != NULL )
-    next = lcfgslist_data(iterator->current);
+  const LCFGResource * next = iterator->list->items[iterator->next];
+  iterator->next++;
 
   return next;
 }
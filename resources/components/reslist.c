@@ -1,22 +1,26 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "common.h"
 #include "resources.h"
 #include "reslist.h"
 
-#define lcfgreslist_append(LIST, ITEM) ( lcfgreslist_insert_next( LIST, lcfgslist_tail(LIST), ITEM ) )
+/* A resource list is a small vector of resources kept in order of
+   descending priority, resources with equal priority are kept in the
+   order in which they were added. Nearly all lists hold a single
+   resource so the first few are stored inline in the list structure
+   and a separate array is only allocated for longer lists. */
 
-static LCFGChange lcfgreslist_remove_next( LCFGResourceList * list,
-                                           LCFGSListNode    * node,
-                                           LCFGResource    ** item )
+static LCFGChange lcfgreslist_remove_at( LCFGResourceList * list,
+                                         unsigned int index,
+                                         LCFGResource ** item )
    __attribute__((warn_unused_result));
 
-static LCFGChange lcfgreslist_insert_next( LCFGResourceList * list,
-                                           LCFGSListNode    * node,
-                                           LCFGResource     * item )
+static LCFGChange lcfgreslist_insert( LCFGResourceList * list,
+                                      LCFGResource     * item )
    __attribute__((warn_unused_result));
 
 LCFGResourceList * lcfgreslist_new(void) {
@@ -29,37 +33,63 @@ LCFGResourceList * lcfgreslist_new(void) {
 
   list->merge_rules = LCFG_MERGE_RULE_NONE;
   list->primary_key = LCFG_COMP_PK_NAME;
-  list->head        = NULL;
-  list->tail        = NULL;
+  list->items       = list->inline_items;
   list->size        = 0;
+  list->capacity    = LCFG_RESLIST_INLINE;
   list->_refcount   = 1;
 
   return list;
 }
 
+/* Ensures there is space in the array for the specified number of
+   items */
+
+static void lcfgreslist_reserve( LCFGResourceList * list,
+                                 unsigned int want ) {
+
+  if ( want <= list->capacity ) return;
+
+  unsigned int new_capacity = list->capacity;
+  while ( new_capacity < want )
+    new_capacity *= 2;
+
+  LCFGResource ** new_items = NULL;
+  if ( list->items == list->inline_items ) {
+    new_items = malloc( new_capacity * sizeof(LCFGResource *) );
+    if ( new_items != NULL )
+      memcpy( new_items, list->inline_items,
+              list->size * sizeof(LCFGResource *) );
+  } else {
+    new_items = realloc( list->items, new_capacity * sizeof(LCFGResource *) );
+  }
+
+  if ( new_items == NULL ) {
+    perror( "Failed to allocate memory for LCFG resource list" );
+    exit(EXIT_FAILURE);
+  }
+
+  list->items    = new_items;
+  list->capacity = new_capacity;
+}
+
 LCFGResourceList * lcfgreslist_clone( const LCFGResourceList * list ) {
 
   LCFGResourceList * clone = lcfgreslist_new();
   clone->merge_rules = list->merge_rules;
   clone->primary_key = list->primary_key;
 
-  LCFGChange change = LCFG_CHANGE_NONE;
-
-  /* This will result in the resources being shared between the lists */
+  /* This will result in the resources being shared between the
+     lists. The order is already correct so the array is just
+     copied. */
 
-  const LCFGSListNode * cur_node = NULL;
-  for ( cur_node = lcfgslist_head(list);
-        cur_node != NULL && LCFGChangeOK(change);
-        cur_node = lcfgslist_next(cur_node) ) {
-
-    LCFGResource * resource = lcfgslist_data(cur_node);
-    change = lcfgreslist_append( clone, resource );
-  }
+  lcfgreslist_reserve( clone, list->size );
 
-  if ( LCFGChangeError(change) ) {
-    lcfgreslist_relinquish(clone);
-    clone = NULL;
+  unsigned int i;
+  for ( i=0; i<list->size; i++ ) {
+    clone->items[i] = list->items[i];
+    lcfgresource_acquire(clone->items[i]);
   }
+  clone->size = list->size;
 
   return clone;
 }
@@ -68,15 +98,13 @@ static void lcfgreslist_destroy( LCFGResourceList * list ) {
 
   if ( list == NULL ) return;
 
-  /* Remove head until the list is empty */
+  unsigned int i;
+  for ( i=0; i<list->size; i++ )
+    lcfgresource_relinquish(list->items[i]);
 
-  while ( lcfgslist_size(list) > 0 ) {
-    LCFGResource * resource = NULL;
-    if ( lcfgreslist_remove_next( list, NULL, &resource )
-         == LCFG_CHANGE_REMOVED ) {
-      lcfgresource_relinquish(resource);
-    }
-  }
+  if ( list->items != list->inline_items )
+    free(list->items);
+  list->items = NULL;
 
   free(list);
   list = NULL;
@@ -115,87 +143,57 @@ bool lcfgreslist_set_merge_rules( LCFGResourceList * list,
   return true;
 }
 
-static LCFGChange lcfgreslist_insert_next( LCFGResourceList * list,
-                                           LCFGSListNode    * node,
-                                           LCFGResource     * item ) {
+/* Inserts a resource at the correct place for its priority. A binary
+   search is used to find the position after any resources which have
+   the same or greater priority. */
+
+static LCFGChange lcfgreslist_insert( LCFGResourceList * list,
+                                      LCFGResource     * item ) {
   assert( list != NULL );
   assert( item != NULL );
 
-  LCFGSListNode * new_node = lcfgslistnode_new(item);
-  if ( new_node == NULL ) return LCFG_CHANGE_ERROR;
+  int priority = lcfgresource_get_priority(item);
 
-  lcfgresource_acquire(item);
-
-  if ( node == NULL ) { /* HEAD */
-
-    if ( lcfgslist_is_empty(list) )
-      list->tail = new_node;
-
-    new_node->next = list->head;
-    list->head     = new_node;
-
-  } else {
-
-    if ( node->next == NULL )
-      list->tail = new_node;
+  unsigned int low  = 0;
+  unsigned int high = list->size;
+  while ( low < high ) {
+    unsigned int mid = low + ( high - low ) / 2;
+    if ( lcfgresource_get_priority(list->items[mid]) >= priority )
+      low = mid + 1;
+    else
+      high = mid;
+  }
 
-    new_node->next = node->next;
-    node->next     = new_node;
+  lcfgreslist_reserve( list, list->size + 1 );
 
-  }
+  memmove( list->items + low + 1, list->items + low,
+           ( list->size - low ) * sizeof(LCFGResource *) );
 
+  lcfgresource_acquire(item);
+  list->items[low] = item;
   list->size++;
 
   return LCFG_CHANGE_ADDED;
 }
 
-static LCFGChange lcfgreslist_remove_next( LCFGResourceList * list,
-                                           LCFGSListNode    * node,
-                                           LCFGResource    ** item ) {
+static LCFGChange lcfgreslist_remove_at( LCFGResourceList * list,
+                                         unsigned int index,
+                                         LCFGResource ** item ) {
   assert( list != NULL );
 
-  if ( lcfgslist_is_empty(list) ) return LCFG_CHANGE_NONE;
-
-  LCFGSListNode * old_node = NULL;
-
-  if ( node == NULL ) { /* HEAD */
-
-    old_node   = list->head;
-    list->head = list->head->next;
+  if ( index >= list->size ) return LCFG_CHANGE_ERROR;
 
-    if ( lcfgslist_size(list) == 1 )
-      list->tail = NULL;
-
-  } else {
-
-    if ( node->next == NULL ) return LCFG_CHANGE_ERROR;
-
-    old_node   = node->next;
-    node->next = node->next->next;
-
-    if ( node->next == NULL )
-      list->tail = node;
-
-  }
+  *item = list->items[index];
 
   list->size--;
-
-  *item = lcfgslist_data(old_node);
-
-  lcfgslistnode_destroy(old_node);
+  memmove( list->items + index, list->items + index + 1,
+           ( list->size - index ) * sizeof(LCFGResource *) );
 
   return LCFG_CHANGE_REMOVED;
 }
 
 const LCFGResource * lcfgreslist_first_resource(const LCFGResourceList * list) {
-
-  const LCFGSListNode * head_node = lcfgslist_head(list);
-
-  const LCFGResource * resource = NULL;
-  if ( head_node != NULL )
-    resource = lcfgslist_data(head_node);
-
-  return resource;
+  return ( lcfgreslist_is_empty(list) ? NULL : list->items[0] );
 }
 
 const char * lcfgreslist_get_name( const LCFGResourceList * list ) {
@@ -221,28 +219,25 @@ LCFGChange lcfgreslist_merge_resource( LCFGResourceList * list,
 
   /* Define these ahead of any jumps to the "apply" label */
 
-  LCFGSListNode * prev_node = NULL;
-  LCFGSListNode * cur_node  = NULL;
-  LCFGResource * cur_res    = NULL;
+  unsigned int cur_index = 0;
+  bool found             = false;
+  LCFGResource * cur_res = NULL;
 
-  /* Doing a search here rather than calling find_node so that the
-     previous node can also be selected. That is needed for removals. */
+  /* Search for a resource with the same name (and context if that is
+     part of the primary key). The index is needed for removals. */
 
   bool ignore_context = !( list->primary_key & LCFG_COMP_PK_CTX );
 
-  LCFGSListNode * node = NULL;
-  for ( node = lcfgslist_head(list);
-        node != NULL && cur_node == NULL;
-        node = lcfgslist_next(node) ) {
+  unsigned int i;
+  for ( i=0; i<list->size; i++ ) {
 
-    const LCFGResource * res = lcfgslist_data(node);
+    const LCFGResource * res = list->items[i];
 
     if ( lcfgresource_same_name( res, new_res ) &&
          ( ignore_context || lcfgresource_same_context( res, new_res ) ) ) {
-      cur_node = node;
+      cur_index = i;
+      found     = true;
       break;
-    } else {
-      prev_node = node; /* used later if a removal is required */
     }
 
   }
@@ -257,8 +252,8 @@ LCFGChange lcfgreslist_merge_resource( LCFGResourceList * list,
 
   /* 0. Avoid genuine duplicates */
 
-  if ( cur_node != NULL ) {
-    cur_res = lcfgslist_data(cur_node);
+  if (found) {
+    cur_res = list->items[cur_index];
 
     /* Merging a struct which is already in the list is a no-op. Note
        that this does not prevent the same spec appearing multiple
@@ -340,11 +335,11 @@ LCFGChange lcfgreslist_merge_resource( LCFGResourceList * list,
 
   if ( accept ) {
 
-    if ( remove_old && cur_node != NULL ) {
+    if ( remove_old && found ) {
 
       LCFGResource * old_res = NULL;
       LCFGChange remove_rc =
-        lcfgreslist_remove_next( list, prev_node, &old_res );
+        lcfgreslist_remove_at( list, cur_index, &old_res );
 
       if ( remove_rc == LCFG_CHANGE_REMOVED ) {
         lcfgresource_relinquish(old_res);
@@ -357,7 +352,7 @@ LCFGChange lcfgreslist_merge_resource( LCFGResourceList * list,
     }
 
     if ( append_new && LCFGChangeOK(result) ) {
-      LCFGChange append_rc = lcfgreslist_append( list, new_res );
+      LCFGChange append_rc = lcfgreslist_insert( list, new_res );
 
       if ( append_rc == LCFG_CHANGE_ADDED ) {
 
@@ -392,12 +387,10 @@ LCFGChange lcfgreslist_merge_list( LCFGResourceList * list1,
 
   LCFGChange change = LCFG_CHANGE_NONE;
 
-  const LCFGSListNode * cur_node = NULL;
-  for ( cur_node = lcfgslist_head(list2);
-        cur_node != NULL && LCFGChangeOK(change);
-        cur_node = lcfgslist_next(cur_node) ) {
+  unsigned int i;
+  for ( i=0; i<list2->size && LCFGChangeOK(change); i++ ) {
 
-    LCFGResource * resource = lcfgslist_data(cur_node);
+    LCFGResource * resource = list2->items[i];
 
     LCFGChange merge_rc = lcfgreslist_merge_resource( list1, resource, msg );
 
@@ -411,31 +404,28 @@ LCFGChange lcfgreslist_merge_list( LCFGResourceList * list1,
   return change;
 }
 
-void lcfgreslist_sort_by_priority( LCFGResourceList * list ) {
-
-  if ( lcfgslist_size(list) < 2 ) return;
-
-  /* Oo. Oo. bubble sort .oO .oO */
+/* Resources are inserted in order of priority so this is only
+   required if the priorities have been changed since the resources
+   were added to the list (e.g. by re-evaluating contexts). An
+   insertion sort is used as it is stable and the list will nearly
+   always already be in order. */
 
-  bool swapped=true;
-  while (swapped) {
-    swapped=false;
-
-    LCFGSListNode * cur_node = NULL;
-    for ( cur_node = lcfgslist_head(list);
-          cur_node != NULL && cur_node->next != NULL;
-          cur_node = lcfgslist_next(cur_node) ) {
+void lcfgreslist_sort_by_priority( LCFGResourceList * list ) {
 
-      LCFGResource * cur_item  = lcfgslist_data(cur_node);
-      LCFGResource * next_item = lcfgslist_data(cur_node->next);
+  if ( lcfgreslist_is_empty(list) || list->size < 2 ) return;
 
-      if ( cur_item->priority < next_item->priority ) {
-        cur_node->data       = next_item;
-        cur_node->next->data = cur_item;
-        swapped = true;
-      }
+  unsigned int i;
+  for ( i=1; i<list->size; i++ ) {
+    LCFGResource * item = list->items[i];
+    int priority = lcfgresource_get_priority(item);
 
+    unsigned int j = i;
+    while ( j > 0 &&
+            lcfgresource_get_priority(list->items[j-1]) < priority ) {
+      list->items[j] = list->items[j-1];
+      j--;
     }
+    list->items[j] = item;
   }
 
 }
@@ -457,12 +447,10 @@ bool lcfgreslist_print( const LCFGResourceList * list,
   bool ok   = true;
   bool done = false;
 
-  const LCFGSListNode * cur_node = NULL;
-  for ( cur_node = lcfgslist_head(list);
-        cur_node != NULL && ok && !done;
-        cur_node = lcfgslist_next(cur_node) ) {
+  unsigned int i;
+  for ( i=0; i<list->size && ok && !done; i++ ) {
 
-    const LCFGResource * res = lcfgslist_data(cur_node);
+    const LCFGResource * res = list->items[i];
 
     if ( all_values || lcfgresource_has_value(res) ) {
 
@@ -47,6 +47,9 @@ bool lcfgreslist_print( const LCFGResourceList * list,
                         FILE * out )
   __attribute__((warn_unused_result));
 
+LCFGResourceList * lcfgcomponent_private_list( LCFGComponent * comp,
+                                               const LCFGResourceList * list );
+
 #endif /* LCFG_CORE_RESOURCES_LIST_H */
 
 /* eof */
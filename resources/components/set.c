@@ -19,6 +19,7 @@
 
 #include "components.h"
 #include "utils.h"
+#include "reslist.h"
 
 #define LCFG_COMPSET_DEFAULT_SIZE 113
 #define LCFG_COMPSET_LOAD_INIT 0.5
@@ -305,6 +306,34 @@ bool lcfgcompset_has_component( const LCFGComponentSet * compset,
   return ( lcfgcompset_find_component( compset, want_name ) != NULL );
 }
 
+/**
+ * @brief Gather memory usage statistics for the component set
+ *
+ * This adds the memory used by the @c LCFGComponentSet and all the
+ * components it contains to the totals in the specified
+ * @c LCFGResourceStats structure. See @c lcfgcomponent_memory_stats()
+ * for details.
+ *
+ * @param[in] compset Pointer to @c LCFGComponentSet
+ * @param[out] stats Pointer to an @c LCFGResourceStats
+ *
+ */
+
+void lcfgcompset_memory_stats( const LCFGComponentSet * compset,
+                               LCFGResourceStats * stats ) {
+  assert( stats != NULL );
+
+  if ( compset == NULL ) return;
+
+  stats->container_bytes += sizeof(LCFGComponentSet) +
+    compset->buckets * sizeof(LCFGComponent *);
+
+  unsigned long i;
+  for ( i=0; i<compset->buckets; i++ )
+    lcfgcomponent_memory_stats( (compset->components)[i], stats );
+
+}
+
 /**
  * @brief Find the component for a given name
  *
@@ -514,7 +543,33 @@ LCFGChange lcfgcompset_merge_components( LCFGComponentSet * compset1,
 
       LCFGChange rc = LCFG_CHANGE_NONE;
       if ( target_comp != NULL ) {
-        rc = lcfgcomponent_merge_component( target_comp, override_comp, msg );
+
+        /* Copy-On-Write: if the target component is also in use
+           elsewhere then the overrides are merged into a clone which
+           replaces it in this set. Cloning is cheap as the clone
+           shares the resources until they are modified. */
+
+        LCFGComponent * new_comp = NULL;
+        if ( lcfgcomponent_is_shared(target_comp) ) {
+          new_comp = lcfgcomponent_clone(target_comp);
+          target_comp = new_comp;
+        }
+
+        if ( target_comp == NULL ) {
+          lcfgutils_build_message( msg, "Failed to clone '%s' component",
+                                   comp_name );
+          rc = LCFG_CHANGE_ERROR;
+        } else {
+          rc = lcfgcomponent_merge_component( target_comp, override_comp, msg );
+
+          if ( new_comp != NULL && LCFGChangeOK(rc) && rc != LCFG_CHANGE_NONE &&
+               lcfgcompset_insert_component( compset1, new_comp )
+                 == LCFG_CHANGE_ERROR )
+            rc = LCFG_CHANGE_ERROR;
+        }
+
+        lcfgcomponent_relinquish(new_comp);
+
       } else if ( take_new ) {
         rc = lcfgcompset_insert_component( compset1, override_comp );
       }
@@ -1151,4 +1206,295 @@ char * lcfgcompset_signature( const LCFGComponentSet * compset ) {
   return hex_digest;
 }
 
+/* Returns the priority for a resource, the priorities for any context
+   expressions are taken from the batch using the identifiers in the
+   same order as the resources, the identifier pointer is moved on
+   past any which is used. */
+
+static int lcfgcompset_batch_priority( const LCFGResource * res,
+                                       const LCFGContextBatch * batch,
+                                       const unsigned int ** ids ) {
+
+  int priority = LCFG_RESOURCE_DEFAULT_PRIORITY;
+  if ( lcfgresource_has_context(res) )
+    priority = lcfgctxbatch_get_priority( batch, *( (*ids)++ ) );
+
+  return priority;
+}
+
+/* Copy-On-Write: if the component is also in use elsewhere then it is
+   replaced in the set by a clone before anything is modified. The
+   clone shares the resources until they are modified. */
+
+static LCFGComponent * lcfgcompset_own_component( LCFGComponentSet * compset,
+                                                  unsigned long bucket,
+                                                  char ** msg ) {
+
+  LCFGComponent * comp = (compset->components)[bucket];
+  if ( !lcfgcomponent_is_shared(comp) ) return comp;
+
+  LCFGComponent * new_comp = lcfgcomponent_clone(comp);
+  if ( new_comp == NULL ||
+       lcfgcompset_insert_component( compset, new_comp )
+       == LCFG_CHANGE_ERROR ) {
+    lcfgutils_build_message( msg, "Failed to clone '%s' component",
+                             lcfgcomponent_get_name(comp) );
+    lcfgcomponent_relinquish(new_comp);
+    return NULL;
+  }
+
+  /* Now held by the set */
+
+  lcfgcomponent_relinquish(new_comp);
+
+  return new_comp;
+}
+
+/* Sets the priority for each resource in a list which is held by the
+   component in the specified bucket of the set. Nothing is modified
+   unless at least one priority changes, in which case the list and
+   resources are first made private to the component so that any
+   clone is unaffected. The list is sorted again if anything
+   changes. */
+
+static LCFGChange lcfgcompset_apply_list( LCFGComponentSet * compset,
+                                          unsigned long bucket,
+                                          const LCFGResourceList * list,
+                                          const LCFGContextBatch * batch,
+                                          const unsigned int ** ids,
+                                          char ** msg ) {
+
+  const unsigned int * first_id = *ids;
+
+  bool changed = false;
+
+  unsigned int i;
+  for ( i=0; i<lcfgreslist_size(list); i++ ) {
+    const LCFGResource * res = list->items[i];
+
+    int priority = lcfgcompset_batch_priority( res, batch, ids );
+    if ( priority != lcfgresource_get_priority(res) )
+      changed = true;
+  }
+
+  if ( !changed ) return LCFG_CHANGE_NONE;
+
+  LCFGComponent * comp = lcfgcompset_own_component( compset, bucket, msg );
+  if ( comp == NULL ) return LCFG_CHANGE_ERROR;
+
+  LCFGResourceList * own_list = lcfgcomponent_private_list( comp, list );
+  if ( own_list == NULL ) {
+    lcfgutils_build_message( msg, "Failed to copy resource '%s'",
+                             lcfgreslist_get_name(list) );
+    return LCFG_CHANGE_ERROR;
+  }
+
+  /* The private list holds the same resources in the same order */
+
+  const unsigned int * list_ids = first_id;
+
+  for ( i=0; i<lcfgreslist_size(own_list); i++ ) {
+    LCFGResource * res = own_list->items[i];
+
+    int priority = lcfgcompset_batch_priority( res, batch, &list_ids );
+
+    if ( priority != lcfgresource_get_priority(res) &&
+         !lcfgresource_set_priority( res, priority ) ) {
+      lcfgutils_build_message( msg, "Failed to set priority for resource '%s'",
+                               lcfgresource_get_name(res) );
+      return LCFG_CHANGE_ERROR;
+    }
+  }
+
+  if ( lcfgreslist_size(own_list) > 1 )
+    lcfgreslist_sort_by_priority(own_list);
+
+  return LCFG_CHANGE_MODIFIED;
+}
+
+/* A resource list which has context expressions and the bucket in
+   the set for the component which holds it. The component is looked
+   up again when the list is updated as it may have been replaced by
+   a clone. */
+
+struct LCFGPendingList {
+  unsigned long bucket;
+  const LCFGResourceList * list;
+};
+
+static LCFGChange lcfgcompset_eval_batch( LCFGComponentSet * compset,
+                                          const LCFGContextList * ctxlist,
+                                          unsigned int max_threads,
+                                          char ** msg ) {
+
+  if ( lcfgcompset_is_empty(compset) ) return LCFG_CHANGE_NONE;
+
+  /* Most resources do not have a context, those lists are updated
+     immediately. For the other lists the distinct expressions are
+     collected, each is evaluated once and then the priorities are
+     applied. Any component which is modified no longer matches the
+     XML it was loaded from so the source hash is cleared (see
+     lcfgcomponent_private_list()). */
+
+  struct LCFGPendingList * pending = NULL;
+  unsigned int npending = 0, pending_size = 0;
+
+  unsigned int * ids = NULL;
+  unsigned int nids = 0, ids_size = 0;
+
+  LCFGContextBatch * batch = lcfgctxbatch_new();
+
+  LCFGChange result = LCFG_CHANGE_NONE;
+
+  unsigned long i;
+  for ( i=0; i<compset->buckets && LCFGChangeOK(result); i++ ) {
+    LCFGComponent * comp = compset->components[i];
+    if ( lcfgcomponent_is_empty(comp) ) continue;
+
+    unsigned long j;
+    for ( j=0; j<comp->buckets && LCFGChangeOK(result); j++ ) {
+      LCFGResourceList * list = comp->resources[j];
+      if ( lcfgreslist_is_empty(list) ) continue;
+
+      unsigned int first_id = nids;
+
+      unsigned int k;
+      for ( k=0; k<lcfgreslist_size(list); k++ ) {
+        const LCFGResource * res = list->items[k];
+        if ( !lcfgresource_has_context(res) ) continue;
+
+        if ( nids == ids_size ) {
+          ids_size = ids_size > 0 ? 2 * ids_size : 64;
+          ids = realloc( ids, ids_size * sizeof(unsigned int) );
+          if ( ids == NULL ) {
+            perror( "Failed to allocate memory for LCFG resource priorities" );
+            exit(EXIT_FAILURE);
+          }
+        }
+
+        ids[nids++] = lcfgctxbatch_add( batch, lcfgresource_get_context(res) );
+      }
+
+      LCFGChange list_change = LCFG_CHANGE_NONE;
+
+      if ( nids == first_id ) {
+        const unsigned int * no_ids = NULL;
+        list_change = lcfgcompset_apply_list( compset, i, list,
+                                              batch, &no_ids, msg );
+      } else {
+
+        if ( npending == pending_size ) {
+          pending_size = pending_size > 0 ? 2 * pending_size : 64;
+          pending = realloc( pending,
+                             pending_size * sizeof(struct LCFGPendingList) );
+          if ( pending == NULL ) {
+            perror( "Failed to allocate memory for LCFG resource priorities" );
+            exit(EXIT_FAILURE);
+          }
+        }
+
+        pending[npending].bucket = i;
+        pending[npending].list   = list;
+        npending++;
+      }
+
+      /* The component may have been replaced by a clone */
+
+      comp = compset->components[i];
+
+      if ( list_change != LCFG_CHANGE_NONE )
+        result = list_change;
+    }
+  }
+
+  if ( LCFGChangeOK(result) &&
+       lcfgctxbatch_evaluate( batch, ctxlist, max_threads, msg )
+       != LCFG_STATUS_OK )
+    result = LCFG_CHANGE_ERROR;
+
+  /* The lists are in the same order as the identifiers */
+
+  const unsigned int * list_ids = ids;
+
+  for ( i=0; i<npending && LCFGChangeOK(result); i++ ) {
+    LCFGChange list_change =
+      lcfgcompset_apply_list( compset, pending[i].bucket, pending[i].list,
+                              batch, &list_ids, msg );
+
+    if ( list_change != LCFG_CHANGE_NONE )
+      result = list_change;
+  }
+
+  lcfgctxbatch_destroy(batch);
+  free(pending);
+  free(ids);
+
+  return result;
+}
+
+/**
+ * @brief Evaluate the priority for all resources for a list of contexts
+ *
+ * This will evaluate and update the value of the @e priority
+ * attribute for all the resources in all the components using the
+ * value set for the @e context attribute (if any) and the list of
+ * LCFG contexts passed in as an argument. The priorities are the same
+ * as those from @c lcfgresource_eval_priority() but each distinct
+ * context expression is only evaluated once, see @c
+ * lcfgctxbatch_evaluate() for details. Any resource list which holds
+ * more than one resource is sorted again by priority if anything
+ * changes.
+ *
+ * This supports Copy-On-Write, any component which is also in use
+ * elsewhere is replaced in the set by a clone before it is modified
+ * and any resource list which is shared (e.g. with a clone of the
+ * component) is duplicated along with the resources before the
+ * priorities are changed. Other components which shared the
+ * resources are not affected. The source hash (see @c
+ * lcfgprofile_from_xml_incremental()) is cleared for each component
+ * in the set which is modified.
+ *
+ * If the priority is successfully changed for any resource the @c
+ * LCFG_CHANGE_MODIFIED value is returned, if nothing changes @c
+ * LCFG_CHANGE_NONE is returned, if an error occurs then @c
+ * LCFG_CHANGE_ERROR is returned.
+ *
+ * @param[in] compset Pointer to an @c LCFGComponentSet
+ * @param[in] ctxlist List of LCFG contexts
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
+LCFGChange lcfgcompset_eval_priority( LCFGComponentSet * compset,
+                                      const LCFGContextList * ctxlist,
+                                      char ** msg ) {
+
+  return lcfgcompset_eval_batch( compset, ctxlist, 1, msg );
+}
+
+/**
+ * @brief Evaluate the priority for all resources using multiple threads
+ *
+ * This does the same as @c lcfgcompset_eval_priority() except that
+ * when there are many distinct context expressions they are split
+ * into chunks which are evaluated in parallel. The number of threads
+ * used is limited to the number of online processors.
+ *
+ * @param[in] compset Pointer to an @c LCFGComponentSet
+ * @param[in] ctxlist List of LCFG contexts
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
+LCFGChange lcfgcompset_eval_priority_parallel( LCFGComponentSet * compset,
+                                               const LCFGContextList * ctxlist,
+                                               char ** msg ) {
+
+  return lcfgcompset_eval_batch( compset, ctxlist, 0, msg );
+}
+
 /* eof */
@@ -0,0 +1,120 @@
+/* Benchmark for encoding and decoding resource values
+
+   Builds a set of resources (default 10000) with values of various
+   lengths, a small proportion of which contain characters which must
+   be encoded, and times checking whether each value needs encoding,
+   encoding the values and then decoding them again. The decoded
+   values must match the originals. */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lcfg/resources.h>
+#include <lcfg/utils.h>
+
+static const size_t lengths[] = { 4, 12, 30, 60, 200, 1000 };
+
+#define NLENGTHS ( sizeof(lengths) / sizeof(lengths[0]) )
+
+static char * make_value( unsigned int id ) {
+
+  size_t len = lengths[id % NLENGTHS];
+
+  char * value = calloc( len + 1, sizeof(char) );
+  if ( value == NULL ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  size_t i;
+  for ( i=0; i<len; i++ )
+    value[i] = ( i % 9 == 8 ) ? ' ' : 'a' + ( i + id ) % 26;
+
+  /* Roughly one value in ten needs encoding */
+
+  if ( id % 10 == 0 )
+    value[len / 2] = ( id % 20 == 0 ) ? '\n' : '&';
+
+  return value;
+}
+
+static double elapsed( const struct timespec * start ) {
+  struct timespec end;
+  clock_gettime( CLOCK_MONOTONIC, &end );
+  return ( end.tv_sec - start->tv_sec ) * 1e3 +
+         ( end.tv_nsec - start->tv_nsec ) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+
+  unsigned int size   = argc > 1 ? atoi(argv[1]) : 10000;
+  unsigned int rounds = argc > 2 ? atoi(argv[2]) : 20;
+
+  LCFGResource ** resources = calloc( size, sizeof(LCFGResource *) );
+  char ** encoded = calloc( size, sizeof(char *) );
+  if ( resources == NULL || encoded == NULL ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int i;
+  for ( i=0; i<size; i++ ) {
+    resources[i] = lcfgresource_new();
+    if ( !lcfgresource_set_value( resources[i], make_value(i) ) ) {
+      fprintf( stderr, "Failed to create resource\n" );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  bool ok = true;
+  unsigned long count = 0;
+  unsigned int round;
+
+  struct timespec start;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      if ( lcfgresource_value_needs_encode(resources[i]) )
+        count++;
+    }
+  }
+  printf( "needs_encode: %8.1f ns/value (%lu need encoding)\n",
+          elapsed(&start) * 1e6 / rounds / size, count / rounds );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      free(encoded[i]);
+      encoded[i] = lcfgresource_enc_value(resources[i]);
+    }
+  }
+  printf( "enc_value:    %8.1f ns/value\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ )
+      lcfgutils_decode_html_entities_utf8( encoded[i], NULL );
+  }
+  printf( "decode:       %8.1f ns/value\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  for ( i=0; i<size; i++ ) {
+    if ( strcmp( encoded[i], lcfgresource_get_value(resources[i]) ) != 0 )
+      ok = false;
+
+    free(encoded[i]);
+    lcfgresource_relinquish(resources[i]);
+  }
+  free(encoded);
+  free(resources);
+
+  if ( !ok )
+    fprintf( stderr, "Decoded values were incorrect\n" );
+
+  return ( ok ? 0 : 1 );
+}
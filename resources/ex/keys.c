@@ -0,0 +1,201 @@
+/* Benchmark for building and parsing resource keys
+
+   Builds a set of resource names (default 10000) and times building
+   the value and type keys for every resource with
+   lcfgresource_build_key() compared with a key buffer which holds the
+   namespace and component name prefix, then times parsing the keys
+   with lcfgresource_parse_key() (which needs a copy of each key as it
+   is modified in place) compared with lcfgresource_parse_key_view().
+   The results must be the same for both. */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lcfg/resources.h>
+
+static const char * namespace = "host01";
+static const char * component = "example";
+
+static double elapsed( const struct timespec * start ) {
+  struct timespec end;
+  clock_gettime( CLOCK_MONOTONIC, &end );
+  return ( end.tv_sec - start->tv_sec ) * 1e3 +
+         ( end.tv_nsec - start->tv_nsec ) / 1e6;
+}
+
+static bool same_part( const char * str, const char * part, size_t len ) {
+  if ( str == NULL || part == NULL ) return ( str == part );
+  return ( strlen(str) == len && strncmp( str, part, len ) == 0 );
+}
+
+int main(int argc, char *argv[]) {
+
+  unsigned int size   = argc > 1 ? atoi(argv[1]) : 10000;
+  unsigned int rounds = argc > 2 ? atoi(argv[2]) : 100;
+
+  char ** names = calloc( size, sizeof(char *) );
+  char ** keys  = calloc( size, sizeof(char *) );
+  if ( names == NULL || keys == NULL ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int i;
+  for ( i=0; i<size; i++ ) {
+    if ( asprintf( &names[i], "entry%u_opt%u", i % 211, i ) < 0 ) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  bool ok = true;
+  unsigned long total1 = 0, total2 = 0;
+  unsigned int round;
+
+  char * buf = NULL;
+  size_t buf_size = 0;
+
+  struct timespec start;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      ssize_t len = lcfgresource_build_key( names[i], component, namespace,
+                                            LCFG_RESOURCE_SYMBOL_VALUE,
+                                            &buf, &buf_size );
+      if ( len > 0 ) total1 += len;
+
+      len = lcfgresource_build_key( names[i], component, namespace,
+                                    LCFG_RESOURCE_SYMBOL_TYPE,
+                                    &buf, &buf_size );
+      if ( len > 0 ) total1 += len;
+    }
+  }
+  printf( "build_key:     %8.1f ns/resource\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  LCFGResourceKeyBuffer keybuf;
+  lcfgresource_keybuf_init( &keybuf, component, namespace );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      if ( lcfgresource_keybuf_set_name( &keybuf, names[i] ) < 0 ) {
+        ok = false;
+        continue;
+      }
+
+      size_t len = 0;
+      if ( lcfgresource_keybuf_get_key( &keybuf, LCFG_RESOURCE_SYMBOL_VALUE,
+                                        &len ) != NULL )
+        total2 += len;
+
+      if ( lcfgresource_keybuf_get_key( &keybuf, LCFG_RESOURCE_SYMBOL_TYPE,
+                                        &len ) != NULL )
+        total2 += len;
+    }
+  }
+  printf( "keybuf:        %8.1f ns/resource\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  if ( total1 != total2 ) ok = false;
+
+  /* Keys for parsing, the same as the keys built with the buffer */
+
+  for ( i=0; i<size; i++ ) {
+    if ( lcfgresource_build_key( names[i], component, namespace,
+                                 ( i % 2 == 0 ? LCFG_RESOURCE_SYMBOL_VALUE :
+                                                LCFG_RESOURCE_SYMBOL_TYPE ),
+                                 &buf, &buf_size ) < 0 ) {
+      fprintf( stderr, "Failed to build key\n" );
+      exit(EXIT_FAILURE);
+    }
+    keys[i] = strdup(buf);
+
+    if ( lcfgresource_keybuf_set_name( &keybuf, names[i] ) < 0 ||
+         strcmp( keys[i],
+                 lcfgresource_keybuf_get_key( &keybuf,
+                   ( i % 2 == 0 ? LCFG_RESOURCE_SYMBOL_VALUE :
+                                  LCFG_RESOURCE_SYMBOL_TYPE ), NULL ) ) != 0 )
+      ok = false;
+  }
+
+  lcfgresource_keybuf_clear(&keybuf);
+
+  total1 = total2 = 0;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      strcpy( buf, keys[i] );
+
+      const char * host = NULL, * comp = NULL, * res = NULL;
+      char type;
+      if ( lcfgresource_parse_key( buf, &host, &comp, &res, &type ) )
+        total1 += strlen(res) + type;
+    }
+  }
+  printf( "parse_key:     %8.1f ns/key\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      LCFGResourceKeyView view;
+      if ( lcfgresource_parse_key_view( keys[i], strlen(keys[i]), &view ) )
+        total2 += view.resource_len + view.type;
+    }
+  }
+  printf( "parse_view:    %8.1f ns/key\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  if ( total1 != total2 ) ok = false;
+
+  /* Check the parts match for some awkward keys */
+
+  const char * tests[] = { "foo", "comp.foo", "#comp.foo", " %ns.comp.foo",
+                           "a.b.comp.foo", "^.comp.foo", ".foo", "comp.",
+                           "ns..foo", "#", "", "   " };
+  const unsigned int ntests = sizeof(tests) / sizeof(tests[0]);
+
+  for ( i=0; i<ntests; i++ ) {
+    char * copy = strdup(tests[i]);
+
+    const char * host = NULL, * comp = NULL, * res = NULL;
+    char type;
+    bool rc1 = lcfgresource_parse_key( copy, &host, &comp, &res, &type );
+
+    LCFGResourceKeyView view;
+    bool rc2 = lcfgresource_parse_key_view( tests[i], strlen(tests[i]),
+                                            &view );
+
+    if ( rc1 != rc2 ||
+         ( rc1 && ( !same_part( host, view.namespace, view.namespace_len ) ||
+                    !same_part( comp, view.component, view.component_len ) ||
+                    !same_part( res,  view.resource,  view.resource_len ) ||
+                    type != view.type ) ) ) {
+      fprintf( stderr, "Parts differ for key '%s'\n", tests[i] );
+      ok = false;
+    }
+
+    free(copy);
+  }
+
+  if ( !ok )
+    fprintf( stderr, "Key results were incorrect\n" );
+
+  for ( i=0; i<size; i++ ) {
+    free(names[i]);
+    free(keys[i]);
+  }
+  free(names);
+  free(keys);
+  free(buf);
+
+  return ( ok ? 0 : 1 );
+}
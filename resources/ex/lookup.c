@@ -0,0 +1,124 @@
+/* Benchmark for resource lookups in a component
+
+   Builds a synthetic component (default 50000 resources) and times
+   merging the resources, looking up every resource by name, looking
+   up names which are not present and cloning the component. */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lcfg/components.h>
+
+static char * make_name( const char * prefix, unsigned int id ) {
+
+  char * name = NULL;
+  if ( asprintf( &name, "%s%u_%u", prefix, id % 97, id ) < 0 ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  return name;
+}
+
+static double elapsed( const struct timespec * start ) {
+  struct timespec end;
+  clock_gettime( CLOCK_MONOTONIC, &end );
+  return ( end.tv_sec - start->tv_sec ) * 1e3 +
+         ( end.tv_nsec - start->tv_nsec ) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+
+  unsigned int size   = argc > 1 ? atoi(argv[1]) : 50000;
+  unsigned int rounds = argc > 2 ? atoi(argv[2]) : 20;
+
+  char ** hits   = calloc( size, sizeof(char *) );
+  char ** misses = calloc( size, sizeof(char *) );
+  if ( hits == NULL || misses == NULL ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int i;
+  for ( i=0; i<size; i++ ) {
+    hits[i]   = make_name( "res", i );
+    misses[i] = make_name( "nores", i );
+  }
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGComponent * comp = lcfgcomponent_new();
+
+  for ( i=0; i<size; i++ ) {
+    LCFGResource * res = lcfgresource_new();
+
+    if ( !lcfgresource_set_name( res, strdup(hits[i]) ) ||
+         !lcfgresource_set_value( res, strdup("value") ) ) {
+      fprintf( stderr, "Failed to create resource\n" );
+      exit(EXIT_FAILURE);
+    }
+
+    char * msg = NULL;
+    if ( lcfgcomponent_merge_resource( comp, res, &msg ) != LCFG_CHANGE_ADDED ) {
+      fprintf( stderr, "Failed to merge resource: %s\n", msg );
+      exit(EXIT_FAILURE);
+    }
+    free(msg);
+
+    lcfgresource_relinquish(res);
+  }
+
+  printf( "merge:  %8.3f ms for %lu resources\n", elapsed(&start),
+          lcfgcomponent_size(comp) );
+
+  bool ok = true;
+
+  unsigned int round;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      if ( lcfgcomponent_find_resource( comp, hits[i] ) == NULL )
+        ok = false;
+    }
+  }
+  printf( "hit:    %8.1f ns/lookup\n", elapsed(&start) * 1e6 / rounds / size );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      if ( lcfgcomponent_find_resource( comp, misses[i] ) != NULL )
+        ok = false;
+    }
+  }
+  printf( "miss:   %8.1f ns/lookup\n", elapsed(&start) * 1e6 / rounds / size );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    LCFGComponent * clone = lcfgcomponent_clone(comp);
+    if ( clone == NULL || lcfgcomponent_size(clone) != size )
+      ok = false;
+    lcfgcomponent_relinquish(clone);
+  }
+  printf( "clone:  %8.3f ms\n", elapsed(&start) / rounds );
+
+  if ( !ok )
+    fprintf( stderr, "Lookup results were incorrect\n" );
+
+  lcfgcomponent_relinquish(comp);
+
+  for ( i=0; i<size; i++ ) {
+    free(hits[i]);
+    free(misses[i]);
+  }
+  free(hits);
+  free(misses);
+
+  return ( ok ? 0 : 1 );
+}
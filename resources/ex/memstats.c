@@ -0,0 +1,97 @@
+/* Memory usage for a synthetic component
+
+   Builds a component (default 50000 resources) with names and values
+   of typical lengths and reports the statistics gathered by
+   lcfgcomponent_memory_stats() along with the total heap usage as
+   measured by mallinfo2() and the time taken to destroy the
+   component. If a second argument of "arena" is given the resources
+   are allocated from an arena owned by the component. */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lcfg/components.h>
+
+static const char * values[] = { "", "yes", "true", "/etc/example.conf",
+                                 "alpha beta gamma delta epsilon",
+                                 "https://www.example.org/path/to/some/resource/value" };
+
+#define NVALUES ( sizeof(values) / sizeof(values[0]) )
+
+int main(int argc, char *argv[]) {
+
+  unsigned int size = argc > 1 ? atoi(argv[1]) : 50000;
+  bool use_arena    = argc > 2 && strcmp( argv[2], "arena" ) == 0;
+
+  size_t before = mallinfo2().uordblks;
+
+  LCFGComponent * comp = lcfgcomponent_new();
+  if (use_arena)
+    lcfgcomponent_use_arena(comp);
+
+  unsigned int i;
+  for ( i=0; i<size; i++ ) {
+    LCFGResource * res = lcfgcomponent_new_resource(comp);
+
+    char * name = NULL;
+    if ( asprintf( &name, "entry%u_opt%u", i % 211, i ) < 0 ) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+    }
+
+    if ( !lcfgresource_set_name( res, name ) ||
+         !lcfgresource_set_value( res, strdup(values[i % NVALUES]) ) ) {
+      fprintf( stderr, "Failed to create resource\n" );
+      exit(EXIT_FAILURE);
+    }
+
+    char * msg = NULL;
+    if ( lcfgcomponent_merge_resource( comp, res, &msg ) != LCFG_CHANGE_ADDED ) {
+      fprintf( stderr, "Failed to merge resource: %s\n", msg );
+      exit(EXIT_FAILURE);
+    }
+    free(msg);
+
+    lcfgresource_relinquish(res);
+  }
+
+  size_t heap = mallinfo2().uordblks - before;
+
+  LCFGResourceStats stats;
+  memset( &stats, 0, sizeof(stats) );
+  lcfgcomponent_memory_stats( comp, &stats );
+
+  size_t total = stats.resource_bytes + stats.string_bytes +
+                 stats.container_bytes;
+
+  printf( "resources:       %lu\n",  stats.resources );
+  printf( "inline strings:  %lu\n",  stats.inline_strings );
+  printf( "heap strings:    %lu\n",  stats.heap_strings );
+  printf( "arena strings:   %lu\n",  stats.arena_strings );
+  printf( "resource bytes:  %zu (%zu per resource)\n", stats.resource_bytes,
+          sizeof(LCFGResource) );
+  printf( "string bytes:    %zu\n",  stats.string_bytes );
+  printf( "container bytes: %zu\n",  stats.container_bytes );
+  printf( "total:           %zu (%.1f per resource)\n", total,
+          (double) total / stats.resources );
+  printf( "heap in use:     %zu (%.1f per resource)\n", heap,
+          (double) heap / stats.resources );
+
+  struct timespec start, end;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  lcfgcomponent_relinquish(comp);
+
+  clock_gettime( CLOCK_MONOTONIC, &end );
+  printf( "destroy:         %.3f ms\n",
+          ( end.tv_sec - start.tv_sec ) * 1e3 +
+          ( end.tv_nsec - start.tv_nsec ) / 1e6 );
+
+  return 0;
+}
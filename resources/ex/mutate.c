@@ -0,0 +1,112 @@
+/* Benchmark for tag mutations on a large list resource
+
+   Applies a sequence of tag mutations (default 5000 additions
+   followed by the removal of every other tag) to a list resource,
+   first by calling lcfgresource_value_add_tag() and
+   lcfgresource_value_remove_tag() for each tag and then as a single
+   batch with lcfgresource_value_mutate_tags(). The resulting values
+   must be the same. */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lcfg/resources.h>
+
+static double elapsed( const struct timespec * start ) {
+  struct timespec end;
+  clock_gettime( CLOCK_MONOTONIC, &end );
+  return ( end.tv_sec - start->tv_sec ) * 1e3 +
+         ( end.tv_nsec - start->tv_nsec ) / 1e6;
+}
+
+static LCFGResource * make_list(void) {
+
+  LCFGResource * res = lcfgresource_new();
+  if ( !lcfgresource_set_type( res, LCFG_RESOURCE_TYPE_LIST ) ) {
+    fprintf( stderr, "Failed to create resource\n" );
+    exit(EXIT_FAILURE);
+  }
+
+  return res;
+}
+
+int main(int argc, char *argv[]) {
+
+  unsigned int size = argc > 1 ? atoi(argv[1]) : 5000;
+
+  char ** tags = calloc( size, sizeof(char *) );
+  LCFGTagMutation * mutations = calloc( size + size / 2,
+                                        sizeof(LCFGTagMutation) );
+  if ( tags == NULL || mutations == NULL ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int i;
+  for ( i=0; i<size; i++ ) {
+    if ( asprintf( &tags[i], "tag%u", i ) < 0 ) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  size_t count = 0;
+  for ( i=0; i<size; i++ ) {
+    mutations[count].type = LCFG_TAG_MUTATE_ADD;
+    mutations[count].tags = tags[i];
+    count++;
+  }
+  for ( i=0; i<size; i+=2 ) {
+    mutations[count].type = LCFG_TAG_MUTATE_REMOVE;
+    mutations[count].tags = tags[i];
+    count++;
+  }
+
+  bool ok = true;
+
+  LCFGResource * res1 = make_list();
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  for ( i=0; ok && i<count; i++ ) {
+    if ( mutations[i].type == LCFG_TAG_MUTATE_ADD )
+      ok = lcfgresource_value_add_tag( res1, mutations[i].tags );
+    else
+      ok = lcfgresource_value_remove_tag( res1, mutations[i].tags );
+  }
+
+  printf( "individual: %10.3f ms for %zu mutations\n", elapsed(&start),
+          count );
+
+  LCFGResource * res2 = make_list();
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  if ( !lcfgresource_value_mutate_tags( res2, mutations, count ) )
+    ok = false;
+
+  printf( "batch:      %10.3f ms for %zu mutations\n", elapsed(&start),
+          count );
+
+  if ( !ok || lcfgresource_value_tag_count(res1) !=
+              lcfgresource_value_tag_count(res2) ) {
+    fprintf( stderr, "Mutation results were incorrect\n" );
+    ok = false;
+  }
+
+  lcfgresource_relinquish(res1);
+  lcfgresource_relinquish(res2);
+
+  for ( i=0; i<size; i++ )
+    free(tags[i]);
+  free(tags);
+  free(mutations);
+
+  return ( ok ? 0 : 1 );
+}
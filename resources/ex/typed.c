@@ -0,0 +1,194 @@
+/* Benchmark for typed access to resource values
+
+   Builds a set of integer, boolean and list resources (default 1000
+   of each, lists have 8 tags by default) and times repeatedly
+   converting the values with strtol(3) and searching the list values
+   for tags, compared with the cached typed views provided by
+   lcfgresource_get_integer(), lcfgresource_is_true() and
+   lcfgresource_value_has_tag(). The results must be the same for
+   both. */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lcfg/resources.h>
+#include <lcfg/utils.h>
+
+static char * make_list( unsigned int id, unsigned int ntags ) {
+
+  size_t size = ntags * 16 + 1;
+  char * value = calloc( size, sizeof(char) );
+  if ( value == NULL ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  size_t len = 0;
+  unsigned int i;
+  for ( i=0; i<ntags; i++ )
+    len += snprintf( value + len, size - len, "%stag%u_%u",
+                     ( i == 0 ? "" : " " ), i, ( id + i ) % 7 );
+
+  return value;
+}
+
+static LCFGResource * make_resource( LCFGResourceType type,
+                                     unsigned int id,
+                                     unsigned int ntags ) {
+
+  LCFGResource * res = lcfgresource_new();
+
+  char * value = NULL;
+  int rc = 0;
+  switch (type) {
+  case LCFG_RESOURCE_TYPE_INTEGER:
+    rc = asprintf( &value, "%u", id * 7919 );
+    break;
+  case LCFG_RESOURCE_TYPE_BOOLEAN:
+    rc = asprintf( &value, "%s", id % 3 == 0 ? "yes" : "" );
+    break;
+  default:
+    value = make_list( id, ntags );
+    break;
+  }
+
+  if ( rc < 0 ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  if ( !lcfgresource_set_type( res, type ) ||
+       !lcfgresource_set_value( res, value ) ) {
+    fprintf( stderr, "Failed to create resource\n" );
+    exit(EXIT_FAILURE);
+  }
+
+  return res;
+}
+
+static double elapsed( const struct timespec * start ) {
+  struct timespec end;
+  clock_gettime( CLOCK_MONOTONIC, &end );
+  return ( end.tv_sec - start->tv_sec ) * 1e3 +
+         ( end.tv_nsec - start->tv_nsec ) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+
+  unsigned int size   = argc > 1 ? atoi(argv[1]) : 1000;
+  unsigned int rounds = argc > 2 ? atoi(argv[2]) : 1000;
+  unsigned int ntags  = argc > 3 ? atoi(argv[3]) : 8;
+
+  LCFGResource ** ints  = calloc( size, sizeof(LCFGResource *) );
+  LCFGResource ** bools = calloc( size, sizeof(LCFGResource *) );
+  LCFGResource ** lists = calloc( size, sizeof(LCFGResource *) );
+  if ( ints == NULL || bools == NULL || lists == NULL ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int i;
+  for ( i=0; i<size; i++ ) {
+    ints[i]  = make_resource( LCFG_RESOURCE_TYPE_INTEGER, i, ntags );
+    bools[i] = make_resource( LCFG_RESOURCE_TYPE_BOOLEAN, i, ntags );
+    lists[i] = make_resource( LCFG_RESOURCE_TYPE_LIST,    i, ntags );
+  }
+
+  const char * wanted[] = { "tag0_3", "tag5_1", "tag7_0", "missing" };
+  const unsigned int nwanted = sizeof(wanted) / sizeof(wanted[0]);
+
+  bool ok = true;
+  long long int sum1 = 0, sum2 = 0;
+  unsigned long count1 = 0, count2 = 0;
+  unsigned int round;
+
+  struct timespec start;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ )
+      sum1 += strtol( lcfgresource_get_value(ints[i]), NULL, 10 );
+  }
+  printf( "strtol:        %8.1f ns/resource\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      int64_t value;
+      if ( lcfgresource_get_integer( ints[i], &value ) )
+        sum2 += value;
+    }
+  }
+  printf( "get_integer:   %8.1f ns/resource\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  if ( sum1 != sum2 ) ok = false;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      const char * value = lcfgresource_get_value(bools[i]);
+      if ( value != NULL && strcmp( value, "yes" ) == 0 )
+        count1++;
+    }
+  }
+  printf( "strcmp:        %8.1f ns/resource\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      if ( lcfgresource_is_true(bools[i]) )
+        count2++;
+    }
+  }
+  printf( "is_true:       %8.1f ns/resource\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  if ( count1 != count2 ) ok = false;
+
+  count1 = count2 = 0;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      if ( lcfgutils_string_hasitem( lcfgresource_get_value(lists[i]),
+                                     wanted[i % nwanted], " \t\r\n" ) )
+        count1++;
+    }
+  }
+  printf( "search tag:    %8.1f ns/resource\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  for ( round=0; round<rounds; round++ ) {
+    for ( i=0; i<size; i++ ) {
+      if ( lcfgresource_value_has_tag( lists[i], wanted[i % nwanted] ) )
+        count2++;
+    }
+  }
+  printf( "has_tag:       %8.1f ns/resource\n",
+          elapsed(&start) * 1e6 / rounds / size );
+
+  if ( count1 != count2 ) ok = false;
+
+  if ( !ok )
+    fprintf( stderr, "Typed results were incorrect\n" );
+
+  for ( i=0; i<size; i++ ) {
+    lcfgresource_relinquish(ints[i]);
+    lcfgresource_relinquish(bools[i]);
+    lcfgresource_relinquish(lists[i]);
+  }
+  free(ints);
+  free(bools);
+  free(lists);
+
+  return ( ok ? 0 : 1 );
+}
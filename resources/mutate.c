@@ -9,6 +9,7 @@
 
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -75,6 +76,10 @@ static const char * lcfgresource_value_find_tag( const LCFGResource * res,
  * valid LCFG tag name (see the lcfgresource_valid_tag() function docs
  * for details).
  *
+ * For a list resource the positions of the tags in the value are
+ * held in the resource so repeated checks do not need to search the
+ * whole value string.
+ *
  * @param res Pointer to @c LCFGResource
  * @param tag Tag to check for in the resource value
  *
@@ -83,7 +88,16 @@ static const char * lcfgresource_value_find_tag( const LCFGResource * res,
  */
 
 bool lcfgresource_value_has_tag( const LCFGResource * res, const char * tag ) {
-  return ( tag != NULL && lcfgresource_value_find_tag( res, tag ) != NULL );
+
+  if ( tag == NULL ) return false;
+
+  /* Anything which is not a simple tag has to be found by searching
+     the value, otherwise the tag offsets are used. */
+
+  if ( *tag == '\0' || strpbrk( tag, allowed_separators ) != NULL )
+    return ( lcfgresource_value_find_tag( res, tag ) != NULL );
+
+  return ( lcfgresource_value_tag_position( res, tag ) >= 0 );
 }
 
 /**
@@ -121,18 +135,19 @@ bool lcfgresource_value_replace_tag( LCFGResource * res,
   /* Cannot replace an empty old tag */
   if ( isempty(old_tag) ) return false;
 
-  if ( strcmp( old_tag, new_tag ) == 0 ) return true;
+  /* If the 'new' tag is empty then this becomes a "removal" operation. */
+
+  bool removal = isempty(new_tag);
+
+  if ( !removal && strcmp( old_tag, new_tag ) == 0 ) return true;
 
   /* Will not replace bad values into a tag list */
-  if ( lcfgresource_is_list(res) && !lcfgresource_valid_list(new_tag) ) {
+  if ( !removal && lcfgresource_is_list(res) &&
+       !lcfgresource_valid_list(new_tag) ) {
     errno = EINVAL;
     return false;
   }
 
-  /* If the 'new' tag is empty then this becomes a "removal" operation. */
-
-  bool removal = isempty(new_tag);
-
   /* Check if there is currently a value */
 
   if ( !lcfgresource_has_value(res) ) {
@@ -652,19 +667,20 @@ bool lcfgresource_value_replace( LCFGResource * res,
   /* Cannot replace an empty old value */
   if ( isempty(old_string) ) return false;
 
-  if ( strcmp( old_string, new_string ) == 0 ) return true;
+  /* If the 'new' string is empty then this becomes a "removal"
+     operation. */
+
+  bool removal = isempty(new_string);
+
+  if ( !removal && strcmp( old_string, new_string ) == 0 ) return true;
 
   /* Will not replace bad values into a tag list */
-  if ( lcfgresource_is_list(res) && !lcfgresource_valid_list(new_string) ) {
+  if ( !removal && lcfgresource_is_list(res) &&
+       !lcfgresource_valid_list(new_string) ) {
     errno = EINVAL;
     return false;
   }
 
-  /* If the 'new' string is empty then this becomes a "removal"
-     operation. */
-
-  bool removal = isempty(new_string);
-
   /* Check if there is currently a value */
 
   if ( !lcfgresource_has_value(res) ) {
@@ -747,4 +763,487 @@ bool lcfgresource_value_remove( LCFGResource * res,
   return lcfgresource_value_replace( res, unwanted_string, NULL );
 }
 
+/* Batched tag mutations
+
+   The tags are held in a working vector of spans which point either
+   into the original value or into the strings for the mutations so
+   that no tag is copied until the new value is built. Prepended tags
+   are held in a separate vector (in reverse order) so that both
+   appending and prepending are amortised constant time. A hash table
+   maps each tag to its positions in the vectors so the first instance
+   of a tag can be found without scanning the whole list. */
+
+struct LCFGTagSpan {
+  const char * str;
+  size_t len;
+  uint32_t hash;
+  bool live;
+};
+
+struct LCFGTagSpanVector {
+  struct LCFGTagSpan * items;
+  size_t size;
+  size_t capacity;
+};
+
+/* References in the table are encoded as a signed integer, positive
+   values are the position in the back vector plus one, negative
+   values are the position in the front vector plus one (negated) and
+   zero marks an empty slot. Ordering of the references is simply the
+   ordering of the integers after subtracting one from the positive
+   values. */
+
+struct LCFGTagWork {
+  struct LCFGTagSpanVector front;
+  struct LCFGTagSpanVector back;
+  size_t original;        /* Number of tags in the original value */
+  bool rebuild;           /* Original tags have been altered */
+  long * table;
+  size_t table_size;
+  size_t table_used;
+};
+
+static uint32_t lcfgtagwork_hash( const char * str, size_t len ) {
+
+  uint32_t hash = 5381;
+
+  size_t i;
+  for ( i=0; i<len; i++ )
+    hash = ( ( hash << 5 ) + hash ) + (unsigned char) str[i];
+
+  return hash;
+}
+
+static inline struct LCFGTagSpan * lcfgtagwork_span( struct LCFGTagWork * work,
+                                                     long ref ) {
+  return ( ref > 0 ? &( work->back.items[ref - 1] )
+                   : &( work->front.items[-ref - 1] ) );
+}
+
+static inline long lcfgtagwork_order( long ref ) {
+  return ( ref > 0 ? ref - 1 : ref );
+}
+
+static void lcfgtagwork_insert( struct LCFGTagWork * work, long ref );
+
+static void lcfgtagwork_grow_table( struct LCFGTagWork * work ) {
+
+  size_t new_size = work->table_size > 0 ? work->table_size * 2 : 64;
+
+  while ( new_size < 2 * ( work->front.size + work->back.size + 1 ) )
+    new_size *= 2;
+
+  free(work->table);
+
+  work->table = calloc( new_size, sizeof(long) );
+  if ( work->table == NULL ) {
+    perror("Failed to allocate memory for LCFG tag table");
+    exit(EXIT_FAILURE);
+  }
+
+  work->table_size = new_size;
+  work->table_used = 0;
+
+  /* Stale slots are dropped, only the live tags are added again */
+
+  size_t i;
+  for ( i=0; i<work->front.size; i++ ) {
+    if ( work->front.items[i].live )
+      lcfgtagwork_insert( work, -( (long) i + 1 ) );
+  }
+  for ( i=0; i<work->back.size; i++ ) {
+    if ( work->back.items[i].live )
+      lcfgtagwork_insert( work, (long) i + 1 );
+  }
+
+}
+
+static void lcfgtagwork_insert( struct LCFGTagWork * work, long ref ) {
+
+  if ( 2 * ( work->table_used + 1 ) > work->table_size )
+    lcfgtagwork_grow_table(work);
+
+  const struct LCFGTagSpan * span = lcfgtagwork_span( work, ref );
+
+  size_t mask = work->table_size - 1;
+  size_t slot = span->hash & mask;
+  while ( work->table[slot] != 0 )
+    slot = ( slot + 1 ) & mask;
+
+  work->table[slot] = ref;
+  work->table_used++;
+}
+
+/* Find the first live instance of a tag, returns zero if not found */
+
+static long lcfgtagwork_find( struct LCFGTagWork * work,
+                              const char * str, size_t len,
+                              uint32_t hash ) {
+
+  if ( work->table_size == 0 ) return 0;
+
+  long result = 0;
+
+  size_t mask = work->table_size - 1;
+  size_t slot = hash & mask;
+  while ( work->table[slot] != 0 ) {
+    long ref = work->table[slot];
+    const struct LCFGTagSpan * span = lcfgtagwork_span( work, ref );
+
+    if ( span->live && span->hash == hash && span->len == len &&
+         memcmp( span->str, str, len ) == 0 &&
+         ( result == 0 ||
+           lcfgtagwork_order(ref) < lcfgtagwork_order(result) ) )
+      result = ref;
+
+    slot = ( slot + 1 ) & mask;
+  }
+
+  return result;
+}
+
+static long lcfgtagwork_push( struct LCFGTagWork * work, bool front,
+                              const char * str, size_t len ) {
+
+  struct LCFGTagSpanVector * vec = front ? &(work->front) : &(work->back);
+
+  if ( vec->size == vec->capacity ) {
+    size_t new_capacity = vec->capacity > 0 ? vec->capacity * 2 : 16;
+
+    struct LCFGTagSpan * new_items =
+      realloc( vec->items, new_capacity * sizeof(struct LCFGTagSpan) );
+    if ( new_items == NULL ) {
+      perror("Failed to allocate memory for LCFG tag list");
+      exit(EXIT_FAILURE);
+    }
+
+    vec->items    = new_items;
+    vec->capacity = new_capacity;
+  }
+
+  struct LCFGTagSpan * span = &( vec->items[vec->size] );
+  span->str  = str;
+  span->len  = len;
+  span->hash = lcfgtagwork_hash( str, len );
+  span->live = true;
+
+  vec->size++;
+
+  long ref = front ? -( (long) vec->size ) : (long) vec->size;
+  lcfgtagwork_insert( work, ref );
+
+  return ref;
+}
+
+/* Calls the function for each tag in the string, for prepending the
+   tags are visited in reverse order so they end up in the original
+   order at the front of the list. */
+
+typedef bool (*LCFGTagWorkFunc)( struct LCFGTagWork * work,
+                                 const char * str, size_t len );
+
+static bool lcfgtagwork_each( struct LCFGTagWork * work,
+                              const char * tags, bool reverse,
+                              LCFGTagWorkFunc fn ) {
+
+  if ( isempty(tags) ) return true;
+
+  bool ok = true;
+
+  if ( !reverse ) {
+    const char * ptr = tags + strspn( tags, allowed_separators );
+    while ( ok && *ptr != '\0' ) {
+      size_t len = strcspn( ptr, allowed_separators );
+      ok = (*fn)( work, ptr, len );
+      ptr += len;
+      ptr += strspn( ptr, allowed_separators );
+    }
+  } else {
+    const char * end = tags + strlen(tags);
+    while ( ok && end > tags ) {
+      while ( end > tags && strchr( allowed_separators, *( end - 1 ) ) )
+        end--;
+
+      const char * start = end;
+      while ( start > tags && !strchr( allowed_separators, *( start - 1 ) ) )
+        start--;
+
+      if ( start < end )
+        ok = (*fn)( work, start, end - start );
+
+      end = start;
+    }
+  }
+
+  return ok;
+}
+
+static bool lcfgtagwork_append( struct LCFGTagWork * work,
+                                const char * str, size_t len ) {
+  lcfgtagwork_push( work, false, str, len );
+  return true;
+}
+
+static bool lcfgtagwork_prepend( struct LCFGTagWork * work,
+                                 const char * str, size_t len ) {
+  lcfgtagwork_push( work, true, str, len );
+  work->rebuild = true;
+  return true;
+}
+
+static bool lcfgtagwork_add( struct LCFGTagWork * work,
+                             const char * str, size_t len ) {
+
+  if ( lcfgtagwork_find( work, str, len, lcfgtagwork_hash( str, len ) ) == 0 )
+    lcfgtagwork_push( work, false, str, len );
+
+  return true;
+}
+
+static bool lcfgtagwork_remove( struct LCFGTagWork * work,
+                                const char * str, size_t len ) {
+
+  long ref = lcfgtagwork_find( work, str, len, lcfgtagwork_hash( str, len ) );
+  if ( ref != 0 ) {
+    lcfgtagwork_span( work, ref )->live = false;
+    work->rebuild = true;
+  }
+
+  return true;
+}
+
+static bool lcfgtagwork_replace( struct LCFGTagWork * work,
+                                 const char * old_tag,
+                                 const char * new_tag ) {
+
+  /* Cannot replace an empty old tag, the old and new tags must both be
+     single tags */
+
+  if ( isempty(old_tag) ||
+       strpbrk( old_tag, allowed_separators ) != NULL ||
+       ( new_tag != NULL && strpbrk( new_tag, allowed_separators ) != NULL ) ) {
+    errno = EINVAL;
+    return false;
+  }
+
+  size_t old_len = strlen(old_tag);
+
+  if ( isempty(new_tag) )
+    return lcfgtagwork_remove( work, old_tag, old_len );
+
+  long ref = lcfgtagwork_find( work, old_tag, old_len,
+                               lcfgtagwork_hash( old_tag, old_len ) );
+  if ( ref == 0 ) return false;
+
+  /* The slot for the old tag becomes stale, it is skipped by lookups
+     as the hash no longer matches. */
+
+  struct LCFGTagSpan * span = lcfgtagwork_span( work, ref );
+  span->str  = new_tag;
+  span->len  = strlen(new_tag);
+  span->hash = lcfgtagwork_hash( span->str, span->len );
+
+  lcfgtagwork_insert( work, ref );
+
+  work->rebuild = true;
+
+  return true;
+}
+
+static bool lcfgtagwork_apply( struct LCFGTagWork * work,
+                               const LCFGTagMutation * mutation ) {
+
+  bool ok = false;
+
+  switch (mutation->type) {
+  case LCFG_TAG_MUTATE_APPEND:
+    ok = lcfgtagwork_each( work, mutation->tags, false,
+                           &lcfgtagwork_append );
+    break;
+  case LCFG_TAG_MUTATE_PREPEND:
+    ok = lcfgtagwork_each( work, mutation->tags, true,
+                           &lcfgtagwork_prepend );
+    break;
+  case LCFG_TAG_MUTATE_ADD:
+    ok = lcfgtagwork_each( work, mutation->tags, false,
+                           &lcfgtagwork_add );
+    break;
+  case LCFG_TAG_MUTATE_REMOVE:
+    ok = lcfgtagwork_each( work, mutation->tags, false,
+                           &lcfgtagwork_remove );
+    break;
+  case LCFG_TAG_MUTATE_REPLACE:
+    ok = lcfgtagwork_replace( work, mutation->tags, mutation->new_tag );
+    break;
+  default:
+    errno = EINVAL;
+    break;
+  }
+
+  return ok;
+}
+
+/* The new value is built in a single allocation. When the original
+   tags are untouched it is copied verbatim (so any separators are
+   preserved) with the appended tags added at the end, otherwise the
+   live tags are joined with single spaces. */
+
+static char * lcfgtagwork_build( const struct LCFGTagWork * work,
+                                 const char * cur_value ) {
+
+  size_t cur_len = cur_value != NULL ? strlen(cur_value) : 0;
+
+  size_t first = 0;
+  size_t new_len = 0;
+  if ( !work->rebuild ) {
+    first   = work->original;
+    new_len = cur_len;
+  }
+
+  size_t i;
+  for ( i=0; i<work->front.size; i++ ) {
+    if ( work->front.items[i].live )
+      new_len += work->front.items[i].len + standard_sep_len;
+  }
+  for ( i=first; i<work->back.size; i++ ) {
+    if ( work->back.items[i].live )
+      new_len += work->back.items[i].len + standard_sep_len;
+  }
+
+  char * result = calloc( new_len + 1, sizeof(char) );
+  if ( result == NULL ) {
+    perror("Failed to allocate memory for LCFG resource value");
+    exit(EXIT_FAILURE);
+  }
+
+  char * to = result;
+
+  if ( !work->rebuild && cur_len > 0 )
+    to = stpncpy( to, cur_value, cur_len );
+
+  for ( i=work->front.size; i>0; i-- ) {
+    const struct LCFGTagSpan * span = &( work->front.items[i - 1] );
+    if ( span->live ) {
+      if ( to != result && strchr( allowed_separators, *( to - 1 ) ) == NULL )
+        to = stpncpy( to, standard_separator, standard_sep_len );
+      to = stpncpy( to, span->str, span->len );
+    }
+  }
+
+  for ( i=first; i<work->back.size; i++ ) {
+    const struct LCFGTagSpan * span = &( work->back.items[i] );
+    if ( span->live ) {
+      if ( to != result && strchr( allowed_separators, *( to - 1 ) ) == NULL )
+        to = stpncpy( to, standard_separator, standard_sep_len );
+      to = stpncpy( to, span->str, span->len );
+    }
+  }
+
+  *to = '\0';
+
+  assert( to <= result + new_len );
+
+  return result;
+}
+
+/**
+ * @brief Apply a sequence of tag mutations to the value for the resource
+ *
+ * This applies each of the mutations in turn to the value for the
+ * @c LCFGResource, the value is only split into tags once and the
+ * new value is only built once at the end. This is much more
+ * efficient than calling the individual functions (e.g. @c
+ * lcfgresource_value_add_tag() or @c lcfgresource_value_remove_tag()
+ * ) when many changes are made to a large list.
+ *
+ * The supported mutations are:
+ *
+ *   - @c LCFG_TAG_MUTATE_APPEND - append all the tags
+ *   - @c LCFG_TAG_MUTATE_PREPEND - prepend all the tags
+ *   - @c LCFG_TAG_MUTATE_ADD - append each tag which is not present
+ *   - @c LCFG_TAG_MUTATE_REMOVE - remove the first instance of each tag
+ *   - @c LCFG_TAG_MUTATE_REPLACE - replace the first instance of a
+ *     single tag with a new tag (or remove it when the new tag is
+ *     empty)
+ *
+ * Tags are compared as whole, whitespace-separated, words. When only
+ * tags are appended the original value is kept intact, otherwise the
+ * new value is the remaining tags separated by single spaces.
+ *
+ * If any mutation fails (e.g. a tag which is not valid for a list
+ * resource or a replacement of a tag which is not present) the value
+ * for the resource is not changed.
+ *
+ * @param res Pointer to @c LCFGResource
+ * @param mutations Array of @c LCFGTagMutation
+ * @param count Number of mutations in the array
+ *
+ * @return Boolean which indicates success
+ *
+ */
+
+bool lcfgresource_value_mutate_tags( LCFGResource * res,
+                                     const LCFGTagMutation * mutations,
+                                     size_t count ) {
+  assert( res != NULL );
+
+  /* Only valid for strings and lists */
+  if ( !lcfgresource_is_string(res) && !lcfgresource_is_list(res) ) {
+    errno = ENOTSUP;
+    return false;
+  }
+
+  /* Will not add bad values to a tag list */
+
+  size_t i;
+  if ( lcfgresource_is_list(res) ) {
+    for ( i=0; i<count; i++ ) {
+      const char * new_tags =
+        ( mutations[i].type == LCFG_TAG_MUTATE_REPLACE ?
+          mutations[i].new_tag : mutations[i].tags );
+
+      if ( !isempty(new_tags) && !lcfgresource_valid_list(new_tags) ) {
+        errno = EINVAL;
+        return false;
+      }
+    }
+  }
+
+  const char * cur_value = lcfgresource_get_value(res);
+
+  struct LCFGTagWork work;
+  memset( &work, 0, sizeof(work) );
+
+  lcfgtagwork_each( &work, cur_value, false, &lcfgtagwork_append );
+  work.original = work.back.size;
+
+  bool ok = true;
+  for ( i=0; ok && i<count; i++ )
+    ok = lcfgtagwork_apply( &work, &(mutations[i]) );
+
+  /* Nothing to do if the value is unchanged */
+
+  bool changed = ( work.rebuild || work.back.size > work.original );
+
+  if ( ok && changed ) {
+    char * result = lcfgtagwork_build( &work, cur_value );
+
+    if ( *result == '\0' ) {
+      free(result);
+      if ( cur_value != NULL )
+        ok = lcfgresource_unset_value(res);
+    } else {
+      ok = lcfgresource_set_value( res, result );
+      if ( !ok )
+        free(result);
+    }
+  }
+
+  free(work.front.items);
+  free(work.back.items);
+  free(work.table);
+
+  return ok;
+}
+
 /* eof */
@@ -11,6 +11,7 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -52,6 +53,73 @@ static const char * lcfgresource_type_names[] = {
  *
  */
 
+/* Flags recording which strings are stored in the inline space of
+   the resource or allocated from an arena rather than separately
+   allocated. The name is stored at the start of the inline space and
+   the value at the end. */
+
+#define LCFG_RESOURCE_NAME_INLINE     (1<<0)
+#define LCFG_RESOURCE_VALUE_INLINE    (1<<1)
+#define LCFG_RESOURCE_NAME_ARENA      (1<<2)
+#define LCFG_RESOURCE_VALUE_ARENA     (1<<3)
+#define LCFG_RESOURCE_CONTEXT_ARENA   (1<<4)
+#define LCFG_RESOURCE_COMMENT_ARENA   (1<<5)
+
+/* Typed views of the value which are computed whenever the value (or
+   type) changes. The integer and the tag offsets share storage so at
+   most one of those is held. */
+
+#define LCFG_RESOURCE_TRUTH_CACHED    (1<<6)
+#define LCFG_RESOURCE_TRUE            (1<<7)
+#define LCFG_RESOURCE_INT_CACHED      (1<<8)
+#define LCFG_RESOURCE_INT_VALID       (1<<9)
+#define LCFG_RESOURCE_TAGS_CACHED     (1<<10)
+
+#define LCFG_RESOURCE_NAME_STORED    ( LCFG_RESOURCE_NAME_INLINE  | LCFG_RESOURCE_NAME_ARENA )
+#define LCFG_RESOURCE_VALUE_STORED   ( LCFG_RESOURCE_VALUE_INLINE | LCFG_RESOURCE_VALUE_ARENA )
+
+#define lcfgresource_name_is_inline(RES)  ( (RES)->_flags & LCFG_RESOURCE_NAME_INLINE )
+#define lcfgresource_value_is_inline(RES) ( (RES)->_flags & LCFG_RESOURCE_VALUE_INLINE )
+
+#define LCFG_RESOURCE_TYPED_CACHED ( LCFG_RESOURCE_TRUTH_CACHED | LCFG_RESOURCE_TRUE | LCFG_RESOURCE_INT_CACHED | LCFG_RESOURCE_INT_VALID | LCFG_RESOURCE_TAGS_CACHED )
+
+static const char tag_separators[] = " \t\r\n";
+
+/* Attribute values shorter than this are copied into a buffer on the
+   stack when they are set from a string which is not null-terminated */
+
+#define LCFG_RESOURCE_ATTR_BUFFER 256
+
+/* The hash for each tag is stored so that a search only needs to
+   compare the value string when there is a likely match. Longer lists
+   also have an open-addressed table (which follows the tags in the
+   same allocation) mapping hashes to the position of the first
+   instance of each tag. */
+
+#define LCFG_RESOURCE_TAGS_LINEAR 8
+
+struct LCFGResourceTagIndex {
+  unsigned int count;
+  unsigned int mask;      /* Table size minus one, zero if no table */
+  unsigned int * table;   /* Tag position plus one, zero when empty */
+  struct {
+    unsigned int start;
+    unsigned int len;
+    uint32_t hash;
+  } tags[];
+};
+
+static inline uint32_t lcfgresource_tag_hash( const char * tag, size_t len ) {
+
+  uint32_t hash = 5381;
+
+  size_t i;
+  for ( i=0; i<len; i++ )
+    hash = ( ( hash << 5 ) + hash ) + (unsigned char) tag[i];
+
+  return hash;
+}
+
 LCFGResource * lcfgresource_new(void) {
 
   LCFGResource * res = malloc( sizeof(LCFGResource) );
@@ -70,11 +138,290 @@ LCFGResource * lcfgresource_new(void) {
   res->derivation = NULL;
   res->comment    = NULL;
   res->priority   = LCFG_RESOURCE_DEFAULT_PRIORITY;
+  res->_flags     = 0;
   res->_refcount  = 1;
+  res->_arena     = NULL;
+
+  res->_typed.tags = NULL;
 
   return res;
 }
 
+/**
+ * @brief Create and initialise a new resource in an arena
+ *
+ * This is similar to @c lcfgresource_new() except that the memory for
+ * the @c LCFGResource structure is taken from the specified @c
+ * LCFGResArena. Any strings which are later set for the name, value,
+ * context or comment and which are too long to be stored inline are
+ * also copied into the arena. The resource holds a reference to the
+ * arena which is released when the resource is destroyed.
+ *
+ * @param[in] arena Pointer to @c LCFGResArena
+ *
+ * @return Pointer to new @c LCFGResource
+ *
+ */
+
+LCFGResource * lcfgresource_arena_new( LCFGResArena * arena ) {
+  assert( arena != NULL );
+
+  LCFGResource * res = lcfgresarena_alloc( arena, sizeof(LCFGResource) );
+
+  res->type      = LCFG_RESOURCE_DEFAULT_TYPE;
+  res->priority  = LCFG_RESOURCE_DEFAULT_PRIORITY;
+  res->_arena    = arena;
+  res->_refcount = 1;
+
+  lcfgresarena_acquire(arena);
+
+  return res;
+}
+
+/* Discard any typed views of the value */
+
+static void lcfgresource_reset_typed( LCFGResource * res ) {
+
+  if ( res->_flags & LCFG_RESOURCE_TAGS_CACHED )
+    free(res->_typed.tags);
+
+  res->_typed.tags = NULL;
+  res->_flags &= ~LCFG_RESOURCE_TYPED_CACHED;
+}
+
+static bool lcfgresource_compute_truth( const LCFGResource * res ) {
+
+  bool is_true = false;
+
+  const char * value = res->value;
+  if ( !isempty(value) ) {
+
+    if ( lcfgresource_is_boolean(res) )
+      is_true = ( strcmp( value, "yes" ) == 0 );
+    else
+      is_true = ( strcmp( value, "0" ) != 0 );
+
+  }
+
+  return is_true;
+}
+
+static bool lcfgresource_parse_integer( const char * value,
+                                        int64_t * result ) {
+
+  if ( !lcfgresource_valid_integer(value) ) return false;
+
+  errno = 0;
+  long long int converted = strtoll( value, NULL, 10 );
+  if ( errno == ERANGE ) return false;
+
+  *result = converted;
+
+  return true;
+}
+
+/* Split the value into tags and record their offsets. Returns NULL
+   if there are no tags. */
+
+static struct LCFGResourceTagIndex * lcfgresource_build_tag_index( const char * value ) {
+
+  struct LCFGResourceTagIndex * index = NULL;
+
+  if ( !isempty(value) ) {
+
+    unsigned int count = 0;
+    const char * ptr = value + strspn( value, tag_separators );
+    while ( *ptr != '\0' ) {
+      count++;
+      ptr += strcspn( ptr, tag_separators );
+      ptr += strspn( ptr, tag_separators );
+    }
+
+    if ( count > 0 ) {
+
+      size_t table_size = 0;
+      if ( count > LCFG_RESOURCE_TAGS_LINEAR ) {
+        table_size = 16;
+        while ( table_size < 2 * count ) table_size *= 2;
+      }
+
+      index = calloc( 1, sizeof(struct LCFGResourceTagIndex) +
+                         count * sizeof(index->tags[0]) +
+                         table_size * sizeof(unsigned int) );
+      if ( index == NULL ) {
+        perror( "Failed to allocate memory for LCFG resource tags" );
+        exit(EXIT_FAILURE);
+      }
+
+      index->count = count;
+      if ( table_size > 0 ) {
+        index->mask  = table_size - 1;
+        index->table = (unsigned int *) &(index->tags[count]);
+      }
+
+      unsigned int i = 0;
+      ptr = value + strspn( value, tag_separators );
+      while ( *ptr != '\0' ) {
+        size_t len = strcspn( ptr, tag_separators );
+        index->tags[i].start = ptr - value;
+        index->tags[i].len   = len;
+        index->tags[i].hash  = lcfgresource_tag_hash( ptr, len );
+        i++;
+        ptr += len;
+        ptr += strspn( ptr, tag_separators );
+      }
+
+      /* Only the first instance of any repeated tag is added */
+
+      for ( i=0; index->table != NULL && i<count; i++ ) {
+        unsigned int slot = index->tags[i].hash & index->mask;
+        while ( index->table[slot] != 0 ) {
+          unsigned int other = index->table[slot] - 1;
+          if ( index->tags[other].hash == index->tags[i].hash &&
+               index->tags[other].len  == index->tags[i].len &&
+               memcmp( value + index->tags[other].start,
+                       value + index->tags[i].start,
+                       index->tags[i].len ) == 0 )
+            break;
+          slot = ( slot + 1 ) & index->mask;
+        }
+
+        if ( index->table[slot] == 0 )
+          index->table[slot] = i + 1;
+      }
+    }
+
+  }
+
+  return index;
+}
+
+/* Compute the typed views of the value, must be called whenever the
+   value or type is changed. These are filled in when the resource is
+   modified rather than when first requested so that readers never
+   alter a resource which might be shared between threads. The tag
+   offsets are only stored for list resources with a value which is
+   not an integer. */
+
+static void lcfgresource_update_typed( LCFGResource * res ) {
+
+  lcfgresource_reset_typed(res);
+
+  if ( lcfgresource_compute_truth(res) )
+    res->_flags |= LCFG_RESOURCE_TRUE;
+  res->_flags |= LCFG_RESOURCE_TRUTH_CACHED;
+
+  int64_t integer = 0;
+  if ( lcfgresource_parse_integer( res->value, &integer ) ) {
+    res->_flags |= ( LCFG_RESOURCE_INT_CACHED | LCFG_RESOURCE_INT_VALID );
+    res->_typed.integer = integer;
+  } else if ( lcfgresource_is_list(res) ) {
+    res->_flags |= LCFG_RESOURCE_TAGS_CACHED;
+    res->_typed.tags = lcfgresource_build_tag_index(res->value);
+  } else {
+    res->_flags |= LCFG_RESOURCE_INT_CACHED;
+  }
+
+}
+
+/* Strings which are stored inline or were allocated from an arena
+   are not freed, the memory is returned with the resource. */
+
+static void lcfgresource_free_string( LCFGResource * res, char ** value,
+                                      unsigned int stored ) {
+
+  if ( !( res->_flags & stored ) )
+    free(*value);
+
+  res->_flags &= ~stored;
+  *value = NULL;
+}
+
+/* Returns the place in the inline space where a string of the given
+   length would be stored (there must be room alongside the other
+   inline string) or NULL if it does not fit. The inline flag is zero
+   for attributes which are never stored inline. */
+
+static char * lcfgresource_inline_slot( const LCFGResource * res, size_t len,
+                                        unsigned int inline_flag ) {
+
+  char * result = NULL;
+
+  if ( inline_flag == LCFG_RESOURCE_NAME_INLINE ) {
+
+    size_t avail = LCFG_RESOURCE_INLINE_SIZE;
+    if ( lcfgresource_value_is_inline(res) )
+      avail -= strlen(res->value) + 1;
+
+    if ( len < avail )
+      result = (char *) res->_inline;
+
+  } else if ( inline_flag == LCFG_RESOURCE_VALUE_INLINE ) {
+
+    size_t avail = LCFG_RESOURCE_INLINE_SIZE;
+    if ( lcfgresource_name_is_inline(res) )
+      avail -= strlen(res->name) + 1;
+
+    if ( len < avail )
+      result = (char *) res->_inline + LCFG_RESOURCE_INLINE_SIZE - ( len + 1 );
+
+  }
+
+  return result;
+}
+
+/* Copies a string into storage for the resource, this is the inline
+   space if the string is short enough, otherwise the arena if the
+   resource has one, otherwise a new separate allocation. */
+
+static char * lcfgresource_store_string( LCFGResource * res,
+                                         const char * str, size_t len,
+                                         unsigned int inline_flag,
+                                         unsigned int arena_flag ) {
+
+  char * result = lcfgresource_inline_slot( res, len, inline_flag );
+
+  if ( result != NULL ) {
+    memcpy( result, str, len );
+    result[len] = '\0';
+    res->_flags |= inline_flag;
+  } else if ( res->_arena != NULL ) {
+    result = lcfgresarena_strndup( res->_arena, str, len );
+    res->_flags |= arena_flag;
+  } else {
+    result = strndup( str, len );
+    if ( result == NULL ) {
+      perror( "Failed to allocate memory for LCFG resource string" );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  return result;
+}
+
+/* When a resource takes ownership of a string it is copied into the
+   inline space or into the arena where possible and the original is
+   freed. Otherwise the string is used directly. */
+
+static char * lcfgresource_adopt_string( LCFGResource * res, char * str,
+                                         unsigned int inline_flag,
+                                         unsigned int arena_flag ) {
+
+  if ( str == NULL ) return NULL;
+
+  size_t len = strlen(str);
+
+  if ( res->_arena == NULL &&
+       lcfgresource_inline_slot( res, len, inline_flag ) == NULL )
+    return str;
+
+  char * result = lcfgresource_store_string( res, str, len,
+                                             inline_flag, arena_flag );
+  free(str);
+
+  return result;
+}
+
 /**
  * @brief Clone the resource
  *
@@ -246,25 +593,33 @@ void lcfgresource_destroy(LCFGResource * res) {
 
   if ( res == NULL ) return;
 
-  free(res->name);
-  res->name = NULL;
+  lcfgresource_reset_typed(res);
 
-  free(res->value);
-  res->value = NULL;
+  lcfgresource_free_string( res, &(res->name),  LCFG_RESOURCE_NAME_STORED );
+  lcfgresource_free_string( res, &(res->value), LCFG_RESOURCE_VALUE_STORED );
 
   lcfgtemplate_destroy(res->template);
   res->template = NULL;
 
-  free(res->context);
-  res->context = NULL;
+  lcfgresource_free_string( res, &(res->context),
+                            LCFG_RESOURCE_CONTEXT_ARENA );
 
   lcfgderivlist_relinquish(res->derivation);
   res->derivation = NULL;
 
-  free(res->comment);
-  res->comment = NULL;
+  lcfgresource_free_string( res, &(res->comment),
+                            LCFG_RESOURCE_COMMENT_ARENA );
+
+  /* A resource allocated from an arena is freed with the arena */
+
+  if ( res->_arena != NULL ) {
+    LCFGResArena * arena = res->_arena;
+    res->_arena = NULL;
+    lcfgresarena_relinquish(arena);
+  } else {
+    free(res);
+  }
 
-  free(res);
   res = NULL;
 
 }
@@ -391,9 +746,46 @@ bool lcfgresource_set_name( LCFGResource * res, char * new_name ) {
 
   bool ok = false;
   if ( lcfgresource_valid_name(new_name) ) {
-    free(res->name);
+    lcfgresource_free_string( res, &(res->name), LCFG_RESOURCE_NAME_STORED );
 
-    res->name = new_name;
+    res->name = lcfgresource_adopt_string( res, new_name,
+                                           LCFG_RESOURCE_NAME_INLINE,
+                                           LCFG_RESOURCE_NAME_ARENA );
+    ok = true;
+  } else {
+    errno = EINVAL;
+  }
+
+  return ok;
+}
+
+/**
+ * @brief Set the name for the resource from a copy
+ *
+ * This is similar to @c lcfgresource_set_name() except that the
+ * resource does NOT assume "ownership" of the string, a copy is
+ * taken. The copy is stored in the resource itself when the name is
+ * short or in the arena when the resource was allocated from one
+ * (see @c lcfgresource_arena_new() ), so loading a resource needs no
+ * separate allocation for the name.
+ *
+ * @param[in] res Pointer to an @c LCFGResource
+ * @param[in] new_name String which is the new name
+ *
+ * @return boolean indicating success
+ *
+ */
+
+bool lcfgresource_set_name_copy( LCFGResource * res, const char * new_name ) {
+  assert( res != NULL );
+
+  bool ok = false;
+  if ( lcfgresource_valid_name(new_name) ) {
+    lcfgresource_free_string( res, &(res->name), LCFG_RESOURCE_NAME_STORED );
+
+    res->name = lcfgresource_store_string( res, new_name, strlen(new_name),
+                                           LCFG_RESOURCE_NAME_INLINE,
+                                           LCFG_RESOURCE_NAME_ARENA );
     ok = true;
   } else {
     errno = EINVAL;
@@ -469,6 +861,7 @@ bool lcfgresource_set_type( LCFGResource * res, LCFGResourceType new_type ) {
        lcfgresource_valid_value_for_type( new_type, res->value ) ) {
 
     res->type = new_type;
+    lcfgresource_update_typed(res);
     ok = true;
   } else {
     errno = EINVAL;
@@ -745,6 +1138,10 @@ bool lcfgresource_is_list( const LCFGResource * res ) {
  * types of resource if the value is @c NULL, "" (empty string), or "0"
  * (zero) it will considered to be false and otherwise true.
  *
+ * The result is computed when the value or type is set so this is
+ * cheap and does not modify the resource, it is safe for several
+ * threads to call this for a shared resource.
+ *
  * @param[in] res Pointer to an @c LCFGResource
  *
  * @return boolean indicating if the value is true
@@ -753,19 +1150,10 @@ bool lcfgresource_is_list( const LCFGResource * res ) {
 bool lcfgresource_is_true( const LCFGResource * res ) {
   assert( res != NULL );
 
-  bool is_true = false;
-
-  const char * value = res->value;
-  if ( !isempty(value) ) {
-
-    if ( lcfgresource_is_boolean(res) )
-      is_true = ( strcmp( value, "yes" ) == 0 );
-    else
-      is_true = ( strcmp( value, "0" ) != 0 );
+  if ( res->_flags & LCFG_RESOURCE_TRUTH_CACHED )
+    return ( res->_flags & LCFG_RESOURCE_TRUE );
 
-  }
-
-  return is_true;
+  return lcfgresource_compute_truth(res);
 }
 
 /**
@@ -1128,7 +1516,10 @@ const char * lcfgresource_get_value( const LCFGResource * res ) {
   return res->value;
 }
 
-static const char unsafe_chars[] = "\r\n&";
+/* Finds the first of the unsafe characters (\r, \n and &) or the
+   terminating nul */
+
+#define lcfgresource_find_unsafe(STR) lcfgutils_string_scan3( STR, '\r', '\n', '&' )
 
 /**
  * Test if the resource values needs encoding in status files
@@ -1150,18 +1541,9 @@ bool lcfgresource_value_needs_encode( const LCFGResource * res ) {
 
   if ( !lcfgresource_has_value(res) ) return false;
 
-  bool needs_encode = false;
-
   const char * value = lcfgresource_get_value(res);
-  const char * ptr;
-  for ( ptr = value; *ptr != '\0'; ptr++ ) {
-    if ( strchr( unsafe_chars, *ptr ) ) {
-      needs_encode = true;
-      break;
-    }
-  }
 
-  return needs_encode;
+  return ( *lcfgresource_find_unsafe(value) != '\0' );
 }
 
 /**
@@ -1207,7 +1589,8 @@ char * lcfgresource_enc_value( const LCFGResource * res ) {
 
   size_t extend = 0;
   const char * ptr;
-  for ( ptr=value; *ptr!='\0'; ptr++ ) {
+  for ( ptr = lcfgresource_find_unsafe(value); *ptr != '\0';
+        ptr = lcfgresource_find_unsafe( ptr + 1 ) ) {
     switch(*ptr)
       {
       case '\r':
@@ -1236,7 +1619,15 @@ char * lcfgresource_enc_value( const LCFGResource * res ) {
 
   char * to = enc_value;
 
-  for ( ptr=value; *ptr!='\0'; ptr++ ) {
+  /* Runs of safe characters are copied in one go */
+
+  const char * from = value;
+  for ( ptr = lcfgresource_find_unsafe(value); *ptr != '\0';
+        ptr = lcfgresource_find_unsafe(from) ) {
+
+    memcpy( to, from, ptr - from );
+    to += ptr - from;
+
     switch(*ptr)
       {
       case '\r':
@@ -1248,12 +1639,14 @@ char * lcfgresource_enc_value( const LCFGResource * res ) {
       case '&':
 	to = stpncpy( to, amp, amp_len );
 	break;
-      default:
-	*to = *ptr;
-	to++;
       }
+
+    from = ptr + 1;
   }
 
+  memcpy( to, from, ptr - from );
+  to += ptr - from;
+
   *to = '\0';
 
   assert( ( enc_value + new_len ) == to );
@@ -1546,9 +1939,49 @@ bool lcfgresource_set_value( LCFGResource * res, char * new_value ) {
 
   bool ok = false;
   if ( lcfgresource_valid_value( res, new_value ) ) {
-    free(res->value);
+    lcfgresource_free_string( res, &(res->value), LCFG_RESOURCE_VALUE_STORED );
+
+    res->value = lcfgresource_adopt_string( res, new_value,
+                                            LCFG_RESOURCE_VALUE_INLINE,
+                                            LCFG_RESOURCE_VALUE_ARENA );
+    lcfgresource_update_typed(res);
+    ok = true;
+  } else {
+    errno = EINVAL;
+  }
+
+  return ok;
+}
 
-    res->value = new_value;
+/**
+ * @brief Set the value for the resource from a copy
+ *
+ * This is similar to @c lcfgresource_set_value() except that the
+ * resource does NOT assume "ownership" of the string, a copy is
+ * taken. The copy is stored in the resource itself when the value is
+ * short or in the arena when the resource was allocated from one
+ * (see @c lcfgresource_arena_new() ), so loading a resource needs no
+ * separate allocation for the value.
+ *
+ * @param[in] res Pointer to an @c LCFGResource
+ * @param[in] new_value String which is the new value
+ *
+ * @return boolean indicating success
+ *
+ */
+
+bool lcfgresource_set_value_copy( LCFGResource * res,
+                                  const char * new_value ) {
+  assert( res != NULL );
+
+  bool ok = false;
+  if ( new_value != NULL && lcfgresource_valid_value( res, new_value ) ) {
+    lcfgresource_free_string( res, &(res->value), LCFG_RESOURCE_VALUE_STORED );
+
+    res->value = lcfgresource_store_string( res, new_value, strlen(new_value),
+                                            LCFG_RESOURCE_VALUE_INLINE,
+                                            LCFG_RESOURCE_VALUE_ARENA );
+    lcfgresource_update_typed(res);
     ok = true;
   } else {
     errno = EINVAL;
@@ -1577,12 +2010,208 @@ bool lcfgresource_set_value( LCFGResource * res, char * new_value ) {
 bool lcfgresource_unset_value( LCFGResource * res ) {
   assert( res != NULL );
 
-  free(res->value);
-  res->value = NULL;
+  lcfgresource_free_string( res, &(res->value), LCFG_RESOURCE_VALUE_STORED );
+  lcfgresource_update_typed(res);
 
   return true;
 }
 
+/* Typed values */
+
+/**
+ * @brief Get the value of the resource as an integer
+ *
+ * If the value for the @c LCFGResource is a valid LCFG integer (see
+ * @c lcfgresource_valid_integer() for details) which fits into a
+ * 64-bit signed integer then it will be stored in the @c result and
+ * true is returned. This works for resources of any type which have
+ * an integer value.
+ *
+ * The value is converted when it is set so this is cheap and does
+ * not modify the resource, it is safe for several threads to call
+ * this for a shared resource. This is the preferred alternative to
+ * repeatedly calling @c atoi(3) or @c strtol(3) on the value.
+ *
+ * @param[in] res Pointer to an @c LCFGResource
+ * @param[out] result Pointer to an integer in which to store the value
+ *
+ * @return boolean indicating if the value is an integer
+ *
+ */
+
+bool lcfgresource_get_integer( const LCFGResource * res, int64_t * result ) {
+  assert( res != NULL );
+  assert( result != NULL );
+
+  if ( res->_flags & LCFG_RESOURCE_INT_CACHED ) {
+    bool valid = ( res->_flags & LCFG_RESOURCE_INT_VALID );
+    if ( valid ) *result = res->_typed.integer;
+    return valid;
+  }
+
+  /* The tag offsets are only held when the value is not an integer */
+
+  if ( res->_flags & LCFG_RESOURCE_TAGS_CACHED ) return false;
+
+  return lcfgresource_parse_integer( res->value, result );
+}
+
+/* The tag offsets for list resources are held in the resource, for
+   other types a temporary index is built which must be freed by the
+   caller. */
+
+static const struct LCFGResourceTagIndex * lcfgresource_tag_index( const LCFGResource * res,
+                                                                    struct LCFGResourceTagIndex ** temp ) {
+
+  if ( res->_flags & LCFG_RESOURCE_TAGS_CACHED )
+    return res->_typed.tags;
+
+  *temp = lcfgresource_build_tag_index(res->value);
+
+  return *temp;
+}
+
+/**
+ * @brief Get the number of tags in the value of the resource
+ *
+ * A @e tag is a sub-string of the value which is separated by
+ * whitespace, this is mostly useful for @e list resources. For a
+ * list resource the offsets of the tags are computed when the value
+ * is set, individual tags can then be accessed using
+ * @c lcfgresource_value_get_tag() without splitting the value again.
+ * For other types of resource the value is split on each call. The
+ * resource is not modified so it is safe for several threads to call
+ * this for a shared resource.
+ *
+ * @param[in] res Pointer to an @c LCFGResource
+ *
+ * @return Number of tags in the value
+ *
+ */
+
+unsigned int lcfgresource_value_tag_count( const LCFGResource * res ) {
+  assert( res != NULL );
+
+  if ( res->_flags & LCFG_RESOURCE_INT_VALID ) return 1;
+
+  struct LCFGResourceTagIndex * temp = NULL;
+  const struct LCFGResourceTagIndex * index =
+    lcfgresource_tag_index( res, &temp );
+
+  unsigned int count = ( index != NULL ? index->count : 0 );
+
+  free(temp);
+
+  return count;
+}
+
+/**
+ * @brief Get a tag from the value of the resource
+ *
+ * Returns a pointer to the start of the specified tag within the
+ * value for the @c LCFGResource and stores the length of the tag in
+ * @c len. Note that the tag is @b NOT nul-terminated, it is followed
+ * by the rest of the value. The pointer is only valid until the value
+ * of the resource is changed. See @c lcfgresource_value_tag_count()
+ * for details.
+ *
+ * @param[in] res Pointer to an @c LCFGResource
+ * @param[in] index Position of the required tag (starting from zero)
+ * @param[out] len Pointer to where the length of the tag is stored
+ *
+ * @return Pointer to the start of the tag or @c NULL if the index is out of range
+ *
+ */
+
+const char * lcfgresource_value_get_tag( const LCFGResource * res,
+                                         unsigned int index,
+                                         size_t * len ) {
+  assert( res != NULL );
+  assert( len != NULL );
+
+  if ( res->_flags & LCFG_RESOURCE_INT_VALID ) {
+    if ( index != 0 ) return NULL;
+
+    *len = strlen(res->value);
+    return res->value;
+  }
+
+  struct LCFGResourceTagIndex * temp = NULL;
+  const struct LCFGResourceTagIndex * tags =
+    lcfgresource_tag_index( res, &temp );
+
+  const char * tag = NULL;
+  if ( tags != NULL && index < tags->count ) {
+    *len = tags->tags[index].len;
+    tag  = res->value + tags->tags[index].start;
+  }
+
+  free(temp);
+
+  return tag;
+}
+
+/**
+ * @brief Find the position of a tag in the value of the resource
+ *
+ * Searches the tags in the value for the @c LCFGResource (see @c
+ * lcfgresource_value_tag_count() for details) for one which exactly
+ * matches the specified string. For a list resource the tag offsets
+ * computed when the value was set are used so the value is not split
+ * again.
+ *
+ * @param[in] res Pointer to an @c LCFGResource
+ * @param[in] tag The tag to be found
+ *
+ * @return Position of the first matching tag or -1 if not found
+ *
+ */
+
+ssize_t lcfgresource_value_tag_position( const LCFGResource * res,
+                                         const char * tag ) {
+  assert( res != NULL );
+  assert( tag != NULL );
+
+  if ( res->_flags & LCFG_RESOURCE_INT_VALID )
+    return ( strcmp( res->value, tag ) == 0 ? 0 : -1 );
+
+  struct LCFGResourceTagIndex * temp = NULL;
+  const struct LCFGResourceTagIndex * index =
+    lcfgresource_tag_index( res, &temp );
+  if ( index == NULL ) return -1;
+
+  size_t tag_len = strlen(tag);
+  uint32_t hash  = lcfgresource_tag_hash( tag, tag_len );
+
+  ssize_t position = -1;
+
+  if ( index->table != NULL ) {
+    unsigned int slot = hash & index->mask;
+    while ( index->table[slot] != 0 ) {
+      unsigned int i = index->table[slot] - 1;
+      if ( index->tags[i].hash == hash && index->tags[i].len == tag_len &&
+           memcmp( res->value + index->tags[i].start, tag, tag_len ) == 0 ) {
+        position = i;
+        break;
+      }
+      slot = ( slot + 1 ) & index->mask;
+    }
+  } else {
+    unsigned int i;
+    for ( i=0; i<index->count; i++ ) {
+      if ( index->tags[i].hash == hash && index->tags[i].len == tag_len &&
+           memcmp( res->value + index->tags[i].start, tag, tag_len ) == 0 ) {
+        position = i;
+        break;
+      }
+    }
+  }
+
+  free(temp);
+
+  return position;
+}
+
 /* Derivations */
 
 /**
@@ -1994,9 +2623,11 @@ bool lcfgresource_set_context( LCFGResource * res, char * new_ctx ) {
 
   bool ok = false;
   if ( new_ctx == NULL || lcfgresource_valid_context(new_ctx) ) {
-    free(res->context);
+    lcfgresource_free_string( res, &(res->context),
+                              LCFG_RESOURCE_CONTEXT_ARENA );
 
-    res->context = new_ctx;
+    res->context = lcfgresource_adopt_string( res, new_ctx, 0,
+                                              LCFG_RESOURCE_CONTEXT_ARENA );
     ok = true;
   } else {
     errno = EINVAL;
@@ -2032,14 +2663,27 @@ bool lcfgresource_add_context( LCFGResource * res,
 
   if ( isempty(extra_context) ) return true;
 
-  char * new_context;
+  /* When there is no existing context the new string is copied
+     directly into the storage for the resource */
+
   if ( !lcfgresource_has_context(res) ) {
-    new_context = strdup(extra_context);
-  } else {
-    new_context =
-      lcfgcontext_combine_expressions( res->context, extra_context );
+    if ( !lcfgresource_valid_context(extra_context) ) {
+      errno = EINVAL;
+      return false;
+    }
+
+    lcfgresource_free_string( res, &(res->context),
+                              LCFG_RESOURCE_CONTEXT_ARENA );
+
+    res->context = lcfgresource_store_string( res, extra_context,
+                                              strlen(extra_context), 0,
+                                              LCFG_RESOURCE_CONTEXT_ARENA );
+    return true;
   }
 
+  char * new_context =
+    lcfgcontext_combine_expressions( res->context, extra_context );
+
   bool ok = lcfgresource_set_context( res, new_context );
   if ( !ok )
     free(new_context);
@@ -2114,9 +2758,11 @@ const char * lcfgresource_get_comment( const LCFGResource * res ) {
 bool lcfgresource_set_comment( LCFGResource * res, char * new_comment ) {
   assert( res != NULL );
 
-  free(res->comment);
+  lcfgresource_free_string( res, &(res->comment),
+                            LCFG_RESOURCE_COMMENT_ARENA );
 
-  res->comment = new_comment;
+  res->comment = lcfgresource_adopt_string( res, new_comment, 0,
+                                            LCFG_RESOURCE_COMMENT_ARENA );
 
   return true;
 }
@@ -3893,8 +4539,8 @@ int lcfgresource_compare_values( const LCFGResource * res1,
   if ( lcfgresource_is_boolean(res1) &&
        lcfgresource_same_type( res1, res2 ) ) {
 
-    bool value1_istrue = ( strcmp( value1_str, "yes" ) == 0 );
-    bool value2_istrue = ( strcmp( value2_str, "yes" ) == 0 );
+    bool value1_istrue = lcfgresource_is_true(res1);
+    bool value2_istrue = lcfgresource_is_true(res2);
 
     /* true is greater than false */
 
@@ -3909,10 +4555,11 @@ int lcfgresource_compare_values( const LCFGResource * res1,
   } else if ( lcfgresource_is_integer(res1) &&
               lcfgresource_same_type( res1, res2 ) ) {
 
-    /* If value cannot be converted to integer will return zero */
+    /* If value cannot be converted to integer will use zero */
 
-    long int value1 = strtol( value1_str, NULL, 10 );
-    long int value2 = strtol( value2_str, NULL, 10 );
+    int64_t value1 = 0, value2 = 0;
+    if ( !lcfgresource_get_integer( res1, &value1 ) ) value1 = 0;
+    if ( !lcfgresource_get_integer( res2, &value2 ) ) value2 = 0;
 
     result = ( value1 == value2 ? 0 : ( value1 > value2 ? 1 : -1 ) );
 
@@ -4423,6 +5070,188 @@ ssize_t lcfgresource_build_key( const char * resource,
   return ( write_len == need_len ? write_len : -1 );
 }
 
+/**
+ * @brief Initialise a buffer for building resource keys
+ *
+ * Sets up an @c LCFGResourceKeyBuffer for building the keys for the
+ * resources of a component. The @c namespace.component. prefix is
+ * computed and stored only once so that building the key for each
+ * resource only requires the resource name to be copied into the
+ * buffer with @c lcfgresource_keybuf_set_name(). The keys for each of
+ * the resource attributes (e.g. derivation, type and value) can then
+ * be retrieved using @c lcfgresource_keybuf_get_key() without any
+ * further copying. The keys are identical to those generated by
+ * @c lcfgresource_build_key().
+ *
+ * The first character of the buffer is reserved for the type symbol,
+ * the key for a value does not have a type symbol so in that case it
+ * starts at the second character.
+ *
+ * When no longer required the memory should be freed using
+ * @c lcfgresource_keybuf_clear().
+ *
+ * @param[in] keybuf Pointer to @c LCFGResourceKeyBuffer
+ * @param[in] component Name of component (optional)
+ * @param[in] namespace Namespace, typically a hostname (optional)
+ *
+ */
+
+void lcfgresource_keybuf_init( LCFGResourceKeyBuffer * keybuf,
+                               const char * component,
+                               const char * namespace ) {
+  assert( keybuf != NULL );
+
+  size_t ns_len   = isempty(namespace) ? 0 : strlen(namespace);
+  size_t comp_len = isempty(component) ? 0 : strlen(component);
+
+  keybuf->prefix_len = 1; /* type symbol */
+  if ( ns_len > 0 )
+    keybuf->prefix_len += ( ns_len + 1 ); /* +1 for '.' (period) separator */
+  if ( comp_len > 0 )
+    keybuf->prefix_len += ( comp_len + 1 ); /* +1 for '.' (period) separator */
+
+  keybuf->name_len = 0;
+  keybuf->size     = keybuf->prefix_len + 64;
+  keybuf->buffer   = calloc( keybuf->size, sizeof(char) );
+  if ( keybuf->buffer == NULL ) {
+    perror("Failed to allocate memory for LCFG resource key");
+    exit(EXIT_FAILURE);
+  }
+
+  char * to = keybuf->buffer + 1;
+
+  if ( ns_len > 0 ) {
+    memcpy( to, namespace, ns_len );
+    to += ns_len;
+    *to = '.';
+    to++;
+  }
+
+  if ( comp_len > 0 ) {
+    memcpy( to, component, comp_len );
+    to += comp_len;
+    *to = '.';
+    to++;
+  }
+
+  *to = '\0';
+}
+
+/**
+ * @brief Set the resource name in a key buffer
+ *
+ * Copies the resource name into the @c LCFGResourceKeyBuffer after
+ * the @c namespace.component. prefix, the buffer will be resized if
+ * necessary. The keys for the resource can then be retrieved using
+ * @c lcfgresource_keybuf_get_key().
+ *
+ * If the resource name is empty this function will return -1.
+ *
+ * @param[in] keybuf Pointer to @c LCFGResourceKeyBuffer
+ * @param[in] resource Name of resource (required)
+ *
+ * @return Length of the key for the value (or -1 for an error)
+ *
+ */
+
+ssize_t lcfgresource_keybuf_set_name( LCFGResourceKeyBuffer * keybuf,
+                                      const char * resource ) {
+  assert( keybuf != NULL );
+  assert( keybuf->buffer != NULL );
+
+  keybuf->name_len = 0;
+
+  if ( isempty(resource) ) return -1;
+
+  size_t len = strlen(resource);
+
+  size_t need_size = keybuf->prefix_len + len + 1;
+  if ( keybuf->size < need_size ) {
+
+    char * new_buf = realloc( keybuf->buffer, ( need_size * sizeof(char) ) );
+    if ( new_buf == NULL ) {
+      perror("Failed to allocate memory for LCFG resource key");
+      exit(EXIT_FAILURE);
+    } else {
+      keybuf->buffer = new_buf;
+      keybuf->size   = need_size;
+    }
+
+  }
+
+  memcpy( keybuf->buffer + keybuf->prefix_len, resource, len + 1 );
+  keybuf->name_len = len;
+
+  return ( keybuf->prefix_len - 1 + len );
+}
+
+/**
+ * @brief Get a resource key from a key buffer
+ *
+ * Returns the key for the current resource name in the
+ * @c LCFGResourceKeyBuffer with the specified type symbol (e.g. @c '%',
+ * @c '#' or @c '^'). For the value the type symbol should be nul. The
+ * key is nul-terminated and remains valid until the resource name is
+ * next changed with @c lcfgresource_keybuf_set_name(), note that the
+ * type symbol is shared so only one of the non-value keys can be used
+ * at a time.
+ *
+ * If the resource name has not been set this function will return a
+ * @c NULL value.
+ *
+ * @param[in] keybuf Pointer to @c LCFGResourceKeyBuffer
+ * @param[in] type_symbol The symbol for the particular key type
+ * @param[out] len Length of the key (optional)
+ *
+ * @return Pointer to the key (or @c NULL for an error)
+ *
+ */
+
+const char * lcfgresource_keybuf_get_key( LCFGResourceKeyBuffer * keybuf,
+                                          char type_symbol,
+                                          size_t * len ) {
+  assert( keybuf != NULL );
+
+  if ( keybuf->name_len == 0 ) return NULL;
+
+  const char * key;
+  size_t key_len = keybuf->prefix_len + keybuf->name_len;
+
+  if ( type_symbol != '\0' ) {
+    keybuf->buffer[0] = type_symbol;
+    key = keybuf->buffer;
+  } else {
+    key = keybuf->buffer + 1;
+    key_len--;
+  }
+
+  if ( len != NULL )
+    *len = key_len;
+
+  return key;
+}
+
+/**
+ * @brief Free the memory for a key buffer
+ *
+ * Frees the memory used by the @c LCFGResourceKeyBuffer, it must be
+ * initialised again with @c lcfgresource_keybuf_init() before it can
+ * be reused.
+ *
+ * @param[in] keybuf Pointer to @c LCFGResourceKeyBuffer
+ *
+ */
+
+void lcfgresource_keybuf_clear( LCFGResourceKeyBuffer * keybuf ) {
+  assert( keybuf != NULL );
+
+  free(keybuf->buffer);
+  keybuf->buffer     = NULL;
+  keybuf->size       = 0;
+  keybuf->prefix_len = 0;
+  keybuf->name_len   = 0;
+}
+
 /**
  * @brief Parse a resource specification
  *
@@ -4502,13 +5331,102 @@ LCFGStatus lcfgresource_parse_spec( char * spec,
   return status;
 }
 
+/**
+ * @brief Parse a resource key without modifying it
+ *
+ * This parses the given resource key into the constituent (namespace,
+ * component name and resource name) parts. Unlike
+ * @c lcfgresource_parse_key() the key is not modified, instead the
+ * @c LCFGResourceKeyView is filled in with pointers into the key and
+ * the length of each part. The key does not need to be
+ * nul-terminated so this can be used directly on keys read from a
+ * DB.
+ *
+ * The resource name is everything after the last @c '.' (period)
+ * separator and the component name is everything after the
+ * separator before that, anything left over is the namespace (which
+ * may itself contain separators). A key which ends with a separator
+ * is not valid.
+ *
+ * @param[in] key Pointer to the resource key
+ * @param[in] len Length of the resource key
+ * @param[out] view Pointer to the @c LCFGResourceKeyView
+ *
+ * @return boolean indicating success
+ *
+ */
+
+bool lcfgresource_parse_key_view( const char * key, size_t len,
+                                  LCFGResourceKeyView * view ) {
+  assert( view != NULL );
+
+  memset( view, 0, sizeof(LCFGResourceKeyView) );
+  view->type = LCFG_RESOURCE_SYMBOL_VALUE;
+
+  if ( key == NULL || len == 0 ) return false;
+
+  const char * start = key;
+  const char * end   = key + len;
+
+  /* Ignore any leading whitespace */
+  while ( start < end && isspace(*start) ) start++;
+
+  if ( start == end ) return false;
+
+  if ( *start == LCFG_RESOURCE_SYMBOL_DERIVATION ||
+       *start == LCFG_RESOURCE_SYMBOL_TYPE       ||
+       *start == LCFG_RESOURCE_SYMBOL_PRIORITY ) {
+    view->type = *start;
+    start++;
+  }
+
+  /* Resource name - finds the *last* separator */
+
+  const char * sep = memrchr( start, '.', end - start );
+  if ( sep == NULL ) {
+    view->resource     = start;
+    view->resource_len = end - start;
+    return true;
+  }
+
+  if ( sep + 1 == end ) return false;
+
+  view->resource     = sep + 1;
+  view->resource_len = end - ( sep + 1 );
+
+  /* Component name - finds the *last* separator */
+
+  end = sep;
+
+  sep = memrchr( start, '.', end - start );
+  if ( sep == NULL ) {
+    view->component     = start;
+    view->component_len = end - start;
+    return true;
+  }
+
+  if ( sep + 1 == end ) return false;
+
+  view->component     = sep + 1;
+  view->component_len = end - ( sep + 1 );
+
+  /* Anything left is the hostname / namespace */
+
+  view->namespace     = start;
+  view->namespace_len = sep - start;
+
+  return true;
+}
+
 /**
  * @brief Parse a resource key
  *
  * This parses the given resource key into the constituent (hostname,
  * component name and resource name) parts. Note that this function
  * modifies the given string in-place and returns pointers to the
- * various chunks of interest.
+ * various chunks of interest. The key is only modified if it is
+ * valid. To parse a key without modifying it use
+ * @c lcfgresource_parse_key_view().
  *
  * @param[in] key Pointer to the resource key (will be modified in place)
  * @param[out] hostname Reference to a pointer to the hostname part of the key (optional)
@@ -4533,60 +5451,24 @@ bool lcfgresource_parse_key( char  * key,
 
   if ( isempty(key) ) return false;
 
-  const char * start = key;
-
-  /* Ignore any leading whitespace */
-  while ( *start != '\0' && isspace(*start) ) start++;
+  LCFGResourceKeyView view;
+  if ( !lcfgresource_parse_key_view( key, strlen(key), &view ) )
+    return false;
 
-  if ( *start == '\0' ) return false;
+  /* Each part is terminated by replacing the following separator */
 
-  if ( *start == LCFG_RESOURCE_SYMBOL_DERIVATION ||
-       *start == LCFG_RESOURCE_SYMBOL_TYPE       ||
-       *start == LCFG_RESOURCE_SYMBOL_PRIORITY ) {
-    *type = *start;
-    start++;
+  if ( view.component != NULL ) {
+    key[ view.resource - key - 1 ] = '\0';
+    *compname = view.component;
   }
 
-  /* Resource name - finds the *last* separator */
-
-  char * sep = strrchr( start, '.' );
-  if ( sep != NULL ) {
-
-    if ( *( sep + 1 ) != '\0' ) {
-      *sep = '\0';
-      *resname = sep + 1;
-    } else {
-      return false;
-    }
-
-  } else {
-    *resname = start;
+  if ( view.namespace != NULL ) {
+    key[ view.component - key - 1 ] = '\0';
+    *hostname = view.namespace;
   }
 
-  /* Component name - finds the *last* separator */
-
-  if ( *resname != start ) {
-
-    sep = strrchr( start, '.' );
-    if ( sep != NULL ) {
-
-      if ( *( sep + 1 ) != '\0' ) {
-        *sep = '\0';
-        *compname = sep + 1;
-      } else {
-        return false;
-      }
-
-    } else {
-      *compname = start;
-    }
-
-    /* Anything left is the hostname / namespace */
-
-    if ( *compname != start )
-      *hostname = start;
-
-  }
+  *resname = view.resource;
+  *type    = view.type;
 
   return true;
 }
@@ -4605,7 +5487,10 @@ bool lcfgresource_parse_key( char  * key,
  *   - value - nul
  *
  * This will take a copy of the new attribute value string where
- * necessary.
+ * necessary. Short values are only copied into the storage for the
+ * resource (which may be an arena) so that loading resources from
+ * status files or DBs does not need an allocation for every
+ * attribute.
  *
  * @param[in] res Pointer to @c LCFGResource
  * @param[in] type_symbol The symbol for the required attribute type
@@ -4633,13 +5518,24 @@ bool lcfgresource_set_attribute( LCFGResource * res,
      the status line or assume this is a simple specification of the
      resource value. */
 
-  /* Always take a copy to ensure the value string is null-terminated */
+  /* The value must be null-terminated. A short value is copied into a
+     buffer on the stack, the setters then copy the string into the
+     storage for the resource so nothing else needs to be allocated. */
 
-  char * value_copy = NULL;
-  if ( value_len > 0 )
-    value_copy = strndup( value, value_len );
+  char buffer[LCFG_RESOURCE_ATTR_BUFFER];
+  char * value_copy = buffer;
+
+  if ( value_len >= sizeof(buffer) ) {
+    value_copy = malloc( value_len + 1 );
+    if ( value_copy == NULL ) {
+      perror( "Failed to allocate memory for LCFG resource attribute" );
+      exit(EXIT_FAILURE);
+    }
+  }
 
-  bool free_copy = true; /* Will value_copy need freeing at end? */
+  if ( value_len > 0 )
+    memcpy( value_copy, value, value_len );
+  value_copy[value_len] = '\0';
 
   const char * attr_name = NULL; /* used for error messages */
 
@@ -4670,8 +5566,9 @@ bool lcfgresource_set_attribute( LCFGResource * res,
       attr_name = "context";
 
       if ( value_len > 0 ) {
-        ok = lcfgresource_set_context( res, value_copy );
-        if (ok) free_copy = false;
+        ok = ( lcfgresource_valid_context(value_copy) &&
+               lcfgresource_set_context( res, NULL ) &&
+               lcfgresource_add_context( res, value_copy ) );
       } else {
         ok = lcfgresource_set_context( res, NULL ); /* unset */
       }
@@ -4699,20 +5596,14 @@ bool lcfgresource_set_attribute( LCFGResource * res,
       ;
       attr_name = "value";
 
-      if ( value_len > 0 ) {
-        /* Value strings may be html encoded as they can contain
-           whitespace characters which would otherwise corrupt the status
-           file formatting. */
+      /* Value strings may be html encoded as they can contain
+         whitespace characters which would otherwise corrupt the status
+         file formatting. */
 
+      if ( value_len > 0 )
         lcfgutils_decode_html_entities_utf8( value_copy, NULL );
 
-        ok = lcfgresource_set_value( res, value_copy );
-      } else {
-        value_copy = strdup("");
-        ok = lcfgresource_set_value( res, value_copy );
-      }
-
-      if (ok) free_copy = false;
+      ok = lcfgresource_set_value_copy( res, value_copy );
 
       break;
     }
@@ -4722,7 +5613,7 @@ bool lcfgresource_set_attribute( LCFGResource * res,
 			     ( value_len > 0 ? value_copy : "(empty string)" ));
   }
 
-  if (free_copy)
+  if ( value_copy != buffer )
     free(value_copy);
 
   return ok;
@@ -4745,6 +5636,64 @@ unsigned long lcfgresource_hash( const LCFGResource * res ) {
   return lcfgutils_string_djbhash( res->name, NULL );
 }
 
+static void lcfgresource_string_stats( const LCFGResource * res,
+                                       const char * str,
+                                       unsigned int inline_flag,
+                                       unsigned int arena_flag,
+                                       LCFGResourceStats * stats ) {
+
+  if ( str == NULL ) return;
+
+  if ( res->_flags & inline_flag ) {
+    stats->inline_strings += 1;
+  } else {
+    if ( res->_flags & arena_flag )
+      stats->arena_strings += 1;
+    else
+      stats->heap_strings += 1;
+
+    stats->string_bytes += strlen(str) + 1;
+  }
+
+}
+
+/**
+ * @brief Gather memory usage statistics for the resource
+ *
+ * This adds the memory used by the @c LCFGResource to the totals in
+ * the specified @c LCFGResourceStats structure. It is intended to be
+ * called for every resource in a container so the structure should be
+ * zeroed before the first call. Short names and values are stored
+ * inside the resource structure and are counted separately from
+ * strings which were allocated from the heap or an arena. The memory used for the
+ * template and derivation is not included as these may be shared
+ * between resources.
+ *
+ * @param[in] res Pointer to an @c LCFGResource
+ * @param[out] stats Pointer to an @c LCFGResourceStats
+ *
+ */
+
+void lcfgresource_memory_stats( const LCFGResource * res,
+                                LCFGResourceStats * stats ) {
+  assert( stats != NULL );
+
+  if ( res == NULL ) return;
+
+  stats->resources      += 1;
+  stats->resource_bytes += sizeof(LCFGResource);
+
+  lcfgresource_string_stats( res, res->name, LCFG_RESOURCE_NAME_INLINE,
+                             LCFG_RESOURCE_NAME_ARENA, stats );
+  lcfgresource_string_stats( res, res->value, LCFG_RESOURCE_VALUE_INLINE,
+                             LCFG_RESOURCE_VALUE_ARENA, stats );
+  lcfgresource_string_stats( res, res->context, 0,
+                             LCFG_RESOURCE_CONTEXT_ARENA, stats );
+  lcfgresource_string_stats( res, res->comment, 0,
+                             LCFG_RESOURCE_COMMENT_ARENA, stats );
+
+}
+
 /**
  * @brief Get a list of all child resources for a specific tag
  *
@@ -4779,13 +5728,16 @@ LCFGStatus lcfgresource_child_names( const LCFGResource * res,
 
   LCFGTagList * child_list = lcfgtaglist_new();
 
+  LCFGTagStack tagstack;
+  lcfgtagstack_from_taglist( &tagstack, tags );
+
   LCFGStatus status = LCFG_STATUS_OK;
   const LCFGTemplate * cur_tmpl = NULL;
   for ( cur_tmpl = lcfgresource_get_template(res);
         cur_tmpl != NULL && status != LCFG_STATUS_ERROR;
         cur_tmpl = cur_tmpl->next ) {
 
-    ssize_t len = lcfgtemplate_substitute( cur_tmpl, tags,
+    ssize_t len = lcfgtemplate_substitute( cur_tmpl, &tagstack,
 					   &child_name, &size, msg );
 
     if ( len > 0 ) {
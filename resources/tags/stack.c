@@ -0,0 +1,190 @@
+/**
+ * @file resources/tags/stack.c
+ * @brief Functions for working with fixed-depth stacks of LCFG resource tags
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tags.h"
+
+/**
+ * @brief Initialise a tag stack
+ *
+ * This sets the specified @c LCFGTagStack to be empty. As the stack
+ * has a fixed depth it is normally declared as a local variable
+ * rather than being allocated.
+ *
+ * @param[in] stack Pointer to @c LCFGTagStack
+ *
+ */
+
+void lcfgtagstack_init( LCFGTagStack * stack ) {
+  assert( stack != NULL );
+
+  stack->depth            = 0;
+  stack->overflow         = 0;
+  stack->overflow_size    = 0;
+  stack->overflow_names   = NULL;
+  stack->overflow_lengths = NULL;
+}
+
+/**
+ * @brief Push a tag name on to a stack
+ *
+ * This pushes the tag name on to the top of the @c LCFGTagStack. The
+ * name is @b NOT copied so it must remain valid until it has been
+ * removed with @c lcfgtagstack_pop().
+ *
+ * Only the top @c LCFG_TAGS_MAX_DEPTH tags, which is the maximum
+ * number of placeholders supported in a template, are available for
+ * templates. When the window is full the bottom tag slides out and
+ * is saved so that it can be restored by @c lcfgtagstack_pop(). The
+ * space for saved tags is only allocated for unusually deep nesting
+ * and is freed once every tag below the window has been popped, so
+ * each push must be matched by a pop.
+ *
+ * @param[in] stack Pointer to @c LCFGTagStack
+ * @param[in] name The tag name
+ * @param[in] len The length of the tag name
+ *
+ */
+
+void lcfgtagstack_push( LCFGTagStack * stack,
+                        const char * name, size_t len ) {
+  assert( stack != NULL );
+  assert( name != NULL );
+
+  if ( stack->depth == LCFG_TAGS_MAX_DEPTH ) {
+
+    if ( stack->overflow == stack->overflow_size ) {
+      unsigned int new_size =
+        stack->overflow_size > 0 ? 2 * stack->overflow_size : 8;
+
+      const char ** new_names = realloc( stack->overflow_names,
+                                         new_size * sizeof(char *) );
+      if ( new_names != NULL ) stack->overflow_names = new_names;
+
+      size_t * new_lengths = realloc( stack->overflow_lengths,
+                                      new_size * sizeof(size_t) );
+      if ( new_lengths != NULL ) stack->overflow_lengths = new_lengths;
+
+      if ( new_names == NULL || new_lengths == NULL ) {
+        perror( "Failed to allocate memory for LCFG tag stack" );
+        exit(EXIT_FAILURE);
+      }
+
+      stack->overflow_size = new_size;
+    }
+
+    stack->overflow_names[stack->overflow]   = stack->names[0];
+    stack->overflow_lengths[stack->overflow] = stack->lengths[0];
+    stack->overflow++;
+
+    stack->depth--;
+
+    unsigned int i;
+    for ( i=0; i<stack->depth; i++ ) {
+      stack->names[i]   = stack->names[i+1];
+      stack->lengths[i] = stack->lengths[i+1];
+    }
+  }
+
+  stack->names[stack->depth]   = name;
+  stack->lengths[stack->depth] = len;
+  stack->depth++;
+
+}
+
+/**
+ * @brief Remove the top tag name from a stack
+ *
+ * This removes the most recently pushed tag name from the
+ * @c LCFGTagStack. If any tags have slid out of the bottom of the
+ * window the most recent is restored. Popping an empty stack has no
+ * effect.
+ *
+ * @param[in] stack Pointer to @c LCFGTagStack
+ *
+ */
+
+void lcfgtagstack_pop( LCFGTagStack * stack ) {
+  assert( stack != NULL );
+
+  if ( stack->depth == 0 ) return;
+
+  stack->depth--;
+
+  if ( stack->overflow > 0 ) {
+
+    unsigned int i;
+    for ( i=stack->depth; i>0; i-- ) {
+      stack->names[i]   = stack->names[i-1];
+      stack->lengths[i] = stack->lengths[i-1];
+    }
+
+    stack->overflow--;
+    stack->names[0]   = stack->overflow_names[stack->overflow];
+    stack->lengths[0] = stack->overflow_lengths[stack->overflow];
+    stack->depth++;
+
+    if ( stack->overflow == 0 ) {
+      free(stack->overflow_names);
+      free(stack->overflow_lengths);
+      stack->overflow_names   = NULL;
+      stack->overflow_lengths = NULL;
+      stack->overflow_size    = 0;
+    }
+  }
+
+}
+
+/**
+ * @brief Fill a tag stack from a tag list
+ *
+ * This sets the contents of the @c LCFGTagStack to be the tags in the
+ * @c LCFGTagList, the tail of the list is the top of the stack. If
+ * the list is longer than @c LCFG_TAGS_MAX_DEPTH then only the tags
+ * at the end of the list are used, these are the only ones which can
+ * be required for a template.
+ *
+ * The tag names are not copied so the list must not be modified
+ * whilst the stack is in use. The stack is initialised so it must not
+ * hold any tags which were pushed with @c lcfgtagstack_push(). The
+ * tags which are not used are not saved so nothing should be popped.
+ *
+ * @param[in] stack Pointer to @c LCFGTagStack
+ * @param[in] taglist Pointer to @c LCFGTagList (may be @c NULL)
+ *
+ */
+
+void lcfgtagstack_from_taglist( LCFGTagStack * stack,
+                                const LCFGTagList * taglist ) {
+  assert( stack != NULL );
+
+  lcfgtagstack_init(stack);
+
+  unsigned int depth = 0;
+  if ( taglist != NULL )
+    depth = taglist->size < LCFG_TAGS_MAX_DEPTH ?
+            taglist->size : LCFG_TAGS_MAX_DEPTH;
+
+  stack->depth = depth;
+
+  const LCFGTagNode * node = taglist != NULL ? taglist->tail : NULL;
+  while ( depth > 0 ) {
+    depth--;
+    stack->names[depth]   = node->tag->name;
+    stack->lengths[depth] = node->tag->name_len;
+    node = node->prev;
+  }
+
+}
+
+/* eof */
@@ -352,12 +352,12 @@ LCFGTemplate * lcfgtemplate_find( const LCFGTemplate * head_template,
 }
 
 char * lcfgresource_build_name( const LCFGTemplate * templates,
-                                LCFGTagList  * taglist,
+                                const LCFGTagStack * tags,
                                 const char * field_name,
                                 char ** msg ) {
 
   /* Replaces each occurrence of the '$' placeholder with the next tag
-     in the list. Work **backwards** from the tail of the list to the head. */
+     in the stack. Work **backwards** from the top of the stack. */
 
   const LCFGTemplate * res_tmpl = lcfgtemplate_find( templates, field_name );
   if ( res_tmpl == NULL ) {
@@ -368,7 +368,7 @@ char * lcfgresource_build_name( const LCFGTemplate * templates,
 
   size_t size = 0;
   char * result = NULL;
-  ssize_t len = lcfgtemplate_substitute( res_tmpl, taglist,
+  ssize_t len = lcfgtemplate_substitute( res_tmpl, tags,
 					 &result, &size, msg );
 
   if ( len < 0 ) {
@@ -380,32 +380,31 @@ char * lcfgresource_build_name( const LCFGTemplate * templates,
 }
 
 ssize_t lcfgtemplate_substitute( const LCFGTemplate * res_tmpl,
-				 LCFGTagList * taglist,
+				 const LCFGTagStack * tags,
 				 char ** result, size_t * size,
 				 char ** msg ) {
 
   const char * template  = lcfgtemplate_get_tmpl(res_tmpl);
 
   unsigned int pcount = res_tmpl->pcount;
-  if ( taglist == NULL || lcfgtaglist_size(taglist) < pcount ) {
+  if ( tags == NULL || tags->depth < pcount ) {
     lcfgutils_build_message( msg, "Insufficient tags for template '%s'\n",
                              template );
     return -1;
   }
 
+  /* The placeholders are filled from the top of the stack */
+
+  const unsigned int top = tags->depth - 1;
+
   /* Find the required length of the resource name */
 
   size_t new_len = res_tmpl->tmpl_len;
 
-  LCFGTagIterator * tagiter = lcfgtagiter_new(taglist);
-
   unsigned int i;
   for ( i=0; i<pcount; i++ ) {
-
-    const LCFGTag * cur_tag = lcfgtagiter_prev(tagiter);
-
     /* -1 for $ placeholder character which is replaced with the tag */
-    new_len += ( lcfgtag_get_length(cur_tag) - 1 );
+    new_len += ( tags->lengths[top - i] - 1 );
   }
 
   /* Allocate the required space */
@@ -434,8 +433,6 @@ ssize_t lcfgtemplate_substitute( const LCFGTemplate * res_tmpl,
   ssize_t after_len;
   size_t offset = new_len;
 
-  lcfgtagiter_reset(tagiter);
-
   for ( i=0; i<pcount; i++ ) {
     int place = res_tmpl->places[i];
     after = place + 1;
@@ -454,19 +451,14 @@ ssize_t lcfgtemplate_substitute( const LCFGTemplate * res_tmpl,
 
     /* Copy the required tag name */
 
-    const LCFGTag * cur_tag = lcfgtagiter_prev(tagiter);
-
-    size_t taglen  = lcfgtag_get_length(cur_tag);
-    const char * tagname = lcfgtag_get_name(cur_tag);
+    size_t taglen = tags->lengths[top - i];
 
     offset -= taglen;
 
-    memcpy( *result + offset, tagname, taglen );
+    memcpy( *result + offset, tags->names[top - i], taglen );
 
   }
 
-  lcfgtagiter_destroy(tagiter);
-
   /* Copy the rest which is static */
 
   memcpy( *result, template, offset );
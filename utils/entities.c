@@ -366,10 +366,14 @@ size_t lcfgutils_decode_html_entities_utf8(char *dest, const char *src)
 	char *to = dest;
 	const char *from = src;
 
+	/* When decoding in place nothing needs to be moved until the
+	   first entity has been decoded */
+
         const char * current;
         while( (current = strchr(from, '&')) )
 	{
-		memmove(to, from, (size_t)(current - from));
+		if(to != from)
+			memmove(to, from, (size_t)(current - from));
 		to += current - from;
 
 		if(parse_entity(current, &to, &from))
@@ -381,7 +385,8 @@ size_t lcfgutils_decode_html_entities_utf8(char *dest, const char *src)
 
 	size_t remaining = strlen(from);
 
-	memmove(to, from, remaining);
+	if(to != from)
+		memmove(to, from, remaining);
 	to += remaining;
 	*to = 0;
 
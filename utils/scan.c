@@ -0,0 +1,186 @@
+/**
+ * @file utils/scan.c
+ * @brief Fast scanning of strings for special characters
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "utils.h"
+
+/* On x86-64 the strings are scanned in 16 byte (SSE2) or 32 byte
+   (AVX2) blocks, the AVX2 version is only used when the processor
+   supports it. Every other platform uses the simple byte-by-byte
+   version.
+
+   The vector versions use aligned loads so they may read beyond the
+   end of the string but never past the end of the aligned block
+   containing the nul, that cannot cross a page boundary so is always
+   safe. It does confuse the address sanitizer so that is disabled for
+   these functions. */
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LCFG_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define LCFG_SCAN_NO_ASAN __attribute__((no_sanitize_address))
+#endif
+#endif
+
+#ifndef LCFG_SCAN_NO_ASAN
+#if defined(__SANITIZE_ADDRESS__)
+#define LCFG_SCAN_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define LCFG_SCAN_NO_ASAN
+#endif
+#endif
+
+typedef const char * (*LCFGScanFunc)( const char * str,
+                                      char c1, char c2, char c3 );
+
+static const char * lcfgutils_scan_scalar( const char * str,
+                                           char c1, char c2, char c3 ) {
+
+  const char * ptr = str;
+  while ( *ptr != '\0' && *ptr != c1 && *ptr != c2 && *ptr != c3 )
+    ptr++;
+
+  return ptr;
+}
+
+#ifdef LCFG_SCAN_X86
+
+LCFG_SCAN_NO_ASAN
+static const char * lcfgutils_scan_sse2( const char * str,
+                                         char c1, char c2, char c3 ) {
+
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  const __m128i v3 = _mm_set1_epi8(c3);
+  const __m128i nul = _mm_setzero_si128();
+
+  size_t offset = (uintptr_t) str % 16;
+  const __m128i * block = (const __m128i *) ( str - offset );
+
+  /* The bits for any bytes before the start of the string in the
+     first block are discarded */
+
+  unsigned int mask = 0xFFFF << offset;
+
+  for (;;) {
+    __m128i data = _mm_load_si128(block);
+
+    __m128i found = _mm_or_si128(
+                      _mm_or_si128( _mm_cmpeq_epi8( data, v1 ),
+                                    _mm_cmpeq_epi8( data, v2 ) ),
+                      _mm_or_si128( _mm_cmpeq_epi8( data, v3 ),
+                                    _mm_cmpeq_epi8( data, nul ) ) );
+
+    unsigned int bits = _mm_movemask_epi8(found) & mask;
+    if ( bits != 0 )
+      return (const char *) block + __builtin_ctz(bits);
+
+    mask = 0xFFFF;
+    block++;
+  }
+
+}
+
+LCFG_SCAN_NO_ASAN
+__attribute__((target("avx2")))
+static const char * lcfgutils_scan_avx2( const char * str,
+                                         char c1, char c2, char c3 ) {
+
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  const __m256i v3 = _mm256_set1_epi8(c3);
+  const __m256i nul = _mm256_setzero_si256();
+
+  size_t offset = (uintptr_t) str % 32;
+  const __m256i * block = (const __m256i *) ( str - offset );
+
+  uint32_t mask = UINT32_C(0xFFFFFFFF) << offset;
+
+  for (;;) {
+    __m256i data = _mm256_load_si256(block);
+
+    __m256i found = _mm256_or_si256(
+                      _mm256_or_si256( _mm256_cmpeq_epi8( data, v1 ),
+                                       _mm256_cmpeq_epi8( data, v2 ) ),
+                      _mm256_or_si256( _mm256_cmpeq_epi8( data, v3 ),
+                                       _mm256_cmpeq_epi8( data, nul ) ) );
+
+    uint32_t bits = (uint32_t) _mm256_movemask_epi8(found) & mask;
+    if ( bits != 0 )
+      return (const char *) block + __builtin_ctz(bits);
+
+    mask = UINT32_C(0xFFFFFFFF);
+    block++;
+  }
+
+}
+
+#endif
+
+/* The implementation is selected on the first call */
+
+static const char * lcfgutils_scan_select( const char * str,
+                                           char c1, char c2, char c3 );
+
+static LCFGScanFunc lcfgutils_scan_impl = &lcfgutils_scan_select;
+
+static const char * lcfgutils_scan_select( const char * str,
+                                           char c1, char c2, char c3 ) {
+
+  LCFGScanFunc impl = &lcfgutils_scan_scalar;
+
+#ifdef LCFG_SCAN_X86
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports("avx2") )
+    impl = &lcfgutils_scan_avx2;
+  else
+    impl = &lcfgutils_scan_sse2;
+#endif
+
+  lcfgutils_scan_impl = impl;
+
+  return (*impl)( str, c1, c2, c3 );
+}
+
+/**
+ * @brief Find the first of a set of characters in a string
+ *
+ * Searches the string for the first instance of any of the three
+ * specified characters. This is similar to @c strpbrk(3) except that
+ * if none of the characters are found a pointer to the terminating
+ * nul character is returned (like @c strchrnul(3) ). This makes it
+ * easy to copy the runs of characters between the matches.
+ *
+ * This is used for finding the characters which need to be encoded
+ * in resource values. On x86-64 the string is scanned using SSE2 or
+ * AVX2 instructions (depending on what the processor supports) so it
+ * is much faster than checking each character in turn. To search for
+ * fewer than three characters just repeat one of them.
+ *
+ * @param[in] str The string to be searched
+ * @param[in] c1 A character to be found
+ * @param[in] c2 A character to be found
+ * @param[in] c3 A character to be found
+ *
+ * @return Pointer to the first matching character or the terminating nul
+ *
+ */
+
+const char * lcfgutils_string_scan3( const char * str,
+                                     char c1, char c2, char c3 ) {
+  return (*lcfgutils_scan_impl)( str, c1, c2, c3 );
+}
+
+/* eof */
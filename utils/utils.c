@@ -11,6 +11,7 @@
 
 #include <ctype.h>
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <stdarg.h>
@@ -707,6 +708,126 @@ LCFGChange lcfgutils_file_update( const char * filename, const char * tmpfile,
   return change;
 }
 
+/* Compare the contents of a file with a buffer, the file is read in
+   large blocks and any difference ends the comparison. */
+
+static bool lcfgutils_file_matches_buffer( const char * filename,
+                                           const char * data, size_t len ) {
+
+  struct stat sb;
+  if ( ( stat( filename, &sb ) != 0 ) || !S_ISREG(sb.st_mode) ||
+       (size_t) sb.st_size != len )
+    return false;
+
+  int fd = open( filename, O_RDONLY );
+  if ( fd < 0 ) return false;
+
+  char block[65536];
+
+  bool matches = true;
+  size_t offset = 0;
+  while ( matches && offset < len ) {
+    ssize_t rc = read( fd, block, sizeof(block) );
+
+    if ( rc < 0 && errno == EINTR ) continue;
+
+    if ( rc <= 0 || (size_t) rc > len - offset ||
+         memcmp( block, data + offset, rc ) != 0 ) {
+      matches = false;
+    } else {
+      offset += rc;
+    }
+  }
+
+  /* Check that the file has not grown */
+
+  if ( matches && read( fd, block, 1 ) != 0 )
+    matches = false;
+
+  close(fd);
+
+  return matches;
+}
+
+/**
+ * @brief Update a file from a buffer if the contents have changed
+ *
+ * This is similar to @c lcfgutils_file_update() except that the new
+ * contents are held in memory rather than in a temporary file. The
+ * buffer is compared with the contents of the current file, only if
+ * they differ is a temporary file (in the same directory) written
+ * using large @c write(2) calls and then atomically renamed into
+ * place. This avoids writing and then reading back the new file when
+ * nothing has changed.
+ *
+ * If the @c mtime is non-zero the modification time of the file will
+ * be set to that value, whether or not the contents have changed.
+ *
+ * @param[in] filename Path to the current file
+ * @param[in] data Pointer to the new contents
+ * @param[in] len Length of the new contents
+ * @param[in] mtime Modification time to set on the file (or zero)
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
+LCFGChange lcfgutils_file_update_buffer( const char * filename,
+                                         const char * data, size_t len,
+                                         time_t mtime ) {
+  assert( filename != NULL );
+  assert( data != NULL || len == 0 );
+
+  LCFGChange change = LCFG_CHANGE_NONE;
+
+  if ( !lcfgutils_file_matches_buffer( filename, data, len ) ) {
+
+    char * tmpfile = lcfgutils_safe_tmpname(filename);
+
+    int fd = mkstemp(tmpfile);
+    if ( fd < 0 ) {
+      change = LCFG_CHANGE_ERROR;
+    } else {
+
+      size_t offset = 0;
+      while ( offset < len ) {
+        ssize_t rc = write( fd, data + offset, len - offset );
+        if ( rc < 0 ) {
+          if ( errno == EINTR ) continue;
+          change = LCFG_CHANGE_ERROR;
+          break;
+        }
+        offset += rc;
+      }
+
+      if ( close(fd) != 0 )
+        change = LCFG_CHANGE_ERROR;
+
+      if ( change != LCFG_CHANGE_ERROR ) {
+        if ( rename( tmpfile, filename ) == 0 )
+          change = LCFG_CHANGE_MODIFIED;
+        else
+          change = LCFG_CHANGE_ERROR;
+      }
+
+      if ( change == LCFG_CHANGE_ERROR )
+        (void) unlink(tmpfile);
+
+    }
+
+    free(tmpfile);
+  }
+
+  if ( change != LCFG_CHANGE_ERROR && mtime != 0 ) {
+    struct utimbuf times;
+    times.actime  = mtime;
+    times.modtime = mtime;
+    (void) utime( filename, &times );
+  }
+
+  return change;
+}
+
 void lcfgutils_build_message( char ** strp, const char *fmt, ... ) {
   free( *strp );
   *strp = NULL;
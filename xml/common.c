@@ -12,6 +12,7 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include <libxml/xmlreader.h>
@@ -103,21 +104,14 @@ bool lcfgxml_moveto_node( xmlTextReaderPtr reader,
   assert( reader != NULL );
   assert( target_nodename != NULL );
 
-  xmlChar * nodename = NULL;
-
   bool done = false;
   int read_status = 1;
   while ( !done && read_status == 1 ) {
     read_status = xmlTextReaderRead(reader);
-    if ( read_status == 1 ) {
-      nodename = xmlTextReaderName(reader);
-
-      if (xmlStrcmp(nodename, BAD_CAST target_nodename) == 0 )
-        done = true;
-
-      xmlFree(nodename);
-      nodename = NULL;
-    }
+    if ( read_status == 1 &&
+         xmlStrEqual( xmlTextReaderConstName(reader),
+                      BAD_CAST target_nodename ) )
+      done = true;
   }
 
   return done;
@@ -141,14 +135,66 @@ bool lcfgxml_correct_location( xmlTextReaderPtr reader,
   assert( reader != NULL );
   assert( expected_nodename != NULL );
 
-  xmlChar * nodename = xmlTextReaderName(reader);
+  return xmlStrEqual( xmlTextReaderConstName(reader),
+                      BAD_CAST expected_nodename );
+}
+
+/**
+ * @brief Gather the LCFG attributes for the current element
+ *
+ * This walks through the attributes for the current element once and
+ * collects the values for the @c cfg:name, @c cfg:derivation,
+ * @c cfg:context, @c cfg:type and @c cfg:template attributes. Any
+ * attribute which is not present will have a @c NULL value. The
+ * reader is returned to the element afterwards.
+ *
+ * The values are not copied, they point to strings held by the XML
+ * reader and are only valid until the reader is next moved on. The
+ * profiles are read with entity substitution enabled so each
+ * attribute value is a single text node which is returned directly
+ * rather than via the shared buffer in the reader.
+ *
+ * @param[in] reader Pointer to XML reader
+ * @param[out] attrs Pointer to @c LCFGXMLAttributes
+ *
+ */
+
+void lcfgxml_gather_attributes( xmlTextReaderPtr reader,
+                                LCFGXMLAttributes * attrs ) {
+  assert( reader != NULL );
+  assert( attrs != NULL );
+
+  memset( attrs, 0, sizeof(LCFGXMLAttributes) );
+
+  if ( xmlTextReaderHasAttributes(reader) != 1 ) return;
 
-  bool correct = ( xmlStrcmp(nodename,BAD_CAST expected_nodename) == 0 );
+  while ( xmlTextReaderMoveToNextAttribute(reader) == 1 ) {
 
-  xmlFree(nodename);
-  nodename = NULL;
+    const xmlChar * attrname = xmlTextReaderConstName(reader);
+    if ( attrname == NULL || xmlStrncmp( attrname, BAD_CAST "cfg:", 4 ) != 0 )
+      continue;
+
+    const xmlChar * localname = attrname + 4;
+    const xmlChar ** value = NULL;
+
+    if (        xmlStrEqual( localname, BAD_CAST "name"       ) ) {
+      value = &(attrs->name);
+    } else if ( xmlStrEqual( localname, BAD_CAST "derivation" ) ) {
+      value = &(attrs->derivation);
+    } else if ( xmlStrEqual( localname, BAD_CAST "context"    ) ) {
+      value = &(attrs->context);
+    } else if ( xmlStrEqual( localname, BAD_CAST "type"       ) ) {
+      value = &(attrs->type);
+    } else if ( xmlStrEqual( localname, BAD_CAST "template"   ) ) {
+      value = &(attrs->template);
+    }
+
+    if ( value != NULL )
+      *value = xmlTextReaderConstValue(reader);
+
+  }
 
-  return correct;
+  xmlTextReaderMoveToElement(reader);
 }
 
 /* eof */
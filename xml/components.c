@@ -20,12 +20,17 @@
 /**
  * @brief Process XML for single component
  *
+ * If the @c LCFG_OPT_USE_ARENA option is specified then the resources
+ * are allocated from an arena owned by the component, see
+ * @c lcfgcomponent_use_arena() for details.
+ *
  * @param[in] reader Pointer to XML reader
  * @param[in] compname Name of component
  * @param[out] result Reference to pointer to new @c LCFGComponent
  * @param[in] base_context A context which will be applied to all resources
  * @param[in] base_derivation A derivation which will be applied to all resources
  * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
+ * @param[in] options Controls the behaviour of the process
  * @param[out] msg Pointer to any diagnostic messages
  *
  * @return Status value indicating success of the process
@@ -38,6 +43,7 @@ LCFGStatus lcfgxml_process_component( xmlTextReaderPtr reader,
 				      const char * base_context,
 				      const char * base_derivation,
 				      const LCFGContextList * ctxlist,
+				      LCFGOption options,
 				      char ** msg ) {
   assert( reader != NULL );
   assert( compname != NULL );
@@ -66,8 +72,16 @@ LCFGStatus lcfgxml_process_component( xmlTextReaderPtr reader,
     goto cleanup;
   }
 
+  if ( options & LCFG_OPT_USE_ARENA )
+    lcfgcomponent_use_arena(lcfgcomp);
+
   int topdepth = xmlTextReaderDepth(reader);
 
+  /* The stack of tags is shared by all the resources */
+
+  LCFGTagStack tags;
+  lcfgtagstack_init(&tags);
+
   bool done  = false;
 
   int read_status = xmlTextReaderRead(reader);
@@ -83,32 +97,26 @@ LCFGStatus lcfgxml_process_component( xmlTextReaderPtr reader,
 
         /* start of new resource */
 
-        char * tagname = NULL; /* should never be set */
+        const char * tagname = NULL; /* should never be set */
 
         status = lcfgxml_process_resource( reader, lcfgcomp, NULL,
-                                           &tagname, NULL,
+                                           &tagname, &tags,
                                            base_context, base_derivation,
                                            ctxlist, msg );
 
-	free(tagname);
-	tagname = NULL;
-
       } else {
-        xmlChar * nodename  = xmlTextReaderName(reader);
+        const xmlChar * nodename = xmlTextReaderConstName(reader);
 
         status = lcfgxml_error( msg, "Unexpected element '%s' of type %d at line %d whilst processing '%s' component.", nodename, nodetype, linenum, compname );
-
-        xmlFree(nodename);
-        nodename = NULL;
       }
 
     } else {
-      xmlChar * nodename  = xmlTextReaderName(reader);
+      const xmlChar * nodename = xmlTextReaderConstName(reader);
 
       if ( nodetype == XML_READER_TYPE_END_ELEMENT ) {
 
         if ( nodedepth == topdepth &&
-             xmlStrcmp(nodename, BAD_CAST lcfgcomp->name ) == 0 ) {
+             xmlStrEqual( nodename, BAD_CAST compname ) ) {
           done = true; /* Successfully finished this block */
         } else {
           status = lcfgxml_error( msg, "Unexpected end element '%s' at line %d whilst processing '%s' component.", nodename, linenum, compname );
@@ -121,8 +129,6 @@ LCFGStatus lcfgxml_process_component( xmlTextReaderPtr reader,
 
       }
 
-      xmlFree(nodename);
-      nodename = NULL;
     }
 
     /* Quit if the processing status is no longer OK */
@@ -159,6 +165,7 @@ LCFGStatus lcfgxml_process_component( xmlTextReaderPtr reader,
  * @param[in] base_derivation A derivation which will be applied to all resources
  * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
  * @param[in] comps_wanted An @c LCFGTagList of names for the desired components
+ * @param[in] options Controls the behaviour of the process
  * @param[out] msg Pointer to any diagnostic messages
  *
  * @return Status value indicating success of the process
@@ -171,6 +178,7 @@ LCFGStatus lcfgxml_process_components( xmlTextReaderPtr reader,
 				       const char * base_derivation,
 				       const LCFGContextList * ctxlist,
 				       const LCFGTagList * comps_wanted,
+				       LCFGOption options,
 				       char ** msg ) {
   assert( reader != NULL );
 
@@ -195,11 +203,15 @@ LCFGStatus lcfgxml_process_components( xmlTextReaderPtr reader,
 
   int read_status = xmlTextReaderRead(reader);
 
-  char * compname = NULL;
+  /* The element names are interned in the dictionary for the reader
+     so they remain valid after the reader has moved on and do not
+     need to be copied or freed. */
+
+  const char * compname = NULL;
 
   while ( !done && read_status == 1 ) {
 
-    xmlChar * nodename  = xmlTextReaderName(reader);
+    const xmlChar * nodename = xmlTextReaderConstName(reader);
     int nodetype        = xmlTextReaderNodeType(reader);
     int nodedepth       = xmlTextReaderDepth(reader);
     int linenum         = xmlTextReaderGetParserLineNumber(reader);
@@ -211,21 +223,20 @@ LCFGStatus lcfgxml_process_components( xmlTextReaderPtr reader,
         /* start of new component */
 
         /* name of node is name of the component */
-	free(compname);
         compname = NULL;
 
         LCFGComponent * cur_comp = NULL;
-        if ( lcfgcomponent_valid_name( (char *) nodename ) ) {
+        if ( lcfgcomponent_valid_name( (const char *) nodename ) ) {
 
-          /* A copy of the most recently seen component name is stashed
-             so that it can be compared each time to see if the end of
-             the component block has been reached. */
+          /* The most recently seen component name is stashed so that
+             it can be compared each time to see if the end of the
+             component block has been reached. */
 
-          compname = (char *) xmlStrdup(nodename);
+          compname = (const char *) nodename;
 
           status = lcfgxml_process_component( reader, compname, &cur_comp,
                                               base_context, base_derivation,
-                                              ctxlist, msg );
+                                              ctxlist, options, msg );
 
         } else {
           status = lcfgxml_error( msg, "Invalid component name '%s' found at line %d whilst processing components.",
@@ -268,11 +279,11 @@ LCFGStatus lcfgxml_process_components( xmlTextReaderPtr reader,
     } else if ( nodetype == XML_READER_TYPE_END_ELEMENT ) {
 
       if ( nodedepth == topdepth &&
-           xmlStrcmp( nodename, BAD_CAST LCFGXML_COMPS_PARENT_NODE ) == 0 ) {
+           xmlStrEqual( nodename, BAD_CAST LCFGXML_COMPS_PARENT_NODE ) ) {
         done = true; /* Successfully finished this block */
       } else if ( compname  == NULL         ||
                   nodedepth != topdepth + 1 ||
-                  xmlStrcmp(nodename, BAD_CAST compname) != 0 ) {
+                  !xmlStrEqual( nodename, BAD_CAST compname ) ) {
 
         status = lcfgxml_error( msg, "Unexpected end element '%s' at line %d whilst processing components.", nodename, linenum );
 
@@ -280,9 +291,6 @@ LCFGStatus lcfgxml_process_components( xmlTextReaderPtr reader,
 
     }
 
-    xmlFree(nodename);
-    nodename = NULL;
-
     /* Quit if the processing status is no longer OK */
     if ( status == LCFG_STATUS_ERROR )
       done = true;
@@ -292,9 +300,6 @@ LCFGStatus lcfgxml_process_components( xmlTextReaderPtr reader,
 
   }
 
-  free(compname);
-  compname = NULL;
-
   if ( status == LCFG_STATUS_ERROR ) {
 
     if ( *msg == NULL )
@@ -0,0 +1,207 @@
+/* Benchmark for evaluating a profile again after a context change
+
+   Writes a synthetic profile (see bench/generate.c, by default 50
+   components each with 200 resources and 10 contexts) where roughly
+   one component in four has a resource with an alternative value for
+   a context expression. The profile is loaded with the first context
+   set, then the second context is set instead and the time taken to
+   update the profile with lcfgprofile_reeval_contexts() is compared
+   with that taken to load the whole profile again. The results must
+   be the same.
+
+   The generator is not part of the library so it must be compiled
+   with this program, e.g.
+
+   cc -o contexts contexts.c ../../bench/generate.c -llcfg_xml */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <lcfg/xml.h>
+#include <lcfg/differences.h>
+
+#include "../../bench/generate.h"
+
+static LCFGContextList * make_ctxlist( unsigned int ctx ) {
+
+  LCFGContextList * ctxlist = lcfgctxlist_new();
+
+  char * str = NULL;
+  if ( asprintf( &str, LCFGBENCH_CONTEXT_FORMAT " = 1", ctx ) < 0 ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  LCFGContext * context = NULL;
+  char * msg = NULL;
+  if ( lcfgcontext_from_string( str, 1, &context, &msg ) != LCFG_STATUS_OK ||
+       lcfgctxlist_update( ctxlist, context ) == LCFG_CHANGE_ERROR ) {
+    fprintf( stderr, "Failed to create context: %s\n", msg );
+    exit(EXIT_FAILURE);
+  }
+
+  lcfgcontext_relinquish(context);
+  free(msg);
+  free(str);
+
+  return ctxlist;
+}
+
+static LCFGProfile * load_profile( const char * path,
+                                   const LCFGContextList * ctxlist ) {
+
+  LCFGProfile * profile = NULL;
+  char * msg = NULL;
+
+  if ( lcfgprofile_from_xml( path, &profile, NULL, NULL, ctxlist, NULL,
+                             false, &msg ) != LCFG_STATUS_OK ) {
+    fprintf( stderr, "Failed to load profile: %s\n", msg );
+    exit(EXIT_FAILURE);
+  }
+
+  free(msg);
+
+  return profile;
+}
+
+/* Every component and the active packages must be the same */
+
+static bool same_profile( const LCFGProfile * profile1,
+                          const LCFGProfile * profile2 ) {
+
+  bool same = ( profile1->components->entries ==
+                profile2->components->entries );
+
+  unsigned long i;
+  for ( i=0; same && i<profile1->components->buckets; i++ ) {
+    const LCFGComponent * comp1 = profile1->components->components[i];
+    if ( comp1 == NULL ) continue;
+
+    const LCFGComponent * comp2 =
+      lcfgcompset_find_component( profile2->components,
+                                  lcfgcomponent_get_name(comp1) );
+
+    LCFGDiffComponent * compdiff = NULL;
+    if ( comp2 == NULL ||
+         lcfgcomponent_diff( comp1, comp2, &compdiff ) != LCFG_CHANGE_NONE )
+      same = false;
+
+    lcfgdiffcomponent_relinquish(compdiff);
+  }
+
+  LCFGPkgSetDiff * pkgdiff = NULL;
+  if ( same && lcfgpkgset_diff( profile1->active_packages,
+                                profile2->active_packages,
+                                &pkgdiff ) != LCFG_CHANGE_NONE )
+    same = false;
+
+  lcfgpkgsetdiff_relinquish(pkgdiff);
+
+  return same;
+}
+
+int main(int argc, char *argv[]) {
+
+  LCFGBenchParams params;
+  lcfgbench_default_params(&params);
+
+  if ( argc > 1 ) params.components = atoi(argv[1]);
+  if ( argc > 2 ) params.resources  = atoi(argv[2]);
+  if ( argc > 3 ) params.contexts   = atoi(argv[3]);
+  unsigned int rounds = argc > 4 ? atoi(argv[4]) : 10;
+
+  if ( params.contexts < 2 ) params.contexts = 2;
+  if ( rounds == 0 ) rounds = 1;
+
+  /* Only some components are affected by a change of contexts */
+
+  params.context_rate = 4 * ( params.resources > 0 ? params.resources : 1 );
+
+  char path[] = "/tmp/lcfg_contexts_XXXXXX";
+  int fd = mkstemp(path);
+  if ( fd == -1 ) {
+    perror("Failed to create temporary file");
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+
+  if ( !lcfgbench_write_profile( &params, 1, path ) ) {
+    perror("Failed to write profile");
+    exit(EXIT_FAILURE);
+  }
+
+  LCFGContextList * old_ctxlist = make_ctxlist(0);
+  LCFGContextList * new_ctxlist = make_ctxlist(1);
+
+  char * msg = NULL;
+  LCFGXMLContextIndex * index = NULL;
+  if ( lcfgxml_context_index( path, NULL, NULL,
+                              &index, &msg ) != LCFG_STATUS_OK ) {
+    fprintf( stderr, "Failed to index profile: %s\n", msg );
+    exit(EXIT_FAILURE);
+  }
+
+  bool ok = true;
+  double total_reeval = 0, total_reload = 0;
+  unsigned int nchanged = 0;
+
+  unsigned int round;
+  for ( round=0; ok && round<rounds; round++ ) {
+    LCFGProfile * profile = load_profile( path, old_ctxlist );
+
+    struct timespec start;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    LCFGTagList * changed = NULL;
+    LCFGChange change = lcfgprofile_reeval_contexts( profile, index,
+                                                     old_ctxlist, new_ctxlist,
+                                                     &changed, &msg );
+
+    total_reeval += lcfgbench_elapsed(&start);
+
+    if ( change != LCFG_CHANGE_MODIFIED ) {
+      fprintf( stderr, "Failed to evaluate contexts: %s\n",
+               msg != NULL ? msg : "no change" );
+      ok = false;
+    } else {
+      nchanged = lcfgtaglist_size(changed);
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    LCFGProfile * reloaded = load_profile( path, new_ctxlist );
+
+    total_reload += lcfgbench_elapsed(&start);
+
+    if ( ok && !same_profile( profile, reloaded ) ) {
+      fprintf( stderr, "Evaluated profile differs from reloaded profile\n" );
+      ok = false;
+    }
+
+    lcfgtaglist_relinquish(changed);
+    lcfgprofile_destroy(reloaded);
+    lcfgprofile_destroy(profile);
+  }
+
+  lcfgxml_context_index_destroy(index);
+  lcfgctxlist_destroy(old_ctxlist);
+  lcfgctxlist_destroy(new_ctxlist);
+  free(msg);
+
+  unlink(path);
+
+  if ( ok ) {
+    printf( "re-evaluate: %8.3f ms\n", total_reeval / rounds );
+    printf( "reload:      %8.3f ms\n", total_reload / rounds );
+    printf( "changed:     %8u of %u components\n", nchanged,
+            params.components );
+  }
+
+  return ( ok ? 0 : 1 );
+}
@@ -0,0 +1,228 @@
+/* Benchmark for applying a directory of XML override profiles
+
+   Writes a synthetic profile (see bench/generate.c, by default 40
+   components each with 500 resources) and a directory with an
+   override file for every component to a temporary directory, then
+   times applying the overrides with lcfgprofile_overrides_xmldir()
+   and with lcfgprofile_overrides_xmldir_parallel(). Every component
+   must be the same as that in the override file for both.
+
+   The generator is not part of the library so it must be compiled
+   with this program, e.g.
+
+   cc -o overrides overrides.c ../../bench/generate.c -llcfg_xml */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <lcfg/xml.h>
+#include <lcfg/differences.h>
+
+#include "../../bench/generate.h"
+
+static char * make_path( const char * dir, const char * name ) {
+
+  char * path = NULL;
+  if ( asprintf( &path, "%s/%s", dir, name ) < 0 ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  return path;
+}
+
+static char * override_path( const char * dir, unsigned int c ) {
+
+  char name[32];
+  snprintf( name, sizeof(name), "comp%u.xml", c );
+
+  return make_path( dir, name );
+}
+
+static LCFGProfile * load_profile( const char * path ) {
+
+  LCFGProfile * profile = NULL;
+  char * msg = NULL;
+
+  if ( lcfgprofile_from_xml( path, &profile, NULL, NULL, NULL, NULL,
+                             false, &msg ) != LCFG_STATUS_OK ) {
+    fprintf( stderr, "Failed to load profile: %s\n", msg );
+    exit(EXIT_FAILURE);
+  }
+
+  free(msg);
+
+  return profile;
+}
+
+/* Every component must have the same resources as the component
+   loaded directly from the override file */
+
+static bool same_components( const LCFGProfile * profile,
+                             LCFGProfile ** expected,
+                             unsigned int ncomps ) {
+
+  bool same = ( profile->components->entries == ncomps );
+
+  unsigned int c;
+  for ( c=0; same && c<ncomps; c++ ) {
+    char name[32];
+    snprintf( name, sizeof(name), "comp%u", c );
+
+    const LCFGComponent * comp1 =
+      lcfgcompset_find_component( profile->components, name );
+    const LCFGComponent * comp2 =
+      lcfgcompset_find_component( expected[c]->components, name );
+
+    LCFGDiffComponent * compdiff = NULL;
+    if ( comp1 == NULL || comp2 == NULL ||
+         lcfgcomponent_diff( comp1, comp2, &compdiff ) != LCFG_CHANGE_NONE )
+      same = false;
+
+    lcfgdiffcomponent_relinquish(compdiff);
+  }
+
+  return same;
+}
+
+static bool apply_overrides( const char * profile_file,
+                             const char * override_dir,
+                             bool parallel, LCFGProfile ** expected,
+                             unsigned int ncomps, double * total_time ) {
+
+  LCFGProfile * profile = load_profile(profile_file);
+  char * msg = NULL;
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGChange change;
+  if ( parallel )
+    change = lcfgprofile_overrides_xmldir_parallel( profile, override_dir,
+                                                    NULL, &msg );
+  else
+    change = lcfgprofile_overrides_xmldir( profile, override_dir,
+                                           NULL, &msg );
+
+  *total_time += lcfgbench_elapsed(&start);
+
+  /* Every component should have been replaced */
+
+  bool ok = ( change == LCFG_CHANGE_MODIFIED &&
+              same_components( profile, expected, ncomps ) );
+
+  free(msg);
+  lcfgprofile_destroy(profile);
+
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+
+  LCFGBenchParams params;
+  lcfgbench_default_params(&params);
+
+  params.components = argc > 1 ? atoi(argv[1]) : 40;
+  params.resources  = argc > 2 ? atoi(argv[2]) : 500;
+  unsigned int rounds = argc > 3 ? atoi(argv[3]) : 10;
+
+  if ( params.components == 0 ) params.components = 1;
+  if ( rounds == 0 ) rounds = 1;
+
+  /* Only the components are loaded from an override file */
+
+  params.list_depth = 0;
+  params.fanout     = 1;
+  params.packages   = 0;
+  params.contexts   = 0;
+
+  unsigned int ncomps = params.components;
+
+  char dir[] = "/tmp/lcfg_overrides_XXXXXX";
+  if ( mkdtemp(dir) == NULL ) {
+    perror("Failed to create temporary directory");
+    exit(EXIT_FAILURE);
+  }
+
+  char * profile_file = make_path( dir, "profile.xml" );
+  if ( !lcfgbench_write_profile( &params, 1, profile_file ) ) {
+    perror("Failed to write profile");
+    exit(EXIT_FAILURE);
+  }
+
+  char * override_dir = make_path( dir, "local" );
+  if ( mkdir( override_dir, 0700 ) != 0 ) {
+    perror("Failed to create temporary directory");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Each override file holds a later version of a single component */
+
+  LCFGProfile ** expected = calloc( ncomps, sizeof(LCFGProfile *) );
+  if ( expected == NULL ) {
+    perror("Failed to allocate memory");
+    exit(EXIT_FAILURE);
+  }
+
+  LCFGBenchParams override_params = params;
+  override_params.components = 1;
+
+  unsigned int c;
+  for ( c=0; c<ncomps; c++ ) {
+    override_params.first = c;
+
+    char * path = override_path( override_dir, c );
+    if ( !lcfgbench_write_profile( &override_params, 2, path ) ) {
+      perror("Failed to write override profile");
+      exit(EXIT_FAILURE);
+    }
+
+    expected[c] = load_profile(path);
+    free(path);
+  }
+
+  bool ok = true;
+  double total_serial = 0, total_parallel = 0;
+  unsigned int round;
+
+  for ( round=0; ok && round<rounds; round++ )
+    ok = apply_overrides( profile_file, override_dir, false,
+                          expected, ncomps, &total_serial );
+
+  for ( round=0; ok && round<rounds; round++ )
+    ok = apply_overrides( profile_file, override_dir, true,
+                          expected, ncomps, &total_parallel );
+
+  for ( c=0; c<ncomps; c++ ) {
+    char * path = override_path( override_dir, c );
+    unlink(path);
+    free(path);
+
+    lcfgprofile_destroy(expected[c]);
+  }
+
+  free(expected);
+
+  rmdir(override_dir);
+  unlink(profile_file);
+  rmdir(dir);
+
+  free(override_dir);
+  free(profile_file);
+
+  if ( ok ) {
+    printf( "serial:   %8.3f ms\n", total_serial / rounds );
+    printf( "parallel: %8.3f ms\n", total_parallel / rounds );
+  } else {
+    fprintf( stderr, "Overrides were not applied correctly\n" );
+  }
+
+  return ( ok ? 0 : 1 );
+}
@@ -0,0 +1,201 @@
+/* Benchmark for loading an XML profile
+
+   Writes a synthetic profile (see bench/generate.c, by default 50
+   components each with 200 resources and a tag list of 20 records)
+   to a temporary file and times loading it with lcfgprofile_from_xml()
+   and with lcfgprofile_from_xml_parallel(). A second version of the
+   profile, in which one component has changed, is also written and
+   the time taken to load it with lcfgprofile_from_xml_incremental()
+   given the first version is reported. The number of memory
+   allocations made whilst loading serially is also reported, these
+   are counted by wrapping the glibc malloc functions so this only
+   works on systems using glibc.
+
+   The generator is not part of the library so it must be compiled
+   with this program, e.g.
+
+   cc -o parse parse.c ../../bench/generate.c -llcfg_xml */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <lcfg/xml.h>
+
+#include "../../bench/generate.h"
+
+extern void * __libc_malloc( size_t size );
+extern void * __libc_calloc( size_t nmemb, size_t size );
+extern void * __libc_realloc( void * ptr, size_t size );
+
+static unsigned long allocs = 0;
+
+void * malloc( size_t size ) {
+  allocs++;
+  return __libc_malloc(size);
+}
+
+void * calloc( size_t nmemb, size_t size ) {
+  allocs++;
+  return __libc_calloc( nmemb, size );
+}
+
+void * realloc( void * ptr, size_t size ) {
+  allocs++;
+  return __libc_realloc( ptr, size );
+}
+
+static void temp_profile( char * filename, const LCFGBenchParams * params,
+                          unsigned int version ) {
+
+  int fd = mkstemp(filename);
+  if ( fd == -1 ) {
+    perror("Failed to create temporary file");
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+
+  if ( !lcfgbench_write_profile( params, version, filename ) ) {
+    perror("Failed to write profile");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static bool load_profile( const char * filename, bool parallel,
+                          unsigned int ncomps, double * total_time ) {
+
+  LCFGProfile * profile = NULL;
+  char * msg = NULL;
+
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  LCFGStatus rc;
+  if ( parallel )
+    rc = lcfgprofile_from_xml_parallel( filename, &profile,
+                                        NULL, NULL, NULL, NULL,
+                                        false, &msg );
+  else
+    rc = lcfgprofile_from_xml( filename, &profile,
+                               NULL, NULL, NULL, NULL,
+                               false, &msg );
+
+  *total_time += lcfgbench_elapsed(&start);
+
+  bool ok = true;
+  if ( rc != LCFG_STATUS_OK ) {
+    fprintf( stderr, "Failed to load profile: %s\n", msg );
+    ok = false;
+  } else if ( profile->components->entries != ncomps ) {
+    ok = false;
+  }
+
+  free(msg);
+  lcfgprofile_destroy(profile);
+
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+
+  LCFGBenchParams params;
+  lcfgbench_default_params(&params);
+
+  if ( argc > 1 ) params.components = atoi(argv[1]);
+  if ( argc > 2 ) params.resources  = atoi(argv[2]);
+  unsigned int rounds = argc > 3 ? atoi(argv[3]) : 10;
+
+  if ( rounds == 0 ) rounds = 1;
+
+  /* Only the first component differs in the second version */
+
+  params.list_depth = 1;
+  params.list_size  = 20;
+  params.fanout     = 1;
+  params.packages   = 0;
+  params.contexts   = 0;
+  params.changed    = 1;
+
+  unsigned int ncomps = params.components;
+
+  char filename[]  = "/tmp/lcfg_parse_XXXXXX";
+  char filename2[] = "/tmp/lcfg_parse_XXXXXX";
+
+  temp_profile( filename,  &params, 1 );
+  temp_profile( filename2, &params, 2 );
+
+  bool ok = true;
+  unsigned long total_allocs = 0;
+  double total_time = 0, total_parallel = 0, total_incremental = 0;
+  unsigned int round;
+
+  for ( round=0; ok && round<rounds; round++ ) {
+    unsigned long before = allocs;
+
+    ok = load_profile( filename, false, ncomps, &total_time );
+
+    total_allocs += allocs - before;
+  }
+
+  for ( round=0; ok && round<rounds; round++ )
+    ok = load_profile( filename, true, ncomps, &total_parallel );
+
+  LCFGProfile * previous = NULL;
+  char * msg = NULL;
+  if ( ok && lcfgprofile_from_xml_incremental( filename, &previous, NULL,
+                                               NULL, NULL, NULL, NULL,
+                                               false, &msg )
+       != LCFG_STATUS_OK ) {
+    fprintf( stderr, "Failed to load profile: %s\n", msg );
+    ok = false;
+  }
+
+  for ( round=0; ok && round<rounds; round++ ) {
+    LCFGProfile * profile = NULL;
+
+    struct timespec start;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    LCFGStatus rc = lcfgprofile_from_xml_incremental( filename2, &profile,
+                                                      previous,
+                                                      NULL, NULL, NULL, NULL,
+                                                      false, &msg );
+
+    total_incremental += lcfgbench_elapsed(&start);
+
+    if ( rc != LCFG_STATUS_OK ) {
+      fprintf( stderr, "Failed to load profile: %s\n", msg );
+      ok = false;
+    } else if ( profile->components->entries != ncomps ) {
+      ok = false;
+    }
+
+    lcfgprofile_destroy(profile);
+  }
+
+  free(msg);
+  lcfgprofile_destroy(previous);
+
+  unlink(filename);
+  unlink(filename2);
+
+  if ( ok ) {
+    unsigned long nodes = (unsigned long) ncomps *
+                          ( params.resources + params.list_size + 1 );
+    printf( "load:     %8.3f ms\n", total_time / rounds );
+    printf( "parallel: %8.3f ms\n", total_parallel / rounds );
+    printf( "reload:   %8.3f ms (one component changed)\n",
+            total_incremental / rounds );
+    printf( "allocs:   %8lu (%.1f per resource)\n", total_allocs / rounds,
+            (double) total_allocs / rounds / nodes );
+  } else {
+    fprintf( stderr, "Profile was not loaded correctly\n" );
+  }
+
+  return ( ok ? 0 : 1 );
+}
@@ -0,0 +1,257 @@
+/**
+ * @file xml/input.c
+ * @brief Functions for opening compressed LCFG XML profiles
+ * @author Stephen Quinney <squinney@inf.ed.ac.uk>
+ * @copyright 2014-2018 University of Edinburgh. All rights reserved. This project is released under the GNU Public License version 2.
+ * $Date$
+ * $Revision$
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libxml/xmlreader.h>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "xml.h"
+
+/* Compressed profiles are decompressed as they are read by passing a
+   decoding callback to xmlReaderForIO(), there is never a temporary
+   uncompressed copy of the file. The compression type is found from
+   the "magic" bytes at the start of the file, not the file name
+   suffix, so any name can be used. */
+
+static const unsigned char gzip_magic[] = { 0x1f, 0x8b };
+static const unsigned char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+/**
+ * @brief Find the type of compression used for a file
+ *
+ * This examines the first few bytes of the file to find the type of
+ * compression which has been used (if any).
+ *
+ * @param[in] data Pointer to the start of the file
+ * @param[in] len Number of bytes available
+ *
+ * @return The compression type
+ *
+ */
+
+LCFGXMLCompression lcfgxml_compression_type( const unsigned char * data,
+                                             size_t len ) {
+
+  if ( len >= sizeof(gzip_magic) &&
+       memcmp( data, gzip_magic, sizeof(gzip_magic) ) == 0 )
+    return LCFG_XML_COMPRESS_GZIP;
+
+  if ( len >= sizeof(zstd_magic) &&
+       memcmp( data, zstd_magic, sizeof(zstd_magic) ) == 0 )
+    return LCFG_XML_COMPRESS_ZSTD;
+
+  return LCFG_XML_COMPRESS_NONE;
+}
+
+/* gzip - the zlib gzFile functions do all the buffering */
+
+static int lcfgxml_gzip_read( void * context, char * buffer, int len ) {
+  return gzread( (gzFile) context, buffer, (unsigned int) len );
+}
+
+static int lcfgxml_gzip_close( void * context ) {
+  return ( gzclose( (gzFile) context ) == Z_OK ? 0 : -1 );
+}
+
+#ifdef HAVE_ZSTD
+
+/* zstd - the compressed data is read in blocks of the recommended
+   size and decompressed directly into the buffer for the reader. */
+
+struct LCFGXMLZstd {
+  FILE * fh;
+  ZSTD_DStream * stream;
+  ZSTD_inBuffer input;
+  void * buffer;
+  size_t buffer_size;
+  size_t remaining; /**< Hint from last call, zero at end of a frame */
+};
+
+typedef struct LCFGXMLZstd LCFGXMLZstd;
+
+static int lcfgxml_zstd_read( void * context, char * buffer, int len ) {
+
+  LCFGXMLZstd * zs = context;
+
+  ZSTD_outBuffer output = { buffer, (size_t) len, 0 };
+
+  /* Keep going until some data has been produced, the reader treats
+     zero as the end of the file */
+
+  while ( output.pos == 0 ) {
+
+    bool at_eof = false;
+
+    if ( zs->input.pos == zs->input.size ) {
+      size_t count = fread( zs->buffer, 1, zs->buffer_size, zs->fh );
+      if ( count > 0 ) {
+        zs->input.src  = zs->buffer;
+        zs->input.size = count;
+        zs->input.pos  = 0;
+      } else if ( ferror(zs->fh) ) {
+        return -1;
+      } else {
+        at_eof = true;
+      }
+    }
+
+    /* At the end of the file the decoder may still hold some output,
+       it is called with no further input until nothing more is
+       produced. Only then is an incomplete frame an error. The hint
+       from a call which produces nothing is not kept as once a frame
+       is complete it refers to the start of another frame. */
+
+    size_t hint = ZSTD_decompressStream( zs->stream, &output, &( zs->input ) );
+    if ( ZSTD_isError(hint) ) return -1;
+
+    if ( at_eof && output.pos == 0 )
+      return ( zs->remaining != 0 ? -1 : 0 );
+
+    zs->remaining = hint;
+  }
+
+  return (int) output.pos;
+}
+
+static int lcfgxml_zstd_close( void * context ) {
+
+  LCFGXMLZstd * zs = context;
+
+  int rc = fclose(zs->fh);
+  ZSTD_freeDStream(zs->stream);
+  free(zs->buffer);
+  free(zs);
+
+  return ( rc == 0 ? 0 : -1 );
+}
+
+static LCFGXMLZstd * lcfgxml_zstd_open( const char * filename ) {
+
+  FILE * fh = fopen( filename, "r" );
+  if ( fh == NULL ) return NULL;
+
+  LCFGXMLZstd * zs = calloc( 1, sizeof(LCFGXMLZstd) );
+  if ( zs == NULL ) {
+    perror( "Failed to allocate memory for zstd decompression" );
+    exit(EXIT_FAILURE);
+  }
+
+  zs->fh          = fh;
+  zs->buffer_size = ZSTD_DStreamInSize();
+  zs->buffer      = malloc(zs->buffer_size);
+  zs->stream      = ZSTD_createDStream();
+
+  if ( zs->buffer == NULL || zs->stream == NULL ) {
+    perror( "Failed to allocate memory for zstd decompression" );
+    exit(EXIT_FAILURE);
+  }
+
+  ZSTD_initDStream(zs->stream);
+
+  return zs;
+}
+
+#endif /* HAVE_ZSTD */
+
+/**
+ * @brief Create an XML reader for a possibly compressed file
+ *
+ * This creates a new XML reader for the specified file. If the file
+ * has been compressed with gzip (or zstd, when support was enabled
+ * at build time) it is decompressed as it is read. Otherwise this is
+ * the same as calling @c xmlReaderForFile().
+ *
+ * The file is always read as @c UTF-8 with the standard LCFG parser
+ * options.
+ *
+ * @param[in] filename The name of the XML file
+ * @param[out] result Reference to pointer for new reader
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgxml_reader_for_file( const char * filename,
+                                    xmlTextReaderPtr * result,
+                                    char ** msg ) {
+  assert( filename != NULL );
+
+  *result = NULL;
+
+  /* Check the magic bytes at the start of the file */
+
+  FILE * fh = fopen( filename, "r" );
+  if ( fh == NULL ) {
+    if (errno == ENOENT) {
+      return lcfgxml_error( msg, "File '%s' does not exist", filename );
+    } else {
+      return lcfgxml_error( msg, "File '%s' is not readable", filename );
+    }
+  }
+
+  unsigned char magic[4];
+  size_t magic_len = fread( magic, 1, sizeof(magic), fh );
+  fclose(fh);
+
+  const int options = XML_PARSE_DTDATTR | XML_PARSE_NOENT;
+
+  xmlTextReaderPtr reader = NULL;
+
+  switch ( lcfgxml_compression_type( magic, magic_len ) ) {
+  case LCFG_XML_COMPRESS_GZIP:
+    ;
+    gzFile gz = gzopen( filename, "rb" );
+    if ( gz == NULL )
+      return lcfgxml_error( msg, "Failed to open compressed file '%s'",
+                            filename );
+
+    /* The close function is called if the reader cannot be created */
+
+    reader = xmlReaderForIO( lcfgxml_gzip_read, lcfgxml_gzip_close, gz,
+                             filename, "UTF-8", options );
+    break;
+  case LCFG_XML_COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+    ;
+    LCFGXMLZstd * zs = lcfgxml_zstd_open(filename);
+    if ( zs == NULL )
+      return lcfgxml_error( msg, "Failed to open compressed file '%s'",
+                            filename );
+
+    reader = xmlReaderForIO( lcfgxml_zstd_read, lcfgxml_zstd_close, zs,
+                             filename, "UTF-8", options );
+    break;
+#else
+    return lcfgxml_error( msg, "File '%s' is compressed with zstd which is not supported", filename );
+#endif
+  default:
+    reader = xmlReaderForFile( filename, "UTF-8", options );
+    break;
+  }
+
+  if ( reader == NULL )
+    return lcfgxml_error( msg, "Failed to initialise the LCFG XML reader" );
+
+  *result = reader;
+
+  return LCFG_STATUS_OK;
+}
+
+/* eof */
@@ -66,10 +66,9 @@ int main(int argc, char* argv[]) {
                override_msg );
     }
 
-    LCFGChange override_change = lcfgprofile_overrides_xmldir( new_profile,
-                                                               override_dir,
-                                                               ctxlist,
-                                                               &override_msg );
+    LCFGChange override_change =
+      lcfgprofile_overrides_xmldir_parallel( new_profile, override_dir,
+                                             ctxlist, &override_msg );
 
     if ( override_change == LCFG_CHANGE_ERROR ) {
       fprintf( stderr, "Failed to apply context overrides to profile: %s\n",
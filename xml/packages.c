@@ -41,72 +41,47 @@ static LCFGStatus lcfgxml_gather_package_attributes( xmlTextReaderPtr reader,
   assert( reader != NULL );
   assert( pkg != NULL );
 
-  if ( !xmlTextReaderHasAttributes(reader) ) return LCFG_STATUS_OK;
-
-  LCFGStatus status = LCFG_STATUS_OK;
+  LCFGXMLAttributes attrs;
+  lcfgxml_gather_attributes( reader, &attrs );
 
   /* Do the derivation first so that any errors after this point get
      the derivation information attached. */
 
-  xmlChar * derivation =
-    xmlTextReaderGetAttribute( reader, BAD_CAST "cfg:derivation" );
-  if ( derivation != NULL && xmlStrlen(derivation) > 0 ) {
+  const char * derivation = (const char *) attrs.derivation;
+  if ( !isempty(derivation) ) {
 
     char * drvmsg = NULL;
     LCFGDerivationList * drvlist =
-      lcfgderivmap_find_or_insert_string( drvmap, (char *) derivation,
-                                          &drvmsg );
+      lcfgderivmap_find_or_insert_string( drvmap, derivation, &drvmsg );
 
     bool ok = false;
 
     if ( drvlist != NULL )
       ok = lcfgpackage_set_derivation( pkg, drvlist );
 
-    if (!ok) {
-      status = LCFG_STATUS_ERROR;
+    if (!ok)
       *msg = lcfgpackage_build_message( pkg, "Invalid derivation '%s': %s",
-                                        (char *) derivation, drvmsg );
-    }
+                                        derivation, drvmsg );
 
     free(drvmsg);
-  }
-
-  xmlFree(derivation);
-  derivation = NULL;
 
-  if ( status == LCFG_STATUS_ERROR ) return status;
+    if (!ok) return LCFG_STATUS_ERROR;
+  }
 
   /* Context Expression */
 
-  xmlChar * context =
-    xmlTextReaderGetAttribute( reader, BAD_CAST "cfg:context" );
-  if ( context != NULL && xmlStrlen(context) > 0 ) {
-
-    if ( lcfgpackage_has_context(pkg) ) {
-
-      if ( !lcfgpackage_add_context( pkg, (char *) context ) )
-        status = LCFG_STATUS_ERROR;
-
-    } else {
+  const char * context = (const char *) attrs.context;
+  if ( !isempty(context) ) {
 
-      if ( lcfgpackage_set_context( pkg, (char *) context ) )
-        context = NULL; /* Package now "owns" context string */
-      else
-        status = LCFG_STATUS_ERROR;
-
-    }
-
-    if ( status == LCFG_STATUS_ERROR ) {
+    if ( !lcfgpackage_add_context( pkg, context ) ) {
       *msg = lcfgpackage_build_message( pkg, "Invalid context '%s'", 
-                                        (char *) context );
+                                        context );
+      return LCFG_STATUS_ERROR;
     }
 
   }
 
-  xmlFree(context);
-  context = NULL;
-
-  return status;
+  return LCFG_STATUS_OK;
 }
 
 /**
@@ -146,7 +121,7 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
      jump to 'cleanup' could otherwise leave them undefined. */
 
   int linenum = 0;
-  xmlChar * cur_element = NULL;
+  const xmlChar * cur_element = NULL;
 
   /* Gather any derivation and context information */
 
@@ -179,15 +154,16 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
 
   while ( !done && read_status == 1 ) {
 
-    xmlChar * nodename  = xmlTextReaderName(reader);
+    /* The element names are interned in the dictionary for the reader
+       so they remain valid after the reader has moved on. */
+
+    const xmlChar * nodename = xmlTextReaderConstName(reader);
     int nodetype        = xmlTextReaderNodeType(reader);
     int nodedepth       = xmlTextReaderDepth(reader);
     linenum             = xmlTextReaderGetParserLineNumber(reader);
 
     if ( nodetype == XML_READER_TYPE_ELEMENT ) {
 
-      xmlFree(cur_element);
-
       cur_element = nodename;
 
       /* examine the next node to see if it is a text node */
@@ -208,7 +184,7 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
            a "secondary" architecture prefix. In that case the forward
            slash character is used as a separator */
 
-        if ( xmlStrcmp(nodename, BAD_CAST "name" ) == 0 ) {
+        if ( xmlStrEqual( nodename, BAD_CAST "name" ) ) {
           char * archname = (char *) nodevalue;
 
           /* Check for the '/' (forward-slash) separator */
@@ -263,7 +239,7 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
 
         /* Version */
 
-        } else if ( xmlStrcmp(nodename, BAD_CAST "v" ) == 0 ) {
+        } else if ( xmlStrEqual( nodename, BAD_CAST "v" ) ) {
 
           if ( !lcfgpackage_set_version( pkg, (char *) nodevalue ) ) {
             status = LCFG_STATUS_ERROR;
@@ -275,7 +251,7 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
 
         /* Release (and optional architecture) */
 
-        } else if ( xmlStrcmp(nodename, BAD_CAST "r" ) == 0 ) {
+        } else if ( xmlStrEqual( nodename, BAD_CAST "r" ) ) {
 
           /* Sometimes the arch is encoded in the release field,
              if it is included there will be a '/' (forward slash)
@@ -320,7 +296,7 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
 
         /* Flags */
 
-        } else if ( xmlStrcmp(nodename, BAD_CAST "options" ) == 0 ) {
+        } else if ( xmlStrEqual( nodename, BAD_CAST "options" ) ) {
 
           if ( !lcfgpackage_set_flags( pkg, (char *) nodevalue ) ) {
             status = LCFG_STATUS_ERROR;
@@ -346,10 +322,10 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
       if ( nodetype == XML_READER_TYPE_END_ELEMENT ) {
 
         if ( nodedepth == topdepth &&
-             xmlStrcmp(nodename, BAD_CAST LCFGXML_PACKAGES_CHILD_NODE ) == 0 ) {
+             xmlStrEqual( nodename, BAD_CAST LCFGXML_PACKAGES_CHILD_NODE ) ) {
           done = true;
         } else if ( cur_element == NULL ||
-                    xmlStrcmp(nodename, cur_element) != 0 ) {
+                    !xmlStrEqual( nodename, cur_element ) ) {
           status = lcfgxml_error( msg, "Unexpected end element '%s' at line %d whilst processing package.", nodename, linenum );
         }
 
@@ -360,9 +336,6 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
 
       }
 
-      xmlFree(nodename);
-      nodename = NULL;
-
     }
 
     /* Quit if the processing status is no longer OK */
@@ -376,8 +349,6 @@ static LCFGStatus lcfgxml_process_package( xmlTextReaderPtr reader,
 
  cleanup:
 
-  xmlFree(cur_element);
-
   if ( status == LCFG_STATUS_ERROR ) {
 
     if ( *msg == NULL )
@@ -466,13 +437,13 @@ LCFGStatus lcfgxml_process_packages( xmlTextReaderPtr reader,
 
   while ( !done && read_status == 1 ) {
 
-    xmlChar * nodename  = xmlTextReaderName(reader);
+    const xmlChar * nodename = xmlTextReaderConstName(reader);
     int nodetype        = xmlTextReaderNodeType(reader);
     int nodedepth       = xmlTextReaderDepth(reader);
     linenum             = xmlTextReaderGetParserLineNumber(reader);
 
     if ( nodetype == XML_READER_TYPE_ELEMENT &&
-         xmlStrcmp(nodename, BAD_CAST LCFGXML_PACKAGES_CHILD_NODE ) == 0 ) {
+         xmlStrEqual( nodename, BAD_CAST LCFGXML_PACKAGES_CHILD_NODE ) ) {
 
       LCFGPackage * pkg = NULL;
 
@@ -521,7 +492,7 @@ LCFGStatus lcfgxml_process_packages( xmlTextReaderPtr reader,
     } else if ( nodetype == XML_READER_TYPE_END_ELEMENT ) {
 
       if ( nodedepth == topdepth &&
-           xmlStrcmp( nodename, BAD_CAST LCFGXML_PACKAGES_PARENT_NODE ) == 0 ) {
+           xmlStrEqual( nodename, BAD_CAST LCFGXML_PACKAGES_PARENT_NODE ) ) {
         done = true;
       } else {
 
@@ -536,9 +507,6 @@ LCFGStatus lcfgxml_process_packages( xmlTextReaderPtr reader,
 
     }
 
-    xmlFree(nodename);
-    nodename = NULL;
-
     /* Quit if the processing status is no longer OK */
     if ( status == LCFG_STATUS_ERROR )
       done = true;
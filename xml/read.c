@@ -7,18 +7,27 @@
  * $Revision: 32561 $
  */
 
+#define _GNU_SOURCE /* for memmem */
+
 #include <assert.h>
+#include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <libxml/xmlreader.h>
 
+#include "differences.h"
+#include "farmhash.h"
 #include "utils.h"
 #include "xml.h"
 
@@ -54,7 +63,11 @@ LCFGStatus lcfgxml_collect_metadata( xmlTextReaderPtr reader,
   assert( stop_nodename != NULL );
   assert( profile != NULL );
 
-  xmlChar * metaname = NULL;
+  /* The element names are interned in the dictionary for the reader
+     so they remain valid after the reader has moved on and do not
+     need to be copied or freed. */
+
+  const xmlChar * metaname = NULL;
 
   bool done = false;
   LCFGStatus status = LCFG_STATUS_OK;
@@ -62,34 +75,28 @@ LCFGStatus lcfgxml_collect_metadata( xmlTextReaderPtr reader,
   int read_status = 1;
   while ( !done && read_status == 1 ) {
 
-    xmlChar * nodename  = xmlTextReaderName(reader);
+    const xmlChar * nodename = xmlTextReaderConstName(reader);
     int nodetype        = xmlTextReaderNodeType(reader);
     int nodedepth       = xmlTextReaderDepth(reader);
     int linenum         = xmlTextReaderGetParserLineNumber(reader);
 
-    if (xmlStrcmp(nodename, BAD_CAST stop_nodename) == 0 ) {
-      xmlFree(nodename);
-      nodename = NULL;
-
+    if ( xmlStrEqual( nodename, BAD_CAST stop_nodename ) ) {
       done = true;
     } else {
       if ( nodedepth == LCFGXML_ATTR_DEPTH ) {
 
         if ( nodetype == XML_READER_TYPE_ELEMENT ) {
 
-          xmlFree(metaname);
           metaname = nodename;
 
         } else {
 
           if ( ! ( nodetype == XML_READER_TYPE_END_ELEMENT &&
-                   xmlStrcmp( nodename, metaname ) == 0 )  &&
+                   xmlStrEqual( nodename, metaname ) )  &&
                nodetype != XML_READER_TYPE_SIGNIFICANT_WHITESPACE ) {
             status = lcfgxml_error( msg, "Unexpected element '%s' of type %d at line %d whilst gathering metadata", nodename, nodetype, linenum );
           }
 
-          xmlFree(nodename);
-          nodename = NULL;
         }
 
       } else {
@@ -99,15 +106,15 @@ LCFGStatus lcfgxml_collect_metadata( xmlTextReaderPtr reader,
 
           xmlChar * nodevalue = xmlTextReaderValue(reader);
 
-          if (        xmlStrcmp( metaname, BAD_CAST "published_by"       ) == 0 ) {
+          if (        xmlStrEqual( metaname, BAD_CAST "published_by"       ) ) {
             profile->published_by       = (char *) nodevalue;
-          } else if ( xmlStrcmp( metaname, BAD_CAST "published_at"       ) == 0 ) {
+          } else if ( xmlStrEqual( metaname, BAD_CAST "published_at"       ) ) {
             profile->published_at       = (char *) nodevalue;
-          } else if ( xmlStrcmp( metaname, BAD_CAST "server_version"     ) == 0 ) {
+          } else if ( xmlStrEqual( metaname, BAD_CAST "server_version"     ) ) {
             profile->server_version     = (char *) nodevalue;
-          } else if ( xmlStrcmp( metaname, BAD_CAST "last_modified"      ) == 0 ) {
+          } else if ( xmlStrEqual( metaname, BAD_CAST "last_modified"      ) ) {
             profile->last_modified      = (char *) nodevalue;
-          } else if ( xmlStrcmp( metaname, BAD_CAST "last_modified_file" ) == 0 ) {
+          } else if ( xmlStrEqual( metaname, BAD_CAST "last_modified_file" ) ) {
             profile->last_modified_file = (char *) nodevalue;
           }
 
@@ -115,8 +122,6 @@ LCFGStatus lcfgxml_collect_metadata( xmlTextReaderPtr reader,
           status = lcfgxml_error( msg, "Unexpected element '%s' of type %d at line %d whilst gathering metadata", nodename, nodetype, linenum );
         }
 
-        xmlFree(nodename);
-        nodename = NULL;
       }
 
     }
@@ -130,9 +135,6 @@ LCFGStatus lcfgxml_collect_metadata( xmlTextReaderPtr reader,
 
   }
 
-  xmlFree(metaname);
-  metaname = NULL;
-
   return status;
 }
 
@@ -141,6 +143,8 @@ LCFGStatus lcfgxml_collect_metadata( xmlTextReaderPtr reader,
  *
  * This will create a new XML reader for the specified file and
  * position the reader at the top @c "lcfg" node in the LCFG profile.
+ * The file may be compressed, see @c lcfgxml_reader_for_file() for
+ * the supported types.
  *
  * If an error occurs the @c NULL value will be returned.
  *
@@ -160,30 +164,15 @@ LCFGStatus lcfgxml_init_reader( const char * filename,
   if ( isempty(filename) )
     return lcfgxml_error( msg, "Invalid XML profile filename" );
 
-  /* 1. Firstly need to check that the file actually exists and is
-        readable. Doing an fopen is better than just calling stat. */
-
-  FILE *file;
-  if ((file = fopen(filename, "r")) == NULL) {
-
-    if (errno == ENOENT) {
-      return lcfgxml_error( msg, "File '%s' does not exist", filename );
-    } else {
-      return lcfgxml_error( msg, "File '%s' is not readable", filename );
-    }
-
-  } else {
-    fclose(file);
-  }
-
-  /* 2. Initialise the XML reader */
+  /* 1. Initialise the XML reader, this also checks that the file
+        actually exists and is readable. Compressed files are
+        decompressed as they are read. */
 
-  xmlTextReaderPtr reader = xmlReaderForFile( filename, "UTF-8",
-                                           XML_PARSE_DTDATTR | XML_PARSE_NOENT);
-  if ( reader == NULL )
-    return lcfgxml_error( msg, "Failed to initialise the LCFG XML reader" );
+  xmlTextReaderPtr reader = NULL;
+  LCFGStatus status = lcfgxml_reader_for_file( filename, &reader, msg );
+  if ( status == LCFG_STATUS_ERROR ) return status;
 
-  /* 3. Walk to the start of the profile */
+  /* 2. Walk to the start of the profile */
 
   bool ok = lcfgxml_moveto_node( reader, LCFGXML_TOP_NODE );
   if ( ok )
@@ -191,7 +180,8 @@ LCFGStatus lcfgxml_init_reader( const char * filename,
 
   if ( !ok ) {
     /* not a valid lcfg profile */
-    lcfgxml_end_reader(reader);
+    xmlTextReaderClose(reader);
+    xmlFreeTextReader(reader);
     reader = NULL;
     lcfgxml_error( msg, "Invalid LCFG XML profile" );
   }
@@ -221,61 +211,35 @@ void lcfgxml_end_reader(xmlTextReaderPtr reader) {
 
 }
 
-/**
- * @brief Process XML for LCFG profile
- *
- * This is the top-level function for processing LCFG XML profiles. It
- * will process the data for components/resources and packages and
- * load them into a new @c LCFGProfile.
- *
- * @param[in] filename The filename for the XML profile.
- * @param[out] result Reference to pointer to new @c LCFGProfile
- * @param[in] base_context A context which will be applied to all resources
- * @param[in] base_derivation A derivation which will be applied to all resources and packages
- * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
- * @param[in] comps_wanted An @c LCFGTagList of names for the desired components
- * @param[in] require_packages Boolean which indicates if packages are required
- * @param[out] msg Pointer to any diagnostic messages
- *
- * @return Status value indicating success of the process
- *
- */
+/* The processing loops all stop when the reader does not return a
+   node, a parse or read error (e.g. a truncated compressed file) is
+   otherwise indistinguishable from reaching the end of the file. */
 
-LCFGStatus lcfgprofile_from_xml( const char * filename,
-				 LCFGProfile ** result,
-				 const char * base_context,
-				 const char * base_derivation,
-				 const LCFGContextList * ctxlist,
-				 const LCFGTagList * comps_wanted,
-				 bool require_packages,
-				 char ** msg ) {
-  assert( filename != NULL );
+static bool lcfgxml_read_failed( xmlTextReaderPtr reader ) {
+  return ( xmlTextReaderReadState(reader) == XML_TEXTREADER_MODE_ERROR );
+}
 
-  /* Declare variables here that are required in cleanup stage */
+/* Process the metadata, components and packages for a profile from
+   a reader which has been positioned at the start of the profile. */
 
-  LCFGProfile * profile = NULL;
+static LCFGStatus lcfgxml_process_profile( xmlTextReaderPtr reader,
+                                           LCFGProfile * profile,
+                                           const char * base_context,
+                                           const char * base_derivation,
+                                           const LCFGContextList * ctxlist,
+                                           const LCFGTagList * comps_wanted,
+                                           bool require_packages,
+                                           LCFGOption options,
+                                           char ** msg ) {
 
   LCFGStatus status = LCFG_STATUS_OK;
 
-  /* Initialise the XML reader for the file */
-
-  xmlTextReaderPtr reader = NULL;
-  status = lcfgxml_init_reader( filename, &reader, msg );
-
-  if ( status == LCFG_STATUS_ERROR ) goto cleanup;
-
-  profile = lcfgprofile_new();
-
-  struct stat sb;
-  if ( stat( filename, &sb ) == 0 )
-    profile->mtime = sb.st_mtime;
-
   /* First metadata group */
 
   status = lcfgxml_collect_metadata( reader, LCFGXML_COMPS_PARENT_NODE,
                                      profile, msg );
 
-  if ( status == LCFG_STATUS_ERROR ) goto cleanup;
+  if ( status == LCFG_STATUS_ERROR ) return status;
 
   /* components */
 
@@ -287,14 +251,14 @@ LCFGStatus lcfgprofile_from_xml( const char * filename,
 
     status = lcfgxml_process_components( reader, &profile->components, 
                                          base_context, base_derivation,
-                                         ctxlist, comps_wanted, 
-                                         msg );
+                                         ctxlist, comps_wanted,
+                                         options, msg );
 
   } else {
     status = lcfgxml_error( msg, "Failed to find components section in LCFG XML profile." );
   }
 
-  if ( status != LCFG_STATUS_OK ) goto cleanup;
+  if ( status != LCFG_STATUS_OK ) return status;
 
   /* packages */
 
@@ -316,16 +280,63 @@ LCFGStatus lcfgprofile_from_xml( const char * filename,
     status = lcfgxml_error( msg, "Failed to find packages section in LCFG XML profile." );
   }
 
-  if ( status != LCFG_STATUS_OK ) goto cleanup;
+  if ( status != LCFG_STATUS_OK ) return status;
 
   /* final metadata section */
 
   status = lcfgxml_collect_metadata( reader, LCFGXML_TOP_NODE,
                                      profile, msg );
 
+  if ( status != LCFG_STATUS_ERROR && lcfgxml_read_failed(reader) )
+    status = lcfgxml_error( msg, "Failed to read LCFG XML profile" );
+
+  return status;
+}
+
+/* Does all the work for lcfgprofile_from_xml() except for cleaning
+   up the parser so that it can be used from multiple threads. */
+
+static LCFGStatus lcfgxml_read_profile( const char * filename,
+                                        LCFGProfile ** result,
+                                        const char * base_context,
+                                        const char * base_derivation,
+                                        const LCFGContextList * ctxlist,
+                                        const LCFGTagList * comps_wanted,
+                                        bool require_packages,
+                                        LCFGOption options,
+                                        char ** msg ) {
+  assert( filename != NULL );
+
+  /* Declare variables here that are required in cleanup stage */
+
+  LCFGProfile * profile = NULL;
+
+  LCFGStatus status = LCFG_STATUS_OK;
+
+  /* Initialise the XML reader for the file */
+
+  xmlTextReaderPtr reader = NULL;
+  status = lcfgxml_init_reader( filename, &reader, msg );
+
+  if ( status == LCFG_STATUS_ERROR ) goto cleanup;
+
+  profile = lcfgprofile_new();
+
+  struct stat sb;
+  if ( stat( filename, &sb ) == 0 )
+    profile->mtime = sb.st_mtime;
+
+  status = lcfgxml_process_profile( reader, profile,
+                                    base_context, base_derivation,
+                                    ctxlist, comps_wanted,
+                                    require_packages, options, msg );
+
  cleanup:
 
-  lcfgxml_end_reader(reader);
+  if ( reader != NULL ) {
+    xmlTextReaderClose(reader);
+    xmlFreeTextReader(reader);
+  }
 
   if ( status == LCFG_STATUS_ERROR ) {
     lcfgprofile_destroy(profile);
@@ -338,145 +349,2263 @@ LCFGStatus lcfgprofile_from_xml( const char * filename,
 }
 
 /**
- * @brief Apply override profiles to current profile
+ * @brief Process XML for LCFG profile
  *
- * This can be used to import local overrides for components. The
- * specified directory is searched for override files which should be
- * named like @c component.xml. Files with names which are not valid
- * component names will be ignored, similarly if the processing of the
- * XML file fails it will be ignored. The @c LCFGComponent loaded from
- * the override file will @b completely replace any existing instance
- * of a component with the same name in the main @c LCFGProfile. This
- * is primarily intended as a useful feature for development
- * environments rather than those which are live.
+ * This is the top-level function for processing LCFG XML profiles. It
+ * will process the data for components/resources and packages and
+ * load them into a new @c LCFGProfile. The profile may be compressed
+ * with gzip (or zstd when that is supported).
  *
- * @param[in] main_profile Pointer to @c LCFGProfile
- * @param[in] override_dir The path to the directory of XML override profiles
- * @param[in] ctxlist An @c LCFGContextList of current contexts
+ * This is the same as calling @c lcfgprofile_from_xml_with_options()
+ * with no options.
+ *
+ * @param[in] filename The filename for the XML profile.
+ * @param[out] result Reference to pointer to new @c LCFGProfile
+ * @param[in] base_context A context which will be applied to all resources
+ * @param[in] base_derivation A derivation which will be applied to all resources and packages
+ * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
+ * @param[in] comps_wanted An @c LCFGTagList of names for the desired components
+ * @param[in] require_packages Boolean which indicates if packages are required
  * @param[out] msg Pointer to any diagnostic messages
  *
- * @return Integer value indicating type of change
+ * @return Status value indicating success of the process
  *
  */
 
-LCFGChange lcfgprofile_overrides_xmldir( LCFGProfile * main_profile,
-                                         const char * override_dir,
-                                         const LCFGContextList * ctxlist,
-                                         char ** msg ) {
-  assert( main_profile != NULL );
+LCFGStatus lcfgprofile_from_xml( const char * filename,
+				 LCFGProfile ** result,
+				 const char * base_context,
+				 const char * base_derivation,
+				 const LCFGContextList * ctxlist,
+				 const LCFGTagList * comps_wanted,
+				 bool require_packages,
+				 char ** msg ) {
 
-  /* If the overrides directory does not exist then just return success */
+  return lcfgprofile_from_xml_with_options( filename, result,
+                                            base_context, base_derivation,
+                                            ctxlist, comps_wanted,
+                                            require_packages, LCFG_OPT_NONE,
+                                            msg );
+}
 
-  struct stat sb;
-  if ( isempty(override_dir) ||
-       ( stat( override_dir, &sb ) != 0 && errno == ENOENT ) ) {
-    return LCFG_CHANGE_NONE;
-  }
+/**
+ * @brief Process XML for LCFG profile with options
+ *
+ * This does the same as @c lcfgprofile_from_xml() but also takes
+ * options which control how the profile is loaded.
+ *
+ * If the @c LCFG_OPT_USE_ARENA option is specified then the resources
+ * for each component are allocated from an arena owned by the
+ * component, see @c lcfgcomponent_use_arena() for details. This is
+ * only worthwhile for a profile which will not be modified after it
+ * is loaded.
+ *
+ * @param[in] filename The filename for the XML profile.
+ * @param[out] result Reference to pointer to new @c LCFGProfile
+ * @param[in] base_context A context which will be applied to all resources
+ * @param[in] base_derivation A derivation which will be applied to all resources and packages
+ * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
+ * @param[in] comps_wanted An @c LCFGTagList of names for the desired components
+ * @param[in] require_packages Boolean which indicates if packages are required
+ * @param[in] options Integer that controls loading behaviour
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Status value indicating success of the process
+ *
+ */
 
-  DIR * dh = opendir(override_dir);
-  if ( dh == NULL ) {
-    lcfgxml_error( msg, "XML override directory '%s' is not accessible",
-                   override_dir );
-    return LCFG_CHANGE_ERROR;
+LCFGStatus lcfgprofile_from_xml_with_options( const char * filename,
+                                              LCFGProfile ** result,
+                                              const char * base_context,
+                                              const char * base_derivation,
+                                              const LCFGContextList * ctxlist,
+                                              const LCFGTagList * comps_wanted,
+                                              bool require_packages,
+                                              LCFGOption options,
+                                              char ** msg ) {
+
+  LCFGStatus status = lcfgxml_read_profile( filename, result,
+                                            base_context, base_derivation,
+                                            ctxlist, comps_wanted,
+                                            require_packages, options, msg );
+
+  xmlCleanupParser();
+
+  return status;
+}
+
+/* Parallel profile loading
+
+   For large profiles the components (and packages) can be parsed on
+   separate threads. The file is mapped into memory and a simple scan
+   (which does not build any nodes) finds the byte range of each
+   component element and of the packages element. Each thread is
+   given a fragment of the file which is presented to its own XML
+   reader as a complete document: the start tag for the top-level
+   lcfg element (so that any namespace declarations are available),
+   the start tag for the components element, a run of consecutive
+   components and the necessary closing tags. Newlines are inserted
+   so that the line numbers reported in any error messages refer to
+   the original file.
+
+   The metadata is collected from a "skeleton" of the profile which
+   has the contents of the components and packages elements removed,
+   this is processed in exactly the same way as the full profile so
+   all the checks on the structure are still done. The results are
+   merged in file order so the profile is identical to that from a
+   serial parse.
+*/
+
+#define LCFGXML_PARALLEL_MIN_SIZE    131072 /* Smaller profiles are not split */
+#define LCFGXML_PARALLEL_MAX_THREADS 16
+#define LCFGXML_FRAGMENT_MAX_SEGS    10
+
+struct LCFGXMLSegment {
+  const char * start;   /**< Start of data (@c NULL for newline padding) */
+  size_t length;        /**< Length of data or number of newlines */
+};
+
+typedef struct LCFGXMLSegment LCFGXMLSegment;
+
+struct LCFGXMLFragment {
+  LCFGXMLSegment segments[LCFGXML_FRAGMENT_MAX_SEGS];
+  unsigned int count;   /**< Number of segments */
+  unsigned int current; /**< Segment currently being read */
+  size_t offset;        /**< Offset within current segment */
+  size_t line;          /**< Line number at end of fragment */
+};
+
+typedef struct LCFGXMLFragment LCFGXMLFragment;
+
+struct LCFGXMLRange {
+  const char * start;   /**< Start of the element */
+  const char * end;     /**< End of the element (not inclusive) */
+  size_t line;          /**< Line number for start of the element */
+};
+
+typedef struct LCFGXMLRange LCFGXMLRange;
+
+/* The layout of the profile as found by lcfgxml_scan_profile() */
+
+struct LCFGXMLLayout {
+  const char * map_end;
+  const char * cursor;    /**< Position up to which lines have been counted */
+  size_t cursor_line;     /**< Line number at the cursor */
+  LCFGXMLRange root;      /**< Start tag for top-level element */
+  LCFGXMLRange root_name; /**< Name of top-level element */
+  LCFGXMLRange comps;     /**< Start tag for components element */
+  const char * comps_end; /**< Start of components end tag */
+  size_t comps_end_line;
+  LCFGXMLRange pkgs;      /**< Complete packages element */
+  const char * pkgs_body; /**< End of packages start tag */
+  const char * pkgs_end;  /**< Start of packages end tag */
+  size_t pkgs_end_line;
+  LCFGXMLRange * children;  /**< Component elements */
+  unsigned int nchildren;
+  unsigned int size;
+};
+
+typedef struct LCFGXMLLayout LCFGXMLLayout;
+
+struct LCFGXMLJob {
+  LCFGXMLFragment fragment;
+  const char * filename;
+  const char * base_context;
+  const char * base_derivation;
+  const LCFGContextList * ctxlist;
+  const LCFGTagList * comps_wanted;
+  LCFGOption options;
+  bool is_packages;                /**< Whether fragment holds packages */
+  LCFGComponentSet * components;
+  LCFGPackageSet * active_packages;
+  LCFGPackageSet * inactive_packages;
+  LCFGStatus status;
+  char * error_msg;
+};
+
+typedef struct LCFGXMLJob LCFGXMLJob;
+
+static size_t lcfgxml_count_lines( const char * start, const char * end ) {
+
+  size_t count = 0;
+  const char * pos = start;
+  while ( pos < end &&
+          ( pos = memchr( pos, '\n', end - pos ) ) != NULL ) {
+    count++;
+    pos++;
   }
 
-  LCFGChange change = LCFG_CHANGE_NONE;
+  return count;
+}
 
-  struct dirent * entry;
+static size_t lcfgxml_layout_line( LCFGXMLLayout * layout,
+                                   const char * pos ) {
 
-  while( ( entry = readdir(dh) ) != NULL ) {
+  layout->cursor_line += lcfgxml_count_lines( layout->cursor, pos );
+  layout->cursor = pos;
 
-    if ( *( entry->d_name ) == '.' ) continue; /* ignore any dot-files */
+  return layout->cursor_line;
+}
+
+static bool lcfgxml_name_is( const char * name, size_t len,
+                             const char * want ) {
+  return ( strlen(want) == len && strncmp( name, want, len ) == 0 );
+}
+
+/* Find the end of a section (comment, CDATA, etc) which is terminated
+   by a string, returns a pointer to the character after the end. */
 
-    /* Looking for any file with a .xml suffix but must also have a
-       basename which is used as the name of the component to
-       override */
+static const char * lcfgxml_skip_past( const char * pos, const char * end,
+                                       const char * term ) {
 
-    if ( lcfgutils_string_endswith( entry->d_name, ".xml" ) ) {
+  const char * found = memmem( pos, end - pos, term, strlen(term) );
 
-      char * comp_name = lcfgutils_basename( entry->d_name, ".xml" );
-      if ( !lcfgcomponent_valid_name(comp_name) ) {
-        /* ignoring files with invalid names */
+  return ( found != NULL ? found + strlen(term) : NULL );
+}
 
-        free(comp_name);
+/* Scan the profile to find the elements which can be parsed
+   separately. This is not a complete XML parser, anything unexpected
+   (e.g. a DOCTYPE which might declare entities or default attributes)
+   causes a false value to be returned and the profile is then parsed
+   serially which will report any errors in the usual way. */
 
-        continue;
+static bool lcfgxml_scan_profile( const char * map, size_t map_size,
+                                  LCFGXMLLayout * layout ) {
+
+  layout->map_end     = map + map_size;
+  layout->cursor      = map;
+  layout->cursor_line = 1;
+
+  const char * end = layout->map_end;
+  const char * pos = map;
+
+  int depth = 0;
+  bool in_comps = false, in_pkgs = false, seen_comps = false;
+
+  while ( pos < end ) {
+
+    const char * tag = memchr( pos, '<', end - pos );
+    if ( tag == NULL || tag + 1 >= end ) break;
+
+    pos = tag + 1;
+
+    if ( *pos == '?' ) {
+      pos = lcfgxml_skip_past( pos, end, "?>" );
+    } else if ( *pos == '!' ) {
+
+      if ( end - pos > 3 && strncmp( pos, "!--", 3 ) == 0 )
+        pos = lcfgxml_skip_past( pos, end, "-->" );
+      else if ( end - pos > 8 && strncmp( pos, "![CDATA[", 8 ) == 0 )
+        pos = lcfgxml_skip_past( pos, end, "]]>" );
+      else
+        return false;
+
+    } else {
+
+      /* Start or end tag, attribute values may contain '>' */
+
+      bool is_end = ( *pos == '/' );
+      const char * name = is_end ? pos + 1 : pos;
+
+      const char * close = name;
+      char quote = '\0';
+      while ( close < end && ( quote != '\0' || *close != '>' ) ) {
+        if ( quote != '\0' ) {
+          if ( *close == quote ) quote = '\0';
+        } else if ( *close == '"' || *close == '\'' ) {
+          quote = *close;
+        }
+        close++;
       }
+      if ( close == end ) return false;
+
+      size_t name_len = strcspn( name, " \t\r\n/>" );
+      if ( name + name_len > close || name_len == 0 ) return false;
+
+      bool is_empty = ( !is_end && *( close - 1 ) == '/' );
+
+      pos = close + 1;
+
+      if ( is_end ) {
+        depth--;
+
+        if ( depth == 1 && in_comps ) {
+          in_comps = false;
+          layout->comps_end = tag;
+          layout->comps_end_line = lcfgxml_layout_line( layout, tag );
+        } else if ( depth == 1 && in_pkgs ) {
+          in_pkgs = false;
+          layout->pkgs.end = pos;
+          layout->pkgs_end = tag;
+          layout->pkgs_end_line = lcfgxml_layout_line( layout, tag );
+        } else if ( depth == 2 && in_comps ) {
+          layout->children[layout->nchildren - 1].end = pos;
+        } else if ( depth == 0 ) {
+          break;
+        }
 
-      char * fullpath = lcfgutils_catfile( override_dir, entry->d_name );
+        if ( depth < 0 ) return false;
 
-      if ( fullpath == NULL ||
-           stat( fullpath, &sb ) != 0 ||
-           !S_ISREG(sb.st_mode) ) {
-        free(comp_name);
-        free(fullpath);
         continue;
       }
 
-      LCFGChange override_change = LCFG_CHANGE_NONE;
+      if ( depth == 0 ) {
 
-      /* We only want to load this component */
+        if ( !lcfgxml_name_is( name, name_len, LCFGXML_TOP_NODE ) ||
+             is_empty )
+          return false;
 
-      LCFGTagList * comps_wanted = lcfgtaglist_new();
-      char * tagmsg = NULL;
-      if ( lcfgtaglist_mutate_add( comps_wanted, comp_name, &tagmsg ) 
-           == LCFG_CHANGE_ERROR ) {
-        lcfgxml_error( msg, "Failed to create list of required components: ",
-                       tagmsg );
-        override_change = LCFG_CHANGE_ERROR;
-      }
-      free(tagmsg);
-      free(comp_name);
+        layout->root.start = tag;
+        layout->root.end   = pos;
+        layout->root.line  = lcfgxml_layout_line( layout, tag );
+        layout->root_name.start = name;
+        layout->root_name.end   = name + name_len;
 
-      LCFGProfile * override_profile = NULL;
-      char * import_msg = NULL;
+      } else if ( depth == 1 ) {
 
-      if ( override_change != LCFG_CHANGE_ERROR ) {
+        if ( lcfgxml_name_is( name, name_len, LCFGXML_COMPS_PARENT_NODE ) ) {
 
-        LCFGStatus read_status = 
-          lcfgprofile_from_xml( fullpath,
-                                &override_profile,/* result */
-                                NULL,            /* base context */
-                                fullpath,        /* base derivation */
-                                ctxlist,         /* current contexts */
-                                comps_wanted,
-                                false,           /* no packages */
-                                &import_msg );
+          if ( seen_comps || is_empty ) return false;
+          seen_comps = true;
+          in_comps   = true;
 
-        if ( read_status == LCFG_STATUS_ERROR )
-          override_change = LCFG_CHANGE_ERROR;
+          layout->comps.start = tag;
+          layout->comps.end   = pos;
+          layout->comps.line  = lcfgxml_layout_line( layout, tag );
 
-      }
+        } else if ( lcfgxml_name_is( name, name_len,
+                                     LCFGXML_PACKAGES_PARENT_NODE ) ) {
 
-      lcfgtaglist_relinquish(comps_wanted);
+          if ( layout->pkgs.start != NULL ) return false;
 
-      if ( override_change != LCFG_CHANGE_ERROR ) {
-        override_change = lcfgprofile_transplant_components( main_profile,
-                                                             override_profile,
-                                                             &import_msg );
-      }
+          if ( !is_empty ) {
+            in_pkgs = true;
+            layout->pkgs.start = tag;
+            layout->pkgs.line  = lcfgxml_layout_line( layout, tag );
+            layout->pkgs_body  = pos;
+          }
+
+        }
+
+      } else if ( depth == 2 && in_comps ) {
+
+        if ( layout->nchildren == layout->size ) {
+          unsigned int new_size = layout->size > 0 ? layout->size * 2 : 64;
+
+          LCFGXMLRange * new_children =
+            realloc( layout->children, new_size * sizeof(LCFGXMLRange) );
+          if ( new_children == NULL ) {
+            perror( "Failed to allocate memory whilst processing XML profile" );
+            exit(EXIT_FAILURE);
+          }
+
+          layout->children = new_children;
+          layout->size     = new_size;
+        }
+
+        LCFGXMLRange * child = &( layout->children[layout->nchildren] );
+        layout->nchildren++;
+
+        child->start = tag;
+        child->end   = pos;
+        child->line  = lcfgxml_layout_line( layout, tag );
 
-      if ( override_change == LCFG_CHANGE_ERROR ) {
-        /* warn but do not fail entire processing */
-        fprintf( stderr, "Failed to process '%s': %s\n", fullpath,
-                 import_msg );
-      } else if ( override_change != LCFG_CHANGE_NONE ) {
-        change = LCFG_CHANGE_MODIFIED;
       }
 
-      free(import_msg);
+      if ( !is_empty ) depth++;
 
-      lcfgprofile_destroy(override_profile);
+    }
 
-      free(fullpath);
+    if ( pos == NULL ) return false;
+  }
+
+  /* Must have seen the complete profile */
+
+  return ( depth == 0 && seen_comps && !in_comps && !in_pkgs &&
+           layout->root.start != NULL );
+}
+
+static void lcfgxml_fragment_add( LCFGXMLFragment * fragment,
+                                  const char * start, const char * end ) {
+  assert( fragment->count < LCFGXML_FRAGMENT_MAX_SEGS );
+
+  LCFGXMLSegment * seg = &( fragment->segments[fragment->count++] );
+  seg->start  = start;
+  seg->length = end - start;
+
+  fragment->line += lcfgxml_count_lines( start, end );
+}
+
+static void lcfgxml_fragment_add_str( LCFGXMLFragment * fragment,
+                                      const char * str ) {
+  lcfgxml_fragment_add( fragment, str, str + strlen(str) );
+}
+
+/* Pad with newlines so that the next data added starts on the line */
+
+static void lcfgxml_fragment_pad( LCFGXMLFragment * fragment,
+                                  size_t line ) {
+  assert( fragment->count < LCFGXML_FRAGMENT_MAX_SEGS );
+
+  if ( line <= fragment->line ) return;
+
+  LCFGXMLSegment * seg = &( fragment->segments[fragment->count++] );
+  seg->start  = NULL;
+  seg->length = line - fragment->line;
+
+  fragment->line = line;
+}
+
+static int lcfgxml_fragment_read( void * context, char * buffer, int len ) {
+
+  LCFGXMLFragment * fragment = context;
+
+  size_t done = 0;
+  while ( done < (size_t) len && fragment->current < fragment->count ) {
+    const LCFGXMLSegment * seg = &( fragment->segments[fragment->current] );
+
+    size_t want = seg->length - fragment->offset;
+    if ( want > (size_t) len - done )
+      want = (size_t) len - done;
+
+    if ( seg->start != NULL )
+      memcpy( buffer + done, seg->start + fragment->offset, want );
+    else
+      memset( buffer + done, '\n', want );
+
+    done += want;
+    fragment->offset += want;
 
+    if ( fragment->offset == seg->length ) {
+      fragment->current++;
+      fragment->offset = 0;
     }
+  }
+
+  return (int) done;
+}
+
+static int lcfgxml_fragment_close( void * context ) {
+  (void) context;
+  return 0;
+}
+
+static xmlTextReaderPtr lcfgxml_fragment_reader( LCFGXMLFragment * fragment,
+                                                 const char * filename ) {
+
+  return xmlReaderForIO( lcfgxml_fragment_read, lcfgxml_fragment_close,
+                         fragment, filename, "UTF-8",
+                         XML_PARSE_DTDATTR | XML_PARSE_NOENT );
+}
 
+static void * lcfgxml_parse_job( void * data ) {
+
+  LCFGXMLJob * job = data;
+
+  xmlTextReaderPtr reader = lcfgxml_fragment_reader( &job->fragment,
+                                                     job->filename );
+  if ( reader == NULL ) {
+    job->status = lcfgxml_error( &job->error_msg,
+                                 "Failed to initialise the LCFG XML reader" );
+    return NULL;
   }
 
-  closedir(dh);
+  if ( job->is_packages ) {
+    job->status = lcfgxml_process_packages( reader,
+                                            &job->active_packages,
+                                            &job->inactive_packages,
+                                            job->base_context,
+                                            job->base_derivation,
+                                            job->ctxlist,
+                                            &job->error_msg );
+  } else {
+    job->status = lcfgxml_process_components( reader, &job->components,
+                                              job->base_context,
+                                              job->base_derivation,
+                                              job->ctxlist,
+                                              job->comps_wanted,
+                                              job->options,
+                                              &job->error_msg );
+  }
 
-  return change;
+  if ( job->status != LCFG_STATUS_ERROR && lcfgxml_read_failed(reader) )
+    job->status = lcfgxml_error( &job->error_msg,
+                                 "Failed to read LCFG XML profile" );
+
+  /* Not lcfgxml_end_reader() as the parser must not be cleaned up
+     whilst other threads are still using it */
+
+  xmlTextReaderClose(reader);
+  xmlFreeTextReader(reader);
+
+  return NULL;
+}
+
+/* Every fragment starts with the start tag for the top-level element */
+
+static void lcfgxml_fragment_init( LCFGXMLFragment * fragment,
+                                   const LCFGXMLLayout * layout ) {
+
+  fragment->line = 1;
+  lcfgxml_fragment_pad( fragment, layout->root.line );
+  lcfgxml_fragment_add( fragment, layout->root.start, layout->root.end );
+}
+
+static void lcfgxml_fragment_finish( LCFGXMLFragment * fragment,
+                                     const LCFGXMLLayout * layout ) {
+
+  lcfgxml_fragment_add_str( fragment, "</" );
+  lcfgxml_fragment_add( fragment, layout->root_name.start,
+                                  layout->root_name.end );
+  lcfgxml_fragment_add_str( fragment, ">" );
+}
+
+/* Add a run of consecutive components within a components element */
+
+static void lcfgxml_fragment_components( LCFGXMLFragment * fragment,
+                                         const LCFGXMLLayout * layout,
+                                         unsigned int first,
+                                         unsigned int last ) {
+
+  lcfgxml_fragment_pad( fragment, layout->comps.line );
+  lcfgxml_fragment_add( fragment, layout->comps.start, layout->comps.end );
+  lcfgxml_fragment_pad( fragment, layout->children[first].line );
+  lcfgxml_fragment_add( fragment, layout->children[first].start,
+                                  layout->children[last].end );
+  lcfgxml_fragment_add_str( fragment, "</" LCFGXML_COMPS_PARENT_NODE ">" );
+}
+
+/* Map the profile into memory and scan it. If the profile is smaller
+   than the minimum size, is compressed, cannot be safely split or
+   has no components then NULL is returned and the caller should just
+   use lcfgprofile_from_xml() which reports any problems with opening
+   the file in the usual way. */
+
+static const char * lcfgxml_map_profile( const char * filename,
+                                         size_t min_size,
+                                         size_t * map_size,
+                                         time_t * mtime,
+                                         LCFGXMLLayout * layout ) {
+
+  memset( layout, 0, sizeof(LCFGXMLLayout) );
+
+  int fd = isempty(filename) ? -1 : open( filename, O_RDONLY );
+
+  struct stat sb;
+  if ( fd == -1 || fstat( fd, &sb ) == -1 ||
+       sb.st_size == 0 || (size_t) sb.st_size < min_size ) {
+
+    if ( fd != -1 ) close(fd);
+
+    return NULL;
+  }
+
+  *map_size = (size_t) sb.st_size;
+  *mtime    = sb.st_mtime;
+
+  const char * map = mmap( NULL, *map_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close(fd);
+
+  if ( map == MAP_FAILED ||
+       lcfgxml_compression_type( (const unsigned char *) map, *map_size )
+         != LCFG_XML_COMPRESS_NONE ||
+       !lcfgxml_scan_profile( map, *map_size, layout ) ||
+       layout->nchildren == 0 ) {
+
+    if ( map != MAP_FAILED ) munmap( (void *) map, *map_size );
+    free(layout->children);
+    layout->children = NULL;
+
+    return NULL;
+  }
+
+  return map;
+}
+
+/**
+ * @brief Process XML for LCFG profile using multiple threads
+ *
+ * This does the same as @c lcfgprofile_from_xml() and gives identical
+ * results but, for large profiles, the components are split into
+ * groups which are parsed in parallel with each other and with the
+ * packages. The number of threads used is limited to the number of
+ * online processors.
+ *
+ * Small profiles, compressed profiles and any profile which has a
+ * structure that cannot be safely split (e.g. one with a @c DOCTYPE
+ * declaration), are simply processed with @c lcfgprofile_from_xml().
+ *
+ * This is the same as calling
+ * @c lcfgprofile_from_xml_parallel_with_options() with no options.
+ *
+ * @param[in] filename The filename for the XML profile.
+ * @param[out] result Reference to pointer to new @c LCFGProfile
+ * @param[in] base_context A context which will be applied to all resources
+ * @param[in] base_derivation A derivation which will be applied to all resources and packages
+ * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
+ * @param[in] comps_wanted An @c LCFGTagList of names for the desired components
+ * @param[in] require_packages Boolean which indicates if packages are required
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgprofile_from_xml_parallel( const char * filename,
+                                          LCFGProfile ** result,
+                                          const char * base_context,
+                                          const char * base_derivation,
+                                          const LCFGContextList * ctxlist,
+                                          const LCFGTagList * comps_wanted,
+                                          bool require_packages,
+                                          char ** msg ) {
+
+  return lcfgprofile_from_xml_parallel_with_options( filename, result,
+                                                     base_context,
+                                                     base_derivation,
+                                                     ctxlist, comps_wanted,
+                                                     require_packages,
+                                                     LCFG_OPT_NONE, msg );
+}
+
+/**
+ * @brief Process XML for LCFG profile with options using multiple threads
+ *
+ * This does the same as @c lcfgprofile_from_xml_parallel() but also
+ * takes options which control how the profile is loaded, see
+ * @c lcfgprofile_from_xml_with_options() for details.
+ *
+ * @param[in] filename The filename for the XML profile.
+ * @param[out] result Reference to pointer to new @c LCFGProfile
+ * @param[in] base_context A context which will be applied to all resources
+ * @param[in] base_derivation A derivation which will be applied to all resources and packages
+ * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
+ * @param[in] comps_wanted An @c LCFGTagList of names for the desired components
+ * @param[in] require_packages Boolean which indicates if packages are required
+ * @param[in] options Integer that controls loading behaviour
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgprofile_from_xml_parallel_with_options( const char * filename,
+                                                       LCFGProfile ** result,
+                                                       const char * base_context,
+                                                       const char * base_derivation,
+                                                       const LCFGContextList * ctxlist,
+                                                       const LCFGTagList * comps_wanted,
+                                                       bool require_packages,
+                                                       LCFGOption options,
+                                                       char ** msg ) {
+  assert( filename != NULL );
+
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if ( ncpus > LCFGXML_PARALLEL_MAX_THREADS )
+    ncpus = LCFGXML_PARALLEL_MAX_THREADS;
+
+  if ( ncpus < 2 )
+    return lcfgprofile_from_xml_with_options( filename, result,
+                                              base_context, base_derivation,
+                                              ctxlist, comps_wanted,
+                                              require_packages, options, msg );
+
+  /* Any problems with opening the file are reported by the serial
+     parser */
+
+  size_t map_size = 0;
+  time_t mtime = 0;
+
+  LCFGXMLLayout layout;
+  const char * map = lcfgxml_map_profile( filename,
+                                          LCFGXML_PARALLEL_MIN_SIZE,
+                                          &map_size, &mtime, &layout );
+
+  if ( map == NULL )
+    return lcfgprofile_from_xml_with_options( filename, result,
+                                              base_context, base_derivation,
+                                              ctxlist, comps_wanted,
+                                              require_packages, options, msg );
+
+  bool has_packages = ( layout.pkgs.start != NULL );
+
+  /* One thread is used for the packages (if any) and the rest are
+     used for groups of components of roughly equal size. */
+
+  unsigned int ngroups = ncpus;
+  if ( has_packages && ngroups > 1 ) ngroups--;
+  if ( ngroups > layout.nchildren ) ngroups = layout.nchildren;
+
+  unsigned int njobs = ngroups + ( has_packages ? 1 : 0 );
+
+  LCFGXMLJob * jobs = calloc( njobs, sizeof(LCFGXMLJob) );
+  if ( jobs == NULL ) {
+    perror( "Failed to allocate memory whilst processing XML profile" );
+    exit(EXIT_FAILURE);
+  }
+
+  size_t comps_size = layout.children[layout.nchildren - 1].end -
+                      layout.children[0].start;
+
+  unsigned int i;
+  unsigned int first = 0;
+  for ( i=0; i<njobs; i++ ) {
+    LCFGXMLJob * job = &jobs[i];
+
+    job->filename        = filename;
+    job->base_context    = base_context;
+    job->base_derivation = base_derivation;
+    job->ctxlist         = ctxlist;
+    job->comps_wanted    = comps_wanted;
+    job->options         = options;
+    job->status          = LCFG_STATUS_OK;
+
+    LCFGXMLFragment * fragment = &( job->fragment );
+    lcfgxml_fragment_init( fragment, &layout );
+
+    if ( i < ngroups ) {
+
+      /* Take components until the group reaches its share of the
+         total size, the last group takes whatever remains */
+
+      unsigned int last = first;
+      if ( i == ngroups - 1 ) {
+        last = layout.nchildren - 1;
+      } else {
+        const char * target = layout.children[0].start +
+                              ( i + 1 ) * ( comps_size / ngroups );
+        while ( last + 1 < layout.nchildren - ( ngroups - i - 1 ) &&
+                layout.children[last].end < target )
+          last++;
+      }
+
+      lcfgxml_fragment_components( fragment, &layout, first, last );
+
+      first = last + 1;
+    } else {
+      job->is_packages = true;
+
+      lcfgxml_fragment_pad( fragment, layout.pkgs.line );
+      lcfgxml_fragment_add( fragment, layout.pkgs.start, layout.pkgs.end );
+    }
+
+    lcfgxml_fragment_finish( fragment, &layout );
+  }
+
+  /* The skeleton has the contents of the components and packages
+     elements removed, they may appear in either order */
+
+  LCFGXMLFragment skeleton;
+  memset( &skeleton, 0, sizeof(LCFGXMLFragment) );
+  skeleton.line = 1;
+
+  const char * body1 = layout.comps.end;
+  const char * end1  = layout.comps_end;
+  size_t end1_line   = layout.comps_end_line;
+  const char * body2 = layout.pkgs_body;
+  const char * end2  = layout.pkgs_end;
+  size_t end2_line   = layout.pkgs_end_line;
+
+  if ( has_packages && body2 < body1 ) {
+    body1 = layout.pkgs_body;
+    end1  = layout.pkgs_end;
+    end1_line = layout.pkgs_end_line;
+    body2 = layout.comps.end;
+    end2  = layout.comps_end;
+    end2_line = layout.comps_end_line;
+  }
+
+  lcfgxml_fragment_add( &skeleton, map, body1 );
+  lcfgxml_fragment_pad( &skeleton, end1_line );
+  if ( has_packages ) {
+    lcfgxml_fragment_add( &skeleton, end1, body2 );
+    lcfgxml_fragment_pad( &skeleton, end2_line );
+    lcfgxml_fragment_add( &skeleton, end2, layout.map_end );
+  } else {
+    lcfgxml_fragment_add( &skeleton, end1, layout.map_end );
+  }
+
+  free(layout.children);
+
+  /* The parser must be initialised before any threads are started */
+
+  xmlInitParser();
+
+  /* The first job is always done in this thread, if a thread cannot
+     be created the job is also done here. */
+
+  pthread_t * threads = calloc( njobs, sizeof(pthread_t) );
+  bool * started = calloc( njobs, sizeof(bool) );
+  if ( threads == NULL || started == NULL ) {
+    perror( "Failed to allocate memory whilst processing XML profile" );
+    exit(EXIT_FAILURE);
+  }
+
+  for ( i=1; i<njobs; i++ )
+    started[i] = ( pthread_create( &threads[i], NULL,
+                                   lcfgxml_parse_job, &jobs[i] ) == 0 );
+
+  /* Process the skeleton whilst the threads are busy */
+
+  LCFGProfile * profile = lcfgprofile_new();
+  profile->mtime = mtime;
+
+  LCFGStatus status = LCFG_STATUS_OK;
+
+  xmlTextReaderPtr reader = lcfgxml_fragment_reader( &skeleton, filename );
+  if ( reader == NULL ) {
+    status = lcfgxml_error( msg, "Failed to initialise the LCFG XML reader" );
+  } else if ( !lcfgxml_moveto_node( reader, LCFGXML_TOP_NODE ) ||
+              !lcfgxml_moveto_next_tag( reader ) ) {
+    status = lcfgxml_error( msg, "Invalid LCFG XML profile" );
+  } else {
+    status = lcfgxml_process_profile( reader, profile,
+                                      base_context, base_derivation,
+                                      ctxlist, comps_wanted,
+                                      require_packages, options, msg );
+  }
+
+  (void) lcfgxml_parse_job( &jobs[0] );
+
+  for ( i=1; i<njobs; i++ ) {
+    if ( started[i] )
+      pthread_join( threads[i], NULL );
+    else
+      (void) lcfgxml_parse_job( &jobs[i] );
+  }
+
+  free(threads);
+  free(started);
+
+  munmap( (void *) map, map_size );
+
+  /* Errors from the components and packages are reported in
+     preference to any from the skeleton. The components normally come
+     first so are checked first, as with a serial parse the first
+     error found is reported. */
+
+  LCFGXMLJob * failed = NULL;
+  for ( i=0; failed == NULL && i<njobs; i++ ) {
+    if ( jobs[i].status != LCFG_STATUS_OK )
+      failed = &jobs[i];
+  }
+
+  if ( failed != NULL ) {
+    free(*msg);
+    *msg = failed->error_msg;
+    failed->error_msg = NULL;
+
+    status = failed->status;
+  }
+
+  /* Merge the results in file order so that the profile is the same
+     as that from a serial parse */
+
+  for ( i=0; status == LCFG_STATUS_OK && i<ngroups; i++ ) {
+    if ( lcfgcompset_transplant_components( profile->components,
+                                            jobs[i].components,
+                                            msg ) == LCFG_CHANGE_ERROR )
+      status = LCFG_STATUS_ERROR;
+  }
+
+  if ( status == LCFG_STATUS_OK && has_packages ) {
+    LCFGXMLJob * job = &jobs[njobs - 1];
+
+    lcfgpkgset_relinquish(profile->active_packages);
+    profile->active_packages = job->active_packages;
+    job->active_packages = NULL;
+
+    lcfgpkgset_relinquish(profile->inactive_packages);
+    profile->inactive_packages = job->inactive_packages;
+    job->inactive_packages = NULL;
+  }
+
+  for ( i=0; i<njobs; i++ ) {
+    lcfgcompset_relinquish(jobs[i].components);
+    lcfgpkgset_relinquish(jobs[i].active_packages);
+    lcfgpkgset_relinquish(jobs[i].inactive_packages);
+    free(jobs[i].error_msg);
+  }
+  free(jobs);
+
+  lcfgxml_end_reader(reader);
+
+  if ( status == LCFG_STATUS_ERROR ) {
+    lcfgprofile_destroy(profile);
+    profile = NULL;
+  }
+
+  *result = profile;
+
+  return status;
+}
+
+/* Incremental profile loading
+
+   When a new version of a profile is published usually only a few
+   components have changed. The file is scanned in the same way as
+   for parallel loading and a hash is computed for the XML of each
+   component element. This is stored in the component which is
+   created so that, when the profile is next loaded, any component
+   with the same hash can be cloned from the previous profile instead
+   of being parsed again. The clone shares the resources until either
+   component is modified, at which point the hash for the modified
+   component is cleared.
+
+   The hash is seeded with the start tag for the top-level element
+   (which holds any namespace declarations), the base context, the
+   base derivation and the contexts as they all affect the resulting
+   resources.
+*/
+
+/* The digest for each context covers the name, value and priority.
+   These are summed so that the result does not depend on the order
+   of the list. */
+
+static uint64_t lcfgxml_contexts_digest( const LCFGContextList * ctxlist ) {
+
+  uint64_t digest = 0;
+
+  if ( lcfgctxlist_is_empty(ctxlist) ) return digest;
+
+  const LCFGSListNode * cur_node;
+  for ( cur_node = lcfgslist_head(ctxlist);
+        cur_node != NULL;
+        cur_node = lcfgslist_next(cur_node) ) {
+
+    const LCFGContext * ctx = lcfgslist_data(cur_node);
+    if ( !lcfgcontext_is_valid(ctx) ) continue;
+
+    /* Include the nul terminators so the strings are delimited and a
+       missing value differs from an empty one */
+
+    const char * name = lcfgcontext_get_name(ctx);
+    uint64_t hash = farmhash64( name, strlen(name) + 1 );
+
+    const char * value = lcfgcontext_get_value(ctx);
+    if ( value != NULL )
+      hash = farmhash64_with_seed( value, strlen(value) + 1, hash );
+
+    int priority = lcfgcontext_get_priority(ctx);
+    hash = farmhash64_with_seed( (const char *) &priority, sizeof(priority),
+                                 hash );
+
+    digest += hash;
+  }
+
+  return digest;
+}
+
+static uint64_t lcfgxml_source_seed( const LCFGXMLLayout * layout,
+                                     const char * base_context,
+                                     const char * base_derivation,
+                                     const LCFGContextList * ctxlist ) {
+
+  uint64_t seed = farmhash64( layout->root.start,
+                              layout->root.end - layout->root.start );
+
+  uint64_t digest = lcfgxml_contexts_digest(ctxlist);
+  seed = farmhash64_with_seed( (const char *) &digest, sizeof(digest), seed );
+
+  if ( base_context != NULL )
+    seed = farmhash64_with_seed( base_context, strlen(base_context), seed );
+
+  if ( base_derivation != NULL )
+    seed = farmhash64_with_seed( base_derivation, strlen(base_derivation),
+                                 seed );
+
+  return seed;
+}
+
+/* The name of a component is the name of the element */
+
+static char * lcfgxml_child_name( const LCFGXMLRange * child ) {
+
+  const char * name = child->start + 1;
+
+  char * result = strndup( name, strcspn( name, " \t\r\n/>" ) );
+  if ( result == NULL ) {
+    perror( "Failed to allocate memory whilst processing XML profile" );
+    exit(EXIT_FAILURE);
+  }
+
+  return result;
+}
+
+/* Parse a run of consecutive components which have changed and store
+   the hash for each of the new components. The components are
+   transplanted into the profile. */
+
+static LCFGStatus lcfgxml_parse_changed( const LCFGXMLLayout * layout,
+                                         const uint64_t * hashes,
+                                         unsigned int first,
+                                         unsigned int last,
+                                         LCFGXMLJob * job,
+                                         LCFGProfile * profile,
+                                         char ** msg ) {
+
+  memset( &( job->fragment ), 0, sizeof(LCFGXMLFragment) );
+  job->status = LCFG_STATUS_OK;
+
+  LCFGXMLFragment * fragment = &( job->fragment );
+  lcfgxml_fragment_init( fragment, layout );
+  lcfgxml_fragment_components( fragment, layout, first, last );
+  lcfgxml_fragment_finish( fragment, layout );
+
+  (void) lcfgxml_parse_job(job);
+
+  LCFGStatus status = job->status;
+
+  if ( status == LCFG_STATUS_ERROR ) {
+    free(*msg);
+    *msg = job->error_msg;
+    job->error_msg = NULL;
+  } else {
+
+    /* If a name appears more than once the last one wins, as when
+       the components are inserted into the set */
+
+    unsigned int i;
+    for ( i=first; i<=last; i++ ) {
+      char * name = lcfgxml_child_name( &( layout->children[i] ) );
+
+      LCFGComponent * comp = lcfgcompset_find_component( job->components,
+                                                         name );
+      if ( comp != NULL )
+        comp->source_hash = hashes[i];
+
+      free(name);
+    }
+
+    if ( lcfgcompset_transplant_components( profile->components,
+                                            job->components,
+                                            msg ) == LCFG_CHANGE_ERROR )
+      status = LCFG_STATUS_ERROR;
+
+  }
+
+  lcfgcompset_relinquish(job->components);
+  job->components = NULL;
+
+  return status;
+}
+
+/**
+ * @brief Process XML for LCFG profile reusing unchanged components
+ *
+ * This does the same as @c lcfgprofile_from_xml() and gives identical
+ * results but any component which has exactly the same XML as when
+ * the previous profile was loaded is not parsed again. Instead the
+ * @c LCFGComponent is cloned from the previous @c LCFGProfile, as
+ * with @c lcfgcomponent_clone() the resources are shared until one
+ * of the components is modified. This is intended for use when a new
+ * version of a profile is received where typically only a few
+ * components will have changed.
+ *
+ * Only components loaded with this function can be reused and only
+ * if they have not been modified since. Changes made with the
+ * component functions are tracked, the resources returned by
+ * @c lcfgcomponent_find_resource() are shared with the previous
+ * profile and must not be modified directly. Any component in
+ * a previous profile which was loaded with a different base context,
+ * base derivation or list of contexts (including the value and
+ * priority of each context) is simply ignored.
+ *
+ * The previous profile is not altered other than by the atomic
+ * updates of the reference counts which record that the components
+ * are shared. It must not be modified or destroyed by any other
+ * thread whilst this function is running.
+ *
+ * Compressed profiles and any profile which has a structure that
+ * cannot be safely split (e.g. one with a @c DOCTYPE declaration) are
+ * always processed fully with @c lcfgprofile_from_xml().
+ *
+ * This is the same as calling
+ * @c lcfgprofile_from_xml_incremental_with_options() with no options.
+ *
+ * @param[in] filename The filename for the XML profile.
+ * @param[out] result Reference to pointer to new @c LCFGProfile
+ * @param[in] previous Pointer to previous @c LCFGProfile (may be @c NULL)
+ * @param[in] base_context A context which will be applied to all resources
+ * @param[in] base_derivation A derivation which will be applied to all resources and packages
+ * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
+ * @param[in] comps_wanted An @c LCFGTagList of names for the desired components
+ * @param[in] require_packages Boolean which indicates if packages are required
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgprofile_from_xml_incremental( const char * filename,
+                                             LCFGProfile ** result,
+                                             const LCFGProfile * previous,
+                                             const char * base_context,
+                                             const char * base_derivation,
+                                             const LCFGContextList * ctxlist,
+                                             const LCFGTagList * comps_wanted,
+                                             bool require_packages,
+                                             char ** msg ) {
+
+  return lcfgprofile_from_xml_incremental_with_options( filename, result,
+                                                        previous,
+                                                        base_context,
+                                                        base_derivation,
+                                                        ctxlist, comps_wanted,
+                                                        require_packages,
+                                                        LCFG_OPT_NONE, msg );
+}
+
+/**
+ * @brief Process XML for LCFG profile with options reusing unchanged components
+ *
+ * This does the same as @c lcfgprofile_from_xml_incremental() but
+ * also takes options which control how the profile is loaded, see
+ * @c lcfgprofile_from_xml_with_options() for details. Components
+ * which are reused from the previous profile keep the arena (if any)
+ * with which they were originally loaded.
+ *
+ * @param[in] filename The filename for the XML profile.
+ * @param[out] result Reference to pointer to new @c LCFGProfile
+ * @param[in] previous Pointer to previous @c LCFGProfile (may be @c NULL)
+ * @param[in] base_context A context which will be applied to all resources
+ * @param[in] base_derivation A derivation which will be applied to all resources and packages
+ * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
+ * @param[in] comps_wanted An @c LCFGTagList of names for the desired components
+ * @param[in] require_packages Boolean which indicates if packages are required
+ * @param[in] options Integer that controls loading behaviour
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgprofile_from_xml_incremental_with_options( const char * filename,
+                                                          LCFGProfile ** result,
+                                                          const LCFGProfile * previous,
+                                                          const char * base_context,
+                                                          const char * base_derivation,
+                                                          const LCFGContextList * ctxlist,
+                                                          const LCFGTagList * comps_wanted,
+                                                          bool require_packages,
+                                                          LCFGOption options,
+                                                          char ** msg ) {
+  assert( filename != NULL );
+
+  /* Any problems with opening the file are reported by the serial
+     parser */
+
+  size_t map_size = 0;
+  time_t mtime = 0;
+
+  LCFGXMLLayout layout;
+  const char * map = lcfgxml_map_profile( filename, 0,
+                                          &map_size, &mtime, &layout );
+
+  if ( map == NULL )
+    return lcfgprofile_from_xml_with_options( filename, result,
+                                              base_context, base_derivation,
+                                              ctxlist, comps_wanted,
+                                              require_packages, options, msg );
+
+  uint64_t * hashes = calloc( layout.nchildren, sizeof(uint64_t) );
+  if ( hashes == NULL ) {
+    perror( "Failed to allocate memory whilst processing XML profile" );
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t seed = lcfgxml_source_seed( &layout, base_context,
+                                       base_derivation, ctxlist );
+
+  unsigned int i;
+  for ( i=0; i<layout.nchildren; i++ ) {
+    const LCFGXMLRange * child = &( layout.children[i] );
+    hashes[i] = farmhash64_with_seed( child->start,
+                                      child->end - child->start, seed );
+  }
+
+  /* The skeleton has the contents of the components element removed,
+     everything else is processed as normal */
+
+  LCFGXMLFragment skeleton;
+  memset( &skeleton, 0, sizeof(LCFGXMLFragment) );
+  skeleton.line = 1;
+
+  lcfgxml_fragment_add( &skeleton, map, layout.comps.end );
+  lcfgxml_fragment_pad( &skeleton, layout.comps_end_line );
+  lcfgxml_fragment_add( &skeleton, layout.comps_end, layout.map_end );
+
+  LCFGProfile * profile = lcfgprofile_new();
+  profile->mtime = mtime;
+
+  LCFGStatus status = LCFG_STATUS_OK;
+
+  xmlTextReaderPtr reader = lcfgxml_fragment_reader( &skeleton, filename );
+  if ( reader == NULL ) {
+    status = lcfgxml_error( msg, "Failed to initialise the LCFG XML reader" );
+  } else if ( !lcfgxml_moveto_node( reader, LCFGXML_TOP_NODE ) ||
+              !lcfgxml_moveto_next_tag( reader ) ) {
+    status = lcfgxml_error( msg, "Invalid LCFG XML profile" );
+  } else {
+    status = lcfgxml_process_profile( reader, profile,
+                                      base_context, base_derivation,
+                                      ctxlist, comps_wanted,
+                                      require_packages, options, msg );
+  }
+
+  /* Work through the components in file order, each run of changed
+     components is parsed as a single fragment. */
+
+  LCFGXMLJob job;
+  memset( &job, 0, sizeof(LCFGXMLJob) );
+  job.filename        = filename;
+  job.base_context    = base_context;
+  job.base_derivation = base_derivation;
+  job.ctxlist         = ctxlist;
+  job.comps_wanted    = comps_wanted;
+  job.options         = options;
+
+  const LCFGComponentSet * prev_comps =
+    previous != NULL ? previous->components : NULL;
+
+  bool pending = false;
+  unsigned int first = 0;
+  for ( i=0; status == LCFG_STATUS_OK && i<=layout.nchildren; i++ ) {
+
+    LCFGComponent * prev_comp = NULL;
+    char * name = NULL;
+
+    if ( i < layout.nchildren ) {
+      name = lcfgxml_child_name( &( layout.children[i] ) );
+
+      prev_comp = lcfgcompset_find_component( prev_comps, name );
+      if ( prev_comp != NULL && ( prev_comp->source_hash == 0 ||
+                                  prev_comp->source_hash != hashes[i] ) )
+        prev_comp = NULL;
+    }
+
+    if ( pending && ( prev_comp != NULL || i == layout.nchildren ) ) {
+      status = lcfgxml_parse_changed( &layout, hashes, first, i - 1,
+                                      &job, profile, msg );
+      pending = false;
+    }
+
+    if ( status == LCFG_STATUS_OK && i < layout.nchildren ) {
+
+      if ( prev_comp == NULL ) {
+        if ( !pending ) {
+          pending = true;
+          first = i;
+        }
+      } else if ( comps_wanted == NULL ||
+                  strcmp( name, "profile" ) == 0 ||
+                  lcfgtaglist_contains( comps_wanted, name ) ) {
+
+        /* The clone shares the resources with the previous component
+           until either of them is modified so the two profiles can be
+           changed independently. Cloning only atomically increments
+           the shared counts in the previous component, nothing else
+           in the previous profile is written. */
+
+        LCFGComponent * new_comp = lcfgcomponent_clone(prev_comp);
+        if ( new_comp == NULL ) {
+          status = lcfgxml_error( msg, "Failed to clone component '%s'", name );
+        } else {
+          new_comp->source_hash = prev_comp->source_hash;
+
+          if ( lcfgcompset_insert_component( profile->components, new_comp )
+               == LCFG_CHANGE_ERROR )
+            status = lcfgxml_error( msg, "Failed to add component '%s' to the set of components", name );
+
+          lcfgcomponent_relinquish(new_comp);
+        }
+
+      }
+
+    }
+
+    free(name);
+  }
+
+  free(hashes);
+  free(layout.children);
+  munmap( (void *) map, map_size );
+
+  lcfgxml_end_reader(reader);
+
+  if ( status == LCFG_STATUS_ERROR ) {
+    lcfgprofile_destroy(profile);
+    profile = NULL;
+  }
+
+  *result = profile;
+
+  return status;
+}
+
+/* Context dependencies
+
+   When the set of active contexts changes only the resources and
+   packages which have a context expression referring to one of the
+   altered contexts can be affected. Once an XML profile has been
+   loaded the inactive and lower priority values are discarded so the
+   affected components (and the packages) are parsed again from the
+   XML with the new list of contexts.
+
+   The reverse index is built by scanning the raw XML of each
+   component element for cfg:context attributes. Anything in the
+   expression which looks like a context name is taken to be a
+   reference, this may include some values and the names of entities,
+   which just means a component is occasionally parsed again
+   unnecessarily.
+*/
+
+#define LCFGXML_CONTEXT_ATTR "context="
+
+/* Find the next possible context name in an expression, if the
+   expression comes directly from the XML then any entity references
+   (e.g. "&amp;") are skipped. */
+
+static const char * lcfgxml_next_ctxname( const char * pos,
+                                          const char * end,
+                                          bool escaped,
+                                          size_t * len ) {
+
+  while ( pos < end ) {
+
+    if ( escaped && *pos == '&' ) {
+      const char * semi = memchr( pos, ';', end - pos );
+      pos = ( semi != NULL ? semi + 1 : end );
+    } else if ( isalpha( (unsigned char) *pos ) ) {
+      const char * name = pos;
+      while ( pos < end &&
+              ( isalnum( (unsigned char) *pos ) || *pos == '_' ) )
+        pos++;
+
+      *len = pos - name;
+      return name;
+    } else if ( isdigit( (unsigned char) *pos ) || *pos == '_' ) {
+      /* A simple value which cannot be a name */
+      while ( pos < end &&
+              ( isalnum( (unsigned char) *pos ) || *pos == '_' ) )
+        pos++;
+    } else {
+      pos++;
+    }
+
+  }
+
+  return NULL;
+}
+
+static void lcfgxml_ctxindex_add( LCFGXMLContextIndex * index,
+                                  const char * name, size_t len,
+                                  const char * owner ) {
+
+  if ( index->nrefs == index->size ) {
+    unsigned int new_size = index->size > 0 ? index->size * 2 : 64;
+
+    LCFGXMLContextRef * new_refs =
+      realloc( index->refs, new_size * sizeof(LCFGXMLContextRef) );
+    if ( new_refs == NULL ) {
+      perror( "Failed to allocate memory whilst indexing XML profile" );
+      exit(EXIT_FAILURE);
+    }
+
+    index->refs = new_refs;
+    index->size = new_size;
+  }
+
+  LCFGXMLContextRef * ref = &( index->refs[index->nrefs++] );
+
+  ref->context = strndup( name, len );
+  ref->owner   = owner != NULL ? strdup(owner) : NULL;
+  if ( ref->context == NULL || ( owner != NULL && ref->owner == NULL ) ) {
+    perror( "Failed to allocate memory whilst indexing XML profile" );
+    exit(EXIT_FAILURE);
+  }
+
+}
+
+/* Add references for all the context expressions within an element */
+
+static void lcfgxml_ctxindex_scan( LCFGXMLContextIndex * index,
+                                   const char * start, const char * end,
+                                   const char * owner ) {
+
+  const size_t attr_len = strlen(LCFGXML_CONTEXT_ATTR);
+
+  const char * pos = start;
+  while ( pos < end ) {
+
+    const char * attr = memmem( pos, end - pos,
+                                LCFGXML_CONTEXT_ATTR, attr_len );
+    if ( attr == NULL ) break;
+
+    pos = attr + attr_len;
+    if ( pos >= end || ( *pos != '"' && *pos != '\'' ) ) continue;
+
+    const char * value = pos + 1;
+    const char * value_end = memchr( value, *pos, end - value );
+    if ( value_end == NULL ) break;
+
+    const char * name;
+    size_t len = 0;
+    while ( ( name = lcfgxml_next_ctxname( value, value_end,
+                                           true, &len ) ) != NULL ) {
+      lcfgxml_ctxindex_add( index, name, len, owner );
+      value = name + len;
+    }
+
+    pos = value_end + 1;
+  }
+
+}
+
+/* References are sorted by context name, references to the packages
+   (with a NULL owner) come before those for components */
+
+static int lcfgxml_ctxref_cmp( const void * a, const void * b ) {
+
+  const LCFGXMLContextRef * ref1 = a;
+  const LCFGXMLContextRef * ref2 = b;
+
+  int result = strcmp( ref1->context, ref2->context );
+  if ( result == 0 ) {
+    if ( ref1->owner == NULL || ref2->owner == NULL )
+      result = ( ref1->owner != NULL ) - ( ref2->owner != NULL );
+    else
+      result = strcmp( ref1->owner, ref2->owner );
+  }
+
+  return result;
+}
+
+/**
+ * @brief Destroy the context index
+ *
+ * When the specified @c LCFGXMLContextIndex is no longer required
+ * this can be used to free all associated memory.
+ *
+ * @param[in] index Pointer to @c LCFGXMLContextIndex to be destroyed.
+ *
+ */
+
+void lcfgxml_context_index_destroy( LCFGXMLContextIndex * index ) {
+
+  if ( index == NULL ) return;
+
+  unsigned int i;
+  for ( i=0; i<index->nrefs; i++ ) {
+    free(index->refs[i].context);
+    free(index->refs[i].owner);
+  }
+
+  free(index->refs);
+  free(index->filename);
+  free(index->base_context);
+  free(index->base_derivation);
+
+  free(index);
+}
+
+/**
+ * @brief Index the contexts referenced in an XML profile
+ *
+ * This creates a new @c LCFGXMLContextIndex which maps the name of
+ * each context referenced in a context expression in the XML profile
+ * to the components (and packages) which use that context. It is
+ * intended to be used with @c lcfgprofile_reeval_contexts() so that
+ * when the contexts change only the affected parts of a profile need
+ * to be evaluated again.
+ *
+ * The base context and derivation should be the same as those used
+ * to load the profile, they are stored in the index for use when
+ * components are parsed again.
+ *
+ * Only uncompressed profiles which can be safely split (see @c
+ * lcfgprofile_from_xml_parallel() for details) can be indexed.
+ *
+ * To avoid memory leaks, when it is no longer required the @c
+ * lcfgxml_context_index_destroy() function should be called.
+ *
+ * @param[in] filename The filename for the XML profile.
+ * @param[in] base_context A context which will be applied to all resources
+ * @param[in] base_derivation A derivation which will be applied to all resources and packages
+ * @param[out] result Reference to pointer to new @c LCFGXMLContextIndex
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Status value indicating success of the process
+ *
+ */
+
+LCFGStatus lcfgxml_context_index( const char * filename,
+                                  const char * base_context,
+                                  const char * base_derivation,
+                                  LCFGXMLContextIndex ** result,
+                                  char ** msg ) {
+  assert( filename != NULL );
+
+  *result = NULL;
+
+  size_t map_size = 0;
+  time_t mtime = 0;
+
+  LCFGXMLLayout layout;
+  const char * map = lcfgxml_map_profile( filename, 0,
+                                          &map_size, &mtime, &layout );
+
+  if ( map == NULL )
+    return lcfgxml_error( msg, "Cannot index contexts for XML profile '%s'",
+                          filename );
+
+  LCFGXMLContextIndex * index = calloc( 1, sizeof(LCFGXMLContextIndex) );
+  if ( index == NULL ) {
+    perror( "Failed to allocate memory whilst indexing XML profile" );
+    exit(EXIT_FAILURE);
+  }
+
+  index->mtime    = mtime;
+  index->filename = strdup(filename);
+  if ( index->filename == NULL ) {
+    perror( "Failed to allocate memory whilst indexing XML profile" );
+    exit(EXIT_FAILURE);
+  }
+
+  if ( base_context != NULL ) {
+    index->base_context = strdup(base_context);
+    if ( index->base_context == NULL ) {
+      perror( "Failed to allocate memory whilst indexing XML profile" );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if ( base_derivation != NULL ) {
+    index->base_derivation = strdup(base_derivation);
+    if ( index->base_derivation == NULL ) {
+      perror( "Failed to allocate memory whilst indexing XML profile" );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  unsigned int i;
+  for ( i=0; i<layout.nchildren; i++ ) {
+    const LCFGXMLRange * child = &( layout.children[i] );
+
+    char * name = lcfgxml_child_name(child);
+    lcfgxml_ctxindex_scan( index, child->start, child->end, name );
+    free(name);
+  }
+
+  if ( layout.pkgs.start != NULL )
+    lcfgxml_ctxindex_scan( index, layout.pkgs.start, layout.pkgs.end, NULL );
+
+  free(layout.children);
+  munmap( (void *) map, map_size );
+
+  /* Sort and remove duplicates */
+
+  if ( index->nrefs > 0 ) {
+    qsort( index->refs, index->nrefs, sizeof(LCFGXMLContextRef),
+           lcfgxml_ctxref_cmp );
+
+    unsigned int count = 1;
+    for ( i=1; i<index->nrefs; i++ ) {
+      LCFGXMLContextRef * ref = &( index->refs[i] );
+
+      if ( lcfgxml_ctxref_cmp( &( index->refs[count - 1] ), ref ) == 0 ) {
+        free(ref->context);
+        free(ref->owner);
+      } else {
+        index->refs[count++] = *ref;
+      }
+    }
+
+    index->nrefs = count;
+  }
+
+  *result = index;
+
+  return LCFG_STATUS_OK;
+}
+
+/* Find the first reference for a context name */
+
+static unsigned int lcfgxml_ctxindex_find( const LCFGXMLContextIndex * index,
+                                           const char * name ) {
+
+  unsigned int low = 0, high = index->nrefs;
+  while ( low < high ) {
+    unsigned int mid = low + ( high - low ) / 2;
+    if ( strcmp( index->refs[mid].context, name ) < 0 )
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/* Add the names of any contexts which differ between the two lists */
+
+static void lcfgxml_changed_contexts( const LCFGContextList * ctxlist1,
+                                      const LCFGContextList * ctxlist2,
+                                      LCFGTagList * changed ) {
+
+  const LCFGSListNode * cur_node;
+  for ( cur_node = lcfgslist_head(ctxlist1);
+        cur_node != NULL;
+        cur_node = lcfgslist_next(cur_node) ) {
+
+    const LCFGContext * cur_ctx = lcfgslist_data(cur_node);
+    if ( !lcfgcontext_is_valid(cur_ctx) ) continue;
+
+    const char * name = lcfgcontext_get_name(cur_ctx);
+
+    const LCFGContext * other_ctx = lcfgctxlist_find_context( ctxlist2, name );
+    if ( other_ctx != NULL && lcfgcontext_identical( cur_ctx, other_ctx ) )
+      continue;
+
+    char * add_msg = NULL;
+    if ( lcfgtaglist_mutate_add( changed, name, &add_msg )
+         == LCFG_CHANGE_ERROR ) {
+      perror( "Failed to allocate memory whilst evaluating contexts" );
+      exit(EXIT_FAILURE);
+    }
+    free(add_msg);
+  }
+
+}
+
+static void lcfgxml_add_affected( LCFGTagList * affected,
+                                  const char * name ) {
+
+  char * add_msg = NULL;
+  if ( lcfgtaglist_mutate_add( affected, name, &add_msg )
+       == LCFG_CHANGE_ERROR ) {
+    perror( "Failed to allocate memory whilst evaluating contexts" );
+    exit(EXIT_FAILURE);
+  }
+  free(add_msg);
+
+}
+
+/**
+ * @brief Evaluate the parts of a profile affected by context changes
+ *
+ * When the list of active contexts changes (e.g. after @c
+ * lcfgcontext_pending_to_active() has been called) this can be used
+ * to update a profile which was loaded from XML with the old list of
+ * contexts. Only the components which have resources with a context
+ * expression that refers to a context which has been added, removed
+ * or modified are parsed again, similarly the packages are only
+ * parsed again if they refer to any of those contexts. The result is
+ * the same as loading the whole profile again with the new list of
+ * contexts.
+ *
+ * The @c LCFGXMLContextIndex must have been created with @c
+ * lcfgxml_context_index() for the same XML profile which has not been
+ * modified since. If a base context was used when loading the profile
+ * and it refers to any of the altered contexts then all the
+ * components are parsed again.
+ *
+ * Any component which was replaced using an override profile (e.g.
+ * with @c lcfgprofile_overrides_context() ) will be replaced by the
+ * version from the main profile if it is affected, the overrides
+ * should be applied again afterwards.
+ *
+ * The names of components for which the values of any resources have
+ * changed are returned as an @c LCFGTagList. To avoid memory leaks,
+ * when it is no longer required the @c lcfgtaglist_relinquish()
+ * function should be called.
+ *
+ * @param[in] profile Pointer to @c LCFGProfile to be updated
+ * @param[in] index Pointer to @c LCFGXMLContextIndex for the XML profile
+ * @param[in] old_ctxlist The @c LCFGContextList used to load the profile
+ * @param[in] new_ctxlist The new @c LCFGContextList
+ * @param[out] changed Reference to pointer to @c LCFGTagList of changed component names
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
+LCFGChange lcfgprofile_reeval_contexts( LCFGProfile * profile,
+                                        const LCFGXMLContextIndex * index,
+                                        const LCFGContextList * old_ctxlist,
+                                        const LCFGContextList * new_ctxlist,
+                                        LCFGTagList ** changed,
+                                        char ** msg ) {
+  assert( profile != NULL );
+  assert( index != NULL );
+
+  *changed = lcfgtaglist_new();
+
+  LCFGTagList * ctxnames = lcfgtaglist_new();
+  lcfgxml_changed_contexts( old_ctxlist, new_ctxlist, ctxnames );
+  lcfgxml_changed_contexts( new_ctxlist, old_ctxlist, ctxnames );
+
+  if ( lcfgtaglist_is_empty(ctxnames) ) {
+    lcfgtaglist_relinquish(ctxnames);
+    return LCFG_CHANGE_NONE;
+  }
+
+  /* Find the affected components and packages */
+
+  LCFGTagList * affected = lcfgtaglist_new();
+  bool all_comps = false, pkgs_affected = false;
+
+  if ( index->base_context != NULL ) {
+    const char * pos = index->base_context;
+    const char * end = pos + strlen(pos);
+
+    const char * name;
+    size_t len = 0;
+    while ( !all_comps &&
+            ( name = lcfgxml_next_ctxname( pos, end, false, &len ) ) != NULL ) {
+
+      const LCFGTagNode * cur_node;
+      for ( cur_node = lcfgtaglist_head(ctxnames);
+            cur_node != NULL && !all_comps;
+            cur_node = lcfgtaglist_next(cur_node) ) {
+
+        const char * ctxname = lcfgtag_get_name( lcfgtaglist_tag(cur_node) );
+        if ( strlen(ctxname) == len && strncmp( ctxname, name, len ) == 0 )
+          all_comps = true;
+      }
+
+      pos = name + len;
+    }
+  }
+
+  const LCFGTagNode * cur_node;
+  for ( cur_node = lcfgtaglist_head(ctxnames);
+        cur_node != NULL;
+        cur_node = lcfgtaglist_next(cur_node) ) {
+
+    const char * ctxname = lcfgtag_get_name( lcfgtaglist_tag(cur_node) );
+
+    unsigned int i;
+    for ( i = lcfgxml_ctxindex_find( index, ctxname );
+          i < index->nrefs && strcmp( index->refs[i].context, ctxname ) == 0;
+          i++ ) {
+
+      const char * owner = index->refs[i].owner;
+      if ( owner == NULL )
+        pkgs_affected = true;
+      else if ( !all_comps )
+        lcfgxml_add_affected( affected, owner );
+
+    }
+  }
+
+  lcfgtaglist_relinquish(ctxnames);
+
+  if ( !all_comps && !pkgs_affected && lcfgtaglist_is_empty(affected) ) {
+    lcfgtaglist_relinquish(affected);
+    return LCFG_CHANGE_NONE;
+  }
+
+  size_t map_size = 0;
+  time_t mtime = 0;
+
+  LCFGXMLLayout layout;
+  const char * map = lcfgxml_map_profile( index->filename, 0,
+                                          &map_size, &mtime, &layout );
+
+  if ( map == NULL || mtime != index->mtime ) {
+    if ( map != NULL ) {
+      free(layout.children);
+      munmap( (void *) map, map_size );
+    }
+
+    lcfgtaglist_relinquish(affected);
+
+    lcfgxml_error( msg, "XML profile '%s' has been modified since the contexts were indexed", index->filename );
+    return LCFG_CHANGE_ERROR;
+  }
+
+  /* Only components which are already in the profile are wanted,
+     each run of affected components is parsed as a single fragment */
+
+  LCFGXMLJob job;
+  memset( &job, 0, sizeof(LCFGXMLJob) );
+  job.filename        = index->filename;
+  job.base_context    = index->base_context;
+  job.base_derivation = index->base_derivation;
+  job.ctxlist         = new_ctxlist;
+
+  LCFGComponentSet * fresh = lcfgcompset_new();
+  LCFGStatus status = LCFG_STATUS_OK;
+
+  bool pending = false;
+  unsigned int first = 0;
+  unsigned int i;
+  for ( i=0; status == LCFG_STATUS_OK && i<=layout.nchildren; i++ ) {
+
+    bool wanted = false;
+    if ( i < layout.nchildren ) {
+      char * name = lcfgxml_child_name( &( layout.children[i] ) );
+
+      wanted = ( lcfgcompset_has_component( profile->components, name ) &&
+                 ( all_comps || lcfgtaglist_contains( affected, name ) ) );
+
+      free(name);
+    }
+
+    if ( pending && !wanted ) {
+      memset( &( job.fragment ), 0, sizeof(LCFGXMLFragment) );
+      job.status = LCFG_STATUS_OK;
+
+      LCFGXMLFragment * fragment = &( job.fragment );
+      lcfgxml_fragment_init( fragment, &layout );
+      lcfgxml_fragment_components( fragment, &layout, first, i - 1 );
+      lcfgxml_fragment_finish( fragment, &layout );
+
+      (void) lcfgxml_parse_job(&job);
+
+      status = job.status;
+      if ( status == LCFG_STATUS_ERROR ) {
+        free(*msg);
+        *msg = job.error_msg;
+        job.error_msg = NULL;
+      } else if ( lcfgcompset_transplant_components( fresh, job.components,
+                                                     msg )
+                  == LCFG_CHANGE_ERROR ) {
+        status = LCFG_STATUS_ERROR;
+      }
+
+      lcfgcompset_relinquish(job.components);
+      job.components = NULL;
+
+      pending = false;
+    }
+
+    if ( wanted && !pending ) {
+      pending = true;
+      first = i;
+    }
+
+  }
+
+  lcfgtaglist_relinquish(affected);
+
+  if ( status == LCFG_STATUS_OK && pkgs_affected &&
+       layout.pkgs.start != NULL ) {
+
+    memset( &( job.fragment ), 0, sizeof(LCFGXMLFragment) );
+    job.status      = LCFG_STATUS_OK;
+    job.is_packages = true;
+
+    LCFGXMLFragment * fragment = &( job.fragment );
+    lcfgxml_fragment_init( fragment, &layout );
+    lcfgxml_fragment_pad( fragment, layout.pkgs.line );
+    lcfgxml_fragment_add( fragment, layout.pkgs.start, layout.pkgs.end );
+    lcfgxml_fragment_finish( fragment, &layout );
+
+    (void) lcfgxml_parse_job(&job);
+
+    status = job.status;
+    if ( status == LCFG_STATUS_ERROR ) {
+      free(*msg);
+      *msg = job.error_msg;
+      job.error_msg = NULL;
+    }
+  }
+
+  free(layout.children);
+  munmap( (void *) map, map_size );
+
+  /* Compare the new components with those currently in the profile,
+     any component which is parsed again has its source hash cleared
+     as it was not loaded with the same list of contexts. */
+
+  LCFGChange change = LCFG_CHANGE_NONE;
+
+  for ( i=0; status == LCFG_STATUS_OK && i<fresh->buckets; i++ ) {
+    LCFGComponent * new_comp = fresh->components[i];
+    if ( new_comp == NULL ) continue;
+
+    new_comp->source_hash = 0;
+
+    const char * name = lcfgcomponent_get_name(new_comp);
+    const LCFGComponent * cur_comp =
+      lcfgcompset_find_component( profile->components, name );
+
+    LCFGDiffComponent * compdiff = NULL;
+    LCFGChange diff_rc = lcfgcomponent_diff( cur_comp, new_comp, &compdiff );
+    lcfgdiffcomponent_relinquish(compdiff);
+
+    if ( diff_rc == LCFG_CHANGE_ERROR ) {
+      status = lcfgxml_error( msg, "Failed to compare versions of component '%s'", name );
+    } else if ( diff_rc != LCFG_CHANGE_NONE ) {
+      change = LCFG_CHANGE_MODIFIED;
+      lcfgxml_add_affected( *changed, name );
+    }
+  }
+
+  if ( status == LCFG_STATUS_OK &&
+       lcfgcompset_transplant_components( profile->components, fresh,
+                                          msg ) == LCFG_CHANGE_ERROR )
+    status = LCFG_STATUS_ERROR;
+
+  lcfgcompset_relinquish(fresh);
+
+  if ( status == LCFG_STATUS_OK && job.is_packages ) {
+
+    LCFGPkgSetDiff * pkgdiff = NULL;
+    LCFGChange diff_rc = lcfgpkgset_diff( profile->active_packages,
+                                          job.active_packages, &pkgdiff );
+    lcfgpkgsetdiff_relinquish(pkgdiff);
+
+    if ( diff_rc == LCFG_CHANGE_ERROR ) {
+      status = lcfgxml_error( msg, "Failed to compare sets of packages" );
+    } else {
+      if ( diff_rc != LCFG_CHANGE_NONE )
+        change = LCFG_CHANGE_MODIFIED;
+
+      lcfgpkgset_relinquish(profile->active_packages);
+      profile->active_packages = job.active_packages;
+      job.active_packages = NULL;
+
+      lcfgpkgset_relinquish(profile->inactive_packages);
+      profile->inactive_packages = job.inactive_packages;
+      job.inactive_packages = NULL;
+    }
+
+  }
+
+  lcfgpkgset_relinquish(job.active_packages);
+  lcfgpkgset_relinquish(job.inactive_packages);
+  free(job.error_msg);
+
+  if ( status == LCFG_STATUS_ERROR ) {
+    lcfgtaglist_relinquish(*changed);
+    *changed = NULL;
+    change = LCFG_CHANGE_ERROR;
+  } else {
+    lcfgtaglist_sort(*changed);
+  }
+
+  return change;
+}
+
+/* Override profiles
+
+   The directory is read first to find the override files, these are
+   sorted by name so that they are always applied in the same order.
+   The files are then parsed, possibly in parallel, each thread takes
+   every Nth file. Finally the components are transplanted into the
+   main profile in order.
+*/
+
+struct LCFGXMLOverride {
+  char * comp_name;          /**< Name of component to be replaced */
+  char * path;               /**< Full path to override file */
+  LCFGProfile * profile;     /**< Profile loaded from override file */
+  LCFGStatus status;
+  char * error_msg;
+};
+
+typedef struct LCFGXMLOverride LCFGXMLOverride;
+
+struct LCFGXMLOverrideJob {
+  LCFGXMLOverride * overrides;
+  unsigned int count;        /**< Total number of override files */
+  unsigned int first;        /**< Index of first file for this job */
+  unsigned int step;         /**< Number of jobs */
+  const LCFGContextList * ctxlist;
+};
+
+typedef struct LCFGXMLOverrideJob LCFGXMLOverrideJob;
+
+static int lcfgxml_override_cmp( const void * a, const void * b ) {
+  const LCFGXMLOverride * o1 = a;
+  const LCFGXMLOverride * o2 = b;
+  return strcmp( o1->comp_name, o2->comp_name );
+}
+
+/* Find the override files in the directory. Looking for any file
+   with a .xml suffix but must also have a basename which is used as
+   the name of the component to override. Files with invalid names
+   are ignored. The file type from the directory entry is used where
+   available to avoid having to stat every file. */
+
+static LCFGStatus lcfgxml_find_overrides( const char * override_dir,
+                                          LCFGXMLOverride ** result,
+                                          unsigned int * count,
+                                          char ** msg ) {
+
+  *result = NULL;
+  *count  = 0;
+
+  DIR * dh = opendir(override_dir);
+  if ( dh == NULL )
+    return lcfgxml_error( msg, "XML override directory '%s' is not accessible",
+                          override_dir );
+
+  LCFGXMLOverride * overrides = NULL;
+  unsigned int size = 0;
+
+  struct dirent * entry;
+  while( ( entry = readdir(dh) ) != NULL ) {
+
+    if ( *( entry->d_name ) == '.' ) continue; /* ignore any dot-files */
+
+    if ( !lcfgutils_string_endswith( entry->d_name, ".xml" ) ) continue;
+
+    if ( entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN &&
+         entry->d_type != DT_LNK ) continue;
+
+    char * comp_name = lcfgutils_basename( entry->d_name, ".xml" );
+    if ( !lcfgcomponent_valid_name(comp_name) ) {
+      free(comp_name);
+      continue;
+    }
+
+    char * fullpath = lcfgutils_catfile( override_dir, entry->d_name );
+
+    struct stat sb;
+    if ( fullpath == NULL ||
+         ( entry->d_type != DT_REG &&
+           ( stat( fullpath, &sb ) != 0 || !S_ISREG(sb.st_mode) ) ) ) {
+      free(comp_name);
+      free(fullpath);
+      continue;
+    }
+
+    if ( *count == size ) {
+      size = size > 0 ? size * 2 : 16;
+
+      LCFGXMLOverride * new_overrides =
+        realloc( overrides, size * sizeof(LCFGXMLOverride) );
+      if ( new_overrides == NULL ) {
+        perror( "Failed to allocate memory whilst processing XML overrides" );
+        exit(EXIT_FAILURE);
+      }
+      overrides = new_overrides;
+    }
+
+    LCFGXMLOverride * override = &( overrides[*count] );
+    memset( override, 0, sizeof(LCFGXMLOverride) );
+    override->comp_name = comp_name;
+    override->path      = fullpath;
+    override->status    = LCFG_STATUS_OK;
+
+    *count += 1;
+  }
+
+  closedir(dh);
+
+  if ( *count > 1 )
+    qsort( overrides, *count, sizeof(LCFGXMLOverride), lcfgxml_override_cmp );
+
+  *result = overrides;
+
+  return LCFG_STATUS_OK;
+}
+
+/* Parse the override files for a job, only the component being
+   overridden is loaded from each file. */
+
+static void * lcfgxml_override_job( void * data ) {
+
+  LCFGXMLOverrideJob * job = data;
+
+  unsigned int i;
+  for ( i=job->first; i<job->count; i+=job->step ) {
+    LCFGXMLOverride * override = &( job->overrides[i] );
+
+    LCFGTagList * comps_wanted = lcfgtaglist_new();
+    char * tagmsg = NULL;
+    if ( lcfgtaglist_mutate_add( comps_wanted, override->comp_name, &tagmsg )
+         == LCFG_CHANGE_ERROR ) {
+      override->status = lcfgxml_error( &override->error_msg,
+                                        "Failed to create list of required components: %s", tagmsg );
+    } else {
+      override->status = lcfgxml_read_profile( override->path,
+                                               &override->profile,
+                                               NULL,           /* base context */
+                                               override->path, /* base derivation */
+                                               job->ctxlist,   /* current contexts */
+                                               comps_wanted,
+                                               false,          /* no packages */
+                                               LCFG_OPT_NONE,
+                                               &override->error_msg );
+    }
+    free(tagmsg);
+
+    lcfgtaglist_relinquish(comps_wanted);
+  }
+
+  return NULL;
+}
+
+static LCFGChange lcfgxml_apply_overrides( LCFGProfile * main_profile,
+                                           const char * override_dir,
+                                           const LCFGContextList * ctxlist,
+                                           unsigned int max_threads,
+                                           char ** msg ) {
+  assert( main_profile != NULL );
+
+  /* If the overrides directory does not exist then just return success */
+
+  struct stat sb;
+  if ( isempty(override_dir) ||
+       ( stat( override_dir, &sb ) != 0 && errno == ENOENT ) ) {
+    return LCFG_CHANGE_NONE;
+  }
+
+  LCFGXMLOverride * overrides = NULL;
+  unsigned int count = 0;
+  if ( lcfgxml_find_overrides( override_dir, &overrides, &count, msg )
+       == LCFG_STATUS_ERROR )
+    return LCFG_CHANGE_ERROR;
+
+  if ( count == 0 ) return LCFG_CHANGE_NONE;
+
+  unsigned int njobs = max_threads < count ? max_threads : count;
+  if ( njobs < 1 ) njobs = 1;
+
+  LCFGXMLOverrideJob * jobs = calloc( njobs, sizeof(LCFGXMLOverrideJob) );
+  pthread_t * threads = calloc( njobs, sizeof(pthread_t) );
+  bool * started = calloc( njobs, sizeof(bool) );
+  if ( jobs == NULL || threads == NULL || started == NULL ) {
+    perror( "Failed to allocate memory whilst processing XML overrides" );
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int i;
+  for ( i=0; i<njobs; i++ ) {
+    jobs[i].overrides = overrides;
+    jobs[i].count     = count;
+    jobs[i].first     = i;
+    jobs[i].step      = njobs;
+    jobs[i].ctxlist   = ctxlist;
+  }
+
+  /* The parser must be initialised before any threads are started.
+     The first job is always done in this thread, if a thread cannot
+     be created the job is also done here. */
+
+  xmlInitParser();
+
+  for ( i=1; i<njobs; i++ )
+    started[i] = ( pthread_create( &threads[i], NULL,
+                                   lcfgxml_override_job, &jobs[i] ) == 0 );
+
+  (void) lcfgxml_override_job( &jobs[0] );
+
+  for ( i=1; i<njobs; i++ ) {
+    if ( started[i] )
+      pthread_join( threads[i], NULL );
+    else
+      (void) lcfgxml_override_job( &jobs[i] );
+  }
+
+  free(jobs);
+  free(threads);
+  free(started);
+
+  xmlCleanupParser();
+
+  /* The LCFGComponent loaded from the override file will completely
+     replace any existing instance of a component with the same
+     name. Any problems are reported but do not cause the entire
+     process to fail. */
+
+  LCFGChange change = LCFG_CHANGE_NONE;
+
+  for ( i=0; i<count; i++ ) {
+    LCFGXMLOverride * override = &( overrides[i] );
+
+    LCFGChange override_change = LCFG_CHANGE_ERROR;
+    if ( override->status != LCFG_STATUS_ERROR )
+      override_change = lcfgprofile_transplant_components( main_profile,
+                                                           override->profile,
+                                                           &override->error_msg );
+
+    if ( override_change == LCFG_CHANGE_ERROR ) {
+      /* warn but do not fail entire processing */
+      fprintf( stderr, "Failed to process '%s': %s\n", override->path,
+               override->error_msg );
+    } else if ( override_change != LCFG_CHANGE_NONE ) {
+      change = LCFG_CHANGE_MODIFIED;
+    }
+
+    lcfgprofile_destroy(override->profile);
+    free(override->error_msg);
+    free(override->comp_name);
+    free(override->path);
+  }
+
+  free(overrides);
+
+  return change;
+}
+
+/**
+ * @brief Apply override profiles to current profile
+ *
+ * This can be used to import local overrides for components. The
+ * specified directory is searched for override files which should be
+ * named like @c component.xml. Files with names which are not valid
+ * component names will be ignored, similarly if the processing of the
+ * XML file fails it will be ignored. The @c LCFGComponent loaded from
+ * the override file will @b completely replace any existing instance
+ * of a component with the same name in the main @c LCFGProfile. The
+ * files are applied in order of name. This is primarily intended as a
+ * useful feature for development environments rather than those which
+ * are live.
+ *
+ * @param[in] main_profile Pointer to @c LCFGProfile
+ * @param[in] override_dir The path to the directory of XML override profiles
+ * @param[in] ctxlist An @c LCFGContextList of current contexts
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
+LCFGChange lcfgprofile_overrides_xmldir( LCFGProfile * main_profile,
+                                         const char * override_dir,
+                                         const LCFGContextList * ctxlist,
+                                         char ** msg ) {
+
+  return lcfgxml_apply_overrides( main_profile, override_dir, ctxlist,
+                                  1, msg );
+}
+
+/**
+ * @brief Apply override profiles to current profile using multiple threads
+ *
+ * This does the same as @c lcfgprofile_overrides_xmldir() and gives
+ * identical results but the override files are parsed in parallel.
+ * The number of threads used is limited to the number of online
+ * processors. Once all the files have been parsed the components are
+ * replaced in the main @c LCFGProfile in order of file name.
+ *
+ * @param[in] main_profile Pointer to @c LCFGProfile
+ * @param[in] override_dir The path to the directory of XML override profiles
+ * @param[in] ctxlist An @c LCFGContextList of current contexts
+ * @param[out] msg Pointer to any diagnostic messages
+ *
+ * @return Integer value indicating type of change
+ *
+ */
+
+LCFGChange lcfgprofile_overrides_xmldir_parallel( LCFGProfile * main_profile,
+                                                  const char * override_dir,
+                                                  const LCFGContextList * ctxlist,
+                                                  char ** msg ) {
+
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if ( ncpus < 1 ) ncpus = 1;
+  if ( ncpus > LCFGXML_PARALLEL_MAX_THREADS )
+    ncpus = LCFGXML_PARALLEL_MAX_THREADS;
+
+  return lcfgxml_apply_overrides( main_profile, override_dir, ctxlist,
+                                  (unsigned int) ncpus, msg );
 }
 
 /**
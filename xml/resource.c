@@ -27,41 +27,40 @@
  * (underscore) followed by a digit those characters will be removed
  * from the name.
  *
- * @param[in] reader Pointer to XML reader
+ * @param[in] attrs Pointer to @c LCFGXMLAttributes for the current node
  *
  * @return Resource name
  *
  */
 
-static char * get_lcfgtagname( xmlTextReaderPtr reader ) {
-  assert( reader != NULL );
-
-  char * tagname = NULL;
-
-  if ( xmlTextReaderHasAttributes(reader) ) {
+static const char * get_lcfgtagname( xmlTextReaderPtr reader,
+                                     const LCFGXMLAttributes * attrs ) {
+  assert( attrs != NULL );
 
-    xmlChar * attrvalue = xmlTextReaderGetAttribute(reader,BAD_CAST "cfg:name");
-    if ( attrvalue != NULL ) {
+  const char * name = (const char *) attrs->name;
+  if ( name == NULL ) return NULL;
 
-      tagname = (char *) attrvalue;
-      size_t length = strlen(tagname);
+  /* Due to a misunderstanding of the XML spec the LCFG server
+     prepends an underscore to the value of the name attribute when
+     the first character is one of [0-9_]. For compatibility this code
+     does the unescaping */
 
-      /* Due to a misunderstanding of the XML spec the LCFG server
-         prepends an underscore to the value of the name attribute
-         when the first character is one of [0-9_]. For compatibility
-         this code does the unescaping */
+  if ( name[0] == '_' && name[1] != '\0' )
+    name++;
 
-      if ( length >= 2 && tagname[0] == '_' ) {
-
-        /* one character shorter but add one for null byte */
-        tagname = memmove( tagname, tagname + 1, length );
-      }
-
-    }
+  /* The tag name is interned in the dictionary for the reader so it
+     remains valid after the reader has moved on to the child nodes
+     and does not need to be freed. Tag names are repeated a lot so
+     this rarely needs any memory to be allocated. */
 
+  const xmlChar * tagname = xmlTextReaderConstString( reader,
+                                                      BAD_CAST name );
+  if ( tagname == NULL ) {
+    perror("Failed to allocate memory for LCFG tag name");
+    exit(EXIT_FAILURE);
   }
 
-  return tagname;
+  return (const char *) tagname;
 }
 
 /**
@@ -75,7 +74,7 @@ static char * get_lcfgtagname( xmlTextReaderPtr reader ) {
  *   - type (@c cfg:type)
  *   - template (@c cfg:template)
  *
- * @param[in] reader Pointer to XML reader
+ * @param[in] attrs Pointer to @c LCFGXMLAttributes for the current node
  * @param[in] res Pointer to @c LCFGResource
  * @param[in] compname Name of component
  * @param[out] msg Pointer to any diagnostic messages
@@ -84,101 +83,64 @@ static char * get_lcfgtagname( xmlTextReaderPtr reader ) {
  *
  */
 
-static LCFGStatus lcfgxml_gather_resource_attributes( xmlTextReaderPtr reader,
+static LCFGStatus lcfgxml_gather_resource_attributes( const LCFGXMLAttributes * attrs,
                                                       LCFGResource * res,
                                                       const char * compname,
                                                       char ** msg ) {
-  assert( reader != NULL );
+  assert( attrs != NULL );
   assert( res != NULL );
 
-  if ( !xmlTextReaderHasAttributes(reader) ) return LCFG_STATUS_OK;
-
-  LCFGStatus status = LCFG_STATUS_OK;
-
   /* Do the derivation first so that any errors after this point get
      the derivation information attached. */
 
-  xmlChar * derivation =
-    xmlTextReaderGetAttribute( reader, BAD_CAST "cfg:derivation" );
-  if ( derivation != NULL && xmlStrlen(derivation) > 0 ) {
+  const char * derivation = (const char *) attrs->derivation;
+  if ( !isempty(derivation) ) {
 
-    if ( !lcfgresource_add_derivation_string( res, (char *) derivation ) ) {
-      status = LCFG_STATUS_ERROR;
+    if ( !lcfgresource_add_derivation_string( res, derivation ) ) {
       *msg = lcfgresource_build_message( res, compname,
                                          "Invalid derivation '%s'",
-                                         (char *) derivation );
+                                         derivation );
+      return LCFG_STATUS_ERROR;
     }
 
   }
 
-  xmlFree(derivation);
-  derivation = NULL;
-
-  if ( status == LCFG_STATUS_ERROR ) return status;
-
   /* Context Expression */
 
-  xmlChar * context =
-    xmlTextReaderGetAttribute( reader, BAD_CAST "cfg:context" );
-  if ( context != NULL && xmlStrlen(context) > 0 ) {
-
-    if ( lcfgresource_has_context(res) ) {
+  const char * context = (const char *) attrs->context;
+  if ( !isempty(context) ) {
 
-      if ( !lcfgresource_add_context( res, (char *) context ) )
-        status = LCFG_STATUS_ERROR;
-
-    } else {
-
-      if ( lcfgresource_set_context( res, (char *) context ) )
-        context = NULL; /* Resource now "owns" context string */
-      else
-        status = LCFG_STATUS_ERROR;
-
-    }
-
-    if ( status == LCFG_STATUS_ERROR ) {
+    if ( !lcfgresource_add_context( res, context ) ) {
       *msg = lcfgresource_build_message( res, compname,
                                          "Invalid context '%s'", 
-                                         (char *) context );
+                                         context );
+      return LCFG_STATUS_ERROR;
     }
 
   }
 
-  xmlFree(context);
-  context = NULL;
-
-  if ( status == LCFG_STATUS_ERROR ) return status;
-
   /* Type */
 
-  xmlChar * type =
-    xmlTextReaderGetAttribute( reader, BAD_CAST "cfg:type" );
-  if ( type != NULL && xmlStrlen(type) > 0 ) {
+  const char * type = (const char *) attrs->type;
+  if ( !isempty(type) ) {
 
     char * type_msg = NULL;
-    if ( !lcfgresource_set_type_as_string( res, (char *) type,
-                                           &type_msg ) ) {
+    if ( !lcfgresource_set_type_as_string( res, type, &type_msg ) ) {
       *msg = lcfgresource_build_message( res, compname,
                                          "Invalid type '%s': %s",
-                                         (char *) type,
-                                         type_msg );
-      status = LCFG_STATUS_ERROR;
-
+                                         type, type_msg );
       free(type_msg);
 
+      return LCFG_STATUS_ERROR;
     }
 
   }
 
-  xmlFree(type);
-  type = NULL;
-
-  if ( status == LCFG_STATUS_ERROR ) return status;
-
   /* Template */
 
-  xmlChar * template =
-    xmlTextReaderGetAttribute( reader, BAD_CAST "cfg:template" );
+  LCFGStatus status = LCFG_STATUS_OK;
+
+  const char * template = (const char *) attrs->template;
   if ( template != NULL ) {
 
     if ( !lcfgresource_is_list(res) ) {
@@ -191,26 +153,22 @@ static LCFGStatus lcfgxml_gather_resource_attributes( xmlTextReaderPtr reader,
 
     }
 
-    if ( xmlStrlen(template) > 0 ) {
+    if ( !isempty(template) ) {
 
       char * tmpl_msg = NULL;
-      if ( !lcfgresource_set_template_as_string( res, (char *) template,
+      if ( !lcfgresource_set_template_as_string( res, template,
                                                  &tmpl_msg ) ) {
         status = LCFG_STATUS_ERROR;
 
         *msg = lcfgresource_build_message( res, compname,
                                            "Invalid template '%s': %s",
-                                           (char *) template,
-                                           tmpl_msg );
+                                           template, tmpl_msg );
       }
 
       free(tmpl_msg);
 
     }
 
-    xmlFree(template);
-    template = NULL;
-
   }
 
   return status;
@@ -226,8 +184,8 @@ static LCFGStatus lcfgxml_gather_resource_attributes( xmlTextReaderPtr reader,
  * @param[in] reader Pointer to XML reader
  * @param[in] lcfgcomp Pointer to current @c LCFGComponent
  * @param[in] templates Pointer to any @c LCFGTemplate (may be @c NULL)
- * @param[out] thistag Tag name for the resource (passed back to parent)
- * @param[in] ancestor_tags An @c LCFGTagList (used to build resource name)
+ * @param[out] thistag Tag name for the resource (passed back to parent, must not be freed)
+ * @param[in] tags An @c LCFGTagStack of ancestor tags (used to build resource name)
  * @param[in] base_context A context which will be applied to the resource
  * @param[in] base_derivation A derivation which will be applied to the resource
  * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
@@ -240,8 +198,8 @@ static LCFGStatus lcfgxml_gather_resource_attributes( xmlTextReaderPtr reader,
 static LCFGStatus lcfgxml_process_record( xmlTextReaderPtr reader,
                                           LCFGComponent * lcfgcomp,
                                           const LCFGTemplate * templates,
-                                          char ** thistag,
-                                          const LCFGTagList * ancestor_tags,
+                                          const char ** thistag,
+                                          LCFGTagStack * tags,
                                           const char * base_context,
                                           const char * base_derivation,
                                           const LCFGContextList * ctxlist,
@@ -251,37 +209,34 @@ static LCFGStatus lcfgxml_process_record( xmlTextReaderPtr reader,
 
   *thistag = NULL;
 
-  int topdepth          = xmlTextReaderDepth(reader);
-  xmlChar * record_name = xmlTextReaderName(reader);
+  /* The element names are interned in the dictionary for the reader
+     so the name remains valid after the reader has moved on and
+     matching end elements can be found by pointer comparison (which
+     xmlStrEqual does first). */
+
+  int topdepth                = xmlTextReaderDepth(reader);
+  const xmlChar * record_name = xmlTextReaderConstName(reader);
 
   LCFGStatus status = LCFG_STATUS_OK;
 
   /* Process tags */
 
-  /* The current_tags list is passed as the ancestor_tags parameter
-     when calling process_resource. */
+  /* The tag for this record is pushed on to the stack whilst the
+     child resources are processed and popped again afterwards. */
 
-  LCFGTagList * current_tags = NULL; /* Created when required */
-  if ( ancestor_tags != NULL )
-    current_tags = lcfgtaglist_clone(ancestor_tags);
+  bool pushed = false;
 
   /* A record ALWAYS has a cfg:name attribute */
 
-  char * tagname = get_lcfgtagname(reader);
-  if ( tagname != NULL ) {
-    *thistag = tagname; /* Will be freed by the caller */
-
-    if ( current_tags == NULL )
-      current_tags = lcfgtaglist_new();
+  LCFGXMLAttributes attrs;
+  lcfgxml_gather_attributes( reader, &attrs );
 
-    char * tagmsg = NULL;
-    if ( lcfgtaglist_mutate_append( current_tags, tagname, &tagmsg )
-         == LCFG_CHANGE_ERROR ) {
-      status = lcfgxml_error( msg, "Failed to append to list of tags: %s", tagmsg );
-    }
-    free(tagmsg);
+  const char * tagname = get_lcfgtagname( reader, &attrs );
+  if ( tagname != NULL ) {
+    *thistag = tagname;
 
-    if ( status == LCFG_STATUS_ERROR ) goto cleanup;
+    lcfgtagstack_push( tags, tagname, strlen(tagname) );
+    pushed = true;
 
   } else {
 
@@ -302,32 +257,27 @@ static LCFGStatus lcfgxml_process_record( xmlTextReaderPtr reader,
     if ( nodedepth == topdepth + 1 ) {
       if ( nodetype == XML_READER_TYPE_ELEMENT ) {
 
-        char * child_tagname = NULL;
+        const char * child_tagname = NULL;
         status = lcfgxml_process_resource( reader, lcfgcomp,
                                            templates,
-                                           &child_tagname, current_tags,
+                                           &child_tagname, tags,
                                            base_context, base_derivation,
                                            ctxlist, msg );
 
-	free(child_tagname);
-	child_tagname = NULL;
-
       } else if ( nodetype != XML_READER_TYPE_WHITESPACE &&
                   nodetype != XML_READER_TYPE_SIGNIFICANT_WHITESPACE ) {
 
-        xmlChar * nodename  = xmlTextReaderName(reader);
+        const xmlChar * nodename = xmlTextReaderConstName(reader);
         status = lcfgxml_error( msg, "Unexpected element '%s' of type %d at line '%d' whilst processing record.", nodename, nodetype, linenum );
-        xmlFree(nodename);
-        nodename = NULL;
 
       }
 
     } else {
-      xmlChar * nodename  = xmlTextReaderName(reader);
+      const xmlChar * nodename = xmlTextReaderConstName(reader);
 
       if ( nodedepth == topdepth && nodetype == XML_READER_TYPE_END_ELEMENT ) {
 
-        if ( xmlStrcmp( nodename, record_name ) == 0 ) {
+        if ( xmlStrEqual( nodename, record_name ) ) {
           done = true; /* Successfully finished this block */
         } else {
           status = lcfgxml_error( msg, "Unexpected end element '%s' at line '%d' whilst processing record.", nodename, linenum );
@@ -337,8 +287,6 @@ static LCFGStatus lcfgxml_process_record( xmlTextReaderPtr reader,
         status = lcfgxml_error( msg, "Unexpected element '%s' of type %d at line '%d' whilst processing record.", nodename, nodetype, linenum);
       }
 
-      xmlFree(nodename);
-      nodename = NULL;
     }
 
     /* Quit if the processing if an error occurred */
@@ -352,10 +300,8 @@ static LCFGStatus lcfgxml_process_record( xmlTextReaderPtr reader,
 
  cleanup:
 
-  xmlFree(record_name);
-  record_name = NULL;
-
-  lcfgtaglist_relinquish(current_tags);
+  if ( pushed )
+    lcfgtagstack_pop(tags);
 
   if ( status == LCFG_STATUS_ERROR && *msg == NULL )
     lcfgxml_error( msg, "Something bad happened whilst processing record." );
@@ -370,8 +316,8 @@ static LCFGStatus lcfgxml_process_record( xmlTextReaderPtr reader,
  * @param[in] reader Pointer to XML reader
  * @param[in] lcfgcomp Pointer to current @c LCFGComponent
  * @param[in] templates Pointer to any @c LCFGTemplate (may be @c NULL)
- * @param[out] thistag Tag name for the resource (passed back to parent)
- * @param[in] ancestor_tags An @c LCFGTagList (used to build resource name)
+ * @param[out] thistag Tag name for the resource (passed back to parent, must not be freed)
+ * @param[in] tags An @c LCFGTagStack of ancestor tags (used to build resource name)
  * @param[in] base_context A context which will be applied to the resource
  * @param[in] base_derivation A derivation which will be applied to the resource
  * @param[in] ctxlist An @c LCFGContextList which is used to evaluate priority
@@ -384,8 +330,8 @@ static LCFGStatus lcfgxml_process_record( xmlTextReaderPtr reader,
 LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
                                      LCFGComponent * lcfgcomp,
                                      const LCFGTemplate * templates,
-                                     char ** thistag,
-                                     const LCFGTagList * ancestor_tags,
+                                     const char ** thistag,
+                                     LCFGTagStack * tags,
                                      const char * base_context,
                                      const char * base_derivation,
                                      const LCFGContextList * ctxlist,
@@ -402,43 +348,41 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
 
   const char * compname = lcfgcomponent_get_name(lcfgcomp);
 
-  int topdepth          = xmlTextReaderDepth(reader);
-  xmlChar * resnodename = xmlTextReaderName(reader);
+  /* The element name is interned in the dictionary for the reader so
+     it remains valid after the reader has moved on */
 
-  /* The resource and child_tags variables are declared here as the
-     jump to 'cleanup' could otherwise leave them undefined. */
+  int topdepth                = xmlTextReaderDepth(reader);
+  const xmlChar * resnodename = xmlTextReaderConstName(reader);
+
+  /* The resource, child_tags and pushed variables are declared here
+     as the jump to 'cleanup' could otherwise leave them undefined. */
 
   LCFGResource * resource = NULL;
   LCFGTagList * child_tags = NULL; /* Created when required */
+  bool pushed = false;
 
   LCFGStatus status = LCFG_STATUS_OK;
 
   /* Process tags */
 
-  /* The current_tags list is passed as the ancestor_tags parameter
-     when calling process_resource and process_record. */
+  /* Any tag for this resource is pushed on to the stack whilst the
+     child nodes are processed and popped again afterwards. */
 
-  LCFGTagList * current_tags = NULL; /* Created when required */
-  if ( ancestor_tags != NULL )
-    current_tags = lcfgtaglist_clone(ancestor_tags);
+  /* The attributes are gathered once, they must be used before the
+     reader is moved on to the child nodes. */
 
-  char * tagname = get_lcfgtagname(reader);
-  if ( tagname != NULL ) {
+  LCFGXMLAttributes attrs;
+  lcfgxml_gather_attributes( reader, &attrs );
 
-    if ( current_tags == NULL )
-      current_tags = lcfgtaglist_new();
+  const char * tagname = get_lcfgtagname( reader, &attrs );
+  if ( tagname != NULL ) {
 
-    char * tagmsg = NULL;
-    if ( lcfgtaglist_mutate_append( current_tags, tagname, &tagmsg )
-         == LCFG_CHANGE_ERROR ) {
-      status = lcfgxml_error( msg, "Failed to append to list of tags: %s", tagmsg );
-    }
-    free(tagmsg);
+    lcfgtagstack_push( tags, tagname, strlen(tagname) );
+    pushed = true;
 
-    if ( status == LCFG_STATUS_ERROR ) goto cleanup;
   }
 
-  resource = lcfgresource_new();
+  resource = lcfgcomponent_new_resource(lcfgcomp);
 
   /* add base context and derivation rather than set so that we take a copy */
 
@@ -460,37 +404,46 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
     }
   }
 
-  char * resname = NULL;
+  char * resname = NULL; /* Only when built from the templates */
   char * name_msg = NULL;
   bool bad_name = false;
 
+  const char * name = (const char *) resnodename;
+
   /* Any failure to set the name is deferred until AFTER the
      attributes have been gathered, this means there is a better
      chance of giving a useful diagnostic message (which hopefully
      includes derivation information). */
 
   if ( templates != NULL ) {
-    resname = lcfgresource_build_name( templates, current_tags,
-                                       (char *) resnodename,
+    resname = lcfgresource_build_name( templates, tags,
+                                       (const char *) resnodename,
                                        &name_msg );
 
     if ( resname == NULL )
       bad_name = true;
+    else
+      name = resname;
 
-  } else {
-    resname = (char *) xmlStrdup(resnodename);
   }
 
+  /* A name taken directly from the element is copied into the storage
+     for the resource rather than being duplicated first */
+
   if ( !bad_name ) {
-    if ( !lcfgresource_set_name( resource, resname ) )
+    if ( resname != NULL ) {
+      if ( !lcfgresource_set_name( resource, resname ) )
+        bad_name = true;
+    } else if ( !lcfgresource_set_name_copy( resource, name ) ) {
       bad_name = true;
+    }
   }
 
   /* Gather attributes before handling any bad name so that info such
      as the derivation is available for the error message. */
 
   LCFGStatus gather_rc =
-    lcfgxml_gather_resource_attributes( reader, resource, compname, msg );
+    lcfgxml_gather_resource_attributes( &attrs, resource, compname, msg );
 
   if ( gather_rc == LCFG_STATUS_ERROR )
     status = LCFG_STATUS_ERROR;
@@ -499,11 +452,11 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
     if ( name_msg != NULL ) {
       *msg = lcfgresource_build_message( resource, compname,
                                             "Invalid name '%s': %s",
-                                            resname, name_msg );
+                                            name, name_msg );
     } else {
       *msg = lcfgresource_build_message( resource, compname,
                                             "Invalid name '%s'",
-                                            resname );
+                                            name );
     }
 
     free(resname);
@@ -530,24 +483,23 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
            nodetype == XML_READER_TYPE_CDATA ||
            nodetype == XML_READER_TYPE_SIGNIFICANT_WHITESPACE ) {
 
-        xmlChar * nodevalue = xmlTextReaderValue(reader);
+        const char * nodevalue = (const char *) xmlTextReaderConstValue(reader);
 
         /* This is a little complicated as boolean values come in a
            variety of supported flavours so might need to be
            canonicalised before setting as the resource value */
 
         if ( lcfgresource_is_boolean(resource) &&
-             !lcfgresource_valid_boolean( (char *) nodevalue ) ) {
+             !lcfgresource_valid_boolean(nodevalue) ) {
 
-          char * canon_value =
-            lcfgresource_canon_boolean( (char *) nodevalue );
+          char * canon_value = lcfgresource_canon_boolean(nodevalue);
 
           if ( canon_value == NULL ||
                !lcfgresource_set_value( resource, canon_value ) ) {
             status = LCFG_STATUS_ERROR;
 
             *msg = lcfgresource_build_message( resource, compname,
-                          "Invalid value '%s'", (char *) nodevalue );
+                          "Invalid value '%s'", nodevalue );
 
             free(canon_value);
           }
@@ -558,32 +510,27 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
              lists get the values modified when a record is processed
              and a tag name is returned. */
 
-          if ( lcfgresource_set_value( resource, (char *) nodevalue ) ) {
-            nodevalue = NULL; /* Resource now "owns" value string */
-          } else {
+          if ( !lcfgresource_set_value_copy( resource, nodevalue ) ) {
             status = LCFG_STATUS_ERROR;
 
             *msg = lcfgresource_build_message( resource, compname,
-                       "Invalid value '%s'", (char *) nodevalue );
+                       "Invalid value '%s'", nodevalue );
           }
 
         }
 
-        xmlFree(nodevalue);
-        nodevalue = NULL;
-
       } else if ( nodetype == XML_READER_TYPE_ELEMENT ) {
 
         LCFGStatus process_rc = LCFG_STATUS_OK;
 
-        char * child_tagname = NULL;
+        const char * child_tagname = NULL;
 
-        xmlChar * nodename  = xmlTextReaderName(reader);
-        if ( lcfgutils_string_endswith( (char *) nodename, "_RECORD" ) ) {
+        const xmlChar * nodename = xmlTextReaderConstName(reader);
+        if ( lcfgutils_string_endswith( (const char *) nodename, "_RECORD" ) ) {
 
           process_rc = lcfgxml_process_record( reader, lcfgcomp,
                                                resource->template,
-                                               &child_tagname, current_tags,
+                                               &child_tagname, tags,
                                                resource->context,
                                                base_derivation, ctxlist,
                                                msg );
@@ -591,7 +538,7 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
         } else {
           process_rc = lcfgxml_process_resource( reader, lcfgcomp,
                                                  resource->template,
-                                                 &child_tagname, current_tags,
+                                                 &child_tagname, tags,
                                                  resource->context,
                                                  base_derivation, ctxlist, 
                                                  msg );
@@ -613,30 +560,23 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
 
             }
             free(tagmsg);
-
-            free(child_tagname);
-            child_tagname = NULL;
           }
 
         }
-        xmlFree(nodename);
-        nodename = NULL;
 
       } else {
 
-        xmlChar * nodename  = xmlTextReaderName(reader);
+        const xmlChar * nodename = xmlTextReaderConstName(reader);
         status = lcfgxml_error( msg, "Unexpected element '%s' of type %d at line '%d' whilst processing resource.", nodename, nodetype, linenum);
-        xmlFree(nodename);
-        nodename = NULL;
 
       }
 
     }  else {
-      xmlChar * nodename  = xmlTextReaderName(reader);
+      const xmlChar * nodename = xmlTextReaderConstName(reader);
 
       if ( nodedepth == topdepth && nodetype == XML_READER_TYPE_END_ELEMENT ) {
 
-        if ( xmlStrcmp( nodename, resnodename ) == 0 ) {
+        if ( xmlStrEqual( nodename, resnodename ) ) {
           done = true; /* Successfully finished this block */
         } else {
           status = lcfgxml_error( msg, "Unexpected end element '%s' at line '%d' whilst processing resource.", nodename, linenum );
@@ -647,8 +587,6 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
 
       }
 
-      xmlFree(nodename);
-      nodename = NULL;
     }
 
     /* Quit if the processing status is no longer OK */
@@ -660,9 +598,6 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
 
   }
 
-  xmlFree(resnodename);
-  resnodename = NULL;
-
   /* If processing was successful then assemble the list of child tags
      into a single string and set it as the parent resource value. */
 
@@ -720,7 +655,6 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
            something with higher priority */
 
         *thistag = tagname;
-        tagname = NULL; /* Will be freed by the caller */
       }
 
       free(merge_msg);
@@ -729,9 +663,9 @@ LCFGStatus lcfgxml_process_resource( xmlTextReaderPtr reader,
 
  cleanup:
 
-  free(tagname);
+  if ( pushed )
+    lcfgtagstack_pop(tags);
 
-  lcfgtaglist_relinquish(current_tags);
   lcfgtaglist_relinquish(child_tags);
 
   if ( status == LCFG_STATUS_ERROR && *msg == NULL ) {